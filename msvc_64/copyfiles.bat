@@ -31,6 +31,7 @@ rem Section 2.1) Copy Qt files
 rem Note: Qt5WebEngine deployment is super crazy - see https://doc.qt.io/qt-5.12/qtwebengine-deploying.html
 copy %QMSI_QT_PATH%\bin\assistant.exe
 copy %QMSI_QT_PATH%\bin\Qt5Core.dll
+copy %QMSI_QT_PATH%\bin\Qt5Concurrent.dll
 copy %QMSI_QT_PATH%\bin\Qt5Gui.dll
 copy %QMSI_QT_PATH%\bin\Qt5Help.dll
 copy %QMSI_QT_PATH%\bin\Qt5Multimedia.dll
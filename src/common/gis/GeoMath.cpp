@@ -22,12 +22,20 @@
 #include "units/IUnit.h"
 #include <stdlib.h>
 
+#include <functional>
+#include <queue>
+#include <QtConcurrent>
 #include <QtGui>
 #include <QtWidgets>
 
 #define PI M_PI
 #define TWOPI (2 * PI)
 
+/// segments with less points are not worth to be processed in a thread of their own
+#define DP_MIN_PARALLEL 10000
+/// number of distances computed in one go by the Douglas Peucker kernel
+#define DP_BLOCK 256
+
 pointDP::pointDP() : used(true), idx(NOIDX)
 {
 }
@@ -207,38 +215,6 @@ qreal GPS_Math_DistanceQuick(const qreal u1, const qreal v1, const qreal u2, con
 }
 
 
-static qreal GPS_Math_distPointLine3D(const point3D &x1, const point3D &x2, const point3D &x0)
-{
-    point3D v1, v2, v3, v1x2;
-
-    // (x0 - x1)
-    v1.x = x0.x - x1.x;
-    v1.y = x0.y - x1.y;
-    v1.z = x0.z - x1.z;
-
-    // (x0 - x2)
-    v2.x = x0.x - x2.x;
-    v2.y = x0.y - x2.y;
-    v2.z = x0.z - x2.z;
-
-    // (x2 - x1)
-    v3.x = x2.x - x1.x;
-    v3.y = x2.y - x1.y;
-    v3.z = x2.z - x1.z;
-
-    // (x0 - x1)x(x0 - x2)
-    v1x2.x  = v1.y * v2.z - v1.z * v2.y;
-    v1x2.y  = v1.z * v2.x - v1.x * v2.z;
-    v1x2.z  = v1.x * v2.y - v1.y * v2.x;
-
-    // |(x0 - x1)x(x0 - x2)|
-    qreal a1x2    = v1x2.x * v1x2.x + v1x2.y * v1x2.y + v1x2.z * v1x2.z;
-    // |(x2 - x1)|
-    qreal a3      = v3.x * v3.x + v3.y * v3.y + v3.z * v3.z;
-
-    return qSqrt(a1x2 / a3);
-}
-
 static inline qreal sqr(qreal a)
 {
     return a * a;
@@ -346,41 +322,188 @@ struct segment
     qint32 idx2;
 };
 
-void GPS_Math_DouglasPeucker(QVector<pointDP> &line, qreal d)
+/// the line's coordinates as separate arrays to keep the distance kernel vectorizable
+struct lineDP
 {
-    if(line.count() < 3)
+    const qreal* x;
+    const qreal* y;
+    const qreal* z;
+    pointDP* pts;
+};
+
+/**
+   @brief Compute |(x0 - x1)x(x0 - x2)|^2 for n points starting at i0
+
+   The loop has no branch, no square root and no division and writes to a
+   local buffer only. With a constant n the compiler vectorizes it at -O2, too.
+ */
+static inline void GPS_Math_DouglasPeuckerDistances(const lineDP& line, qint32 i0, qint32 n, const point3D& p1, const point3D& p2, qreal* dist)
+{
+    const qreal* x = line.x + i0;
+    const qreal* y = line.y + i0;
+    const qreal* z = line.z + i0;
+
+    for(qint32 k = 0; k < n; k++)
     {
-        return;
+        const qreal v1x = x[k] - p1.x;
+        const qreal v1y = y[k] - p1.y;
+        const qreal v1z = z[k] - p1.z;
+        const qreal v2x = x[k] - p2.x;
+        const qreal v2y = y[k] - p2.y;
+        const qreal v2z = z[k] - p2.z;
+
+        const qreal cx = v1y * v2z - v1z * v2y;
+        const qreal cy = v1z * v2x - v1x * v2z;
+        const qreal cz = v1x * v2y - v1y * v2x;
+
+        dist[k] = cx * cx + cy * cy + cz * cz;
     }
+}
 
-    QStack<segment> stack;
-    stack << segment(0, line.size() - 1);
+/**
+   @brief Find the point of a segment with the largest distance to the line between it's end points
 
-    while(!stack.isEmpty())
-    {
-        qint32 idx = NOIDX;
-        segment seg = stack.pop();
+   The distance is compared squared and multiplied by the length of the
+   line instead of dividing by it. The distances are computed block wise
+   into a buffer first. The search for the maximum is a separate pass over
+   the buffer, as it's data dependent update of the index would prevent
+   the vectorization of the distance computation.
+
+   @return The index of the point or NOIDX if all points are closer than sqrt(d2).
+ */
+static qint32 GPS_Math_DouglasPeuckerFarthest(const lineDP& line, const segment& seg, qreal d2)
+{
+    const qreal* x = line.x;
+    const qreal* y = line.y;
+    const qreal* z = line.z;
+
+    const point3D p1(x[seg.idx1], y[seg.idx1], z[seg.idx1]);
+    const point3D p2(x[seg.idx2], y[seg.idx2], z[seg.idx2]);
 
-        pointDP& x1 = line[seg.idx1];
-        pointDP& x2 = line[seg.idx2];
+    // |(x2 - x1)|^2
+    const qreal a3 = (p2.x - p1.x) * (p2.x - p1.x) + (p2.y - p1.y) * (p2.y - p1.y) + (p2.z - p1.z) * (p2.z - p1.z);
 
-        qreal dmax = d;
+    qint32 idx = NOIDX;
+    if(a3 == 0)
+    {
+        // a closed loop, use the distance to the end point
+        qreal dmax = d2;
         for(qint32 i = seg.idx1 + 1; i < seg.idx2; i++)
         {
-            qreal distance = GPS_Math_distPointLine3D(x1, x2, line[i]);
-            if(distance > dmax)
+            const qreal dist = (x[i] - p1.x) * (x[i] - p1.x) + (y[i] - p1.y) * (y[i] - p1.y) + (z[i] - p1.z) * (z[i] - p1.z);
+            if(dist > dmax)
             {
                 idx  = i;
-                dmax = distance;
+                dmax = dist;
+            }
+        }
+        return idx;
+    }
+
+    // |(x0 - x1)x(x0 - x2)|^2 > d^2 * |(x2 - x1)|^2
+    qreal dmax = d2 * a3;
+    qreal dist[DP_BLOCK];
+    for(qint32 i0 = seg.idx1 + 1; i0 < seg.idx2; i0 += DP_BLOCK)
+    {
+        const qint32 n = qMin(DP_BLOCK, seg.idx2 - i0);
+        if(n == DP_BLOCK)
+        {
+            // the constant trip count lets the compiler vectorize the full blocks
+            GPS_Math_DouglasPeuckerDistances(line, i0, DP_BLOCK, p1, p2, dist);
+        }
+        else
+        {
+            GPS_Math_DouglasPeuckerDistances(line, i0, n, p1, p2, dist);
+        }
+
+        for(qint32 k = 0; k < n; k++)
+        {
+            if(dist[k] > dmax)
+            {
+                idx  = i0 + k;
+                dmax = dist[k];
             }
         }
+    }
+
+    return idx;
+}
+
+static void GPS_Math_DouglasPeuckerSegment(const lineDP& line, const segment& start, qreal d2)
+{
+    QStack<segment> stack;
+    stack << start;
 
-        if(idx > 0)
+    while(!stack.isEmpty())
+    {
+        const segment seg = stack.pop();
+        const qint32 idx = GPS_Math_DouglasPeuckerFarthest(line, seg, d2);
+
+        if(idx != NOIDX)
         {
             stack << segment(seg.idx1, idx);
             stack << segment(idx, seg.idx2);
         }
         else
+        {
+            for(qint32 i = seg.idx1 + 1; i < seg.idx2; i++)
+            {
+                line.pts[i].used = false;
+            }
+        }
+    }
+}
+
+void GPS_Math_DouglasPeucker(QVector<pointDP> &line, qreal d)
+{
+    const qint32 N = line.count();
+    if(N < 3)
+    {
+        return;
+    }
+
+    QVector<qreal> x(N);
+    QVector<qreal> y(N);
+    QVector<qreal> z(N);
+    for(qint32 i = 0; i < N; i++)
+    {
+        const pointDP& pt = line[i];
+        x[i] = pt.x;
+        y[i] = pt.y;
+        z[i] = pt.z;
+    }
+
+    // detach the line before the threads write to it
+    const lineDP data = {x.constData(), y.constData(), z.constData(), line.data()};
+    const qreal d2 = d * d;
+
+    /*
+        Once a segment is split both parts are independent of each other. Split
+        the line breadth first until there are enough segments to keep all
+        cores busy. Small segments are not split any further as they are not
+        worth the overhead of a thread.
+     */
+    const qint32 maxSegments = QThread::idealThreadCount() * 4;
+    QVector<segment> segments;
+    QQueue<segment> queue;
+    queue << segment(0, N - 1);
+
+    while(!queue.isEmpty() && (queue.count() + segments.count()) < maxSegments)
+    {
+        const segment seg = queue.dequeue();
+        if((seg.idx2 - seg.idx1) < DP_MIN_PARALLEL)
+        {
+            segments << seg;
+            continue;
+        }
+
+        const qint32 idx = GPS_Math_DouglasPeuckerFarthest(data, seg, d2);
+        if(idx != NOIDX)
+        {
+            queue << segment(seg.idx1, idx);
+            queue << segment(idx, seg.idx2);
+        }
+        else
         {
             for(qint32 i = seg.idx1 + 1; i < seg.idx2; i++)
             {
@@ -388,6 +511,106 @@ void GPS_Math_DouglasPeucker(QVector<pointDP> &line, qreal d)
             }
         }
     }
+    segments += queue.toVector();
+
+    QtConcurrent::blockingMap(segments, [&data, d2](const segment& seg)
+    {
+        GPS_Math_DouglasPeuckerSegment(data, seg, d2);
+    });
+}
+
+void GPS_Math_VisvalingamWhyatt(QVector<pointDP> &line, qreal area)
+{
+    const qint32 N = line.count();
+    if(N < 3)
+    {
+        return;
+    }
+
+    // the remaining points as double linked list
+    QVector<qint32> prev(N);
+    QVector<qint32> next(N);
+    for(qint32 i = 0; i < N; i++)
+    {
+        prev[i] = i - 1;
+        next[i] = i + 1;
+    }
+
+    // the effective area of a point is the area of the triangle with it's remaining neighbours
+    auto effectiveArea = [&line, &prev, &next](qint32 i) -> qreal
+    {
+        const pointDP& p0 = line[prev[i]];
+        const pointDP& p1 = line[i];
+        const pointDP& p2 = line[next[i]];
+
+        const qreal v1x = p1.x - p0.x;
+        const qreal v1y = p1.y - p0.y;
+        const qreal v1z = p1.z - p0.z;
+        const qreal v2x = p2.x - p0.x;
+        const qreal v2y = p2.y - p0.y;
+        const qreal v2z = p2.z - p0.z;
+
+        const qreal cx = v1y * v2z - v1z * v2y;
+        const qreal cy = v1z * v2x - v1x * v2z;
+        const qreal cz = v1x * v2y - v1y * v2x;
+
+        return 0.5 * qSqrt(cx * cx + cy * cy + cz * cz);
+    };
+
+    /*
+        The heap is not updated when the area of a point changes. Instead a
+        new entry is added. Outdated entries are detected by comparing them
+        with the point's current area and skipped.
+     */
+    typedef QPair<qreal, qint32> entry_t;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t> > heap;
+
+    QVector<qreal> areas(N, 0);
+    QVector<bool> removed(N, false);
+    for(qint32 i = 1; i < N - 1; i++)
+    {
+        areas[i] = effectiveArea(i);
+        heap.push(entry_t(areas[i], i));
+    }
+
+    while(!heap.empty())
+    {
+        const entry_t entry = heap.top();
+        heap.pop();
+
+        const qint32 i = entry.second;
+        if(removed[i] || entry.first != areas[i])
+        {
+            continue;
+        }
+
+        if(entry.first >= area)
+        {
+            break;
+        }
+
+        removed[i] = true;
+        line[i].used = false;
+
+        const qint32 i0 = prev[i];
+        const qint32 i2 = next[i];
+        next[i0] = i2;
+        prev[i2] = i0;
+
+        // a neighbour's area must not be smaller than the one of the point
+        // just removed. Else it would be removed before points that have been
+        // removed already.
+        for(qint32 j : {i0, i2})
+        {
+            if((j == 0) || (j == N - 1))
+            {
+                continue;
+            }
+
+            areas[j] = qMax(entry.first, effectiveArea(j));
+            heap.push(entry_t(areas[j], j));
+        }
+    }
 }
 
 
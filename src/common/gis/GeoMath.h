@@ -56,7 +56,10 @@ qreal   GPS_Math_Distance(const qreal u1, const qreal v1, const qreal u2, const
 qreal   GPS_Math_Distance(const qreal u1, const qreal v1, const qreal u2, const qreal v2);
 /// use for short distances, much quicker processing
 qreal   GPS_Math_DistanceQuick(const qreal u1, const qreal v1, const qreal u2, const qreal v2);
+/// mark all points closer than d to the simplified line as unused, the line is processed in parallel
 void    GPS_Math_DouglasPeucker(QVector<pointDP>& line, qreal d);
+/// mark all points with an effective triangle area smaller than area as unused
+void    GPS_Math_VisvalingamWhyatt(QVector<pointDP>& line, qreal area);
 QPointF GPS_Math_Wpt_Projection(const QPointF& pt1, qreal distance, qreal bearing);
 bool    GPS_Math_LineCrossesRect(const QPointF& p1, const QPointF& p2, const QRectF& rect);
 qreal   GPS_Math_DistPointPolyline(const QPolygonF &points, const QPointF &q);
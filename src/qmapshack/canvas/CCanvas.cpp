@@ -1252,6 +1252,16 @@ bool CCanvas::findPolylineCloseBy(const QPointF& pt1, const QPointF& pt2, qint32
     return map->findPolylineCloseBy(pt1, pt2, threshold, polyline);
 }
 
+void CCanvas::seedMapCache(const QRectF& area)
+{
+    map->seedCache(area);
+}
+
+void CCanvas::seedMapCache(const QPolygonF& line, qreal width)
+{
+    map->seedCache(line, width);
+}
+
 void CCanvas::saveSizeTrackProfile()
 {
     if(plotTrackProfile.isNull())
@@ -1345,34 +1355,51 @@ void CCanvas::print(QPainter& p, const QRectF& area, const QPointF& focus, bool
     const QSize oldSize = size();
     const QSize newSize(area.size().toSize());
 
-    setDrawContextSize(newSize);
+    startPrintTile(newSize, focus);
+    finishPrintTile(p, newSize, focus, printScale);
 
-    // ----- start to draw thread based content -----
-    // move coordinate system to center of the screen
-    p.translate(newSize.width() >> 1, newSize.height() >> 1);
+    setDrawContextSize(oldSize);
+}
+
+void CCanvas::startPrintTile(const QSize& size, const QPointF& focus)
+{
+    // a draw context still busy with the last tile refuses to resize
+    for(IDrawContext* context : qAsConst(allDrawContext))
+    {
+        context->wait();
+    }
+    setDrawContextSize(size);
 
-    redraw_e redraw = eRedrawAll;
+    // the draw contexts need a painter to show their last buffer. As that
+    // buffer is of no interest a small dummy image will do.
+    QImage dummy(1, 1, QImage::Format_ARGB32);
+    QPainter p(&dummy);
 
     for(IDrawContext* context : qAsConst(allDrawContext))
     {
-        context->draw(p, redraw, focus);
+        context->draw(p, eRedrawAll, focus);
     }
+}
 
+void CCanvas::finishPrintTile(QPainter& p, const QSize& size, const QPointF& focus, bool printScale)
+{
+    // ----- start to draw thread based content -----
     for(IDrawContext* context : qAsConst(allDrawContext))
     {
         context->wait();
     }
 
+    p.save();
+    // move coordinate system to center of the screen
+    p.translate(size.width() >> 1, size.height() >> 1);
     for(IDrawContext* context : qAsConst(allDrawContext))
     {
-        context->draw(p, redraw, focus);
+        context->draw(p, eRedrawNone, focus);
     }
+    p.restore();
 
-    // restore coordinate system to default
-    p.resetTransform();
     // ----- start to draw fast content -----
-
-    QRect r(QPoint(0, 0), area.size().toSize());
+    QRect r(QPoint(0, 0), size);
 
     grid->draw(p, r);
     gis->draw(p, r);
@@ -1381,8 +1408,14 @@ void CCanvas::print(QPainter& p, const QRectF& area, const QPointF& focus, bool
     {
         drawScale(p, r);
     }
+}
 
-    setDrawContextSize(oldSize);
+void CCanvas::printScale(QPainter& p, const QRectF& area)
+{
+    p.save();
+    p.translate(-area.topLeft());
+    drawScale(p, area);
+    p.restore();
 }
 
 bool CCanvas::event(QEvent* event)
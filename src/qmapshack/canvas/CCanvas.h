@@ -170,8 +170,49 @@ public:
      */
     bool findPolylineCloseBy(const QPointF& pt1, const QPointF& pt2, qint32 threshold, QPolygonF& polyline);
 
+    /**
+       @brief Download the tiles of all active online maps covering an area for offline use
+
+       @param area          the area in [rad]
+     */
+    void seedMapCache(const QRectF& area);
+    /**
+       @brief Download the tiles of all active online maps along a track or route for offline use
+
+       @param line          the line's points in [rad]
+       @param width         the corridor's width to each side of the line in [m]
+     */
+    void seedMapCache(const QPolygonF& line, qreal width);
+
     void print(QPainter& p, const QRectF& area, const QPointF& focus, bool printScale = true);
 
+    /**
+       @brief Start the draw context threads to render a print tile
+
+       This returns immediately. Several canvases can render their tiles
+       in parallel this way. Call finishPrintTile() to get the result.
+
+       @param size      the tile's size in [pixel]
+       @param focus     the tile's center in [rad]
+     */
+    void startPrintTile(const QSize& size, const QPointF& focus);
+    /**
+       @brief Wait for the tile started by startPrintTile() and draw it
+
+       @param p             the painter to draw the tile to, the tile is drawn at 0,0
+       @param size          the tile's size in [pixel], as passed to startPrintTile()
+       @param focus         the tile's center in [rad], as passed to startPrintTile()
+       @param printScale    set true to draw the scale into the bottom right corner
+     */
+    void finishPrintTile(QPainter& p, const QSize& size, const QPointF& focus, bool printScale);
+    /**
+       @brief Draw the scale into the bottom right corner of an area
+
+       @param p     the painter with the origin at the area's top left corner
+       @param area  the area in [pixel] of this canvas
+     */
+    void printScale(QPainter& p, const QRectF& area);
+
     /**
        @brief Set a single map file to be shown on the canvas
 
@@ -62,6 +62,7 @@
 #include "helpers/CSettings.h"
 #include "helpers/CWptIconManager.h"
 #include "setup/IAppSetup.h"
+#include "units/IUnit.h"
 
 #include <QApplication>
 #include <QtSql>
@@ -147,11 +148,15 @@ CGisListWks::CGisListWks(QWidget* parent)
     actionEditTrk = addAction(QIcon("://icons/32x32/LineMove.png"), tr("Edit Track Points"), this, &CGisListWks::slotEditTrk);
     actionReverseTrk = addAction(QIcon("://icons/32x32/Reverse.png"), tr("Reverse Track"), this, &CGisListWks::slotReverseTrk);
     actionCombineTrk = addAction(QIcon("://icons/32x32/Combine.png"), tr("Combine Tracks"), this, &CGisListWks::slotCombineTrk);
+    actionReducePointsTrk = addAction(QIcon("://icons/32x32/PointHide.png"), tr("Hide Points (Douglas Peuker)..."), this, &CGisListWks::slotReducePointsTrk);
+    actionSmoothProfileTrk = addAction(QIcon("://icons/32x32/SetEle.png"), tr("Smooth Profile (Median)..."), this, &CGisListWks::slotSmoothProfileTrk);
+    actionZeroSpeedDriftTrk = addAction(QIcon("://icons/32x32/PointHide.png"), tr("Hide Zero Speed Drift..."), this, &CGisListWks::slotZeroSpeedDriftTrk);
     actionEleWptTrk = addAction(QIcon("://icons/32x32/SetEle.png"), tr("Replace Elevation by DEM"), this, &CGisListWks::slotEleWptTrk);
     actionCopyTrkWithWpt = addAction(QIcon("://icons/32x32/CopyTrkWithWpt.png"), tr("Copy Track with Waypoints"), this, &CGisListWks::slotCopyTrkWithWpt);
     actionToRoute = addAction(QIcon("://icons/32x32/Route.png"), tr("Convert to Route"), this, &CGisListWks::slotToRoute);
     actionNogoTrk = addAction(QIcon("://icons/32x32/NoGo.png"), tr("Toggle Nogo-Line"), this, &CGisListWks::slotNogoItem);
     actionNogoTrk->setCheckable(true);
+    actionSeedCacheTrk = addAction(QIcon("://icons/32x32/Map.png"), tr("Seed Online Map Cache..."), this, &CGisListWks::slotSeedCacheItem);
 
     // waypoint related actions
     actionBubbleWpt = addAction(QIcon("://icons/32x32/Bubble.png"), tr("Show Bubble"), this, &CGisListWks::slotBubbleWpt);
@@ -174,6 +179,7 @@ CGisListWks::CGisListWks(QWidget* parent)
     actionRte2Trk = addAction(QIcon("://icons/32x32/Track.png"), tr("Convert to Track"), this, &CGisListWks::slotRte2Trk);
     actionNogoRte = addAction(QIcon("://icons/32x32/NoGo.png"), tr("Toggle Nogo-Line"), this, &CGisListWks::slotNogoItem);
     actionNogoRte->setCheckable(true);
+    actionSeedCacheRte = addAction(QIcon("://icons/32x32/Map.png"), tr("Seed Online Map Cache..."), this, &CGisListWks::slotSeedCacheItem);
 
     // area related actions
     actionEditArea = addAction(QIcon("://icons/32x32/AreaMove.png"), tr("Edit Area Points"), this, &CGisListWks::slotEditArea);
@@ -1061,6 +1067,7 @@ void CGisListWks::showMenuItemTrk(const QPoint& p, const IGisItem::key_t& key)
     menu.addAction(actionCopyTrkWithWpt);
     menu.addAction(actionToRoute);
     menu.addAction(actionNogoTrk);
+    menu.addAction(actionSeedCacheTrk);
     menu.addSeparator();
     menu.addAction(actionDelete);
     menu.exec(p);
@@ -1107,6 +1114,7 @@ void CGisListWks::showMenuItemRte(const QPoint& p)
     menu.addAction(actionReverseRte);
     menu.addAction(actionRte2Trk);
     menu.addAction(actionNogoRte);
+    menu.addAction(actionSeedCacheRte);
     menu.addSeparator();
     menu.addAction(actionDelete);
     menu.exec(p);
@@ -1145,6 +1153,9 @@ void CGisListWks::showMenuItem(const QPoint& p, const QList<IGisItem::key_t>& ke
     menu.addAction(actionEleWptTrk);
     menu.addSection(tr("Tracks"));
     menu.addAction(actionCombineTrk);
+    menu.addAction(actionReducePointsTrk);
+    menu.addAction(actionSmoothProfileTrk);
+    menu.addAction(actionZeroSpeedDriftTrk);
     action = menu.addMenu(CActivityTrk::getMenu(keysTrks, &menu));
     action->setEnabled(!keysTrks.isEmpty());
     action = menu.addMenu(IGisItem::getColorMenu(tr("Set Track Color"), this, SLOT(slotColorTrk()), &menu));
@@ -1224,6 +1235,7 @@ void CGisListWks::slotContextMenu(const QPoint& point)
         {
             QList<IGisItem::key_t> keysTrk;
             QList<IGisItem::key_t> keysWpt;
+            bool hasEditableTrks = false;
 
             const QList<QTreeWidgetItem*>& items = selectedItems();
             for(QTreeWidgetItem* item : items)
@@ -1232,6 +1244,7 @@ void CGisListWks::slotContextMenu(const QPoint& point)
                 if(trk != nullptr)
                 {
                     keysTrk << trk->getKey();
+                    hasEditableTrks |= !trk->isReadOnly();
                 }
 
                 CGisItemWpt* wpt = dynamic_cast<CGisItemWpt*>(item);
@@ -1247,6 +1260,9 @@ void CGisListWks::slotContextMenu(const QPoint& point)
             actionRteFromWpt->setEnabled(keysWpt.count() > 1);
             actionEditPrxWpt->setEnabled(hasWpts);
             actionCombineTrk->setEnabled(keysTrk.count() > 1);
+            actionReducePointsTrk->setEnabled(hasEditableTrks);
+            actionSmoothProfileTrk->setEnabled(hasEditableTrks);
+            actionZeroSpeedDriftTrk->setEnabled(hasEditableTrks);
             actionEleWptTrk->setEnabled(hasWpts | hasTrks);
             showMenuItem(p, keysTrk, keysWpt);
             return;
@@ -1723,6 +1739,45 @@ void CGisListWks::slotNogoItem()
     }
 }
 
+void CGisListWks::slotSeedCacheItem()
+{
+    QPolygonF line;
+    {
+        CGisListWksEditLock lock(false, IGisItem::mutexItems);
+
+        IGisLine* gisLine = dynamic_cast<IGisLine*>(currentItem());
+        if(gisLine == nullptr)
+        {
+            return;
+        }
+        gisLine->getPolylineDegFromData(line);
+    }
+
+    CCanvas* canvas = CMainWindow::self().getVisibleCanvas();
+    if(line.isEmpty() || (canvas == nullptr))
+    {
+        return;
+    }
+
+    SETTINGS;
+    bool ok = false;
+    qreal width = QInputDialog::getDouble(this, tr("Seed Online Map Cache..."), tr("Width of the corridor on each side of the line (%1):").arg(IUnit::self().baseUnit),
+                                          cfg.value("Map/seedCorridor", 500).toDouble() * IUnit::self().baseFactor, 1, 100000, 0, &ok);
+    if(!ok)
+    {
+        return;
+    }
+    width /= IUnit::self().baseFactor;
+    cfg.setValue("Map/seedCorridor", width);
+
+    for(QPointF& pt : line)
+    {
+        pt *= DEG_TO_RAD;
+    }
+
+    canvas->seedMapCache(line, width);
+}
+
 void CGisListWks::slotDelRadiusWpt()
 {
     CGisListWksEditLock lock(false, IGisItem::mutexItems);
@@ -1857,6 +1912,75 @@ void CGisListWks::slotColorTrk()
     }
 }
 
+QList<CGisItemTrk*> CGisListWks::selectedTracks()
+{
+    CGisListWksEditLock lock(false, IGisItem::mutexItems);
+
+    QList<CGisItemTrk*> trks;
+    const QList<QTreeWidgetItem*>& items = selectedItems();
+    for(QTreeWidgetItem* item : items)
+    {
+        CGisItemTrk* trk = dynamic_cast<CGisItemTrk*>(item);
+        if((trk != nullptr) && !trk->isReadOnly())
+        {
+            trks << trk;
+        }
+    }
+    return trks;
+}
+
+void CGisListWks::slotReducePointsTrk()
+{
+    SETTINGS;
+    bool ok = false;
+    qreal dist = QInputDialog::getDouble(this, tr("Hide Points..."), tr("Max. distance to the simplified track (%1):").arg(IUnit::self().baseUnit),
+                                         cfg.value("TrackDetails/Filter/DouglasPeuker/distance", 5).toInt(), 0, 10000, 0, &ok);
+    if(!ok)
+    {
+        return;
+    }
+    cfg.setValue("TrackDetails/Filter/DouglasPeuker/distance", qRound(dist));
+
+    CGisItemTrk::filterReducePoints(selectedTracks(), dist / IUnit::self().baseFactor, CGisItemTrk::eReduceDouglasPeuker);
+}
+
+void CGisListWks::slotSmoothProfileTrk()
+{
+    SETTINGS;
+    bool ok = false;
+    qint32 points = QInputDialog::getInt(this, tr("Smooth Profile..."), tr("Number of points used for the median:"),
+                                         cfg.value("TrackDetails/Filter/Median/points", 5).toInt(), 5, 9, 2, &ok);
+    if(!ok)
+    {
+        return;
+    }
+    cfg.setValue("TrackDetails/Filter/Median/points", points);
+
+    CGisItemTrk::filterSmoothProfile(selectedTracks(), points);
+}
+
+void CGisListWks::slotZeroSpeedDriftTrk()
+{
+    SETTINGS;
+    bool ok = false;
+    qreal distance = QInputDialog::getDouble(this, tr("Hide Zero Speed Drift..."), tr("Min. distance between points (%1):").arg(IUnit::self().baseUnit),
+                                             cfg.value("TrackDetails/Filter/ZeroSpeedDriftCleaner/distance", 0.75 * IUnit::self().baseFactor).toDouble() * IUnit::self().baseFactor, 0.01, 100, 2, &ok);
+    if(!ok)
+    {
+        return;
+    }
+
+    qreal ratio = QInputDialog::getDouble(this, tr("Hide Zero Speed Drift..."), tr("Max. ratio between path and direct distance:"),
+                                          cfg.value("TrackDetails/Filter/ZeroSpeedDriftCleaner/ratio", 2).toDouble(), 2, 100, 2, &ok);
+    if(!ok)
+    {
+        return;
+    }
+    cfg.setValue("TrackDetails/Filter/ZeroSpeedDriftCleaner/distance", distance / IUnit::self().baseFactor);
+    cfg.setValue("TrackDetails/Filter/ZeroSpeedDriftCleaner/ratio", ratio);
+
+    CGisItemTrk::filterZeroSpeedDriftCleaner(selectedTracks(), distance / IUnit::self().baseFactor, ratio);
+}
 
 void CGisListWks::slotRangeTrk()
 {
@@ -34,6 +34,7 @@ class IGisProject;
 class CDBProject;
 class IDeviceWatcher;
 class QActionGroup;
+class CGisItemTrk;
 
 class CGisListWks : public QTreeWidget
 {
@@ -93,6 +94,7 @@ private slots:
     void slotDeleteItem();
     void slotBubbleWpt();
     void slotNogoItem();
+    void slotSeedCacheItem();
     void slotDelRadiusWpt();
     void slotEditRadiusWpt();
     void slotProjWpt();
@@ -105,6 +107,9 @@ private slots:
     void slotRangeTrk();
     void slotActivityTrk(trkact_t act);
     void slotColorTrk();
+    void slotReducePointsTrk();
+    void slotSmoothProfileTrk();
+    void slotZeroSpeedDriftTrk();
     void slotCopyTrkWithWpt();
     void slotFocusRte(bool on);
     void slotCalcRte();
@@ -160,6 +165,8 @@ private:
     void showMenuItemRte(const QPoint& p);
     void showMenuItemOvl(const QPoint& p);
     void showMenuItem(const QPoint& p, const QList<IGisItem::key_t>& keysTrks, const QList<IGisItem::key_t>& keysWpts);
+    /// collect all selected tracks that are not read-only
+    QList<CGisItemTrk*> selectedTracks();
 
     void syncPrjToDevices(IGisProject* project, const QSet<QString>& keys);
     QSet<QString> getAllDeviceKeys() const;
@@ -217,14 +224,19 @@ private:
     QAction* actionEditTrk;
     QAction* actionReverseTrk;
     QAction* actionCombineTrk;
+    QAction* actionReducePointsTrk;
+    QAction* actionSmoothProfileTrk;
+    QAction* actionZeroSpeedDriftTrk;
     QAction* actionRangeTrk;
     QAction* actionNogoTrk;
+    QAction* actionSeedCacheTrk;
     QAction* actionCopyTrkWithWpt;
     QAction* actionFocusRte;
     QAction* actionCalcRte;
     QAction* actionResetRte;
     QAction* actionEditRte;
     QAction* actionNogoRte;
+    QAction* actionSeedCacheRte;
     QAction* actionReverseRte;
     QAction* actionRte2Trk;
     QAction* actionEditArea;
@@ -40,6 +40,7 @@
 #include "gis/tcx/CTcxProject.h"
 #include "gis/trk/CGisItemTrk.h"
 #include "gis/wpt/CGisItemWpt.h"
+#include "helpers/CDraw.h"
 #include "helpers/CProgressDialog.h"
 #include "helpers/CSelectCopyAction.h"
 #include "helpers/CSettings.h"
@@ -47,6 +48,13 @@
 
 #include <QtWidgets>
 
+/// waypoints on the screen up to this number are never grouped
+#define CLUSTER_MIN_WPTS    200
+/// the grid size to group waypoints [px]
+#define CLUSTER_CELL_SIZE   48
+/// the grid size of the waypoint index [rad]
+#define WPT_INDEX_CELL_SIZE (0.01 * DEG_TO_RAD)
+
 
 const QString IGisProject::filedialogAllSupported = "All Supported (*.gpx *.GPX *.tcx *.TCX *.sml *.log *.qms *.qlb *.slf *.fit)";
 const QString IGisProject::filedialogFilterGPX = "GPS Exchange Format (*.gpx *.GPX)";
@@ -331,6 +339,7 @@ void IGisProject::setChanged()
         }
     }
     updateDecoration(false);
+    invalidateWptIndex();
     updateItems();
 }
 
@@ -367,6 +376,8 @@ void IGisProject::updateItems()
         return;
     }
 
+    invalidateWptIndex();
+
     sortItems();
     updateItemCounters();
 
@@ -890,11 +901,12 @@ void IGisProject::drawItem(QPainter& p, const QPolygonF& viewport, QList<QRectF>
         return;
     }
 
+    QList<CGisItemWpt*> wpts;
     for(int i = 0; i < childCount(); i++)
     {
         if(gis->needsRedraw())
         {
-            break;
+            return;
         }
 
         IGisItem* item = dynamic_cast<IGisItem*>(child(i));
@@ -903,8 +915,198 @@ void IGisProject::drawItem(QPainter& p, const QPolygonF& viewport, QList<QRectF>
             continue;
         }
 
+        if(item->type() == IGisItem::eTypeWpt)
+        {
+            CGisItemWpt* wpt = static_cast<CGisItemWpt*>(item);
+            if(wpt->isClusterable())
+            {
+                wpts << wpt;
+                continue;
+            }
+        }
+
         item->drawItem(p, viewport, blockedAreas, gis);
     }
+
+    drawWaypoints(p, viewport, blockedAreas, gis, wpts);
+}
+
+void IGisProject::drawWaypoints(QPainter& p, const QPolygonF& viewport, QList<QRectF>& blockedAreas, CGisDraw* gis, const QList<CGisItemWpt*>& wpts)
+{
+    if(wpts.isEmpty())
+    {
+        return;
+    }
+
+    QPolygonF tmp = viewport;
+    gis->convertRad2Px(tmp);
+    const QRectF& extViewport = tmp.boundingRect();
+
+    // project only the waypoints in the viewport, all others are reset
+    const QSet<const CGisItemWpt*>& inside = findWaypoints(viewport.boundingRect(), wpts);
+
+    QVector<qint32> visible;
+    QPolygonF pos(wpts.count());
+    for(int i = 0; i < wpts.count(); i++)
+    {
+        if(inside.contains(wpts[i]))
+        {
+            visible << i;
+            pos[i] = wpts[i]->getPosition() * DEG_TO_RAD;
+            gis->convertRad2Px(pos[i]);
+        }
+        else
+        {
+            wpts[i]->drawIcon(p, NOPOINTF, blockedAreas);
+        }
+    }
+
+    // the viewport in [rad] is not a rectangle on the screen for all projections
+    for(int i = visible.count() - 1; i >= 0; i--)
+    {
+        const qint32 idx = visible[i];
+        if(!extViewport.contains(pos[idx]))
+        {
+            wpts[idx]->drawIcon(p, NOPOINTF, blockedAreas);
+            visible.remove(i);
+        }
+    }
+
+    if(visible.count() < CLUSTER_MIN_WPTS)
+    {
+        for(qint32 i : qAsConst(visible))
+        {
+            wpts[i]->drawIcon(p, pos[i], blockedAreas);
+        }
+        return;
+    }
+
+    // group the waypoints by grid cells, keep the order of first appearance
+    QVector<quint64> cells;
+    QHash<quint64, QVector<qint32> > members;
+    for(qint32 i : qAsConst(visible))
+    {
+        const quint32 x = quint32(qFloor(pos[i].x() / CLUSTER_CELL_SIZE));
+        const quint32 y = quint32(qFloor(pos[i].y() / CLUSTER_CELL_SIZE));
+        const quint64 cell = (quint64(x) << 32) | y;
+
+        QVector<qint32>& m = members[cell];
+        if(m.isEmpty())
+        {
+            cells << cell;
+        }
+        m << i;
+    }
+
+    const QFont& f = CMainWindow::self().getMapFont();
+    const int sizeMin = (f.pointSize() + (f.bold() ? 3 : 2)) * 2;
+    p.setFont(f);
+
+    for(quint64 cell : qAsConst(cells))
+    {
+        const QVector<qint32>& m = members[cell];
+        if(m.count() == 1)
+        {
+            wpts[m[0]]->drawIcon(p, pos[m[0]], blockedAreas);
+            continue;
+        }
+
+        QPointF center(0, 0);
+        for(qint32 i : m)
+        {
+            center += pos[i];
+            wpts[i]->drawIcon(p, NOPOINTF, blockedAreas);
+        }
+        center /= m.count();
+
+        const QString& str = QString::number(m.count());
+        const int size = qMax(sizeMin, qCeil(p.boundingRect(QRectF(), str).width()) + 8);
+        CDraw::number(m.count(), size, p, center, Qt::darkBlue);
+
+        QRectF rect(0, 0, size, size);
+        rect.moveCenter(center);
+        blockedAreas << rect;
+    }
+}
+
+QSet<const CGisItemWpt*> IGisProject::findWaypoints(const QRectF& area, const QList<CGisItemWpt*>& wpts)
+{
+    QMutexLocker lock(&IGisItem::mutexItems);
+
+    auto cellX = [](qreal lon) -> qint32
+    {
+        return qFloor((lon + M_PI) / WPT_INDEX_CELL_SIZE);
+    };
+    auto cellY = [](qreal lat) -> qint32
+    {
+        return qFloor((lat + M_PI_2) / WPT_INDEX_CELL_SIZE);
+    };
+    auto cellKey = [](qint32 x, qint32 y) -> quint64
+    {
+        return (quint64(quint32(x)) << 32) | quint32(y);
+    };
+
+    if(wptIndexCount != wpts.count())
+    {
+        wptIndex.clear();
+        for(const CGisItemWpt* wpt : wpts)
+        {
+            const QPointF& pos = wpt->getPosition() * DEG_TO_RAD;
+            wptIndex[cellKey(cellX(pos.x()), cellY(pos.y()))] << wptref_t {wpt, pos};
+        }
+        wptIndexCount = wpts.count();
+    }
+
+    QSet<const CGisItemWpt*> result;
+    const QRectF& rect = area.normalized();
+
+    auto addCell = [&](const QVector<wptref_t>& cell)
+    {
+        for(const wptref_t& ref : cell)
+        {
+            if(rect.contains(ref.pos))
+            {
+                result << ref.wpt;
+            }
+        }
+    };
+
+    const qint32 x1 = cellX(rect.left());
+    const qint32 x2 = cellX(rect.right());
+    const qint32 y1 = cellY(rect.top());
+    const qint32 y2 = cellY(rect.bottom());
+
+    // for a large area it is faster to test all occupied cells
+    if(qint64(x2 - x1 + 1) * (y2 - y1 + 1) > wptIndex.count())
+    {
+        for(const QVector<wptref_t>& cell : qAsConst(wptIndex))
+        {
+            addCell(cell);
+        }
+    }
+    else
+    {
+        for(qint32 y = y1; y <= y2; y++)
+        {
+            for(qint32 x = x1; x <= x2; x++)
+            {
+                const auto& it = wptIndex.constFind(cellKey(x, y));
+                if(it != wptIndex.constEnd())
+                {
+                    addCell(*it);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+void IGisProject::invalidateWptIndex()
+{
+    QMutexLocker lock(&IGisItem::mutexItems);
+    wptIndex.clear();
+    wptIndexCount = NOIDX;
 }
 
 void IGisProject::drawItem(QPainter& p, const QRectF& viewport, CGisDraw* gis)
@@ -26,8 +26,10 @@
 #include "gis/search/CSearch.h"
 #include "helpers/CSelectCopyAction.h"
 #include <QDebug>
+#include <QHash>
 #include <QMessageBox>
 #include <QPointer>
+#include <QSet>
 #include <QTreeWidgetItem>
 
 class CGisListWks;
@@ -567,6 +569,38 @@ public:
     {
         return projectFilter;
     }
+private:
+    /**
+       @brief Draw all waypoints that are plain icons
+
+       The waypoints in the viewport are found by the index, see findWaypoints(). Only
+       their positions are projected and compared to the viewport. If there are
+       too many waypoints on the screen to be readable they are grouped by a grid on the
+       screen. Cells with more than one waypoint are drawn as a marker with the number of
+       waypoints.
+
+       @param p             the painter to use
+       @param viewport      the viewport in [rad]
+       @param blockedAreas  the areas of all icons and markers are appended
+       @param gis           the draw context
+       @param wpts          the waypoints, see CGisItemWpt::isClusterable()
+     */
+    void drawWaypoints(QPainter& p, const QPolygonF& viewport, QList<QRectF>& blockedAreas, CGisDraw* gis, const QList<CGisItemWpt*>& wpts);
+
+    /**
+       @brief Find the waypoints within an area
+
+       The waypoints are sorted into a grid by their position. The grid is built on
+       demand and dropped by invalidateWptIndex(). It is rebuilt, too, if the number of
+       waypoints differs from the one used to build it.
+
+       @param area          the area in [rad]
+       @param wpts          all waypoints to search, see CGisItemWpt::isClusterable()
+       @return The waypoints within the area
+     */
+    QSet<const CGisItemWpt*> findWaypoints(const QRectF& area, const QList<CGisItemWpt*>& wpts);
+    void invalidateWptIndex();
+
 protected:
     void genKey() const;
     virtual void setupName(const QString& defaultName);
@@ -642,6 +676,17 @@ protected:
     CSearch workspaceSearch = CSearch("");
 
     CProjectFilterItem* projectFilter = nullptr;
+
+    struct wptref_t
+    {
+        const CGisItemWpt* wpt;
+        /// position in [rad]
+        QPointF pos;
+    };
+    /// the waypoints sorted into a grid of cells, see findWaypoints()
+    QHash<quint64, QVector<wptref_t> > wptIndex;
+    /// the number of waypoints in wptIndex, NOIDX if it has to be rebuilt
+    qint32 wptIndexCount = NOIDX;
 };
 Q_DECLARE_METATYPE(IGisProject*)
 
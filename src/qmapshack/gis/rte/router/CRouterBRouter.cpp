@@ -20,6 +20,7 @@
 #include "canvas/CCanvas.h"
 #include "CMainWindow.h"
 #include "gis/CGisWorkspace.h"
+#include "gis/GeoMath.h"
 #include "gis/rte/CGisItemRte.h"
 #include "gis/rte/router/brouter/CRouterBRouterInfo.h"
 #include "gis/rte/router/brouter/CRouterBRouterLocal.h"
@@ -210,6 +211,23 @@ QString CRouterBRouter::getOptions()
                    .arg(comboAlternative->currentData().toInt() + 1));
 }
 
+QString CRouterBRouter::getDataVersion()
+{
+    // only the local installation is used for on-the-fly routing
+    if(setup->installMode != CRouterBRouterSetup::eModeLocal)
+    {
+        return QString();
+    }
+
+    // adding or replacing segments changes the modification time of the directory
+    const QFileInfo segments(QDir(setup->localDir).absoluteFilePath(setup->localSegmentsDir));
+    const QFileInfo profile(setup->getProfileDir(CRouterBRouterSetup::eModeLocal).absoluteFilePath(comboProfile->currentData().toString() + ".brf"));
+
+    return QString("%1 %2 %3").arg(segments.absoluteFilePath())
+           .arg(segments.lastModified().toMSecsSinceEpoch())
+           .arg(profile.lastModified().toMSecsSinceEpoch());
+}
+
 void CRouterBRouter::routerSelected()
 {
     getBRouterVersion();
@@ -369,90 +387,340 @@ int CRouterBRouter::synchronousRequest(const QVector<QPointF>& points, const QLi
         //Processing userinputevents in local eventloop would cause a SEGV when clicking 'abort' of calling LineOp
         eventLoop.exec(QEventLoop::ExcludeUserInputEvents);
 
-        const QNetworkReply::NetworkError& netErr = reply->error();
-        if (netErr == QNetworkReply::RemoteHostClosedError && nogos.size() > 1 && !isMinimumVersion(1, 4, 10))
+        readResponse(reply, nogos.size(), coords, costs);
+    }
+    catch(const QString& msg)
+    {
+        coords.clear();
+        if(!msg.isEmpty())
         {
-            throw tr("this version of BRouter does not support more then 1 nogo-area");
+            reply->deleteLater();
+            mutex.unlock();
+            throw tr("Bad response from server: %1").arg(msg);
         }
-        else if(netErr != QNetworkReply::NoError)
+    }
+
+    reply->deleteLater();
+    slotCloseStatusMsg();
+    mutex.unlock();
+    return coords.size();
+}
+
+int CRouterBRouter::calcRoutes(QVector<leg_t>& legs, const fCanceled& canceled)
+{
+    if(!hasFastRouting() || legs.isEmpty())
+    {
+        return IRouter::calcRoutes(legs, canceled);
+    }
+
+    if (!mutex.tryLock())
+    {
+        return 0;
+    }
+
+    if (localBRouter->isBRouterNotRunning())
+    {
+        localBRouter->startBRouter();
+    }
+
+    synchronous = true;
+
+    QList<IGisItem*> nogos;
+    CGisWorkspace::self().getNogoAreas(nogos);
+
+    // The local server terminates the oldest request if more requests than
+    // it's configured number of threads are running. Never send more.
+    const int maxPending = qMax(1, setup->localNumberThreads.toInt());
+
+    QEventLoop eventLoop;
+    QHash<QNetworkReply*, int> pending;
+    int nextLeg = 0;
+    int cnt = 0;
+    bool aborted = false;
+
+    std::function<void()> sendRequests = [&]()
+    {
+        while(!aborted && nextLeg < legs.size() && pending.size() < maxPending)
         {
-            throw reply->errorString();
+            const QVector<QPointF> points = {legs[nextLeg].p1* RAD_TO_DEG, legs[nextLeg].p2 * RAD_TO_DEG};
+
+            QNetworkReply* reply = networkAccessManager->get(getRequest(points, nogos));
+            pending[reply] = nextLeg++;
+
+            connect(reply, &QNetworkReply::finished, &eventLoop, [&, reply]()
+            {
+                leg_t& leg = legs[pending.take(reply)];
+                leg.coords.clear();
+                try
+                {
+                    readResponse(reply, nogos.size(), leg.coords, &leg.costs);
+                    leg.result = leg.coords.size();
+                    cnt++;
+                }
+                catch(const QString&)
+                {
+                    leg.coords.clear();
+                    leg.result = -1;
+                }
+                reply->deleteLater();
+
+                sendRequests();
+                if(pending.isEmpty())
+                {
+                    eventLoop.quit();
+                }
+            });
         }
-        slotClearError();
+    };
 
-        const QByteArray& res = reply->readAll();
+    QTimer timer;
+    connect(&timer, &QTimer::timeout, this, [&]()
+    {
+        if(!aborted && canceled())
+        {
+            aborted = true;
+            // aborting emits finished() and changes pending
+            const QList<QNetworkReply*>& replies = pending.keys();
+            for(QNetworkReply* reply : replies)
+            {
+                reply->abort();
+            }
+        }
+    });
+    timer.start(100);
 
-        if(res.isEmpty())
+    sendRequests();
+    if(!pending.isEmpty())
+    {
+        // user input while routing can crash the application
+        eventLoop.exec(QEventLoop::ExcludeUserInputEvents);
+    }
+
+    slotCloseStatusMsg();
+    mutex.unlock();
+    return aborted ? -1 : cnt;
+}
+
+/**
+   @brief Split a route through several points into the legs between these points
+
+   The route is split at the route point closest to each intermediate point,
+   searching forward from the previous split. The costs are distributed by
+   the length of the legs.
+ */
+static void splitRoute(QVector<IRouter::leg_t>& legs, const QPolygonF& coords, qreal costs)
+{
+    QVector<qreal> lengths(legs.size(), 0);
+    qreal totalLength = 0;
+
+    int start = 0;
+    for(int n = 0; n < legs.size(); n++)
+    {
+        IRouter::leg_t& leg = legs[n];
+        leg.coords.clear();
+        if(coords.isEmpty())
         {
-            throw tr("response is empty");
+            leg.result = -1;
+            continue;
         }
 
-        QDomDocument xml;
-        xml.setContent(res);
-        const QDomElement& xmlGpx = xml.documentElement();
+        int end = coords.size() - 1;
+        if(n < legs.size() - 1)
+        {
+            qreal minDist = NOFLOAT;
+            for(int i = start; i < coords.size(); i++)
+            {
+                const QPointF& d = coords[i] - leg.p2;
+                const qreal dist = d.x() * d.x() + d.y() * d.y();
+                if(dist < minDist)
+                {
+                    minDist = dist;
+                    end = i;
+                }
+            }
+        }
 
-        if(xmlGpx.isNull() || xmlGpx.tagName() != "gpx")
+        for(int i = start; i <= end; i++)
         {
-            throw QString(res);
+            leg.coords << coords[i];
+            if(i > start)
+            {
+                lengths[n] += GPS_Math_DistanceQuick(coords[i - 1].x(), coords[i - 1].y(), coords[i].x(), coords[i].y());
+            }
+        }
+        totalLength += lengths[n];
+        leg.result = leg.coords.size();
+        start = end;
+    }
+
+    for(int n = 0; n < legs.size(); n++)
+    {
+        legs[n].costs = (costs < 0 || totalLength <= 0) ? costs : costs * lengths[n] / totalLength;
+    }
+}
+
+void CRouterBRouter::calcRoutesAsync(qint32 id, const QVector<leg_t>& legs)
+{
+    if(!hasFastRouting() || legs.isEmpty())
+    {
+        IRouter::calcRoutesAsync(id, legs);
+        return;
+    }
+
+    if (localBRouter->isBRouterNotRunning())
+    {
+        localBRouter->startBRouter();
+    }
+
+    QList<IGisItem*> nogos;
+    CGisWorkspace::self().getNogoAreas(nogos);
+    const int nNogos = nogos.size();
+
+    asyncErrors[id] = QString();
+
+    // consecutive legs are combined into a single request with all their points
+    int n = 0;
+    while(n < legs.size())
+    {
+        QVector<leg_t> chain = {legs[n++]};
+        while(n < legs.size() && legs[n].p1 == chain.last().p2)
+        {
+            chain << legs[n++];
         }
-        setup->parseBRouterVersion(xmlGpx.attribute("creator"));
 
-        // read the shape
-        const QDomNodeList& xmlLatLng = xmlGpx.firstChildElement("trk")
-                                        .firstChildElement("trkseg")
-                                        .elementsByTagName("trkpt");
-        for(int n = 0; n < xmlLatLng.size(); n++)
+        QVector<QPointF> points = {chain.first().p1 * RAD_TO_DEG};
+        for(const leg_t& leg : qAsConst(chain))
         {
-            const QDomElement& elem = xmlLatLng.item(n).toElement();
-            coords << QPointF();
-            QPointF& point = coords.last();
-            point.setX(elem.attribute("lon").toFloat() * DEG_TO_RAD);
-            point.setY(elem.attribute("lat").toFloat() * DEG_TO_RAD);
+            points << leg.p2 * RAD_TO_DEG;
         }
 
-        //find costs of route (copied and adapted from CGisItemRte::setResultFromBrouter)
-        if(costs != nullptr)
+        QNetworkReply* reply = networkAccessManager->get(getRequest(points, nogos));
+        reply->setProperty("async", true);
+        asyncReplies.insert(id, reply);
+
+        connect(reply, &QNetworkReply::finished, this, [this, id, chain, reply, nNogos]()
         {
-            const QDomNodeList& nodes = xml.childNodes();
-            for (int i = 0; i < nodes.count(); i++)
+            reply->deleteLater();
+            if(!asyncReplies.contains(id, reply))
             {
-                const QDomNode& node = nodes.at(i);
-                if (!node.isComment())
-                {
-                    continue;
-                }
-                const QString& commentTxt = node.toComment().data();
-                // ' track-length = 180864 filtered ascend = 428 plain-ascend = -172 cost=270249 '
-                const QRegExp rxAscDes("(\\s*track-length\\s*=\\s*)(-?\\d+)(\\s*)(filtered ascend\\s*=\\s*-?\\d+)(\\s*)(plain-ascend\\s*=\\s*-?\\d+)(\\s*)(cost\\s*=\\s*)(-?\\d+)(\\s*)");
-                int pos = rxAscDes.indexIn(commentTxt);
-                if (pos > -1)
+                // canceled
+                return;
+            }
+            asyncReplies.remove(id, reply);
+
+            QPolygonF coords;
+            qreal costs = -1;
+            try
+            {
+                readResponse(reply, nNogos, coords, &costs);
+            }
+            catch(const QString& msg)
+            {
+                coords.clear();
+                asyncErrors[id] = tr("Bad response from server: %1").arg(msg);
+            }
+
+            QVector<leg_t> results = chain;
+            splitRoute(results, coords, costs);
+            for(const leg_t& leg : qAsConst(results))
+            {
+                // the request might be canceled by a receiver of the signal
+                if(!asyncErrors.contains(id))
                 {
-                    bool ok;
-                    *costs = rxAscDes.cap(9).toDouble(&ok);
-                    if(!ok)
-                    {
-                        *costs = -1;
-                    }
+                    return;
                 }
-                break;
+                emit sigRouteLegFinished(id, leg);
             }
-        }
+
+            if(asyncErrors.contains(id) && !asyncReplies.contains(id))
+            {
+                emit sigRoutesFinished(id, asyncErrors.take(id));
+            }
+        });
     }
-    catch(const QString& msg)
+}
+
+void CRouterBRouter::cancelRoutesAsync(qint32 id)
+{
+    const QList<QNetworkReply*>& replies = asyncReplies.values(id);
+    asyncReplies.remove(id);
+    asyncErrors.remove(id);
+    for(QNetworkReply* reply : replies)
     {
-        coords.clear();
-        if(!msg.isEmpty())
+        reply->abort();
+    }
+}
+
+void CRouterBRouter::readResponse(QNetworkReply* reply, int nNogos, QPolygonF& coords, qreal* costs)
+{
+    const QNetworkReply::NetworkError& netErr = reply->error();
+    if (netErr == QNetworkReply::RemoteHostClosedError && nNogos > 1 && !isMinimumVersion(1, 4, 10))
+    {
+        throw tr("this version of BRouter does not support more then 1 nogo-area");
+    }
+    else if(netErr != QNetworkReply::NoError)
+    {
+        throw reply->errorString();
+    }
+    slotClearError();
+
+    const QByteArray& res = reply->readAll();
+
+    if(res.isEmpty())
+    {
+        throw tr("response is empty");
+    }
+
+    QDomDocument xml;
+    xml.setContent(res);
+    const QDomElement& xmlGpx = xml.documentElement();
+
+    if(xmlGpx.isNull() || xmlGpx.tagName() != "gpx")
+    {
+        throw QString(res);
+    }
+    setup->parseBRouterVersion(xmlGpx.attribute("creator"));
+
+    // read the shape
+    const QDomNodeList& xmlLatLng = xmlGpx.firstChildElement("trk")
+                                    .firstChildElement("trkseg")
+                                    .elementsByTagName("trkpt");
+    for(int n = 0; n < xmlLatLng.size(); n++)
+    {
+        const QDomElement& elem = xmlLatLng.item(n).toElement();
+        coords << QPointF();
+        QPointF& point = coords.last();
+        point.setX(elem.attribute("lon").toFloat() * DEG_TO_RAD);
+        point.setY(elem.attribute("lat").toFloat() * DEG_TO_RAD);
+    }
+
+    //find costs of route (copied and adapted from CGisItemRte::setResultFromBrouter)
+    if(costs != nullptr)
+    {
+        const QDomNodeList& nodes = xml.childNodes();
+        for (int i = 0; i < nodes.count(); i++)
         {
-            reply->deleteLater();
-            mutex.unlock();
-            throw tr("Bad response from server: %1").arg(msg);
+            const QDomNode& node = nodes.at(i);
+            if (!node.isComment())
+            {
+                continue;
+            }
+            const QString& commentTxt = node.toComment().data();
+            // ' track-length = 180864 filtered ascend = 428 plain-ascend = -172 cost=270249 '
+            const QRegExp rxAscDes("(\\s*track-length\\s*=\\s*)(-?\\d+)(\\s*)(filtered ascend\\s*=\\s*-?\\d+)(\\s*)(plain-ascend\\s*=\\s*-?\\d+)(\\s*)(cost\\s*=\\s*)(-?\\d+)(\\s*)");
+            int pos = rxAscDes.indexIn(commentTxt);
+            if (pos > -1)
+            {
+                bool ok;
+                *costs = rxAscDes.cap(9).toDouble(&ok);
+                if(!ok)
+                {
+                    *costs = -1;
+                }
+            }
+            break;
         }
     }
-
-    reply->deleteLater();
-    slotCloseStatusMsg();
-    mutex.unlock();
-    return coords.size();
 }
 
 void CRouterBRouter::calcRoute(const IGisItem::key_t& key)
@@ -506,7 +774,8 @@ void CRouterBRouter::calcRoute(const IGisItem::key_t& key)
 
 void CRouterBRouter::slotRequestFinished(QNetworkReply* reply)
 {
-    if (synchronous)
+    // replies of calcRoutesAsync() are handled by their own lambda
+    if (synchronous || reply->property("async").toBool())
     {
         return;
     }
@@ -48,8 +48,12 @@ public:
 
     void calcRoute(const IGisItem::key_t& key) override;
     int calcRoute(const QPointF& p1, const QPointF& p2, QPolygonF& coords, qreal* costs = nullptr) override;
+    int calcRoutes(QVector<leg_t>& legs, const fCanceled& canceled) override;
+    void calcRoutesAsync(qint32 id, const QVector<leg_t>& legs) override;
+    void cancelRoutesAsync(qint32 id) override;
     bool hasFastRouting() override;
     QString getOptions() override;
+    QString getDataVersion() override;
     void routerSelected() override;
 
     void setupLocalDir(QString localDir);
@@ -75,6 +79,8 @@ private:
     bool isMinimumVersion(int major, int minor, int patch) const;
     void updateBRouterStatus() const;
     int synchronousRequest(const QVector<QPointF>& points, const QList<IGisItem*>& nogos, QPolygonF& coords, qreal* costs);
+    /// parse the reply of a synchronous request, throws a QString on errors
+    void readResponse(QNetworkReply* reply, int nNogos, QPolygonF& coords, qreal* costs);
     QNetworkRequest getRequest(const QVector<QPointF>& routePoints, const QList<IGisItem*>& nogos) const;
     QUrl getServiceUrl() const;
 
@@ -90,6 +96,11 @@ private:
     CProgressDialog* progress { nullptr };
     bool isShutdown { false };
 
+    /// the pending replies of calcRoutesAsync() by request id
+    QMultiHash<qint32, QNetworkReply*> asyncReplies;
+    /// the active requests of calcRoutesAsync() with their last error
+    QHash<qint32, QString> asyncErrors;
+
     static CRouterBRouter* pSelf;
     friend class CRouterBRouterLocal;
 };
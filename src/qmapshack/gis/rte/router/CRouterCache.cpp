@@ -0,0 +1,258 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "gis/rte/router/CRouterCache.h"
+#include "setup/IAppSetup.h"
+
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QtGui>
+
+#define CACHE_DIR_NAME      "RouteCache"
+#define CACHE_DB_NAME       "routes.db"
+#define CACHE_CONNECTION    "RouteCache"
+#define CLEANUP_INTERVAL    100
+
+CRouterCache::CRouterCache()
+{
+    QDir dir(IAppSetup::getPlatformInstance()->defaultCachePath());
+    dir.mkpath(CACHE_DIR_NAME);
+    dir.cd(CACHE_DIR_NAME);
+
+    db = QSqlDatabase::addDatabase("QSQLITE", CACHE_CONNECTION);
+    db.setDatabaseName(dir.absoluteFilePath(CACHE_DB_NAME));
+    if(!db.open())
+    {
+        qDebug() << "failed to open route cache" << db.lastError();
+        return;
+    }
+
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode=WAL");
+    if(!query.exec("CREATE TABLE IF NOT EXISTS routes ("
+                   "hash TEXT PRIMARY KEY NOT NULL, "
+                   "coords BLOB NOT NULL, "
+                   "costs REAL NOT NULL, "
+                   "size INTEGER NOT NULL, "
+                   "accessed INTEGER NOT NULL)"))
+    {
+        qDebug() << "failed to create route table" << query.lastError();
+    }
+    // the index covers the size to sum it up without touching the routes
+    query.exec("CREATE INDEX IF NOT EXISTS idx_accessed ON routes(accessed, size)");
+
+    if(query.exec("SELECT SUM(size) FROM routes") && query.next())
+    {
+        totalSize = query.value(0).toLongLong();
+    }
+}
+
+CRouterCache::~CRouterCache()
+{
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(CACHE_CONNECTION);
+}
+
+QString CRouterCache::hash(const QString& context, const QPointF& p1, const QPointF& p2)
+{
+    QCryptographicHash md5(QCryptographicHash::Md5);
+    md5.addData(context.toUtf8());
+    md5.addData(reinterpret_cast<const char*>(&p1), sizeof(p1));
+    md5.addData(reinterpret_cast<const char*>(&p2), sizeof(p2));
+    return md5.result().toHex();
+}
+
+bool CRouterCache::find(const QString& context, const QPointF& p1, const QPointF& p2, QPolygonF& coords, qreal& costs)
+{
+    if(!db.isOpen())
+    {
+        return false;
+    }
+
+    const QString& key = hash(context, p1, p2);
+
+    QSqlQuery query(db);
+    query.prepare("SELECT coords, costs FROM routes WHERE hash=:hash");
+    query.bindValue(":hash", key);
+    if(!query.exec() || !query.next())
+    {
+        misses++;
+        return false;
+    }
+
+    QByteArray buffer = qUncompress(query.value(0).toByteArray());
+    QDataStream stream(&buffer, QIODevice::ReadOnly);
+    stream.setVersion(QDataStream::Qt_5_2);
+
+    coords.clear();
+    stream >> coords;
+    costs = query.value(1).toDouble();
+
+    if(stream.status() != QDataStream::Ok)
+    {
+        coords.clear();
+        misses++;
+        return false;
+    }
+
+    query.prepare("UPDATE routes SET accessed=:accessed WHERE hash=:hash");
+    query.bindValue(":accessed", QDateTime::currentDateTimeUtc().toSecsSinceEpoch());
+    query.bindValue(":hash", key);
+    query.exec();
+
+    hits++;
+    return true;
+}
+
+void CRouterCache::insert(const QString& context, const QPointF& p1, const QPointF& p2, const QPolygonF& coords, qreal costs)
+{
+    if(!db.isOpen())
+    {
+        return;
+    }
+
+    QByteArray buffer;
+    QDataStream stream(&buffer, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_2);
+    stream << coords;
+    buffer = qCompress(buffer);
+
+    const QString& key = hash(context, p1, p2);
+
+    // a replaced route must not be counted twice
+    qint64 sizeReplaced = 0;
+    QSqlQuery query(db);
+    query.prepare("SELECT size FROM routes WHERE hash=:hash");
+    query.bindValue(":hash", key);
+    if(query.exec() && query.next())
+    {
+        sizeReplaced = query.value(0).toLongLong();
+    }
+
+    query.prepare("INSERT OR REPLACE INTO routes (hash, coords, costs, size, accessed) VALUES (:hash, :coords, :costs, :size, :accessed)");
+    query.bindValue(":hash", key);
+    query.bindValue(":coords", buffer);
+    query.bindValue(":costs", costs);
+    query.bindValue(":size", buffer.size());
+    query.bindValue(":accessed", QDateTime::currentDateTimeUtc().toSecsSinceEpoch());
+    if(!query.exec())
+    {
+        qDebug() << "failed to store route" << query.lastError();
+        return;
+    }
+
+    totalSize += buffer.size() - sizeReplaced;
+    if(++cntInsert >= CLEANUP_INTERVAL || totalSize > qint64(maxSizeMB) * 1024 * 1024)
+    {
+        cleanup();
+    }
+}
+
+void CRouterCache::clear()
+{
+    hits = 0;
+    misses = 0;
+    totalSize = 0;
+
+    if(db.isOpen())
+    {
+        QSqlQuery query(db);
+        query.exec("DELETE FROM routes");
+        query.exec("VACUUM");
+    }
+}
+
+void CRouterCache::setMaxSize(qint32 mb)
+{
+    maxSizeMB = mb;
+    cleanup();
+}
+
+void CRouterCache::cleanup()
+{
+    cntInsert = 0;
+    if(!db.isOpen())
+    {
+        return;
+    }
+
+    QSqlQuery query(db);
+    if(query.exec("SELECT SUM(size) FROM routes") && query.next())
+    {
+        totalSize = query.value(0).toLongLong();
+    }
+
+    const qint64 maxSize = qint64(maxSizeMB) * 1024 * 1024;
+    if(totalSize <= maxSize)
+    {
+        return;
+    }
+
+    // remove the least recently used routes down to 90% of the limit
+    // to avoid a cleanup with each insert
+    qint64 excess = totalSize - maxSize * 9 / 10;
+    QStringList hashes;
+    query.setForwardOnly(true);
+    if(query.exec("SELECT hash, size FROM routes ORDER BY accessed"))
+    {
+        while(excess > 0 && query.next())
+        {
+            hashes << query.value(0).toString();
+            excess -= query.value(1).toLongLong();
+        }
+    }
+    query.finish();
+
+    db.transaction();
+    query.prepare("DELETE FROM routes WHERE hash=:hash");
+    for(const QString& hash : qAsConst(hashes))
+    {
+        query.bindValue(":hash", hash);
+        query.exec();
+    }
+    db.commit();
+
+    if(query.exec("SELECT SUM(size) FROM routes") && query.next())
+    {
+        totalSize = query.value(0).toLongLong();
+    }
+}
+
+QString CRouterCache::getStatistics()
+{
+    qint32 count = 0;
+    if(db.isOpen())
+    {
+        QSqlQuery query(db);
+        if(query.exec("SELECT COUNT(*) FROM routes") && query.next())
+        {
+            count = query.value(0).toInt();
+        }
+    }
+
+    const quint32 total = hits + misses;
+    const qreal rate = total ? (100.0 * hits / total) : 0.0;
+
+    return tr("%1 routes, %2 MB, hit rate %3% (%4 of %5 requests)")
+           .arg(count)
+           .arg(totalSize / (1024.0 * 1024.0), 0, 'f', 1)
+           .arg(rate, 0, 'f', 0)
+           .arg(hits)
+           .arg(total);
+}
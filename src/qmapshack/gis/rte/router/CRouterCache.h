@@ -0,0 +1,90 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CROUTERCACHE_H
+#define CROUTERCACHE_H
+
+#include <QCoreApplication>
+#include <QPolygonF>
+#include <QSqlDatabase>
+
+/**
+   @brief Persistent cache for routes calculated on-the-fly
+
+   Each route is stored with a hash of everything that has an influence
+   on the result: the router, it's options, the version of the routing
+   data, the no-go areas and the start and end point. The caller builds
+   the first part once as a context string and passes it with each request.
+
+   The routes are stored compressed in a SQLite database in the cache
+   directory. If the database exceeds the size limit the least recently
+   used routes are removed.
+
+   The cache is used by the GUI thread only.
+ */
+class CRouterCache
+{
+    Q_DECLARE_TR_FUNCTIONS(CRouterCache)
+public:
+    CRouterCache();
+    virtual ~CRouterCache();
+
+    /**
+       @brief Search for a route
+
+       @param context   the router's context, see class description
+       @param p1        the start point [rad]
+       @param p2        the end point [rad]
+       @param coords    the route's coordinates, if found
+       @param costs     the route's costs, if found
+
+       @return True if the route was found.
+     */
+    bool find(const QString& context, const QPointF& p1, const QPointF& p2, QPolygonF& coords, qreal& costs);
+    /// store a route, see find() for the parameters
+    void insert(const QString& context, const QPointF& p1, const QPointF& p2, const QPolygonF& coords, qreal costs);
+    /// remove all routes and reset the statistics
+    void clear();
+
+    void setMaxSize(qint32 mb);
+    qint32 getMaxSize() const
+    {
+        return maxSizeMB;
+    }
+
+    /// get a human readable summary of size and hit rate
+    QString getStatistics();
+
+private:
+    static QString hash(const QString& context, const QPointF& p1, const QPointF& p2);
+    /// remove the least recently used routes exceeding the size limit
+    void cleanup();
+
+    QSqlDatabase db;
+    qint32 maxSizeMB = 50;
+    /// total size of all routes in the database
+    qint64 totalSize = 0;
+    /// number of inserts since the last cleanup
+    qint32 cntInsert = 0;
+
+    quint32 hits = 0;
+    quint32 misses = 0;
+};
+
+#endif //CROUTERCACHE_H
+
@@ -21,6 +21,14 @@
 #include "gis/rte/router/CRouterSetup.h"
 #include "helpers/CProgressDialog.h"
 
+#include <QtCore>
+
+static inline QString pointKey(const QPointF& pt)
+{
+    //10 digits after the decimal point in exponential format should be by far enough
+    return QString::number(pt.x(), 'e', 10) + QString::number(pt.y(), 'e', 10);
+}
+
 CRouterOptimization::CRouterOptimization()
 {
     routerOptions = CRouterSetup::self().getOptions();
@@ -39,7 +47,15 @@ int CRouterOptimization::optimize(SGisLine& line)
     }
 
     CProgressDialog progress(tr("Optimizing route"), 0, line.length() + 2, nullptr);
+    canceled = [&progress](){return progress.wasCanceled(); };
+    const int result = optimize(line, progress);
+    // do not keep a reference to the dialog
+    canceled = [](){return false; };
+    return result;
+}
 
+int CRouterOptimization::optimize(SGisLine& line, CProgressDialog& progress)
+{
     //Optimize using air distance and known distances, since this is much faster than routing, especially brouter
     SGisLine newAirdistanceOrder;
     SGisLine oldAirdistanceOrder = line;
@@ -49,6 +65,19 @@ int CRouterOptimization::optimize(SGisLine& line)
         oldAirdistanceOrder = newAirdistanceOrder;
         gain = createNextBestOrder(oldAirdistanceOrder, newAirdistanceOrder);
     }
+    //Calculate the routes of both orders in one batch. This is by far faster than
+    //calculating them leg by leg, as the router handles them in parallel.
+    QVector<QPair<QPointF, QPointF> > pairs;
+    for(int i = 0; i < line.length() - 1; i++)
+    {
+        pairs << qMakePair(oldAirdistanceOrder[i].coord, oldAirdistanceOrder[i + 1].coord);
+        pairs << qMakePair(line[i].coord, line[i + 1].coord);
+    }
+    if(!fetchRoutes(pairs))
+    {
+        return -1;
+    }
+
     //Do routing and calculate cost for order found
     qreal airdistanceOrderCosts = getRealRouteCosts(oldAirdistanceOrder);
 
@@ -221,10 +250,33 @@ qreal CRouterOptimization::twoOptStep(const SGisLine& oldOrder, SGisLine& newOrd
 
 qreal CRouterOptimization::getRealRouteCosts(const SGisLine& line, qreal costCutoff)
 {
+    // the number of unknown legs calculated in one batch. It's limited to keep the
+    // benefit of the cost cutoff without idling cores
+    const int batchSize = QThread::idealThreadCount();
+
     qreal costs = 0;
     for(int i = 0; i < line.length() - 1; i++)
     {
         const routing_cache_item_t* route = getRoute(line[i].coord, line[i + 1].coord);
+        if(route == nullptr)
+        {
+            QVector<QPair<QPointF, QPointF> > pairs;
+            for(int j = i; j < line.length() - 1 && pairs.size() < batchSize; j++)
+            {
+                if(getRoute(line[j].coord, line[j + 1].coord) == nullptr)
+                {
+                    pairs << qMakePair(line[j].coord, line[j + 1].coord);
+                }
+            }
+
+            if(!fetchRoutes(pairs))
+            {
+                return -1;
+            }
+
+            route = getRoute(line[i].coord, line[i + 1].coord);
+        }
+
         if(route == nullptr)
         {
             return -1;
@@ -241,9 +293,8 @@ qreal CRouterOptimization::getRealRouteCosts(const SGisLine& line, qreal costCut
 
 qreal CRouterOptimization::bestKnownDistance(const IGisLine::point_t& start, const IGisLine::point_t& end)
 {
-    //10 digits after the decimal point in exponential format should be by far enough
-    QString start_key = QString::number(start.coord.x(), 'e', 10) + QString::number(start.coord.y(), 'e', 10);
-    QString end_key = QString::number(end.coord.x(), 'e', 10) + QString::number(end.coord.y(), 'e', 10);
+    const QString& start_key = pointKey(start.coord);
+    const QString& end_key = pointKey(end.coord);
 
     if(!routingCache.contains(start_key))
     {
@@ -274,25 +325,58 @@ qreal CRouterOptimization::bestKnownDistance(const IGisLine::point_t& start, con
 
 const CRouterOptimization::routing_cache_item_t* CRouterOptimization::getRoute(const QPointF& start, const QPointF& end)
 {
-    QString start_key = QString::number(start.x(), 'e', 10) + QString::number(start.y(), 'e', 10);
-    QString end_key = QString::number(end.x(), 'e', 10) + QString::number(end.y(), 'e', 10);
+    const auto& it = routingCache.constFind(pointKey(start));
+    if(it == routingCache.constEnd())
+    {
+        return nullptr;
+    }
+
+    const auto& route = it->constFind(pointKey(end));
+    return route == it->constEnd() ? nullptr : &(*route);
+}
+
+bool CRouterOptimization::fetchRoutes(const QVector<QPair<QPointF, QPointF> >& pairs)
+{
+    QSet<QString> queued;
+    QVector<IRouter::leg_t> legs;
+    for(const QPair<QPointF, QPointF>& pair : pairs)
+    {
+        const QString& key = pointKey(pair.first) + pointKey(pair.second);
+        if(queued.contains(key) || getRoute(pair.first, pair.second) != nullptr)
+        {
+            continue;
+        }
+        queued << key;
 
-    if(!routingCache.contains(start_key))
+        IRouter::leg_t leg;
+        leg.p1 = pair.first;
+        leg.p2 = pair.second;
+        legs << leg;
+    }
+
+    if(legs.isEmpty())
     {
-        routingCache[start_key] = {};
+        return true;
     }
 
-    if(!routingCache[start_key].contains(end_key))
+    if(CRouterSetup::self().calcRoutes(legs, canceled) < 0)
     {
-        routing_cache_item_t cacheItem;
-        int response = CRouterSetup::self().calcRoute(start, end, cacheItem.route, &cacheItem.costs);
-        if(response < 0)
+        return false;
+    }
+
+    for(const IRouter::leg_t& leg : qAsConst(legs))
+    {
+        if(leg.result < 0)
         {
-            return nullptr;
+            continue;
         }
-        routingCache[start_key][end_key] = cacheItem;
 
-        qreal airToCostFactor = cacheItem.costs / GPS_Math_DistanceQuick(start.x(), start.y(), end.x(), end.y());
+        routing_cache_item_t cacheItem;
+        cacheItem.route = leg.coords;
+        cacheItem.costs = leg.costs;
+        routingCache[pointKey(leg.p1)][pointKey(leg.p2)] = cacheItem;
+
+        qreal airToCostFactor = leg.costs / GPS_Math_DistanceQuick(leg.p1.x(), leg.p1.y(), leg.p2.x(), leg.p2.y());
         if( airToCostFactor < minAirToCostFactor || minAirToCostFactor < 0)
         {
             minAirToCostFactor = airToCostFactor;
@@ -300,11 +384,27 @@ const CRouterOptimization::routing_cache_item_t* CRouterOptimization::getRoute(c
         totalAirToCosts += airToCostFactor;
         totalNumOfRoutes++;
     }
-    return &routingCache[start_key][end_key];
+
+    return !canceled();
+}
+
+bool CRouterOptimization::fetchRoutes(const SGisLine& line)
+{
+    QVector<QPair<QPointF, QPointF> > pairs;
+    for(int i = 0; i < line.length() - 1; i++)
+    {
+        pairs << qMakePair(line[i].coord, line[i + 1].coord);
+    }
+    return fetchRoutes(pairs);
 }
 
 int CRouterOptimization::fillSubPts(SGisLine& line)
 {
+    if(!fetchRoutes(line))
+    {
+        return -1;
+    }
+
     for(int i = 0; i < line.length() - 1; i++)
     {
         line[i].subpts.clear();
@@ -19,10 +19,13 @@
 #ifndef CROUTEROPTIMIZATION_H
 #define CROUTEROPTIMIZATION_H
 #include <gis/IGisLine.h>
+#include <gis/rte/router/IRouter.h>
 #include <QCoreApplication>
 #include <QMap>
 #include <QPolygonF>
 
+class CProgressDialog;
+
 class CRouterOptimization
 {
     Q_DECLARE_TR_FUNCTIONS(CRouterOptimization)
@@ -31,6 +34,7 @@ public:
     int optimize(SGisLine& line);
 
 private:
+    int optimize(SGisLine& line, CProgressDialog& progress);
 
     struct routing_cache_item_t
     {
@@ -44,7 +48,18 @@ private:
 
     qreal getRealRouteCosts(const SGisLine& line, qreal costCutoff = -1);
     qreal bestKnownDistance(const IGisLine::point_t& start, const IGisLine::point_t& end);
+    /// get a route from the routingCache or nullptr if it is not known yet
     const routing_cache_item_t* getRoute(const QPointF& from, const QPointF& to);
+    /**
+       @brief Calculate all routes between pairs of points not in the routingCache yet
+
+       The routes are calculated as one batch. Depending on the router this is done concurrently.
+
+       @return False if the user canceled the operation.
+     */
+    bool fetchRoutes(const QVector<QPair<QPointF, QPointF> >& pairs);
+    /// fetch the routes of all legs of the line
+    bool fetchRoutes(const SGisLine& line);
     int fillSubPts(SGisLine& line);
     /// checks if router settings were changed and if yes, discards the routingCache
     void checkRouter();
@@ -54,6 +69,8 @@ private:
     qreal totalAirToCosts = 0;
     qreal totalNumOfRoutes = 0;
     QString routerOptions = "";
+    /// polled by the router while calculating a batch of routes, only valid during optimize()
+    IRouter::fCanceled canceled = [](){return false; };
 };
 
 #endif // CROUTEROPTIMIZATION_H
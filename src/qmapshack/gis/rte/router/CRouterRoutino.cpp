@@ -27,11 +27,17 @@
 #include "helpers/CSettings.h"
 #include "setup/IAppSetup.h"
 
+#include <QtConcurrent>
 #include <QtWidgets>
 #include <routino.h>
 
 QPointer<CProgressDialog> CRouterRoutino::progress;
 
+/// set by the GUI thread to abort the calculations of calcRoutes()
+static QAtomicInt batchAborted;
+/// the abort flag of the calcRoutesAsync() job running in the current thread
+static thread_local QAtomicInt* asyncAborted = nullptr;
+
 int ProgressFunc(double complete)
 {
     if(CRouterRoutino::progress.isNull())
@@ -44,6 +50,16 @@ int ProgressFunc(double complete)
     return !CRouterRoutino::progress->wasCanceled();
 }
 
+static int ProgressFuncBatch(double)
+{
+    return !batchAborted.load();
+}
+
+static int ProgressFuncAsync(double)
+{
+    return (asyncAborted == nullptr) || !asyncAborted->load();
+}
+
 CRouterRoutino* CRouterRoutino::pSelf = nullptr;
 
 CRouterRoutino::CRouterRoutino(QWidget* parent)
@@ -93,6 +109,8 @@ CRouterRoutino::CRouterRoutino(QWidget* parent)
     comboLanguage->addItem(tr("Spanish"), "es");
 
     connect(toolSetupPaths, &QToolButton::clicked, this, &CRouterRoutino::slotSetupPaths);
+    // the signal is emitted by the worker thread, thus this is called from the GUI thread's event loop
+    connect(this, &CRouterRoutino::sigRoutesFinished, this, [this](qint32 id){asyncJobs.remove(id); });
 
     SETTINGS;
     dbPaths = cfg.value("Route/routino/paths", dbPaths).toStringList();
@@ -266,6 +284,8 @@ void CRouterRoutino::buildDatabaseList()
             /* determine the profile to use for each database*/
             QVariantMap dmap;
             dmap["db"] = QVariant ((qulonglong)data);
+            dmap["path"] = dir.absolutePath();
+            dmap["prefix"] = prefix;
 
             /* check possible profiles.xml locations and use the first available */
             int pError = 0;
@@ -321,6 +341,8 @@ void CRouterRoutino::buildDatabaseList()
 
 void CRouterRoutino::freeDatabaseList()
 {
+    waitForAsyncJobs();
+
     for(int i = 0; i < comboDatabase->count(); i++)
     {
         QVariantMap map = comboDatabase->itemData(i, Qt::UserRole).toMap();
@@ -328,6 +350,82 @@ void CRouterRoutino::freeDatabaseList()
         Routino_UnloadDatabase(data);
     }
     comboDatabase->clear();
+
+    for(const QVector<Routino_Database*>& databases : qAsConst(threadDatabases))
+    {
+        for(Routino_Database* data : databases)
+        {
+            Routino_UnloadDatabase(data);
+        }
+    }
+    threadDatabases.clear();
+
+    for(const QList<Routino_Database*>& databases : qAsConst(asyncDatabases))
+    {
+        for(Routino_Database* data : databases)
+        {
+            Routino_UnloadDatabase(data);
+        }
+    }
+    asyncDatabases.clear();
+}
+
+QString CRouterRoutino::getDataVersion()
+{
+    const QVariantMap& map = comboDatabase->currentData(Qt::UserRole).toMap();
+    const QString& path = map["path"].toString();
+    const QString& prefix = map["prefix"].toString();
+    if(path.isEmpty())
+    {
+        return QString();
+    }
+
+    const QFileInfo segments(QDir(path).absoluteFilePath(prefix + "-segments.mem"));
+    const QFileInfo profiles(map["profilesPath"].toString());
+
+    return QString("%1/%2 %3 %4").arg(path, prefix)
+           .arg(segments.lastModified().toMSecsSinceEpoch())
+           .arg(profiles.lastModified().toMSecsSinceEpoch());
+}
+
+QVector<Routino_Database*> CRouterRoutino::getThreadDatabases(const QVariantMap& map, int n)
+{
+    const QString& path = map["path"].toString();
+    const QString& prefix = map["prefix"].toString();
+
+    QVector<Routino_Database*>& databases = threadDatabases[path + "/" + prefix];
+    while(databases.size() < n)
+    {
+#ifdef Q_OS_WIN
+        Routino_Database* data = Routino_LoadDatabase(path.toLocal8Bit(), prefix.toLocal8Bit());
+#else
+        Routino_Database* data = Routino_LoadDatabase(path.toUtf8(), prefix.toUtf8());
+#endif
+        if(data == nullptr)
+        {
+            break;
+        }
+        databases << data;
+    }
+    return databases.mid(0, n);
+}
+
+void CRouterRoutino::readRoute(Routino_Output* route, bool quickest, QPolygonF& coords, qreal* costs)
+{
+    Routino_Output* next = route;
+    while(next)
+    {
+        if(next->type != ROUTINO_POINT_WAYPOINT)
+        {
+            coords << QPointF(next->lon, next->lat);
+        }
+        if(costs != nullptr)
+        {
+            // This works, since CRouteOptimization adapts it's weights according to the data it gets
+            *costs = quickest ? next->time : next->dist;
+        }
+        next = next->next;
+    }
 }
 
 int CRouterRoutino::loadProfiles(const QString& profilesPath)
@@ -518,29 +616,7 @@ int CRouterRoutino::calcRoute(const QPointF& p1, const QPointF& p2, QPolygonF& c
 
         if(route != nullptr)
         {
-            Routino_Output* next = route;
-            while(next)
-            {
-                if(next->type != ROUTINO_POINT_WAYPOINT)
-                {
-                    coords << QPointF(next->lon, next->lat);
-                }
-                if(costs != nullptr)
-                {
-                    if(comboMode->currentIndex() == 1)
-                    {
-                        // ROUTINO_ROUTE_QUICKEST
-                        // This works, since CRouteOptimization adapts it's weights according to the data it gets
-                        *costs = next->time;
-                    }
-                    else
-                    {
-                        // ROUTINO_ROUTE_SHORTEST
-                        *costs = next->dist;
-                    }
-                }
-                next = next->next;
-            }
+            readRoute(route, comboMode->currentIndex() == 1, coords, costs);
             Routino_DeleteRoute(route);
         }
         else
@@ -569,3 +645,243 @@ int CRouterRoutino::calcRoute(const QPointF& p1, const QPointF& p2, QPolygonF& c
     mutex.unlock();
     return coords.size();
 }
+
+CRouterRoutino::setup_t CRouterRoutino::getSetup()
+{
+    setup_t setup;
+    setup.map = comboDatabase->currentData(Qt::UserRole).toMap();
+    setup.data = (Routino_Database*)(setup.map["db"].toULongLong());
+    if(nullptr == setup.data)
+    {
+        throw QString();
+    }
+
+    const QString& profilesPath = setup.map["profilesPath"].toString();
+    if(profilesPath != currentProfilesPath)
+    {
+        // the profiles are about to be replaced, stop everything still using them
+        waitForAsyncJobs();
+    }
+    loadProfiles(profilesPath);
+
+    QString strProfile = comboProfile->currentData(Qt::UserRole).toString();
+    QString strLanguage = comboLanguage->currentData(Qt::UserRole).toString();
+
+    setup.profile = Routino_GetProfile(strProfile.toUtf8());
+    if( setup.profile == NULL )
+    {
+        throw tr("Required profile '%1' is not in the current profiles file.").arg(strProfile);
+    }
+    setup.translation = Routino_GetTranslation(strLanguage.toUtf8());
+
+    int res = Routino_ValidateProfile(setup.data, setup.profile);
+    if(res != 0)
+    {
+        throw xlateRoutinoError(Routino_errno);
+    }
+
+    setup.quickest = comboMode->currentIndex() == 1;
+    setup.options = ROUTINO_ROUTE_LIST_HTML_ALL | (setup.quickest ? ROUTINO_ROUTE_QUICKEST : ROUTINO_ROUTE_SHORTEST);
+
+    return setup;
+}
+
+bool CRouterRoutino::calcLeg(Routino_Database* data, const setup_t& setup, leg_t& leg, int (*progress)(double))
+{
+    leg.coords.clear();
+    leg.result = -1;
+
+    Routino_Waypoint* waypoints[2] = {0};
+    waypoints[0] = Routino_FindWaypoint(data, setup.profile, leg.p1.y() * RAD_TO_DEG, leg.p1.x() * RAD_TO_DEG);
+    waypoints[1] = Routino_FindWaypoint(data, setup.profile, leg.p2.y() * RAD_TO_DEG, leg.p2.x() * RAD_TO_DEG);
+
+    if(waypoints[0] != nullptr && waypoints[1] != nullptr)
+    {
+        Routino_Output* route = Routino_CalculateRoute(data, setup.profile, setup.translation, waypoints, 2, setup.options, progress);
+        if(route != nullptr)
+        {
+            readRoute(route, setup.quickest, leg.coords, &leg.costs);
+            Routino_DeleteRoute(route);
+            leg.result = leg.coords.size();
+        }
+    }
+
+    free(waypoints[0]);
+    free(waypoints[1]);
+
+    return leg.result > 0;
+}
+
+int CRouterRoutino::calcRoutes(QVector<leg_t>& legs, const fCanceled& canceled)
+{
+    if(legs.isEmpty())
+    {
+        return 0;
+    }
+
+    if(!mutex.tryLock())
+    {
+        return 0;
+    }
+
+    int cnt = 0;
+    try
+    {
+        const setup_t& setup = getSetup();
+
+        QVector<Routino_Database*> databases = getThreadDatabases(setup.map, qMin(QThread::idealThreadCount(), legs.size()));
+        if(databases.isEmpty())
+        {
+            throw xlateRoutinoError(Routino_errno);
+        }
+
+        // detach in the GUI thread, the workers access the items via the raw pointer
+        leg_t* items = legs.data();
+        const int N = legs.size();
+        QAtomicInt nextLeg(0);
+        QAtomicInt success(0);
+        batchAborted = 0;
+
+        // each worker takes the next free leg until all are done
+        auto worker = [&](Routino_Database*& data)
+        {
+            int idx;
+            while(!batchAborted.load() && (idx = nextLeg.fetchAndAddOrdered(1)) < N)
+            {
+                if(calcLeg(data, setup, items[idx], ProgressFuncBatch))
+                {
+                    success.fetchAndAddOrdered(1);
+                }
+            }
+        };
+
+        QEventLoop eventLoop;
+        QTimer timer;
+        QFutureWatcher<void> watcher;
+        connect(&watcher, &QFutureWatcher<void>::finished, &eventLoop, &QEventLoop::quit);
+        connect(&timer, &QTimer::timeout, this, [&]()
+        {
+            if(canceled())
+            {
+                batchAborted = 1;
+            }
+        });
+        timer.start(100);
+        watcher.setFuture(QtConcurrent::map(databases, worker));
+        // user input while routing can crash the application
+        eventLoop.exec(QEventLoop::ExcludeUserInputEvents);
+
+        cnt = batchAborted.load() ? -1 : success.load();
+    }
+    catch(const QString& msg)
+    {
+        if(!msg.isEmpty())
+        {
+            mutex.unlock();
+            throw msg;
+        }
+    }
+
+    mutex.unlock();
+    return cnt;
+}
+
+void CRouterRoutino::calcRoutesAsync(qint32 id, const QVector<leg_t>& legs)
+{
+    setup_t setup;
+    try
+    {
+        setup = getSetup();
+    }
+    catch(const QString& msg)
+    {
+        emit sigRoutesFinished(id, msg);
+        return;
+    }
+
+    const QString& key = setup.map["path"].toString() + "/" + setup.map["prefix"].toString();
+    Routino_Database* data = nullptr;
+    {
+        QMutexLocker lock(&mutexAsync);
+        if(!asyncDatabases[key].isEmpty())
+        {
+            data = asyncDatabases[key].takeLast();
+        }
+    }
+
+    if(data == nullptr)
+    {
+        const QString& path = setup.map["path"].toString();
+        const QString& prefix = setup.map["prefix"].toString();
+#ifdef Q_OS_WIN
+        data = Routino_LoadDatabase(path.toLocal8Bit(), prefix.toLocal8Bit());
+#else
+        data = Routino_LoadDatabase(path.toUtf8(), prefix.toUtf8());
+#endif
+        if(data == nullptr)
+        {
+            emit sigRoutesFinished(id, xlateRoutinoError(Routino_errno));
+            return;
+        }
+    }
+
+    QSharedPointer<QAtomicInt> aborted(new QAtomicInt(0));
+    asyncJobs[id] = aborted;
+
+    // forget about futures of finished jobs
+    asyncFutures.erase(std::remove_if(asyncFutures.begin(), asyncFutures.end(), [](const QFuture<void>& f){return f.isFinished(); }), asyncFutures.end());
+
+    asyncFutures << QtConcurrent::run([this, id, legs, setup, data, key, aborted]()
+    {
+        asyncAborted = aborted.data();
+
+        QString error;
+        for(leg_t leg : legs)
+        {
+            if(aborted->load())
+            {
+                break;
+            }
+
+            if(!calcLeg(data, setup, leg, ProgressFuncAsync) && !aborted->load())
+            {
+                error = xlateRoutinoError(Routino_errno);
+            }
+            // the signal is queued to the GUI thread
+            emit sigRouteLegFinished(id, leg);
+        }
+
+        asyncAborted = nullptr;
+
+        {
+            QMutexLocker lock(&mutexAsync);
+            asyncDatabases[key] << data;
+        }
+
+        emit sigRoutesFinished(id, error);
+    });
+}
+
+void CRouterRoutino::cancelRoutesAsync(qint32 id)
+{
+    QSharedPointer<QAtomicInt> aborted = asyncJobs.take(id);
+    if(!aborted.isNull())
+    {
+        *aborted = 1;
+    }
+}
+
+void CRouterRoutino::waitForAsyncJobs()
+{
+    for(const QSharedPointer<QAtomicInt>& aborted : qAsConst(asyncJobs))
+    {
+        *aborted = 1;
+    }
+    asyncJobs.clear();
+
+    for(QFuture<void>& future : asyncFutures)
+    {
+        future.waitForFinished();
+    }
+    asyncFutures.clear();
+}
@@ -23,7 +23,10 @@
 #include "ui_IRouterRoutino.h"
 #include <routino.h>
 
+#include <QFuture>
+#include <QHash>
 #include <QPoint>
+#include <QSharedPointer>
 
 class CProgressDialog;
 
@@ -40,10 +43,14 @@ public:
 
     void calcRoute(const IGisItem::key_t& key) override;
     int calcRoute(const QPointF& p1, const QPointF& p2, QPolygonF& coords, qreal* costs) override;
+    int calcRoutes(QVector<leg_t>& legs, const fCanceled& canceled) override;
+    void calcRoutesAsync(qint32 id, const QVector<leg_t>& legs) override;
+    void cancelRoutesAsync(qint32 id) override;
 
     bool hasFastRouting() override;
 
     QString getOptions() override;
+    QString getDataVersion() override;
 
     static QPointer<CProgressDialog> progress;
 
@@ -54,17 +61,52 @@ private slots:
 
 
 private:
+    /// everything needed to calculate a route, collected in the GUI thread
+    struct setup_t
+    {
+        QVariantMap map;
+        Routino_Database* data = nullptr;
+        Routino_Profile* profile = nullptr;
+        Routino_Translation* translation = nullptr;
+        int options = 0;
+        bool quickest = false;
+    };
+
     virtual ~CRouterRoutino();
+    /// collect the setup for the current database and options, throws a QString on errors
+    setup_t getSetup();
+    /// calculate a single leg with the given database handle, thread safe as long as the handle is not shared
+    static bool calcLeg(Routino_Database* data, const setup_t& setup, leg_t& leg, int (*progress)(double));
+    /// abort all jobs of calcRoutesAsync() and wait for them to finish
+    void waitForAsyncJobs();
     void buildDatabaseList();
     void freeDatabaseList();
     int loadProfiles(const QString& profilesPath);
     void updateHelpText();
     QString xlateRoutinoError(int err);
+    /// get at least n database handles for the database described by map
+    QVector<Routino_Database*> getThreadDatabases(const QVariantMap& map, int n);
+    static void readRoute(Routino_Output* route, bool quickest, QPolygonF& coords, qreal* costs);
     static CRouterRoutino* pSelf;
 
     QStringList dbPaths;
     QString currentProfilesPath;
 
+    /**
+       Routino keeps the state of a calculation with the database handle. Thus
+       each thread needs it's own handle. They are loaded on demand and kept
+       until the database list is rebuilt. The key is the database's path and prefix.
+     */
+    QHash<QString, QVector<Routino_Database*> > threadDatabases;
+
+    /// idle database handles for calcRoutesAsync(), same key as threadDatabases
+    QHash<QString, QList<Routino_Database*> > asyncDatabases;
+    /// protect asyncDatabases, the jobs give back their handle from the worker thread
+    QMutex mutexAsync;
+    /// the abort flags of the running jobs of calcRoutesAsync()
+    QHash<qint32, QSharedPointer<QAtomicInt> > asyncJobs;
+    QList<QFuture<void> > asyncFutures;
+
     QMutex mutex {QMutex::NonRecursive};
 };
 
@@ -43,16 +43,35 @@ CRouterSetup::CRouterSetup(QWidget* parent)
     stackedWidget->addWidget(new CRouterMapQuest(this));
     stackedWidget->addWidget(new CRouterBRouter(this));
 
+    for(int i = 0; i < stackedWidget->count(); i++)
+    {
+        IRouter* router = dynamic_cast<IRouter*>(stackedWidget->widget(i));
+        // queued, as routers might emit the signals before calcRoutesAsync() returned the request's id
+        connect(router, &IRouter::sigRouteLegFinished, this, &CRouterSetup::slotRouteLegFinished, Qt::QueuedConnection);
+        connect(router, &IRouter::sigRoutesFinished, this, &CRouterSetup::slotRoutesFinished, Qt::QueuedConnection);
+    }
+
     connect(comboRouter, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &CRouterSetup::slotSelectRouter);
 
     SETTINGS;
     comboRouter->setCurrentIndex(cfg.value("Route/current", 0).toInt());
+    checkRouteCache->setChecked(cfg.value("Route/cache/enabled", true).toBool());
+    spinRouteCacheSize->setValue(cfg.value("Route/cache/maxSize", 50).toInt());
+    routeCache.setMaxSize(spinRouteCacheSize->value());
+
+    connect(checkRouteCache, &QCheckBox::toggled, this, &CRouterSetup::slotRouteCacheChanged);
+    connect(spinRouteCacheSize, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &CRouterSetup::slotRouteCacheChanged);
+    connect(toolClearRouteCache, &QToolButton::clicked, this, &CRouterSetup::slotClearRouteCache);
+
+    updateRouteCacheStatus();
 }
 
 CRouterSetup::~CRouterSetup()
 {
     SETTINGS;
     cfg.setValue("Route/current", comboRouter->currentIndex());
+    cfg.setValue("Route/cache/enabled", checkRouteCache->isChecked());
+    cfg.setValue("Route/cache/maxSize", spinRouteCacheSize->value());
 }
 
 bool CRouterSetup::hasFastRouting()
@@ -87,12 +106,262 @@ void CRouterSetup::calcRoute(const IGisItem::key_t& key)
 int CRouterSetup::calcRoute(const QPointF& p1, const QPointF& p2, QPolygonF& coords, qreal* costs)
 {
     IRouter* router = dynamic_cast<IRouter*>(stackedWidget->currentWidget());
-    if(router)
+    if(router == nullptr)
     {
-        return router->calcRoute(p1, p2, coords, costs);
+        return false;
     }
 
-    return false;
+    const QString& context = getCacheContext(router);
+
+    qreal _costs = -1;
+    if(!context.isEmpty() && routeCache.find(context, p1, p2, coords, _costs))
+    {
+        if(costs != nullptr)
+        {
+            *costs = _costs;
+        }
+        updateRouteCacheStatus();
+        return coords.size();
+    }
+
+    int res = router->calcRoute(p1, p2, coords, &_costs);
+    if(costs != nullptr)
+    {
+        *costs = _costs;
+    }
+
+    if(!context.isEmpty() && res > 0)
+    {
+        routeCache.insert(context, p1, p2, coords, _costs);
+    }
+    updateRouteCacheStatus();
+
+    return res;
+}
+
+int CRouterSetup::calcRoutes(QVector<IRouter::leg_t>& legs, const IRouter::fCanceled& canceled)
+{
+    IRouter* router = dynamic_cast<IRouter*>(stackedWidget->currentWidget());
+    if(router == nullptr)
+    {
+        return 0;
+    }
+
+    const QString& context = getCacheContext(router);
+    if(context.isEmpty())
+    {
+        return router->calcRoutes(legs, canceled);
+    }
+
+    // pass only the legs not found in the cache to the router
+    int cnt = 0;
+    QVector<int> indices;
+    QVector<IRouter::leg_t> missing;
+    for(int i = 0; i < legs.size(); i++)
+    {
+        IRouter::leg_t& leg = legs[i];
+        if(routeCache.find(context, leg.p1, leg.p2, leg.coords, leg.costs))
+        {
+            leg.result = leg.coords.size();
+            cnt++;
+        }
+        else
+        {
+            indices << i;
+            missing << leg;
+        }
+    }
+
+    if(!missing.isEmpty())
+    {
+        int res = router->calcRoutes(missing, canceled);
+        if(res < 0)
+        {
+            updateRouteCacheStatus();
+            return -1;
+        }
+
+        for(int i = 0; i < missing.size(); i++)
+        {
+            const IRouter::leg_t& leg = missing[i];
+            legs[indices[i]] = leg;
+            if(leg.result > 0)
+            {
+                routeCache.insert(context, leg.p1, leg.p2, leg.coords, leg.costs);
+            }
+        }
+        cnt += res;
+    }
+    updateRouteCacheStatus();
+
+    return cnt;
+}
+
+qint32 CRouterSetup::calcRoutesAsync(const QVector<IRouter::leg_t>& legs)
+{
+    const qint32 id = ++lastAsyncId;
+
+    async_t& request = asyncRequests[id];
+    request.router = dynamic_cast<IRouter*>(stackedWidget->currentWidget());
+    if(request.router == nullptr)
+    {
+        request.routerDone = true;
+        request.cacheDone = true;
+        QTimer::singleShot(0, this, [this, id](){checkAsyncFinished(id); });
+        return id;
+    }
+
+    request.context = getCacheContext(request.router);
+
+    QVector<IRouter::leg_t> cached;
+    QVector<IRouter::leg_t> missing;
+    for(IRouter::leg_t leg : legs)
+    {
+        if(!request.context.isEmpty() && routeCache.find(request.context, leg.p1, leg.p2, leg.coords, leg.costs))
+        {
+            leg.result = leg.coords.size();
+            cached << leg;
+        }
+        else
+        {
+            missing << leg;
+        }
+    }
+    updateRouteCacheStatus();
+
+    QTimer::singleShot(0, this, [this, id, cached]()
+    {
+        for(const IRouter::leg_t& leg : cached)
+        {
+            // the request might be canceled by a receiver of the signal
+            if(!asyncRequests.contains(id))
+            {
+                return;
+            }
+            emit sigRouteLegFinished(id, leg);
+        }
+
+        if(asyncRequests.contains(id))
+        {
+            asyncRequests[id].cacheDone = true;
+            checkAsyncFinished(id);
+        }
+    });
+
+    if(missing.isEmpty())
+    {
+        request.routerDone = true;
+    }
+    else
+    {
+        request.router->calcRoutesAsync(id, missing);
+    }
+
+    return id;
+}
+
+void CRouterSetup::cancelRoutesAsync(qint32 id)
+{
+    if(!asyncRequests.contains(id))
+    {
+        return;
+    }
+
+    const async_t& request = asyncRequests.take(id);
+    if(request.router != nullptr && !request.routerDone)
+    {
+        request.router->cancelRoutesAsync(id);
+    }
+}
+
+void CRouterSetup::slotRouteLegFinished(qint32 id, const IRouter::leg_t& leg)
+{
+    if(!asyncRequests.contains(id))
+    {
+        return;
+    }
+
+    const QString& context = asyncRequests[id].context;
+    if(!context.isEmpty() && leg.result > 0)
+    {
+        routeCache.insert(context, leg.p1, leg.p2, leg.coords, leg.costs);
+        updateRouteCacheStatus();
+    }
+
+    emit sigRouteLegFinished(id, leg);
+}
+
+void CRouterSetup::slotRoutesFinished(qint32 id, const QString& error)
+{
+    if(!asyncRequests.contains(id))
+    {
+        return;
+    }
+
+    async_t& request = asyncRequests[id];
+    request.routerDone = true;
+    request.error = error;
+    checkAsyncFinished(id);
+}
+
+void CRouterSetup::checkAsyncFinished(qint32 id)
+{
+    if(!asyncRequests.contains(id))
+    {
+        return;
+    }
+
+    const async_t& request = asyncRequests[id];
+    if(request.routerDone && request.cacheDone)
+    {
+        emit sigRoutesFinished(id, asyncRequests.take(id).error);
+    }
+}
+
+QString CRouterSetup::getCacheContext(IRouter* router)
+{
+    if(!checkRouteCache->isChecked() || !router->hasFastRouting())
+    {
+        return QString();
+    }
+
+    const QString& version = router->getDataVersion();
+    if(version.isEmpty())
+    {
+        return QString();
+    }
+
+    // any change to the no-go areas results in a new hash
+    QList<IGisItem*> nogos;
+    CGisWorkspace::self().getNogoAreas(nogos);
+
+    QStringList nogoKeys;
+    for(IGisItem* item : qAsConst(nogos))
+    {
+        nogoKeys << item->getKey().item + ":" + item->getHash();
+    }
+    nogoKeys.sort();
+
+    return QString("%1|%2|%3|%4").arg(comboRouter->currentIndex()).arg(router->getOptions(), version, nogoKeys.join(","));
+}
+
+void CRouterSetup::slotRouteCacheChanged()
+{
+    routeCache.setMaxSize(spinRouteCacheSize->value());
+    updateRouteCacheStatus();
+}
+
+void CRouterSetup::slotClearRouteCache()
+{
+    routeCache.clear();
+    updateRouteCacheStatus();
+}
+
+void CRouterSetup::updateRouteCacheStatus()
+{
+    spinRouteCacheSize->setEnabled(checkRouteCache->isChecked());
+    labelRouteCache->setEnabled(checkRouteCache->isChecked());
+    labelRouteCache->setText(routeCache.getStatistics());
 }
 
 QString CRouterSetup::getOptions()
@@ -20,6 +20,8 @@
 #define CROUTERSETUP_H
 
 #include "gis/IGisItem.h"
+#include "gis/rte/router/CRouterCache.h"
+#include "gis/rte/router/IRouter.h"
 #include "ui_IRouterSetup.h"
 #include <QWidget>
 
@@ -35,6 +37,19 @@ public:
 
     void calcRoute(const IGisItem::key_t& key);
     int calcRoute(const QPointF& p1, const QPointF& p2, QPolygonF& coords, qreal* costs = nullptr);
+    /// calculate a batch of routes with the current router, see IRouter::calcRoutes()
+    int calcRoutes(QVector<IRouter::leg_t>& legs, const IRouter::fCanceled& canceled);
+    /**
+       @brief Calculate routes with the current router without blocking
+
+       See IRouter::calcRoutesAsync(). The results are reported by the signals
+       of this class. Routes found in the route cache are reported with the
+       next event loop cycle. No signals are emitted for canceled requests.
+
+       @return The id of the request
+     */
+    qint32 calcRoutesAsync(const QVector<IRouter::leg_t>& legs);
+    void cancelRoutesAsync(qint32 id);
     QString getOptions();
 
     bool hasFastRouting();
@@ -43,13 +58,46 @@ public:
 
     void setRouterTitle(router_e, QString title);
 
+signals:
+    void sigRouteLegFinished(qint32 id, const IRouter::leg_t& leg);
+    void sigRoutesFinished(qint32 id, const QString& error);
+
 private slots:
     void slotSelectRouter(int i);
+    void slotRouteLegFinished(qint32 id, const IRouter::leg_t& leg);
+    void slotRoutesFinished(qint32 id, const QString& error);
+    void slotRouteCacheChanged();
+    void slotClearRouteCache();
 
 private:
     friend class Ui_IMainWindow;
     CRouterSetup(QWidget* parent);
 
+    /**
+       @brief Get the context of a route request for the route cache
+
+       @return The context or an empty string if the route cache can't be used
+     */
+    QString getCacheContext(IRouter* router);
+    void updateRouteCacheStatus();
+    /// emit sigRoutesFinished() if the router and the route cache are done with the request
+    void checkAsyncFinished(qint32 id);
+
+    CRouterCache routeCache;
+
+    struct async_t
+    {
+        IRouter* router = nullptr;
+        QString context;
+        QString error;
+        bool routerDone = false;
+        bool cacheDone = false;
+    };
+
+    /// the pending requests of calcRoutesAsync()
+    QHash<qint32, async_t> asyncRequests;
+    qint32 lastAsyncId = 0;
+
     static CRouterSetup* pSelf;
 };
 
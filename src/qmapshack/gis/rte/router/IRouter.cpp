@@ -18,13 +18,90 @@
 
 #include "gis/rte/router/IRouter.h"
 
+#include <QtCore>
+
 IRouter::IRouter(bool fastRouting, QWidget* parent)
     : QWidget(parent)
     , fastRouting(fastRouting)
 {
+    qRegisterMetaType<IRouter::leg_t>("IRouter::leg_t");
 }
 
 IRouter::~IRouter()
 {
 }
 
+
+int IRouter::calcRoutes(QVector<leg_t>& legs, const fCanceled& canceled)
+{
+    int cnt = 0;
+    for(leg_t& leg : legs)
+    {
+        if(canceled())
+        {
+            return -1;
+        }
+
+        leg.result = calcRoute(leg.p1, leg.p2, leg.coords, &leg.costs);
+        if(leg.result > 0)
+        {
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+void IRouter::calcRoutesAsync(qint32 id, const QVector<leg_t>& legs)
+{
+    if(asyncRequests.isEmpty())
+    {
+        QTimer::singleShot(0, this, &IRouter::slotNextAsyncLeg);
+    }
+    asyncRequests[id] = legs;
+}
+
+void IRouter::cancelRoutesAsync(qint32 id)
+{
+    asyncRequests.remove(id);
+    asyncErrors.remove(id);
+}
+
+void IRouter::slotNextAsyncLeg()
+{
+    if(asyncRequests.isEmpty() || asyncBusy)
+    {
+        return;
+    }
+
+    const qint32 id = asyncRequests.firstKey();
+    QVector<leg_t>& legs = asyncRequests.first();
+
+    if(!legs.isEmpty())
+    {
+        leg_t leg = legs.takeFirst();
+        asyncBusy = true;
+        try
+        {
+            leg.result = calcRoute(leg.p1, leg.p2, leg.coords, &leg.costs);
+        }
+        catch(const QString& msg)
+        {
+            leg.result = -1;
+            asyncErrors[id] = msg;
+        }
+        asyncBusy = false;
+        emit sigRouteLegFinished(id, leg);
+    }
+
+    // the request might be canceled by a receiver of the signal
+    if(asyncRequests.contains(id) && asyncRequests[id].isEmpty())
+    {
+        asyncRequests.remove(id);
+        emit sigRoutesFinished(id, asyncErrors.take(id));
+    }
+
+    if(!asyncRequests.isEmpty())
+    {
+        QTimer::singleShot(0, this, &IRouter::slotNextAsyncLeg);
+    }
+}
@@ -20,6 +20,7 @@
 #define IROUTER_H
 
 #include "gis/IGisItem.h"
+#include <functional>
 #include <QWidget>
 
 class IRouter : public QWidget
@@ -29,8 +30,57 @@ public:
     IRouter(bool fastRouting, QWidget* parent);
     virtual ~IRouter();
 
+    /// a single route between two points as used by calcRoutes()
+    struct leg_t
+    {
+        QPointF p1;
+        QPointF p2;
+        QPolygonF coords;
+        qreal costs = -1;
+        /// the result of the calculation, the number of points in coords or -1 on failure
+        qint32 result = -1;
+        /// free to use by the caller, it is passed back unchanged
+        qint32 idx = -1;
+    };
+
+    /// polled while calcRoutes() is busy, return true to abort the calculation
+    using fCanceled = std::function<bool()>;
+
     virtual void calcRoute(const IGisItem::key_t& key) = 0;
     virtual int calcRoute(const QPointF& p1, const QPointF& p2, QPolygonF& coords, qreal* costs = nullptr) = 0;
+
+    /**
+       @brief Calculate a batch of independent routes
+
+       The default implementation calls calcRoute() for one leg after the other.
+       Routers able to serve several requests at once override it to calculate
+       the legs concurrently. The GUI event loop is kept running meanwhile.
+
+       @param legs      the legs to calculate, the results are stored in the items
+       @param canceled  polled from time to time to check if the user aborted the operation
+
+       @return The number of successfully calculated legs or -1 if the operation was canceled.
+     */
+    virtual int calcRoutes(QVector<leg_t>& legs, const fCanceled& canceled);
+
+    /**
+       @brief Calculate routes without blocking the GUI
+
+       The result of each leg is reported by sigRouteLegFinished() as soon
+       as it is available. The order of the results is not defined. After the
+       last leg sigRoutesFinished() is emitted. Signals of a request canceled
+       by cancelRoutesAsync() might still be in the event queue. The receiver
+       has to ignore them.
+
+       The default implementation calls calcRoute() for one leg per event loop cycle.
+
+       @param id    an unique id to identify the request's signals
+       @param legs  the legs to calculate
+     */
+    virtual void calcRoutesAsync(qint32 id, const QVector<leg_t>& legs);
+    /// cancel a request of calcRoutesAsync(), calculations in progress are aborted if possible
+    virtual void cancelRoutesAsync(qint32 id);
+
     virtual bool hasFastRouting()
     {
         return fastRouting;
@@ -38,11 +88,40 @@ public:
 
     virtual QString getOptions() = 0;
 
+    /**
+       @brief Identify the routing data used by the router
+
+       Used as part of the route cache's key. The string has to change
+       as soon as the routing data or the profiles are updated.
+
+       @return A string identifying the data or an empty string to disable the route cache
+     */
+    virtual QString getDataVersion()
+    {
+        return QString();
+    }
+
     virtual void routerSelected() {}
 
+signals:
+    void sigRouteLegFinished(qint32 id, const IRouter::leg_t& leg);
+    void sigRoutesFinished(qint32 id, const QString& error);
+
+private slots:
+    void slotNextAsyncLeg();
+
 private:
     bool fastRouting;
+
+    /// pending requests of the default calcRoutesAsync()
+    QMap<qint32, QVector<leg_t> > asyncRequests;
+    /// the last error message of each pending request
+    QMap<qint32, QString> asyncErrors;
+    /// true while slotNextAsyncLeg() is calculating, to block re-entrance from nested event loops
+    bool asyncBusy = false;
 };
 
+Q_DECLARE_METATYPE(IRouter::leg_t)
+
 #endif //IROUTER_H
 
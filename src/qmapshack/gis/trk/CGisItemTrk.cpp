@@ -1047,7 +1047,7 @@ void CGisItemTrk::verifyTrkPt(CTrackData::trkpt_t*& last, CTrackData::trkpt_t& t
     trkpt.valid |= (trkpt.slope1 == NOFLOAT) || (trkpt.slope2 == NOFLOAT) ? quint32(CTrackData::trkpt_t::eInvalidSlope) : quint32(CTrackData::trkpt_t::eValidSlope);
 }
 
-void CGisItemTrk::consolidatePoints()
+void CGisItemTrk::consolidatePoints(CTrackData& trk)
 {
     for(CTrackData::trkseg_t& seg : trk.segs)
     {
@@ -1063,26 +1063,20 @@ void CGisItemTrk::consolidatePoints()
 
 void CGisItemTrk::deriveSecondaryData()
 {
-    consolidatePoints();
+    derived_t derived;
+    deriveTrackData(trk, derived);
+    deriveSecondaryData(derived);
+}
+
+void CGisItemTrk::deriveTrackData(CTrackData& trk, derived_t& derived)
+{
+    consolidatePoints(trk);
 
     qreal north = -90;
     qreal east = -180;
     qreal south = 90;
     qreal west = 180;
 
-    // reset all secondary data
-    allValidFlags = 0;
-    cntInvalidPoints = 0;
-    cntTotalPoints = 0;
-    cntVisiblePoints = 0;
-    timeStart = QDateTime();
-    timeEnd = QDateTime();
-    totalDistance = NOFLOAT;
-    totalAscent = NOFLOAT;
-    totalDescent = NOFLOAT;
-    totalElapsedSeconds = NOTIME;
-    totalElapsedSecondsMoving = NOTIME;
-
     trk.removeEmptySegments();
 
     // no data -> nothing to do
@@ -1091,8 +1085,6 @@ void CGisItemTrk::deriveSecondaryData()
         return;
     }
 
-    activities.updateFlags();
-
     CTrackData::trkpt_t* lastValid = nullptr;
     CTrackData::trkpt_t* lastTrkpt = nullptr;
     qreal timestampStart = NOFLOAT;
@@ -1104,7 +1096,7 @@ void CGisItemTrk::deriveSecondaryData()
 
     for(CTrackData::trkpt_t& trkpt : trk)
     {
-        trkpt.idxTotal = cntTotalPoints++;
+        trkpt.idxTotal = derived.cntTotalPoints++;
 
         if(trkpt.isHidden())
         {
@@ -1113,7 +1105,7 @@ void CGisItemTrk::deriveSecondaryData()
         }
 
 
-        trkpt.idxVisible = cntVisiblePoints++;
+        trkpt.idxVisible = derived.cntVisiblePoints++;
         lintrk << &trkpt;
 
         west = qMin(west, trkpt.lon);
@@ -1161,8 +1153,8 @@ void CGisItemTrk::deriveSecondaryData()
         }
         else
         {
-            timeStart = trkpt.time;
-            timestampStart = timeStart.toMSecsSinceEpoch() / 1000.0;
+            derived.timeStart = trkpt.time;
+            timestampStart = derived.timeStart.toMSecsSinceEpoch() / 1000.0;
             lastEle = trkpt.ele;
 
             trkpt.deltaDistance = 0;
@@ -1176,7 +1168,7 @@ void CGisItemTrk::deriveSecondaryData()
         lastTrkpt = &trkpt;
     }
 
-    boundingRect = QRectF(QPointF(west * DEG_TO_RAD, north * DEG_TO_RAD), QPointF(east * DEG_TO_RAD, south * DEG_TO_RAD));
+    derived.boundingRect = QRectF(QPointF(west * DEG_TO_RAD, north * DEG_TO_RAD), QPointF(east * DEG_TO_RAD, south * DEG_TO_RAD));
 
     for(int p = 0; p < lintrk.size(); p++)
     {
@@ -1246,23 +1238,48 @@ void CGisItemTrk::deriveSecondaryData()
         // verify data
         verifyTrkPt(lastValid, trkpt);
         // add current status to allValidFlags
-        allValidFlags |= trkpt.valid;
+        derived.allValidFlags |= trkpt.valid;
         if((trkpt.valid & 0xFFFF0000) != 0)
         {
-            cntInvalidPoints++;
+            derived.cntInvalidPoints++;
         }
     }
 
     if(nullptr != lastTrkpt)
     {
-        timeEnd = lastTrkpt->time;
-        totalDistance = lastTrkpt->distance;
-        totalAscent = lastTrkpt->ascent;
-        totalDescent = lastTrkpt->descent;
-        totalElapsedSeconds = lastTrkpt->elapsedSeconds;
-        totalElapsedSecondsMoving = lastTrkpt->elapsedSecondsMoving;
+        derived.timeEnd = lastTrkpt->time;
+        derived.totalDistance = lastTrkpt->distance;
+        derived.totalAscent = lastTrkpt->ascent;
+        derived.totalDescent = lastTrkpt->descent;
+        derived.totalElapsedSeconds = lastTrkpt->elapsedSeconds;
+        derived.totalElapsedSecondsMoving = lastTrkpt->elapsedSecondsMoving;
     }
+}
 
+void CGisItemTrk::deriveSecondaryData(const derived_t& derived)
+{
+    allValidFlags = derived.allValidFlags;
+    cntInvalidPoints = derived.cntInvalidPoints;
+    cntTotalPoints = derived.cntTotalPoints;
+    cntVisiblePoints = derived.cntVisiblePoints;
+    colorIndex.clear();
+    timeStart = derived.timeStart;
+    timeEnd = derived.timeEnd;
+    totalDistance = derived.totalDistance;
+    totalAscent = derived.totalAscent;
+    totalDescent = derived.totalDescent;
+    totalElapsedSeconds = derived.totalElapsedSeconds;
+    totalElapsedSecondsMoving = derived.totalElapsedSecondsMoving;
+
+    // no data -> nothing to do
+    if(trk.isEmpty())
+    {
+        return;
+    }
+
+    boundingRect = derived.boundingRect;
+
+    activities.updateFlags();
     activities.update();
 
     updateExtremaAndExtensions();
@@ -2006,11 +2023,11 @@ void CGisItemTrk::drawItem(QPainter& p, const QPolygonF& viewport, QList<QRectF>
     }
     else if(getColorizeSource() == "activity")
     {
-        drawColorizedByActivity(p);
+        drawColorizedByActivity(p, extViewport);
     }
     else
     {
-        drawColorized(p);
+        drawColorized(p, extViewport);
     }
 
     if (isNogo())
@@ -2119,71 +2136,116 @@ void CGisItemTrk::drawLimitLabels(limit_type_e type, const QString& label, const
     blockedAreas << rect;
 }
 
-void CGisItemTrk::setPen(QPainter& p, QPen& pen, trkact_t act) const
+void CGisItemTrk::drawColorizedByActivity(QPainter& p, const QRectF& extViewport)
 {
-    pen.setColor((act == CTrackData::trkpt_t::eAct20None) ? color : CActivityTrk::getDescriptor(act).color);
-    p.setPen(pen);
+    const QRgb colorNone = color.rgb();
+    drawColorRuns(p, extViewport, [colorNone](const CTrackData::trkpt_t& ptPrev, const CTrackData::trkpt_t&) -> QRgb
+    {
+        const trkact_t act = ptPrev.getAct();
+        return act == CTrackData::trkpt_t::eAct20None ? colorNone : CActivityTrk::getDescriptor(act).color.rgb();
+    });
 }
 
-void CGisItemTrk::drawColorizedByActivity(QPainter& p) const
+/// the color table of colorized tracks, from red (high) to blue (low)
+static const QVector<QRgb>& colorizeTable()
 {
-    QPen pen;
-    pen.setWidth(penWidthFg);
-    pen.setCapStyle(Qt::RoundCap);
-
-    for(const CTrackData::trkseg_t& segment : trk.segs)
+    static const QVector<QRgb> table = []() -> QVector<QRgb>
     {
-        const CTrackData::trkpt_t* ptPrev = nullptr;
+        QImage colors(1, 256, QImage::Format_RGB888);
+        QPainter colorsPainter(&colors);
 
-        for(const CTrackData::trkpt_t& pt : segment.pts)
+        QLinearGradient colorsGradient(colors.rect().topLeft(), colors.rect().bottomLeft());
+        colorsGradient.setColorAt(1.0, QColor(  0, 0, 255));   // blue
+        colorsGradient.setColorAt(0.6, QColor(  0, 255, 0));   // green
+        colorsGradient.setColorAt(0.4, QColor(255, 255, 0));   // yellow
+        colorsGradient.setColorAt(0.0, QColor(255, 0, 0));     // red
+        colorsPainter.fillRect(colors.rect(), colorsGradient);
+        colorsPainter.end();
+
+        QVector<QRgb> table(256);
+        for(int i = 0; i < 256; i++)
         {
-            if(pt.isHidden())
-            {
-                continue;
-            }
-            if(nullptr == ptPrev)
-            {
-                setPen(p, pen, pt.getAct());
-                ptPrev = &pt;
-                continue;
-            }
+            table[i] = colors.pixel(0, i);
+        }
+        return table;
+    }();
+
+    return table;
+}
 
-            p.drawLine(lineSimple[ptPrev->idxVisible], lineSimple[pt.idxVisible]);
+void CGisItemTrk::updateColorIndex()
+{
+    const QString& source = getColorizeSource();
+    const qreal low = getColorizeLimitLow();
+    const qreal high = getColorizeLimitHigh();
 
-            if(ptPrev->getAct() != pt.getAct())
-            {
-                setPen(p, pen, pt.getAct());
-            }
+    if(colorIndex.size() == qint32(cntVisiblePoints) && source == colorIndexSource && low == colorIndexLow && high == colorIndexHigh)
+    {
+        return;
+    }
 
-            ptPrev = &pt;
+    colorIndexSource = source;
+    colorIndexLow = low;
+    colorIndexHigh = high;
+
+    const CKnownExtension& ext = CKnownExtension::get(source);
+    auto valueFunc = ext.valueFunc;
+    const qreal factor = ext.factor;
+
+    colorIndex.fill(0, cntVisiblePoints);
+    for(const CTrackData::trkpt_t& pt : trk)
+    {
+        if(pt.isHidden() || pt.idxVisible < 0 || pt.idxVisible >= colorIndex.size())
+        {
+            continue;
         }
+
+        float colorAt = ( factor * valueFunc(pt) - low ) / (high - low);
+        colorAt = qMin(qMax(colorAt, 0.f), 1.f);
+        colorIndex[pt.idxVisible] = quint8((1.f - colorAt) * 255.f);
     }
 }
 
-void CGisItemTrk::drawColorized(QPainter& p) const
+void CGisItemTrk::drawColorized(QPainter& p, const QRectF& extViewport)
 {
-    auto valueFunc = CKnownExtension::get(getColorizeSource()).valueFunc;
+    updateColorIndex();
+
+    const QVector<QRgb>& colors = colorizeTable();
+    const QVector<quint8>& index = colorIndex;
+    drawColorRuns(p, extViewport, [&colors, &index](const CTrackData::trkpt_t&, const CTrackData::trkpt_t& pt) -> QRgb
+    {
+        return colors[index[pt.idxVisible]];
+    });
+}
 
-    QImage colors(1, 256, QImage::Format_RGB888);
-    QPainter colorsPainter(&colors);
+void CGisItemTrk::drawColorRuns(QPainter& p, const QRectF& extViewport, std::function<QRgb(const CTrackData::trkpt_t&, const CTrackData::trkpt_t&)> colorFunc)
+{
+    QPen pen;
+    pen.setWidth(penWidthFg);
+    pen.setCapStyle(Qt::RoundCap);
+    pen.setJoinStyle(Qt::RoundJoin);
 
-    QLinearGradient colorsGradient(colors.rect().topLeft(), colors.rect().bottomLeft());
-    colorsGradient.setColorAt(1.0, QColor(  0, 0, 255));   // blue
-    colorsGradient.setColorAt(0.6, QColor(  0, 255, 0));   // green
-    colorsGradient.setColorAt(0.4, QColor(255, 255, 0));   // yellow
-    colorsGradient.setColorAt(0.0, QColor(255, 0, 0));     // red
-    colorsPainter.fillRect(colors.rect(), colorsGradient);
+    QPolygonF run;
+    QRgb runColor = 0;
 
-    const qreal factor = CKnownExtension::get(getColorizeSource()).factor;
+    auto flush = [&]()
+    {
+        if(run.size() > 1)
+        {
+            pen.setColor(runColor);
+            p.setPen(pen);
+            p.drawPolyline(run);
+        }
+        run.resize(0);
+    };
 
     for(const CTrackData::trkseg_t& segment : trk.segs)
     {
         const CTrackData::trkpt_t* ptPrev = nullptr;
-        QColor colorStart;
 
         for(const CTrackData::trkpt_t& pt : segment.pts)
         {
-            if(pt.isHidden())
+            if(pt.isHidden() || pt.idxVisible < 0 || pt.idxVisible >= lineSimple.size())
             {
                 continue;
             }
@@ -2193,30 +2255,32 @@ void CGisItemTrk::drawColorized(QPainter& p) const
                 continue;
             }
 
-            float colorAt = ( factor * valueFunc(pt) - getColorizeLimitLow() ) / (getColorizeLimitHigh() - getColorizeLimitLow());
-            colorAt = qMin(qMax(colorAt, 0.f), 1.f);
+            const CTrackData::trkpt_t& pt0 = *ptPrev;
+            const QPointF& pt1 = lineSimple[pt0.idxVisible];
+            const QPointF& pt2 = lineSimple[pt.idxVisible];
+            ptPrev = &pt;
 
-            const QColor& colorEnd = colors.pixel(0, ((1.f - colorAt) * 255.f));
-            if(!colorStart.isValid())
+            const bool isVisible = qMax(pt1.x(), pt2.x()) >= extViewport.left()
+                                   && qMin(pt1.x(), pt2.x()) <= extViewport.right()
+                                   && qMax(pt1.y(), pt2.y()) >= extViewport.top()
+                                   && qMin(pt1.y(), pt2.y()) <= extViewport.bottom();
+            if(!isVisible)
             {
-                colorStart = colorEnd;
+                flush();
+                continue;
             }
 
-            QLinearGradient grad(lineSimple[ptPrev->idxVisible], lineSimple[pt.idxVisible]);
-            grad.setColorAt(0.f, colorStart);
-            grad.setColorAt(1.f, colorEnd);
-
-            QPen pen;
-            pen.setBrush(QBrush(grad));
-            pen.setWidth(penWidthFg);
-            pen.setCapStyle(Qt::RoundCap);
-
-            p.setPen(pen);
-            p.drawLine(lineSimple[ptPrev->idxVisible], lineSimple[pt.idxVisible]);
-
-            ptPrev = &pt;
-            colorStart = colorEnd;
+            const QRgb segColor = colorFunc(pt0, pt);
+            if(run.isEmpty() || segColor != runColor)
+            {
+                flush();
+                run << pt1;
+                runColor = segColor;
+            }
+            run << pt2;
         }
+
+        flush();
     }
 }
 
@@ -81,6 +81,13 @@ public:
         , eRangeStateMove2nd
     };
 
+    /// algorithms to select the track points hidden by filterReducePoints()
+    enum reduce_e
+    {
+        eReduceDouglasPeuker
+        , eReduceVisvalingamWhyatt
+    };
+
     enum visual_e
     {
         eVisualNone          = 0
@@ -320,9 +327,21 @@ public:
     qreal getMax(const QString& source) const;
 
 private:
-    void drawColorized(QPainter& p) const;
-    void drawColorizedByActivity(QPainter& p) const;
-    void setPen(QPainter& p, QPen& pen, trkact_t act) const;
+    void drawColorized(QPainter& p, const QRectF& extViewport);
+    void drawColorizedByActivity(QPainter& p, const QRectF& extViewport);
+    /**
+       @brief Draw the visible part of lineSimple with a color per line segment
+
+       Line segments outside the viewport are skipped. Consecutive segments of the same
+       color are drawn as a single polyline.
+
+       @param p             the painter to use
+       @param extViewport   the viewport in [px]
+       @param colorFunc     returns the color of the segment between two visible points
+     */
+    void drawColorRuns(QPainter& p, const QRectF& extViewport, std::function<QRgb(const CTrackData::trkpt_t&, const CTrackData::trkpt_t&)> colorFunc);
+    /// update colorIndex if the colorize source, it's limits or the track have changed
+    void updateColorIndex();
     /**@}*/
 
 
@@ -589,20 +608,27 @@ public:
 
         @note All filter implementations are found in src/gis/trk/filter/filter.cpp
 
+        The expensive filters run in a background thread on a copy of the
+        track data. The static variants apply the filter to several tracks
+        in parallel.
+
         @{
      */
     /**
-       @brief Reduce the amount of visible track points with the help of the Douglas Peuker algorithm
+       @brief Reduce the amount of visible track points
 
-       @param dist the Douglas Peuker distance in meters
+       @param threshold the Douglas Peuker distance in meters or the Visvalingam Whyatt area in square meters
+       @param algorithm the algorithm used to select the points
      */
-    void filterReducePoints(qreal dist);
+    void filterReducePoints(qreal threshold, reduce_e algorithm);
+    static void filterReducePoints(const QList<CGisItemTrk*>& trks, qreal threshold, reduce_e algorithm);
 
     /** @brief Remove track points without valid location at the beginning of the track */
     void filterRemoveInvalidPoints();
 
     /** @param points  size of Median filter */
     void filterSmoothProfile(int points);
+    static void filterSmoothProfile(const QList<CGisItemTrk*>& trks, int points);
 
     /** @param offset elevation offset in meters */
     void filterOffsetElevation(int offset);
@@ -631,6 +657,7 @@ public:
     void filterChangeStartPoint(qint32 idxNewStartPoint, const QString& wptName);
     void filterLoopsCut(qreal dist);
     void filterZeroSpeedDriftCleaner(qreal distance, qreal ratio);
+    static void filterZeroSpeedDriftCleaner(const QList<CGisItemTrk*>& trks, qreal distance, qreal ratio);
     /** @} */
 
     /**
@@ -674,7 +701,7 @@ private:
     /**
        @brief Consolidate points and subpoints
      */
-    void consolidatePoints();
+    static void consolidatePoints(CTrackData& trk);
 
     /**
        @brief Derive secondary data from the track data
@@ -683,12 +710,70 @@ private:
      */
     void deriveSecondaryData();
 
+    /// the statistics collected by deriveTrackData()
+    struct derived_t
+    {
+        quint32 allValidFlags = 0;
+        qint32 cntInvalidPoints = 0;
+        qint32 cntTotalPoints = 0;
+        qint32 cntVisiblePoints = 0;
+        QRectF boundingRect;
+        QDateTime timeStart;
+        QDateTime timeEnd;
+        qreal totalDistance = NOFLOAT;
+        qreal totalAscent = NOFLOAT;
+        qreal totalDescent = NOFLOAT;
+        qreal totalElapsedSeconds = NOTIME;
+        qreal totalElapsedSecondsMoving = NOTIME;
+    };
+
+    /**
+       @brief The part of deriveSecondaryData() operating on the track data only
+
+       As it does not touch the item it can run on a copy of the track
+       data in a worker thread.
+
+       @param trk       the track data to update
+       @param derived   the statistics collected on the way
+     */
+    static void deriveTrackData(CTrackData& trk, derived_t& derived);
+
+    /**
+       @brief Finish deriveSecondaryData() with the results of deriveTrackData()
+
+       @param derived   the statistics of the current track data
+     */
+    void deriveSecondaryData(const derived_t& derived);
+
     /**
      * @brief Reset internal data like range selection and details dialog
      */
     void resetInternalData();
 
-    void verifyTrkPt(CTrackData::trkpt_t*& last, CTrackData::trkpt_t& trkpt);
+    static void verifyTrkPt(CTrackData::trkpt_t*& last, CTrackData::trkpt_t& trkpt);
+
+    /// a filter operating on track data only, returns false if nothing was changed
+    using filter_t = std::function<bool(CTrackData&)>;
+    /**
+       @brief Apply a filter to copies of the tracks' data in the background
+
+       The filter and the track data part of deriveSecondaryData() run for
+       all tracks in parallel while a progress dialog is shown. Once all
+       tracks are done the results replace the track data. If the user
+       cancels, all results are discarded and the tracks stay untouched.
+       The same happens to the result of a track deleted or changed while
+       the filter was running.
+
+       @param trks  the tracks to filter
+       @param filter the filter, it must not access anything but the track data passed
+       @param what  the history entry for changed tracks
+       @param icon  the history entry's icon
+     */
+    static void filterInBackground(const QList<CGisItemTrk*>& trks, const filter_t& filter, const QString& what, const QString& icon);
+
+    static bool reducePoints(CTrackData& trk, qreal threshold, reduce_e algorithm);
+    static bool smoothProfile(CTrackData& trk, int points);
+    static bool zeroSpeedDriftCleaner(CTrackData& trk, qreal distance, qreal ratio);
 
     /** @defgroup ExtremaExtensions Stuff related to calculation of extrema/extensions
 
@@ -878,6 +963,16 @@ private:
     QPolygonF lineSimple;   //< the current track line as screen pixel coordinates
     QPolygonF lineFull;     //< visible and invisible points
 
+    /**
+       The color of each visible point as index into the color table of
+       drawColorized(). It is reset by deriveSecondaryData() and updated by
+       updateColorIndex() with the source and limits used.
+     */
+    QVector<quint8> colorIndex;
+    QString colorIndexSource;
+    qreal colorIndexLow = 0;
+    qreal colorIndexHigh = 0;
+
     qint32 penWidthFg = 1;  //< inner trackline width
     qint32 penWidthBg = 3;  //< outer trackline width
     qint32 penWidthHi = 11; //< highlighted trackline width
@@ -30,22 +30,79 @@ CFilterDouglasPeuker::CFilterDouglasPeuker(CGisItemTrk& trk, QWidget* parent)
 {
     setupUi(this);
 
-    spinBox->setSuffix(IUnit::self().baseUnit);
+    comboAlgorithm->addItem(tr("Douglas Peuker"), CGisItemTrk::eReduceDouglasPeuker);
+    comboAlgorithm->addItem(tr("Visvalingam Whyatt"), CGisItemTrk::eReduceVisvalingamWhyatt);
 
     SETTINGS;
-    spinBox->setValue(cfg.value("TrackDetails/Filter/DouglasPeuker/distance", 5).toInt());
+    distance = cfg.value("TrackDetails/Filter/DouglasPeuker/distance", distance).toInt();
+    area = cfg.value("TrackDetails/Filter/DouglasPeuker/area", area).toInt();
+    const int idx = comboAlgorithm->findData(cfg.value("TrackDetails/Filter/DouglasPeuker/algorithm", CGisItemTrk::eReduceDouglasPeuker).toInt());
+    comboAlgorithm->setCurrentIndex(qMax(0, idx));
+    algorithm = comboAlgorithm->currentData().toInt();
+    showAlgorithm();
 
     connect(toolApply, &QToolButton::clicked, this, &CFilterDouglasPeuker::slotApply);
+    connect(comboAlgorithm, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &CFilterDouglasPeuker::slotAlgorithmChanged);
 }
 
 CFilterDouglasPeuker::~CFilterDouglasPeuker()
 {
+    storeValue();
+
     SETTINGS;
-    cfg.setValue("TrackDetails/Filter/DouglasPeuker/distance", spinBox->value());
+    cfg.setValue("TrackDetails/Filter/DouglasPeuker/algorithm", algorithm);
+    cfg.setValue("TrackDetails/Filter/DouglasPeuker/distance", distance);
+    cfg.setValue("TrackDetails/Filter/DouglasPeuker/area", area);
+}
+
+void CFilterDouglasPeuker::storeValue()
+{
+    if(algorithm == CGisItemTrk::eReduceVisvalingamWhyatt)
+    {
+        area = spinBox->value();
+    }
+    else
+    {
+        distance = spinBox->value();
+    }
+}
+
+void CFilterDouglasPeuker::showAlgorithm()
+{
+    if(algorithm == CGisItemTrk::eReduceVisvalingamWhyatt)
+    {
+        label->setText(tr("Hide track points if the area of the triangle with the neighboring points is less than"));
+        spinBox->setSuffix(IUnit::self().baseUnit + "²");
+        spinBox->setMaximum(100000);
+        spinBox->setValue(area);
+    }
+    else
+    {
+        label->setText(tr("Hide track points if the distance to a line between neighboring points is less than"));
+        spinBox->setSuffix(IUnit::self().baseUnit);
+        spinBox->setMaximum(99);
+        spinBox->setValue(distance);
+    }
+}
+
+void CFilterDouglasPeuker::slotAlgorithmChanged(int idx)
+{
+    storeValue();
+    algorithm = comboAlgorithm->itemData(idx).toInt();
+    showAlgorithm();
 }
 
 void CFilterDouglasPeuker::slotApply()
 {
     CCanvasCursorLock cursorLock(Qt::WaitCursor, __func__);
-    trk.filterReducePoints(spinBox->value() / IUnit::self().baseFactor);
+
+    const qreal baseFactor = IUnit::self().baseFactor;
+    if(algorithm == CGisItemTrk::eReduceVisvalingamWhyatt)
+    {
+        trk.filterReducePoints(spinBox->value() / (baseFactor * baseFactor), CGisItemTrk::eReduceVisvalingamWhyatt);
+    }
+    else
+    {
+        trk.filterReducePoints(spinBox->value() / baseFactor, CGisItemTrk::eReduceDouglasPeuker);
+    }
 }
@@ -33,9 +33,19 @@ public:
 
 private slots:
     void slotApply();
+    void slotAlgorithmChanged(int idx);
 
 private:
+    void storeValue();
+    void showAlgorithm();
+
     CGisItemTrk& trk;
+
+    /// the algorithm shown by the widget
+    qint32 algorithm = 0;
+    /// the last values of both algorithms in base units
+    qint32 distance = 5;
+    qint32 area = 100;
 };
 
 #endif //CFILTERDOUGLASPEUKER_H
@@ -25,11 +25,129 @@
 #include "gis/trk/CGisItemTrk.h"
 #include "gis/trk/CKnownExtension.h"
 #include "gis/trk/CPropertyTrk.h"
+#include "helpers/CProgressDialog.h"
 
 #include <QLineF>
+#include <QtConcurrent>
 #include <QtMath>
 
-void CGisItemTrk::filterReducePoints(qreal dist)
+/// identify the item's state by its current history entry
+static QString historyTag(const IGisItem& item)
+{
+    const IGisItem::history_t& history = item.getHistory();
+    if(history.histIdxCurrent == NOIDX)
+    {
+        return QString();
+    }
+    return QString::number(history.histIdxCurrent) + history.events[history.histIdxCurrent].hash;
+}
+
+void CGisItemTrk::filterInBackground(const QList<CGisItemTrk*>& trks, const filter_t& filter, const QString& what, const QString& icon)
+{
+    struct job_t
+    {
+        key_t key;
+        QString tag;
+        CTrackData trk;
+        derived_t derived;
+        bool changed;
+    };
+
+    // The items are tracked by key as they can be deleted or changed while
+    // the event loop below is running.
+    QVector<job_t> jobs;
+    {
+        QMutexLocker lock(&mutexItems);
+        for(CGisItemTrk* item : trks)
+        {
+            jobs << job_t {item->getKey(), historyTag(*item), item->trk, derived_t(), false};
+        }
+    }
+
+    if(jobs.isEmpty())
+    {
+        return;
+    }
+
+    QFuture<void> future = QtConcurrent::map(jobs, [filter](job_t& job)
+    {
+        job.changed = filter(job.trk);
+        if(job.changed)
+        {
+            deriveTrackData(job.trk, job.derived);
+        }
+    });
+
+    // the watcher's events wake up the loop below as soon as there is progress
+    QFutureWatcher<void> watcher;
+    watcher.setFuture(future);
+
+    PROGRESS_SETUP(what, 0, jobs.count(), CMainWindow::getBestWidgetForParent());
+    while(!future.isFinished())
+    {
+        // user input is blocked until the modal dialog is visible
+        QEventLoop::ProcessEventsFlags flags = QEventLoop::WaitForMoreEvents;
+        if(!progress.isVisible())
+        {
+            flags |= QEventLoop::ExcludeUserInputEvents;
+        }
+        QApplication::processEvents(flags);
+
+        PROGRESS(future.progressValue(),
+        {
+            future.cancel();
+            future.waitForFinished();
+            return;
+        });
+    }
+
+    QMutexLocker lock(&mutexItems);
+    for(job_t& job : jobs)
+    {
+        if(!job.changed)
+        {
+            continue;
+        }
+
+        // drop the result if the track is gone or has been changed in the meantime
+        CGisItemTrk* item = dynamic_cast<CGisItemTrk*>(CGisWorkspace::self().getItemByKey(job.key));
+        if((item == nullptr) || (historyTag(*item) != job.tag))
+        {
+            continue;
+        }
+
+        item->trk = job.trk;
+        item->deriveSecondaryData(job.derived);
+        item->changed(what, icon);
+    }
+}
+
+void CGisItemTrk::filterReducePoints(qreal threshold, reduce_e algorithm)
+{
+    filterReducePoints({this}, threshold, algorithm);
+}
+
+void CGisItemTrk::filterReducePoints(const QList<CGisItemTrk*>& trks, qreal threshold, reduce_e algorithm)
+{
+    QString val, unit, what;
+    if(algorithm == eReduceVisvalingamWhyatt)
+    {
+        IUnit::self().meter2area(threshold, val, unit);
+        what = tr("Hide points by Visvalingam Whyatt algorithm (%1%2)").arg(val, unit);
+    }
+    else
+    {
+        IUnit::self().meter2distance(threshold, val, unit);
+        what = tr("Hide points by Douglas Peuker algorithm (%1%2)").arg(val, unit);
+    }
+
+    filterInBackground(trks, [threshold, algorithm](CTrackData& trk)
+    {
+        return reducePoints(trk, threshold, algorithm);
+    }, what, "://icons/48x48/PointHide.png");
+}
+
+bool CGisItemTrk::reducePoints(CTrackData& trk, qreal threshold, reduce_e algorithm)
 {
     QVector<pointDP> line;
     bool nothingDone = true;
@@ -44,7 +162,7 @@ void CGisItemTrk::filterReducePoints(qreal dist)
 
     if(line.size() < 3)
     {
-        return;
+        return false;
     }
 
     point3D pt0 = line[0];
@@ -65,7 +183,14 @@ void CGisItemTrk::filterReducePoints(qreal dist)
         pt2.y = pt1.y + qSin(a1 * DEG_TO_RAD) * d;
     }
 
-    GPS_Math_DouglasPeucker(line, dist);
+    if(algorithm == eReduceVisvalingamWhyatt)
+    {
+        GPS_Math_VisvalingamWhyatt(line, threshold);
+    }
+    else
+    {
+        GPS_Math_DouglasPeucker(line, threshold);
+    }
 
     int cnt = 0;
 
@@ -87,15 +212,7 @@ void CGisItemTrk::filterReducePoints(qreal dist)
         cnt++;
     }
 
-    if(nothingDone)
-    {
-        return;
-    }
-
-    deriveSecondaryData();
-    QString val, unit;
-    IUnit::self().meter2distance(dist, val, unit);
-    changed(tr("Hide points by Douglas Peuker algorithm (%1%2)").arg(val, unit), "://icons/48x48/PointHide.png");
+    return !nothingDone;
 }
 
 void CGisItemTrk::filterRemoveInvalidPoints()
@@ -165,6 +282,19 @@ void CGisItemTrk::filterDelete()
 }
 
 void CGisItemTrk::filterSmoothProfile(int points)
+{
+    filterSmoothProfile({this}, points);
+}
+
+void CGisItemTrk::filterSmoothProfile(const QList<CGisItemTrk*>& trks, int points)
+{
+    filterInBackground(trks, [points](CTrackData& trk)
+    {
+        return smoothProfile(trk, points);
+    }, tr("Smoothed profile with a Median filter of size %1").arg(points), "://icons/48x48/SetEle.png");
+}
+
+bool CGisItemTrk::smoothProfile(CTrackData& trk, int points)
 {
     QVector<int> window(points, 0);
     QVector<int> ele1, ele2;
@@ -177,7 +307,7 @@ void CGisItemTrk::filterSmoothProfile(int points)
 
     if(ele1.size() < (points + 1))
     {
-        return;
+        return false;
     }
 
     int d = points >> 1;
@@ -197,8 +327,7 @@ void CGisItemTrk::filterSmoothProfile(int points)
     {
         pt.ele = ele2[cnt++];
     }
-    deriveSecondaryData();
-    changed(tr("Smoothed profile with a Median filter of size %1").arg(points), "://icons/48x48/SetEle.png");
+    return true;
 }
 
 void CGisItemTrk::filterTerrainSlope()
@@ -647,6 +776,21 @@ void CGisItemTrk::filterLoopsCut(qreal minLoopLength)
 }
 
 void CGisItemTrk::filterZeroSpeedDriftCleaner(qreal distance, qreal ratio)
+{
+    filterZeroSpeedDriftCleaner({this}, distance, ratio);
+}
+
+void CGisItemTrk::filterZeroSpeedDriftCleaner(const QList<CGisItemTrk*>& trks, qreal distance, qreal ratio)
+{
+    QString val, unit;
+    IUnit::self().meter2distance(distance, val, unit);
+    filterInBackground(trks, [distance, ratio](CTrackData& trk)
+    {
+        return zeroSpeedDriftCleaner(trk, distance, ratio);
+    }, tr("Hide zero speed drift knots with a distance criteria of (%1%2) and ratio of (%3)").arg(val, unit).arg(ratio), "://icons/48x48/FilterZeroSpeedDriftCleaner.png");
+}
+
+bool CGisItemTrk::zeroSpeedDriftCleaner(CTrackData& trk, qreal distance, qreal ratio)
 {
     qint32 knotPtsCount = 0;
     bool knotStarted = false;
@@ -767,8 +911,5 @@ void CGisItemTrk::filterZeroSpeedDriftCleaner(qreal distance, qreal ratio)
         }
     }
 
-    deriveSecondaryData();
-    QString val, unit;
-    IUnit::self().meter2distance(distance, val, unit);
-    changed(tr("Hide zero speed drift knots with a distance criteria of (%1%2) and ratio of (%3)").arg(val, unit).arg(ratio), "://icons/48x48/FilterZeroSpeedDriftCleaner.png");
+    return true;
 }
@@ -687,6 +687,27 @@ void CGisItemWpt::drawItem(QPainter& p, const QPolygonF& viewport, QList<QRectF>
     blockedAreas << QRectF(posScreen - focus, icon.size());
 }
 
+bool CGisItemWpt::isClusterable() const
+{
+    return !(flags & eFlagWptBubble) && (proximity == NOFLOAT || proximity == 0.);
+}
+
+void CGisItemWpt::drawIcon(QPainter& p, const QPointF& pos, QList<QRectF>& blockedAreas)
+{
+    rectBubble = QRect();
+    radius = NOFLOAT;
+    posScreen = pos;
+
+    if(pos == NOPOINTF)
+    {
+        return;
+    }
+
+    p.drawPixmap(posScreen - focus, icon);
+
+    blockedAreas << QRectF(posScreen - focus, icon.size());
+}
+
 void CGisItemWpt::drawItem(QPainter& p, const QRectF& /*viewport*/, CGisDraw* gis)
 {
     if(mouseIsOverBubble && !doBubbleMove && !doBubbleSize && rectBubble.isValid() && !isReadOnly())
@@ -711,9 +732,10 @@ void CGisItemWpt::drawItem(QPainter& p, const QRectF& /*viewport*/, CGisDraw* gi
         p.drawRoundedRect(rectBubbleEdit.adjusted(-2, -2, 2, 2), RECT_RADIUS, RECT_RADIUS);
         p.drawRoundedRect(rectBubbleSize.adjusted(-2, -2, 2, 2), RECT_RADIUS, RECT_RADIUS);
 
-        p.drawPixmap(rectBubbleMove, QPixmap("://icons/32x32/MoveArrow.png"));
-        p.drawPixmap(rectBubbleEdit, QPixmap("://icons/32x32/EditDetails.png"));
-        p.drawPixmap(rectBubbleSize, QPixmap("://icons/32x32/SizeArrow.png"));
+        CWptIconManager& iconManager = CWptIconManager::self();
+        p.drawPixmap(rectBubbleMove, iconManager.loadIcon("://icons/32x32/MoveArrow.png"));
+        p.drawPixmap(rectBubbleEdit, iconManager.loadIcon("://icons/32x32/EditDetails.png"));
+        p.drawPixmap(rectBubbleSize, iconManager.loadIcon("://icons/32x32/SizeArrow.png"));
     }
 }
 
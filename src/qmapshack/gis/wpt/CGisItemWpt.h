@@ -297,6 +297,21 @@ public:
     void drawItem(QPainter& p, const QRectF& viewport, CGisDraw* gis) override;
     void drawLabel(QPainter& p, const QPolygonF& viewport, QList<QRectF>& blockedAreas, const QFontMetricsF& fm, CGisDraw* gis) override;
     void drawHighlight(QPainter& p) override;
+    /**
+       @brief Check if the waypoint is drawn as plain icon
+
+       Waypoints without a bubble and without a proximity circle can be drawn
+       by drawIcon() and can be part of a cluster.
+     */
+    bool isClusterable() const;
+    /**
+       @brief Draw the waypoint's icon at a position computed by the project
+
+       @param p             the painter to use
+       @param pos           the position on the screen [px], NOPOINTF if the waypoint is not drawn, e.g. as it is part of a cluster
+       @param blockedAreas  the icon's area is appended
+     */
+    void drawIcon(QPainter& p, const QPointF& pos, QList<QRectF>& blockedAreas);
     bool isCloseTo(const QPointF& pos) override;
     bool isWithin(const QRectF& area, selflags_t flags) override;
     void mouseMove(const QPointF& pos) override;
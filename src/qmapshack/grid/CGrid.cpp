@@ -94,6 +94,7 @@ void CGrid::setProjAndColor(const QString& projStr, const QColor& c)
 {
     color = c;
     proj.init("EPSG:4326", projStr.toLatin1());
+    cells.clear();
     if(!proj.isValid())
     {
         QMessageBox::warning(
@@ -212,6 +213,141 @@ bool CGrid::calcIntersection(qreal x1, qreal y1, qreal x2, qreal y2, qreal x3, q
 }
 
 
+/// the maximum number of cells in the cache, before it is cleared
+#define MAX_CELLS           20000
+/// the number of times an edge segment is split at most
+#define MAX_DENSIFY_DEPTH   5
+/// an edge segment is split if it's mid point deviates more than this fraction of it's length
+#define DENSIFY_TOLERANCE   0.005
+
+void CGrid::updateCells(const QList<quint64>& keys, qreal xSpace, qreal ySpace)
+{
+    if(cellSpace != QPointF(xSpace, ySpace) || cells.size() > MAX_CELLS)
+    {
+        cells.clear();
+        cellSpace = QPointF(xSpace, ySpace);
+    }
+
+    struct vertex_t
+    {
+        QPointF grid;
+        QPointF rad;
+        /// the segment to the next vertex has to be checked
+        bool open;
+    };
+
+    QList<quint64> missing;
+    QVector< QVector<vertex_t> > edges;
+    QPolygonF corners;
+    for(quint64 key : keys)
+    {
+        if(cells.contains(key))
+        {
+            continue;
+        }
+        missing << key;
+
+        const qreal x = qint32(key >> 32) * xSpace;
+        const qreal y = qint32(key & 0xFFFFFFFF) * ySpace;
+        corners << QPointF(x, y) << QPointF(x + xSpace, y) << QPointF(x, y - ySpace);
+    }
+
+    if(missing.isEmpty())
+    {
+        return;
+    }
+
+    // reproject all corners at once
+    QPolygonF cornersRad = corners;
+    proj.transform(cornersRad, PJ_INV);
+
+    for(qint32 n = 0; n < corners.size(); n += 3)
+    {
+        // top edge
+        edges << QVector<vertex_t>({{corners[n], cornersRad[n], true}, {corners[n + 1], cornersRad[n + 1], false}});
+        // left edge
+        edges << QVector<vertex_t>({{corners[n], cornersRad[n], true}, {corners[n + 2], cornersRad[n + 2], false}});
+    }
+
+    // Split edge segments until they are close enough to the real curve.
+    // The mid points of all open segments are reprojected at once per pass.
+    for(qint32 depth = 0; depth < MAX_DENSIFY_DEPTH; depth++)
+    {
+        QPolygonF mids;
+        for(const QVector<vertex_t>& edge : qAsConst(edges))
+        {
+            for(qint32 i = 0; i < edge.size() - 1; i++)
+            {
+                if(edge[i].open)
+                {
+                    mids << (edge[i].grid + edge[i + 1].grid) / 2;
+                }
+            }
+        }
+
+        if(mids.isEmpty())
+        {
+            break;
+        }
+
+        QPolygonF midsRad = mids;
+        proj.transform(midsRad, PJ_INV);
+
+        qint32 k = 0;
+        for(QVector<vertex_t>& edge : edges)
+        {
+            QVector<vertex_t> result;
+            for(qint32 i = 0; i < edge.size(); i++)
+            {
+                vertex_t v = edge[i];
+                if(!v.open || (i == edge.size() - 1))
+                {
+                    v.open = false;
+                    result << v;
+                    continue;
+                }
+
+                const QPointF& r1 = v.rad;
+                const QPointF& r2 = edge[i + 1].rad;
+                const QPointF& m = midsRad[k];
+                const QPointF& mGrid = mids[k];
+                k++;
+
+                // compare distances with the longitude scaled to the latitude
+                const qreal s = qCos(m.y());
+                const QPointF d1 = m - (r1 + r2) / 2;
+                const QPointF d2 = r2 - r1;
+                const qreal deviation = qSqrt(d1.x() * d1.x() * s * s + d1.y() * d1.y());
+                const qreal length = qSqrt(d2.x() * d2.x() * s * s + d2.y() * d2.y());
+
+                const bool split = deviation > (DENSIFY_TOLERANCE * length);
+                const bool open = split && (depth < MAX_DENSIFY_DEPTH - 1);
+
+                v.open = open;
+                result << v;
+                if(split)
+                {
+                    result << vertex_t {mGrid, m, open};
+                }
+            }
+            edge = result;
+        }
+    }
+
+    for(qint32 n = 0; n < missing.size(); n++)
+    {
+        cell_t& cell = cells[missing[n]];
+        for(const vertex_t& v : qAsConst(edges[2 * n]))
+        {
+            cell.top << v.rad;
+        }
+        for(const vertex_t& v : qAsConst(edges[2 * n + 1]))
+        {
+            cell.left << v.rad;
+        }
+    }
+}
+
 struct val_t
 {
     val_t(qint32 pos, qreal val) : pos(pos), val(val)
@@ -307,58 +443,78 @@ void CGrid::draw(QPainter& p, const QRect& rect)
     qreal h = rect.height();
     qreal w = rect.width();
 
-    while(y > btmMin)
+    // Each cell draws it's top and left edge. One more row and column
+    // are needed to close the cells at the bottom and the right.
+    const qint32 i1 = qRound((xStart - xGridSpace) / xGridSpace);
+    const qint32 i2 = qCeil(rightMax / xGridSpace) + 1;
+    qint32 j1 = qRound(y / yGridSpace);
+    qint32 j2 = qFloor(btmMin / yGridSpace) - 1;
+    if(proj.isTarLatLong())
     {
-        while(x < rightMax)
-        {
-            QPointF p1(x, y);
-            QPointF p2(x + xGridSpace, y);
-            QPointF p3(x + xGridSpace, y - yGridSpace);
-            QPointF p4(x, y - yGridSpace);
-
-
-            qreal xVal = p1.x();
-            qreal yVal = p1.y();
-
-            proj.transform(p1, PJ_INV);
-            proj.transform(p2, PJ_INV);
-            proj.transform(p3, PJ_INV);
-            proj.transform(p4, PJ_INV);
-
-//            qDebug() << (p1 * RAD_TO_DEG) << (p2 * RAD_TO_DEG) << (p3 * RAD_TO_DEG) << (p4 * RAD_TO_DEG);
+        // Keep all cell edges within +-85° like the limits above. The
+        // poles can't be projected by most target projections.
+        const qint32 jMax = qFloor(85 * DEG_TO_RAD / yGridSpace + 1e-9);
+        j1 = qMin(j1, jMax);
+        j2 = qMax(j2, 1 - jMax);
+    }
 
-            map->convertRad2Px(p1);
-            map->convertRad2Px(p2);
-            map->convertRad2Px(p3);
-            map->convertRad2Px(p4);
+    QList<quint64> keys;
+    for(qint32 j = j1; j >= j2; j--)
+    {
+        for(qint32 i = i1; i <= i2; i++)
+        {
+            keys << cellKey(i, j);
+        }
+    }
+    updateCells(keys, xGridSpace, yGridSpace);
 
-            qreal xx, yy;
-            if(calcIntersection(0, 0, w, 0, p1.x(), p1.y(), p4.x(), p4.y(), xx, yy))
-            {
-                horzTopTicks << val_t(xx, xVal);
-            }
-            if(calcIntersection(0, h, w, h, p1.x(), p1.y(), p4.x(), p4.y(), xx, yy))
-            {
-                horzBtmTicks << val_t(xx, xVal);
-            }
-            if(calcIntersection(0, 0, 0, h, p1.x(), p1.y(), p2.x(), p2.y(), xx, yy))
-            {
-                vertLftTicks << val_t(yy, yVal);
-            }
-            if(calcIntersection(w, 0, w, h, p1.x(), p1.y(), p2.x(), p2.y(), xx, yy))
+    // find the intersection of a line with the viewport's edge
+    auto findTick = [](const QPolygonF& line, qreal x1, qreal y1, qreal x2, qreal y2, qreal& xx, qreal& yy) -> bool
+    {
+        for(qint32 n = 0; n < line.size() - 1; n++)
+        {
+            const QPointF& pt1 = line[n];
+            const QPointF& pt2 = line[n + 1];
+            if(calcIntersection(x1, y1, x2, y2, pt1.x(), pt1.y(), pt2.x(), pt2.y(), xx, yy))
             {
-                vertRgtTicks << val_t(yy, yVal);
+                return true;
             }
+        }
+        return false;
+    };
+
+    for(quint64 key : qAsConst(keys))
+    {
+        const cell_t& cell = cells[key];
 
-            p.drawLine(p1, p2);
-            p.drawLine(p2, p3);
-            p.drawLine(p3, p4);
-            p.drawLine(p4, p1);
+        qreal xVal = qint32(key >> 32) * xGridSpace;
+        qreal yVal = qint32(key & 0xFFFFFFFF) * yGridSpace;
 
-            x += xGridSpace;
+        QPolygonF top = cell.top;
+        QPolygonF left = cell.left;
+        map->convertRad2Px(top);
+        map->convertRad2Px(left);
+
+        qreal xx, yy;
+        if(findTick(left, 0, 0, w, 0, xx, yy))
+        {
+            horzTopTicks << val_t(xx, xVal);
         }
-        x = xStart;
-        y -= yGridSpace;
+        if(findTick(left, 0, h, w, h, xx, yy))
+        {
+            horzBtmTicks << val_t(xx, xVal);
+        }
+        if(findTick(top, 0, 0, 0, h, xx, yy))
+        {
+            vertLftTicks << val_t(yy, yVal);
+        }
+        if(findTick(top, w, 0, w, h, xx, yy))
+        {
+            vertRgtTicks << val_t(yy, yVal);
+        }
+
+        p.drawPolyline(top);
+        p.drawPolyline(left);
     }
     USE_ANTI_ALIASING(p, true);
     p.restore();
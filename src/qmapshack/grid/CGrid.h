@@ -22,7 +22,9 @@
 #include "gis/proj_x.h"
 
 #include <QColor>
+#include <QHash>
 #include <QObject>
+#include <QPolygonF>
 class QPainter;
 class QSettings;
 class CMapDraw;
@@ -48,12 +50,42 @@ public:
 
 private:
     void findGridSpace(qreal min, qreal max, qreal& xSpace, qreal& ySpace);
-    bool calcIntersection(qreal x1, qreal y1, qreal x2, qreal y2, qreal x3, qreal y3, qreal x4, qreal y4, qreal& x, qreal& y);
+    static bool calcIntersection(qreal x1, qreal y1, qreal x2, qreal y2, qreal x3, qreal y3, qreal x4, qreal y4, qreal& x, qreal& y);
+
+    /**
+       @brief Make sure the cache holds all cells, missing ones are calculated in bulk
+
+       @param keys      the keys of the cells, see cellKey()
+       @param xSpace    the grid spacing in x dimension
+       @param ySpace    the grid spacing in y dimension
+     */
+    void updateCells(const QList<quint64>& keys, qreal xSpace, qreal ySpace);
+
+    static quint64 cellKey(qint32 i, qint32 j)
+    {
+        return (quint64(quint32(i)) << 32) | quint32(j);
+    }
 
     CMapDraw* map;
 
     CProj proj {"EPSG:4326", "EPSG:4326"};
     QColor color = Qt::magenta;
+
+    /**
+       A grid cell is represented by it's top and left edge as lines
+       in [rad]. Curved edges are densified. As the lines do not depend
+       on the map's projection or the viewport the cells can be reused
+       until the grid projection or spacing changes.
+     */
+    struct cell_t
+    {
+        QPolygonF top;
+        QPolygonF left;
+    };
+
+    QHash<quint64, cell_t> cells;
+    /// the grid spacing the cells are calculated for
+    QPointF cellSpace;
 };
 
 #endif //CGRID_H
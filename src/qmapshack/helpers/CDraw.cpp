@@ -205,6 +205,127 @@ void CDraw::text(const QString& str, QPainter& p, const QRect& r, const QColor&
     p.drawText(r, Qt::AlignCenter, str);
 }
 
+void CDraw::textPath(const QString& text, QPainter& p, const QPolygonF& line, const QFont& f, qint32 lineWidth, const QColor& color)
+{
+    QPainterPath path;
+    QFont font = f;
+    QFontMetricsF fm(font);
+
+    path.addPolygon(line);
+
+    // get path length and string length
+    qreal length = qAbs(path.length());
+    qreal width = fm.width(text);
+
+    // adjust font size until string fits into polyline
+    while(width > (length * 0.7))
+    {
+        font.setPixelSize(font.pixelSize() - 1);
+        fm = QFontMetricsF(font);
+        width = fm.width(text);
+
+        if((font.pixelSize() < 8))
+        {
+            break;
+        }
+    }
+
+    // no way to draw a readable string - skip
+    if((font.pixelSize() < 8))
+    {
+        return;
+    }
+
+    fm = QFontMetricsF(font);
+    p.setFont(font);
+
+    // adjust exact offset to first half of segment
+    const qreal ref = (length - width) / 2;
+    qreal offset = 0;
+
+    const int size = line.size();
+    for(int i = 1; i < size; ++i)
+    {
+        const QPointF& p1 = line[i - 1];
+        const QPointF& p2 = line[i];
+        const qreal dx = p2.x() - p1.x();
+        const qreal dy = p2.y() - p1.y();
+        const qreal d = qSqrt(dx * dx + dy * dy);
+
+        if((offset + d / 2) >= ref)
+        {
+            offset = ref;
+            break;
+        }
+        if((offset + d) >= ref)
+        {
+            offset += d / 2;
+            break;
+        }
+        offset += d;
+    }
+
+    // get starting angle of first two letters
+    qreal percent1 = offset / length;
+    qreal percent2 = (offset + fm.width(text.left(2))) / length;
+
+    QPointF point1 = path.pointAtPercent(percent1);
+    QPointF point2 = path.pointAtPercent(percent2);
+
+    qreal angle;
+
+    // flip path if string start is E->W direction
+    // this helps, sometimes, in 50 % of the cases :)
+    if(point2.x() - point1.x() < 0)
+    {
+        path = path.toReversed();
+    }
+
+    // draw string letter by letter and adjust angle
+    const int len = text.size();
+    percent2 = offset / length;
+    point2 = path.pointAtPercent(percent2);
+
+    for(int i = 0; i < len; ++i)
+    {
+        percent2 = (offset + fm.width(text[i])) / length;
+
+        point1 = point2;
+        point2 = path.pointAtPercent(percent2);
+
+        angle = qAtan((point2.y() - point1.y()) / (point2.x() - point1.x())) * 180 / M_PI;
+
+        if(point2.x() - point1.x() < 0)
+        {
+            angle += 180;
+        }
+
+        p.save();
+        p.translate(point1);
+        p.rotate(angle);
+
+        p.translate(0, -(lineWidth + 2));
+
+        QString str = text.mid(i, 1);
+        p.setPen(Qt::white);
+        p.drawText(-1, -1, str);
+        p.drawText( 0, -1, str);
+        p.drawText(+1, -1, str);
+        p.drawText(-1, 0, str);
+        p.drawText(+1, 0, str);
+        p.drawText(-1, +1, str);
+        p.drawText( 0, +1, str);
+        p.drawText(+1, +1, str);
+
+        p.setPen(color);
+        p.drawText( 0, 0, str);
+
+        p.restore();
+
+        offset += fm.width(text[i]);
+    }
+}
+
 QPoint CDraw::bubble(QPainter& p, const QRect& contentRect, const QPoint& pointerPos, const QColor& background)
 {
     qint32 pointerBasePos = qMax(0, pointerPos.x() - contentRect.left());
@@ -68,6 +68,21 @@ public:
     static void text(const QString& str, QPainter& p, const QPoint& center, const QColor& color, const QFont& font = CMainWindow::self().getMapFont());
     static void text(const QString& str, QPainter& p, const QRect& r, const QColor& color);
 
+    /**
+       @brief Draw a text along a line, letter by letter
+
+       The font size is reduced until the text fits into the line. If the text
+       gets unreadable it is not drawn at all.
+
+       @param text          the text to draw
+       @param p             an active QPainter
+       @param line          the line in [px]
+       @param font          the font to start with
+       @param lineWidth     the width of the line, the text is drawn above it
+       @param color         the text's color
+     */
+    static void textPath(const QString& text, QPainter& p, const QPolygonF& line, const QFont& font, qint32 lineWidth, const QColor& color);
+
     /**
        @brief Draw a cartoon bubble
 
@@ -59,8 +59,16 @@ QPixmap CWptIconManager::createGrayscale(QString path)
     return pixmap_gray;
 }
 
+void CWptIconManager::clearCache()
+{
+    QMutexLocker lock(&mutexCache);
+    iconsByName.clear();
+    iconsByPath.clear();
+}
+
 void CWptIconManager::init()
 {
+    clearCache();
     wptIcons.clear();
 
     wptIcons["Default"] = icon_t(wptDefault, 16, 16);
@@ -207,6 +215,7 @@ void CWptIconManager::setWptIconByName(const QString& name, const QString& filen
 {
     QPixmap icon(filename);
     wptIcons[name] = icon_t(filename, icon.width() >> 1, icon.height() >> 1);
+    clearCache();
 }
 
 
@@ -218,26 +227,52 @@ void CWptIconManager::setWptIconByName(const QString& name, const QPixmap& icon)
 
     icon.save(filename);
     wptIcons[name] = icon_t(filename, icon.width() >> 1, icon.height() >> 1);
+    clearCache();
 }
 
 QPixmap CWptIconManager::loadIcon(const QString& path)
 {
+    QMutexLocker lock(&mutexCache);
+    auto it = iconsByPath.constFind(path);
+    if(it != iconsByPath.constEnd())
+    {
+        return *it;
+    }
+
+    QPixmap icon;
     QFileInfo finfo(path);
     if(finfo.completeSuffix() != "bmp")
     {
-        return QPixmap(path);
+        icon = QPixmap(path);
     }
     else
     {
         QImage img = QPixmap(path).toImage().convertToFormat(QImage::Format_Indexed8);
         img.setColor(0, qRgba(0, 0, 0, 0));
-        return QPixmap::fromImage(img);
+        icon = QPixmap::fromImage(img);
     }
+
+    iconsByPath[path] = icon;
+    return icon;
 }
 
 
 QPixmap CWptIconManager::getWptIconByName(const QString& name, QPointF& focus, QString* src)
 {
+    {
+        QMutexLocker lock(&mutexCache);
+        auto it = iconsByName.constFind(name);
+        if(it != iconsByName.constEnd())
+        {
+            focus = it->focus;
+            if(src)
+            {
+                *src = it->path;
+            }
+            return it->icon;
+        }
+    }
+
     QPixmap icon;
     QString path;
 
@@ -281,6 +316,8 @@ QPixmap CWptIconManager::getWptIconByName(const QString& name, QPointF& focus, Q
         icon = icon.scaled(icon.size() * s, Qt::KeepAspectRatio, Qt::SmoothTransformation);
     }
 
+    QMutexLocker lock(&mutexCache);
+    iconsByName[name] = {icon, focus, path};
     return icon;
 }
 
@@ -23,9 +23,12 @@
 
 #include <QAction>
 #include <QFont>
+#include <QHash>
 #include <QMap>
 #include <QMenu>
+#include <QMutex>
 #include <QObject>
+#include <QPixmap>
 #include <QPoint>
 #include <QString>
 #include <QTemporaryFile>
@@ -57,6 +60,7 @@ public:
 
     QMenu* getWptIconMenu(const QString& title, QObject* obj, const char* slot, QWidget* parent);
 
+    /// load an icon from a file or a resource, the icons are cached by path
     QPixmap loadIcon(const QString& path);
 
     const QMap<QString, icon_t>& getWptIcons()
@@ -73,6 +77,8 @@ private:
     void setWptIconByName(const QString& name, const QString& filename);
     void setWptIconByName(const QString& name, const QPixmap& icon);
     void removeNumberedBullets();
+    /// drop all cached icons, call whenever the icon setup changes
+    void clearCache();
 
     static CWptIconManager* pSelf;
     static const char* wptDefault;
@@ -84,6 +90,20 @@ private:
     QMap<qint32, QString> mapNumberedBullets;
 
     QPixmap createGrayscale(QString path);
+
+    struct cached_icon_t
+    {
+        QPixmap icon;
+        QPointF focus;
+        QString path;
+    };
+
+    /// guards the caches as icons are used by the drawing threads, too
+    QMutex mutexCache;
+    /// the icons as returned by getWptIconByName(), the key is the icon's name
+    QHash<QString, cached_icon_t> iconsByName;
+    /// the icons as returned by loadIcon(), the key is the path
+    QHash<QString, QPixmap> iconsByPath;
 };
 
 #endif //CWPTICONMANAGER_H
@@ -27,17 +27,25 @@
 #include "map/CMapList.h"
 #include "map/CMapPathSetup.h"
 #include "map/IMap.h"
+#include "map/IMapOnline.h"
 #include "setup/IAppSetup.h"
 
+#include <QtConcurrent>
 #include <QtGui>
 #include <QtWidgets>
 
+#define FILE_META_NAME      "MapFiles.dat"
+#define FILE_META_MAGIC     "QMSMAPFI"
+#define FILE_META_VERSION   2
 
 
 QList<CMapDraw*> CMapDraw::maps;
 QString CMapDraw::cachePath = "";
 QStringList CMapDraw::mapPaths;
-QStringList CMapDraw::supportedFormats = QString("*.vrt|*.jnx|*.img|*.rmap|*.wmts|*.tms|*.gemf").split('|');
+QStringList CMapDraw::supportedFormats = QString("*.vrt|*.jnx|*.img|*.rmap|*.wmts|*.tms|*.gemf|*.map").split('|');
+QHash<QString, CMapDraw::filemeta_t> CMapDraw::fileMeta;
+QMutex CMapDraw::mutexFileMeta;
+bool CMapDraw::fileMetaChanged = false;
 
 
 CMapDraw::CMapDraw(CCanvas* parent)
@@ -47,6 +55,14 @@ CMapDraw::CMapDraw(CCanvas* parent)
     CMainWindow::self().addMapList(mapList, canvas->objectName());
     connect(canvas, &CCanvas::destroyed, mapList, &CMapList::deleteLater);
     connect(mapList, &CMapList::sigChanged, this, &CMapDraw::emitSigCanvasUpdate);
+    connect(&watcherMapList, &QFutureWatcher<QList<mapfile_t> >::finished, this, &CMapDraw::slotMapListScanned);
+    connect(&watcherActivate, &QFutureWatcher<void>::finished, this, &CMapDraw::slotActivatePrepared);
+    connect(this, &CMapDraw::sigMapsNeeded, this, &CMapDraw::slotActivateMaps);
+
+    timerActivate = new QTimer(this);
+    timerActivate->setSingleShot(true);
+    timerActivate->setInterval(0);
+    connect(timerActivate, &QTimer::timeout, this, &CMapDraw::slotActivateNext);
 
     buildMapList();
 
@@ -55,6 +71,8 @@ CMapDraw::CMapDraw(CCanvas* parent)
 
 CMapDraw::~CMapDraw()
 {
+    watcherMapList.waitForFinished();
+    watcherActivate.waitForFinished();
     maps.removeOne(this);
 }
 
@@ -102,12 +120,18 @@ void CMapDraw::setupMapPath(const QStringList& paths)
 {
     mapPaths = paths;
 
+    // start the search for all views first to let them search in parallel
+    QList<QStringList> keys;
     for(CMapDraw* map : qAsConst(maps))
     {
-        QStringList keys;
-        map->saveActiveMapsList(keys);
+        keys << QStringList();
+        map->saveActiveMapsList(keys.last());
         map->buildMapList();
-        map->restoreActiveMapsList(keys);
+    }
+
+    for(int i = 0; i < maps.count(); i++)
+    {
+        maps[i]->restoreActiveMapsList(keys[i]);
     }
 }
 
@@ -143,13 +167,17 @@ void CMapDraw::getInfo(const QPoint& px, QString& str)
         {
             CMapItem* item = mapList->item(i);
 
-            if(!item || item->getMapfile().isNull())
+            if(!item || !item->isActivated())
             {
                 // as all active maps have to be at the top of the list
                 // it is ok to break as soon as the first map with no
                 // active files is hit.
                 break;
             }
+            if(item->isDeferred())
+            {
+                continue;
+            }
 
             item->getMapfile()->getInfo(px, str);
         }
@@ -170,13 +198,17 @@ void CMapDraw::getToolTip(const QPoint& px, QString& str)
         {
             CMapItem* item = mapList->item(i);
 
-            if(!item || item->getMapfile().isNull())
+            if(!item || !item->isActivated())
             {
                 // as all active maps have to be at the top of the list
                 // it is ok to break as soon as the first map with no
                 // active files is hit.
                 break;
             }
+            if(item->isDeferred())
+            {
+                continue;
+            }
 
             item->getMapfile()->getToolTip(px, str);
         }
@@ -199,13 +231,17 @@ poi_t CMapDraw::findPOICloseBy(const QPoint& px) const
         {
             CMapItem* item = mapList->item(i);
 
-            if(!item || item->getMapfile().isNull())
+            if(!item || !item->isActivated())
             {
                 // as all active maps have to be at the top of the list
                 // it is ok to break as soon as the first map with no
                 // active files is hit.
                 break;
             }
+            if(item->isDeferred())
+            {
+                continue;
+            }
 
             item->getMapfile()->findPOICloseBy(px, poi);
             if(poi.pos != NOPOINTF)
@@ -234,13 +270,17 @@ bool CMapDraw::findPolylineCloseBy(const QPointF& pt1, const QPointF& pt2, qint3
         {
             CMapItem* item = mapList->item(i);
 
-            if(!item || item->getMapfile().isNull())
+            if(!item || !item->isActivated())
             {
                 // as all active maps have to be at the top of the list
                 // it is ok to break as soon as the first map with no
                 // active files is hit.
                 break;
             }
+            if(item->isDeferred())
+            {
+                continue;
+            }
 
             res = item->getMapfile()->findPolylineCloseBy(pt1, pt2, threshold, polyline);
             if(res)
@@ -253,6 +293,62 @@ bool CMapDraw::findPolylineCloseBy(const QPointF& pt1, const QPointF& pt2, qint3
     return res;
 }
 
+void CMapDraw::seedCache(const QRectF& area)
+{
+    CMapItem::mutexActiveMaps.lock();
+    if(mapList)
+    {
+        for(int i = 0; i < mapList->count(); i++)
+        {
+            CMapItem* item = mapList->item(i);
+
+            if(!item || !item->isActivated())
+            {
+                break;
+            }
+            if(item->isDeferred())
+            {
+                continue;
+            }
+
+            IMapOnline* map = dynamic_cast<IMapOnline*>(item->getMapfile().data());
+            if(map != nullptr)
+            {
+                map->seedArea(area);
+            }
+        }
+    }
+    CMapItem::mutexActiveMaps.unlock();
+}
+
+void CMapDraw::seedCache(const QPolygonF& line, qreal width)
+{
+    CMapItem::mutexActiveMaps.lock();
+    if(mapList)
+    {
+        for(int i = 0; i < mapList->count(); i++)
+        {
+            CMapItem* item = mapList->item(i);
+
+            if(!item || !item->isActivated())
+            {
+                break;
+            }
+            if(item->isDeferred())
+            {
+                continue;
+            }
+
+            IMapOnline* map = dynamic_cast<IMapOnline*>(item->getMapfile().data());
+            if(map != nullptr)
+            {
+                map->seedCorridor(line, width);
+            }
+        }
+    }
+    CMapItem::mutexActiveMaps.unlock();
+}
+
 void CMapDraw::saveConfig(QSettings& cfg) /* override */
 {
     // store group context for later use
@@ -264,6 +360,12 @@ void CMapDraw::saveConfig(QSettings& cfg) /* override */
     cfg.setValue("active", keys);
     cfg.setValue("zoomIndex", zoomIndex);
     cfg.endGroup();
+
+    QMutexLocker lock(&mutexFileMeta);
+    if(fileMetaChanged)
+    {
+        saveFileMeta(getCacheRootPath());
+    }
 }
 
 void CMapDraw::loadConfig(QSettings& cfg) /* override */
@@ -286,7 +388,7 @@ void CMapDraw::loadConfig(QSettings& cfg) /* override */
     zoom(idx);
 }
 
-CMapItem* CMapDraw::createMapItem(const QString& filename, QSet<QString>& maps)
+CMapItem* CMapDraw::createMapItem(const QString& filename, const QString& key, QSet<QString>& maps)
 {
     CMapItem* item = new CMapItem(*mapList, this);
 
@@ -294,18 +396,24 @@ CMapItem* CMapDraw::createMapItem(const QString& filename, QSet<QString>& maps)
     maps.insert(fi.completeBaseName());
 
     item->setText(0, fi.completeBaseName().replace("_", " "));
-    item->setFilename(filename);
+    item->setFilename(filename, key);
     item->updateIcon();
     return item;
 }
 
 void CMapDraw::buildMapList(const QString& filename)
 {
+    // drop the result of a pending search
+    watcherMapList.waitForFinished();
+    mapListPending = false;
+
     QMutexLocker lock(&CMapItem::mutexActiveMaps);
     mapList->clear();
+    mapList->setSearching(false);
+    resetActivation();
 
     QSet<QString> maps;
-    CMapItem* item = createMapItem(filename, maps);
+    CMapItem* item = createMapItem(filename, CMapItem::calcKey(filename), maps);
     item->activate();
 }
 
@@ -313,26 +421,193 @@ void CMapDraw::buildMapList()
 {
     QMutexLocker lock(&CMapItem::mutexActiveMaps);
     mapList->clear();
+    mapList->setSearching(true);
+    resetActivation();
+
+    /*
+        Reading all map folders can take a while, especially on network drives.
+        Do it in the background. The GUI stays responsive and several views
+        search in parallel.
+     */
+    mapListPending = true;
+    watcherMapList.setFuture(QtConcurrent::run(&CMapDraw::scanMapPaths, mapPaths, getCacheRootPath()));
+}
+
+QString CMapDraw::getCacheRootPath()
+{
+    return cachePath.isEmpty() ? IAppSetup::getPlatformInstance()->defaultCachePath() : cachePath;
+}
+
+void CMapDraw::slotMapListScanned()
+{
+    finishMapList();
+    emitSigCanvasUpdate();
+}
+
+void CMapDraw::finishMapList()
+{
+    if(!mapListPending)
+    {
+        return;
+    }
+
+    watcherMapList.waitForFinished();
+    mapListPending = false;
+
+    QMutexLocker lock(&CMapItem::mutexActiveMaps);
 
     QSet<QString> maps;
+    const QList<mapfile_t>& mapfiles = watcherMapList.result();
+    for(const mapfile_t& mapfile : mapfiles)
+    {
+        createMapItem(mapfile.filename, mapfile.key, maps);
+    }
+
+    mapList->sort();
+
+    CDiskCache::cleanupRemovedMaps(maps);
+
+    mapList->setSearching(false);
 
-    for(const QString& path : qAsConst(mapPaths))
+    // continue restoreActiveMapsList() with the complete list
+    if(!keysRestore.isEmpty())
+    {
+        const QStringList keys = keysRestore;
+        keysRestore.clear();
+        deferActiveMaps(keys);
+    }
+}
+
+QList<CMapDraw::mapfile_t> CMapDraw::scanMapPaths(const QStringList& paths, const QString& cacheRoot)
+{
+    QFileInfoList files;
+    for(const QString& path : paths)
     {
         QDir dir(path);
+        files += dir.entryInfoList(supportedFormats, QDir::Files | QDir::Readable, QDir::Name);
+    }
+
+    QMutexLocker lock(&mutexFileMeta);
 
-        // find available maps
-        const QStringList& filenames = dir.entryList(supportedFormats, QDir::Files | QDir::Readable, QDir::Name);
-        for(const QString& filename : filenames)
+    const QString& metaFilename = QDir(cacheRoot).absoluteFilePath(FILE_META_NAME);
+    if(fileMeta.isEmpty())
+    {
+        QFile file(metaFilename);
+        if(file.open(QIODevice::ReadOnly))
         {
-            createMapItem(dir.absoluteFilePath(filename), maps);
+            QDataStream stream(&file);
+            stream.setVersion(QDataStream::Qt_5_2);
+
+            QByteArray magic;
+            quint32 version = 0;
+            qint32 count = 0;
+            stream >> magic >> version >> count;
+            if(magic == FILE_META_MAGIC && version == FILE_META_VERSION)
+            {
+                for(qint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+                {
+                    QString filename;
+                    filemeta_t meta;
+                    stream >> filename >> meta.size >> meta.lastModified >> meta.key >> meta.boundingBox;
+                    fileMeta[filename] = meta;
+                }
+            }
+
+            if(stream.status() != QDataStream::Ok)
+            {
+                fileMeta.clear();
+            }
         }
     }
 
-    mapList->sort();
+    // use the cached key of all files unchanged since the last search
+    QList<mapfile_t> mapfiles;
+    QList<qint32> missing;
+    QStringList missingFilenames;
+    QHash<QString, filemeta_t> meta;
+    for(const QFileInfo& fi : qAsConst(files))
+    {
+        mapfile_t mapfile;
+        mapfile.filename = fi.absoluteFilePath();
 
-    CDiskCache::cleanupRemovedMaps(maps);
+        filemeta_t& m = meta[mapfile.filename];
+        m.size = fi.size();
+        m.lastModified = fi.lastModified().toMSecsSinceEpoch();
 
-    mapList->updateHelpText();
+        const filemeta_t& cached = fileMeta.value(mapfile.filename);
+        if(cached.size == m.size && cached.lastModified == m.lastModified && !cached.key.isEmpty())
+        {
+            m.key = mapfile.key = cached.key;
+            m.boundingBox = cached.boundingBox;
+        }
+        else
+        {
+            missing << mapfiles.count();
+            missingFilenames << mapfile.filename;
+        }
+
+        mapfiles << mapfile;
+    }
+
+    // compute the missing keys in parallel as each one has to wait for the file system.
+    // Other views can use the metadata meanwhile.
+    lock.unlock();
+    const QList<QString>& keys = QtConcurrent::blockingMapped<QList<QString> >(missingFilenames, &CMapItem::calcKey);
+
+    for(int i = 0; i < missing.count(); i++)
+    {
+        mapfile_t& mapfile = mapfiles[missing[i]];
+        mapfile.key = meta[mapfile.filename].key = keys[i];
+    }
+
+    lock.relock();
+    // keep the areas learned by activated maps meanwhile
+    for(auto it = meta.begin(); it != meta.end(); ++it)
+    {
+        const filemeta_t& current = fileMeta.value(it.key());
+        if(current.key == it->key)
+        {
+            it->boundingBox = current.boundingBox;
+        }
+    }
+
+    // store the metadata if anything has changed
+    if(!missing.isEmpty() || meta.count() != fileMeta.count() || fileMetaChanged)
+    {
+        fileMeta = meta;
+        saveFileMeta(cacheRoot);
+    }
+
+    return mapfiles;
+}
+
+void CMapDraw::saveFileMeta(const QString& cacheRoot)
+{
+    QDir().mkpath(cacheRoot);
+    QSaveFile file(QDir(cacheRoot).absoluteFilePath(FILE_META_NAME));
+    if(file.open(QIODevice::WriteOnly))
+    {
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_2);
+        stream << QByteArray(FILE_META_MAGIC) << quint32(FILE_META_VERSION) << qint32(fileMeta.count());
+        for(auto it = fileMeta.constBegin(); it != fileMeta.constEnd(); ++it)
+        {
+            stream << it.key() << it->size << it->lastModified << it->key << it->boundingBox;
+        }
+        file.commit();
+    }
+    fileMetaChanged = false;
+}
+
+void CMapDraw::setBoundingBox(const QString& filename, const QRectF& area)
+{
+    QMutexLocker lock(&mutexFileMeta);
+    auto meta = fileMeta.find(filename);
+    if((meta != fileMeta.end()) && (meta->boundingBox != area))
+    {
+        meta->boundingBox = area;
+        fileMetaChanged = true;
+    }
 }
 
 void CMapDraw::saveActiveMapsList(QStringList& keys)
@@ -347,13 +622,21 @@ void CMapDraw::saveActiveMapsList(QStringList& keys)
 
 void CMapDraw::saveActiveMapsList(QStringList& keys, QSettings& cfg)
 {
+    // the list is empty until the search is done, the active maps are still waiting to be restored
+    if(mapListPending)
+    {
+        keys += keysRestore;
+        return;
+    }
+
     QMutexLocker lock(&CMapItem::mutexActiveMaps);
 
     for(int i = 0; i < mapList->count(); i++)
     {
         CMapItem* item = mapList->item(i);
-        if(item && !item->getMapfile().isNull())
+        if(item && item->isActivated())
         {
+            // a deferred item has no configuration to save, it's last one is kept
             item->saveConfig(cfg);
             keys << item->getKey();
         }
@@ -375,10 +658,9 @@ void CMapDraw::loadConfigForMapItem(CMapItem* item)
     cfg.endGroup();
 }
 
-void CMapDraw::restoreActiveMapsList(const QStringList& keys)
+QList<CMapItem*> CMapDraw::getMapItems(const QStringList& keys)
 {
-    QMutexLocker lock(&CMapItem::mutexActiveMaps);
-
+    QList<CMapItem*> items;
     for(const QString& key : keys)
     {
         for(int i = 0; i < mapList->count(); i++)
@@ -387,43 +669,195 @@ void CMapDraw::restoreActiveMapsList(const QStringList& keys)
 
             if(item && item->getKey() == key)
             {
-                /**
-                    @Note   the item will load it's configuration upon successful activation
-                            by calling loadConfigForMapItem().
-                 */
-                item->activate();
+                items << item;
                 break;
             }
         }
     }
+    return items;
+}
 
-    mapList->updateHelpText();
+void CMapDraw::restoreActiveMapsList(const QStringList& keys)
+{
+    // do not wait for a pending search, finishMapList() will continue
+    if(mapListPending)
+    {
+        keysRestore = keys;
+        return;
+    }
+
+    deferActiveMaps(keys);
 }
 
 void CMapDraw::restoreActiveMapsList(const QStringList& keys, QSettings& cfg)
+{
+    /*
+        The configuration is only available during this call. Therefore
+        the maps can't be deferred but have to be activated right away.
+     */
+    finishMapList();
+
+    QMutexLocker lock(&CMapItem::mutexActiveMaps);
+
+    const QList<CMapItem*>& items = getMapItems(keys);
+    QStringList filenames;
+    for(const CMapItem* item : items)
+    {
+        filenames << item->getFilename();
+    }
+    CMapItem::prepareActivation(filenames);
+
+    for(CMapItem* item : items)
+    {
+        if(item->activate())
+        {
+            item->loadConfig(cfg);
+        }
+    }
+
+    mapList->updateHelpText();
+}
+
+void CMapDraw::deferActiveMaps(const QStringList& keys)
 {
     QMutexLocker lock(&CMapItem::mutexActiveMaps);
 
+    SETTINGS;
+    cfg.beginGroup(cfgGroup);
+    cfg.beginGroup("map");
+
+    QStringList keysNow;
+    const QList<CMapItem*>& items = getMapItems(keys);
+    for(CMapItem* item : items)
+    {
+        const QString& key = item->getKey();
+
+        // the scale range is part of the map's configuration saved by the last activation
+        const qreal minScale = cfg.value(key + "/minScale", NOFLOAT).toDouble();
+        const qreal maxScale = cfg.value(key + "/maxScale", NOFLOAT).toDouble();
+
+        QRectF area;
+        {
+            QMutexLocker lockMeta(&mutexFileMeta);
+            area = fileMeta.value(item->getFilename()).boundingBox;
+        }
+
+        /*
+            A map with a cached area is activated as soon as a view needs it
+            to draw. All others are activated right away to learn their area.
+         */
+        item->defer(area, minScale, maxScale);
+        if(area.isNull())
+        {
+            keysNow << key;
+        }
+    }
+
+    cfg.endGroup(); // map
+    cfg.endGroup(); // cfgGroup
+
+    mapList->updateHelpText();
+    slotActivateMaps(keysNow);
+    emitSigCanvasUpdate();
+}
+
+void CMapDraw::resetActivation()
+{
+    keysRestore.clear();
+    keysActivate.clear();
+    keysBatch.clear();
+    cntActivateDone = 0;
+    cntActivateTotal = 0;
+    mapList->setActivating(0, 0);
+}
+
+void CMapDraw::slotActivateMaps(const QStringList& keys)
+{
     for(const QString& key : keys)
     {
-        for(int i = 0; i < mapList->count(); i++)
+        if(!keysActivate.contains(key) && !keysBatch.contains(key))
         {
-            CMapItem* item = mapList->item(i);
+            keysActivate << key;
+            cntActivateTotal++;
+        }
+    }
+    mapList->setActivating(cntActivateDone, cntActivateTotal);
 
-            if(item && item->getKey() == key)
+    // a running batch will pick up the keys when done
+    if(keysBatch.isEmpty() && !watcherActivate.isRunning())
+    {
+        timerActivate->start();
+    }
+}
+
+void CMapDraw::slotActivatePrepared()
+{
+    timerActivate->start();
+}
+
+void CMapDraw::slotActivateNext()
+{
+    // wait for the preparation of the current batch
+    if(watcherActivate.isRunning())
+    {
+        return;
+    }
+
+    if(keysBatch.isEmpty())
+    {
+        if(!keysActivate.isEmpty())
+        {
+            // prepare the next batch in the background
+            keysBatch = keysActivate;
+            keysActivate.clear();
+
+            QStringList filenames;
             {
-                if(item->activate())
+                QMutexLocker lock(&CMapItem::mutexActiveMaps);
+                const QList<CMapItem*>& items = getMapItems(keysBatch);
+                for(const CMapItem* item : items)
                 {
-                    item->loadConfig(cfg);
+                    filenames << item->getFilename();
                 }
-                break;
             }
+            watcherActivate.setFuture(QtConcurrent::run(&CMapItem::prepareActivation, filenames));
+            return;
+        }
+
+        // all done
+        cntActivateDone = 0;
+        cntActivateTotal = 0;
+        mapList->setActivating(0, 0);
+
+        QMutexLocker lock(&mutexFileMeta);
+        if(fileMetaChanged)
+        {
+            saveFileMeta(getCacheRootPath());
+        }
+        return;
+    }
+
+    // the map objects are created one by one to keep the GUI responsive in between
+    const QString key = keysBatch.takeFirst();
+    {
+        QMutexLocker lock(&CMapItem::mutexActiveMaps);
+        const QList<CMapItem*>& items = getMapItems({key});
+        if(!items.isEmpty() && items.first()->isDeferred())
+        {
+            /**
+                @Note   the item will load it's configuration upon successful activation
+                        by calling loadConfigForMapItem().
+             */
+            items.first()->activate();
         }
     }
 
+    mapList->setActivating(++cntActivateDone, cntActivateTotal);
     mapList->updateHelpText();
-}
+    emitSigCanvasUpdate();
 
+    timerActivate->start();
+}
 
 void CMapDraw::reportStatusToCanvas(const QString& key, const QString& msg)
 {
@@ -432,6 +866,13 @@ void CMapDraw::reportStatusToCanvas(const QString& key, const QString& msg)
 
 void CMapDraw::drawt(IDrawContext::buffer_t& currentBuffer) /* override */
 {
+    // the buffer's area and scale to test the deferred maps
+    QPolygonF area;
+    area << currentBuffer.ref1 << currentBuffer.ref2 << currentBuffer.ref3 << currentBuffer.ref4;
+    const QRectF& rectArea = area.boundingRect();
+    const QPointF& bufferScale = currentBuffer.scale * currentBuffer.zoomFactor;
+
+    QStringList keysNeeded;
     bool seenActiveMap = false;
     // iterate over all active maps and call the draw method
     CMapItem::mutexActiveMaps.lock();
@@ -441,20 +882,34 @@ void CMapDraw::drawt(IDrawContext::buffer_t& currentBuffer) /* override */
         {
             CMapItem* item = mapList->item(i);
 
-            if(!item || item->getMapfile().isNull())
+            if(!item || !item->isActivated())
             {
                 // as all active maps have to be at the top of the list
                 // it is ok to break as soon as the first map with no
                 // active files is hit.
                 break;
             }
+            seenActiveMap = true;
+            if(item->isDeferred())
+            {
+                if(item->isNeeded(rectArea, bufferScale))
+                {
+                    keysNeeded << item->getKey();
+                }
+                continue;
+            }
 
             item->getMapfile()->draw(currentBuffer);
-            seenActiveMap = true;
         }
     }
     CMapItem::mutexActiveMaps.unlock();
 
+    // the map objects have to be created by the GUI thread
+    if(!keysNeeded.isEmpty())
+    {
+        emit sigMapsNeeded(keysNeeded);
+    }
+
     if(seenActiveMap != hasActiveMap)
     {
         hasActiveMap = seenActiveMap;
@@ -20,9 +20,14 @@
 #define CMAPDRAW_H
 
 #include "canvas/IDrawContext.h"
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QRectF>
 #include <QStringList>
 
 class QPainter;
+class QTimer;
 class CCanvas;
 class CMapList;
 class QSettings;
@@ -123,6 +128,21 @@ public:
      */
     bool findPolylineCloseBy(const QPointF& pt1, const QPointF& pt2, qint32 threshold, QPolygonF& polyline);
 
+    /**
+       @brief Download the tiles of all active online maps covering an area
+
+       @param area          the area in [rad]
+     */
+    void seedCache(const QRectF& area);
+
+    /**
+       @brief Download the tiles of all active online maps along a line
+
+       @param line          the line's points in [rad]
+       @param width         the corridor's width to each side of the line in [m]
+     */
+    void seedCache(const QPolygonF& line, qreal width);
+
     /**
        @brief Build a usable map list from a single map file
 
@@ -132,28 +152,85 @@ public:
      */
     void buildMapList(const QString& filename);
 
+    /**
+       @brief Cache the area covered by a map file
+
+       The area is used to defer the activation of the map the next time it is restored.
+
+       @param filename  the map's filename
+       @param area      the area in [rad] as reported by IMap::getBoundingBox()
+     */
+    static void setBoundingBox(const QString& filename, const QRectF& area);
+
 signals:
     void sigActiveMapsChanged(bool noActiveMap);
+    /// emitted by the draw thread for deferred maps needed to draw the view
+    void sigMapsNeeded(const QStringList& keys);
 
 protected:
     void drawt(buffer_t& currentBuffer) override;
 
+private slots:
+    void slotMapListScanned();
+    /// queue deferred maps for activation in the background
+    void slotActivateMaps(const QStringList& keys);
+    void slotActivatePrepared();
+    /// activate the next map of the current batch
+    void slotActivateNext();
 
 private:
+    /// a map file found by scanMapPaths()
+    struct mapfile_t
+    {
+        QString filename;
+        QString key;
+    };
+
+    /// the cached metadata of a map file
+    struct filemeta_t
+    {
+        qint64 size = 0;
+        qint64 lastModified = 0;
+        QString key;
+        /// the area covered by the map in [rad], null until the map has been activated once
+        QRectF boundingBox;
+    };
+
     /**
        @brief Create a CMapItem from a filename
 
        @param filename the map's filename, can be a resuource, too
+       @param key   the map's key as computed by CMapItem::calcKey()
        @param maps  a set to collect the paths of all collected maps.
 
        @return The created map item.
      */
-    CMapItem* createMapItem(const QString& filename, QSet<QString>& maps);
+    CMapItem* createMapItem(const QString& filename, const QString& key, QSet<QString>& maps);
     /**
        @brief Search in paths found in mapPaths for files with supported extensions and add them to mapList.
 
+       The search is done by a worker thread. The map list is empty until the search
+       has finished. All methods depending on the map list's content have to call
+       finishMapList() first.
      */
     void buildMapList();
+    /// wait for a pending search of buildMapList() and fill the map list with the result
+    void finishMapList();
+    /**
+       @brief Find all map files in a list of paths
+
+       This is called by a worker thread. The map's keys are looked up in the metadata
+       cache. Only files that are new or have changed are read to compute their key.
+
+       @param paths         the paths to search
+       @param cacheRoot     the path to store the metadata cache in
+       @return A list of all map files found.
+     */
+    static QList<mapfile_t> scanMapPaths(const QStringList& paths, const QString& cacheRoot);
+    /// write fileMeta to the cache, mutexFileMeta has to be locked by the caller
+    static void saveFileMeta(const QString& cacheRoot);
+    /// the configured cache path or the platform's default
+    static QString getCacheRootPath();
     /**
        @brief Save list of active maps to configuration file
 
@@ -171,11 +248,28 @@ private:
     void saveActiveMapsList(QStringList& keys);
     /**
        @brief Restore list of active maps from configuration file
+
+       This does not wait for a pending search of buildMapList(). The maps
+       are deferred by deferActiveMaps() as soon as the map list is complete.
+
        @param keys MD5 hash keys to identify the maps
      */
     void restoreActiveMapsList(const QStringList& keys);
 
     void restoreActiveMapsList(const QStringList& keys, QSettings& cfg);
+    /**
+       @brief Add maps to the active maps without loading them
+
+       Maps with a known area are activated as soon as the draw thread needs
+       them for the first time. All others are queued for activation right away.
+
+       @param keys MD5 hash keys to identify the maps
+     */
+    void deferActiveMaps(const QStringList& keys);
+    /// drop all maps waiting to be restored or activated
+    void resetActivation();
+    /// get the map items of the keys in the keys' order, unknown keys are skipped
+    QList<CMapItem*> getMapItems(const QStringList& keys);
 
     /// the treewidget holding all active and inactive map items
     CMapList* mapList;
@@ -194,6 +288,29 @@ private:
     /// a list of supported map formats
     static QStringList supportedFormats;
 
+    /// the metadata of all map files found by the last search, the key is the absolute path
+    static QHash<QString, filemeta_t> fileMeta;
+    /// guards fileMeta as several map views search in parallel
+    static QMutex mutexFileMeta;
+    /// true if fileMeta has changed since it has been saved the last time
+    static bool fileMetaChanged;
+
+    QFutureWatcher<QList<mapfile_t> > watcherMapList;
+    /// true while the result of the search of buildMapList() is not in the map list
+    bool mapListPending = false;
+    /// the active maps to restore as soon as the search of buildMapList() is done
+    QStringList keysRestore;
+
+    /// the maps waiting for the next batch of activations
+    QStringList keysActivate;
+    /// the maps of the current batch, prepared by watcherActivate and activated by slotActivateNext()
+    QStringList keysBatch;
+    QFutureWatcher<void> watcherActivate;
+    QTimer* timerActivate;
+    /// the progress shown by the map list
+    int cntActivateDone = 0;
+    int cntActivateTotal = 0;
+
     bool hasActiveMap = false;
 };
 
@@ -24,9 +24,12 @@
 #include "helpers/CDraw.h"
 #include "map/CMapDraw.h"
 #include "map/CMapGEMF.h"
+#include "map/cache/CTileCache.h"
 #include "units/IUnit.h"
 
 #include <QDebug>
+#include <QtConcurrent>
+#include <QtEndian>
 #include <QtGui>
 #include <QtWidgets>
 
@@ -115,7 +118,7 @@ CMapGEMF::CMapGEMF(const QString& filename, CMapDraw* parent)
 
     for(quint32 i = 0; i <= MAX_ZOOM_LEVEL; i++)
     {
-        QList<range_t> rangeZoom;
+        QVector<range_t> rangeZoom;
         for(const range_t& range : qAsConst(ranges))
         {
             if(range.zoomlevel == i)
@@ -127,29 +130,64 @@ CMapGEMF::CMapGEMF(const QString& filename, CMapDraw* parent)
         }
         if(!rangeZoom.empty())
         {
+            std::sort(rangeZoom.begin(), rangeZoom.end(), [](const range_t& r1, const range_t& r2)
+            {
+                return r1.minX < r2.minX;
+            });
+
+            quint32 maxX = 0;
+            for(range_t& range : rangeZoom)
+            {
+                maxX = qMax(maxX, range.maxX);
+                range.maxXRunning = maxX;
+            }
             rangesByZoom[i] = rangeZoom;
-            qDebug() << "CMapGEMF: Found " << rangeZoom.length() << " ranges for zoomlevel " << i;
+            qDebug() << "CMapGEMF: Found " << rangeZoom.size() << " ranges for zoomlevel " << i;
         }
     }
+
+    // open and map all split files for the lifetime of the map
     QString partfile = filename;
-    QFile f(partfile);
-    f.open(QIODevice::ReadOnly);
+    quint64 start = 0;
     quint32 i = 1;
-    do
+    while(true)
     {
+        QSharedPointer<QFile> f(new QFile(partfile));
+        if(!f->open(QIODevice::ReadOnly))
+        {
+            break;
+        }
+
         gemffile_t gf;
         gf.filename = partfile;
-        gf.size = f.size();
-        f.close();
+        gf.start = start;
+        gf.size = f->size();
+        gf.file = f;
+        gf.data = f->map(0, gf.size);
+        if(gf.data == nullptr)
+        {
+            qDebug() << "CMapGEMF: Failed to map" << partfile << "fall back to read";
+        }
         files << gf;
+
+        start += gf.size;
         partfile = filename + "-" + QString::number(i);
         i++;
-        f.setFileName(partfile);
     }
-    while( f.open(QIODevice::ReadOnly) );
     isActivated = true;
 }
 
+CMapGEMF::~CMapGEMF()
+{
+    for(gemffile_t& gf : files)
+    {
+        if(gf.data != nullptr)
+        {
+            gf.file->unmap(const_cast<uchar*>(gf.data));
+        }
+    }
+}
+
 void CMapGEMF::draw(IDrawContext::buffer_t& buf)
 {
     if(map->needsRedraw())
@@ -206,92 +244,168 @@ void CMapGEMF::draw(IDrawContext::buffer_t& buf)
     qint32 col2 = lon2tile(x2 * RAD_TO_DEG, z) / 256;
     qint32 row1 = lat2tile(y1 * RAD_TO_DEG, z) / 256;
     qint32 row2 = lat2tile(y2 * RAD_TO_DEG, z) / 256;
+
+    struct job_t
+    {
+        qint32 col;
+        qint32 row;
+        QString key;
+        QByteArray data;
+        QImage img;
+    };
+
+    QVector<job_t> jobs;
     for(qint32 row = row1; row <= row2; row++)
     {
         for(qint32 col = col1; col <= col2; col++)
         {
-            qreal xx1 = tile2lon(col, z) * DEG_TO_RAD;
-            qreal yy1 = tile2lat(row, z) * DEG_TO_RAD;
-            qreal xx2 = tile2lon(col + 1, z) * DEG_TO_RAD;
-            qreal yy2 = tile2lat(row + 1, z) * DEG_TO_RAD;
+            job_t job;
+            job.col = col;
+            job.row = row;
+            job.key = CTileCache::key(filename, z, (quint64(quint32(col)) << 32) | quint32(row));
+            jobs << job;
+        }
+    }
+
+    // Get decoded tiles from the cache and collect the data of all others.
+    QVector<job_t*> pendingJobs;
+    for(job_t& job : jobs)
+    {
+        if(CTileCache::self().find(job.key, job.img))
+        {
+            continue;
+        }
+
+        job.data = getTileData(job.col, job.row, z);
+        if(!job.data.isEmpty())
+        {
+            pendingJobs << &job;
+        }
+    }
+
+    if(map->needsRedraw())
+    {
+        return;
+    }
 
-            QPolygonF l;
-            l << QPointF(xx1, yy1) << QPointF(xx2, yy1) << QPointF(xx2, yy2) << QPointF(xx1, yy2);
+    // decode all missing tiles in parallel
+    QtConcurrent::blockingMap(pendingJobs, [](job_t* job)
+    {
+        job->img.loadFromData(job->data);
+        job->data.clear();
+        CTileCache::self().insert(job->key, job->img);
+    });
 
-            const QImage& img = getTile(col, row, z);
-            drawTile(img, l, p);
+    for(const job_t& job : qAsConst(jobs))
+    {
+        if(map->needsRedraw())
+        {
+            break;
         }
+
+        qreal xx1 = tile2lon(job.col, z) * DEG_TO_RAD;
+        qreal yy1 = tile2lat(job.row, z) * DEG_TO_RAD;
+        qreal xx2 = tile2lon(job.col + 1, z) * DEG_TO_RAD;
+        qreal yy2 = tile2lat(job.row + 1, z) * DEG_TO_RAD;
+
+        QPolygonF l;
+        l << QPointF(xx1, yy1) << QPointF(xx2, yy1) << QPointF(xx2, yy2) << QPointF(xx1, yy2);
+
+        drawTile(job.img, l, p);
     }
 }
 
-quint64 CMapGEMF::getFilenameFromAddress(const quint64 offset, QString& filename)
+QByteArray CMapGEMF::readData(const quint64 address, const quint64 size)
 {
-    quint64 temp = offset;
+    // find the split file by a binary search on the start addresses
+    auto it = std::upper_bound(files.begin(), files.end(), address, [](quint64 addr, const gemffile_t& gf)
+    {
+        return addr < gf.start;
+    });
 
-    for(const gemffile_t& gf : qAsConst(files))
+    if(it == files.begin())
     {
-        if(temp < gf.size)
-        {
-            filename = gf.filename;
+        qDebug() << "CMAPGemf: ImageAddress was wrong " << address;
+        return QByteArray();
+    }
 
-            return temp;
-        }
-        temp -= gf.size;
+    const gemffile_t& gf = *(--it);
+    const quint64 offset = address - gf.start;
+    if(offset + size > gf.size)
+    {
+        qDebug() << "CMAPGemf: ImageAddress was wrong " << address;
+        return QByteArray();
     }
 
-    qDebug() << "CMAPGemf: ImageAddress was wrong " << offset;
-    return 0;
+    if(gf.data != nullptr)
+    {
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(gf.data + offset), size);
+    }
+
+    QByteArray data(size, 0);
+    gf.file->seek(offset);
+    if(gf.file->read(data.data(), size) != qint64(size))
+    {
+        return QByteArray();
+    }
+    return data;
 }
 
-QImage CMapGEMF::getTile(const quint32 row, const quint32 col, const quint32 z)
+const CMapGEMF::range_t* CMapGEMF::findRange(const quint32 col, const quint32 row, const quint32 z) const
 {
-    if(!rangesByZoom.contains(z))
+    auto ranges = rangesByZoom.constFind(z);
+    if(ranges == rangesByZoom.constEnd())
     {
-        qDebug() << "CMapGEMF: getTile called for a zoomlevel not available";
-        return QImage();
+        return nullptr;
     }
-    QList<range_t> ranges = rangesByZoom[z];
 
-    for(const range_t& range : ranges)
+    // all ranges before the first one starting right of the column are candidates
+    auto it = std::upper_bound(ranges->begin(), ranges->end(), col, [](quint32 x, const range_t& range)
     {
-        if(row >= range.minX
-           && row <= range.maxX
-           && col >= range.minY
-           && col <= range.maxY)
-        {
-            const quint32 Xidx = row - range.minX;
-            const quint32 Yidx = col - range.minY;
-            const quint32 nrYVals = range.maxY + 1 - range.minY;
-            const quint32 TileIdx = Xidx * nrYVals + Yidx;
-            const quint64 offsetRange = TileIdx * 12; // 4 + 8
+        return x < range.minX;
+    });
 
-            quint64 offsetGEMF = offsetRange + range.offset;
-            QString splitfile;
-            offsetGEMF = getFilenameFromAddress(offsetGEMF, splitfile);
-
-            QFile file(splitfile);
-            file.open(QIODevice::ReadOnly);
-            QDataStream dataFile(&file);
+    while(it != ranges->begin())
+    {
+        const range_t& range = *(--it);
+        if(range.maxXRunning < col)
+        {
+            // no range up to this one reaches the column
+            break;
+        }
 
-            dataFile.skipRawData(offsetGEMF);
+        if(col <= range.maxX && row >= range.minY && row <= range.maxY)
+        {
+            return &range;
+        }
+    }
 
-            quint64 imageDataAddress;
-            dataFile >> imageDataAddress;
+    return nullptr;
+}
 
-            quint32 size;
-            dataFile >> size;
+QByteArray CMapGEMF::getTileData(const quint32 col, const quint32 row, const quint32 z)
+{
+    const range_t* range = findRange(col, row, z);
+    if(range == nullptr)
+    {
+        return QByteArray();
+    }
 
-            file.close();
+    const quint32 Xidx = col - range->minX;
+    const quint32 Yidx = row - range->minY;
+    const quint32 nrYVals = range->maxY + 1 - range->minY;
+    const quint64 TileIdx = quint64(Xidx) * nrYVals + Yidx;
+    const quint64 offsetRange = TileIdx * 12; // 4 + 8
 
-            quint64 imageDataOffset = getFilenameFromAddress(imageDataAddress, splitfile);
-            QFile imageFile(splitfile);
-            imageFile.open(QIODevice::ReadOnly);
-            imageFile.seek(imageDataOffset);
-            QByteArray imageData(size, 0);
-            imageFile.read(imageData.data(), size);
-            return QImage::fromData((uchar*)imageData.data(), size, 0);
-        }
+    const QByteArray& entry = readData(range->offset + offsetRange, 12);
+    if(entry.size() != 12)
+    {
+        return QByteArray();
     }
 
-    return QImage();
+    const uchar* ptr = reinterpret_cast<const uchar*>(entry.constData());
+    const quint64 imageDataAddress = qFromBigEndian<quint64>(ptr);
+    const quint32 size = qFromBigEndian<quint32>(ptr + 8);
+
+    return readData(imageDataAddress, size);
 }
@@ -21,19 +21,51 @@
 
 #include "IMap.h"
 
+#include <QSharedPointer>
+
+class QFile;
+
+/**
+   @brief Map driver for GEMF tile archives
+
+   All split files of the archive are memory mapped once. The ranges of
+   each zoom level are sorted by their first column to find the range of
+   a tile by a binary search. The tile's index entry is then read directly
+   from the mapped file. If a file can't be mapped (e.g. on 32 bit systems)
+   it is read by seek and read instead.
+
+   Decoded tiles are stored in CTileCache. Missing tiles of the viewport
+   are decoded in parallel.
+ */
 class CMapGEMF : public IMap
 {
     Q_OBJECT
 public:
     CMapGEMF(const QString& filename, CMapDraw* parent);
+    virtual ~CMapGEMF();
     void draw(IDrawContext::buffer_t& buf) override;
 
 private:
     const quint32 MAX_ZOOM_LEVEL = 21;
     const quint32 MIN_ZOOM_LEVEL = 0;
 
-    QImage getTile(const quint32 col, const quint32 row, const quint32 z);
-    quint64 getFilenameFromAddress(const quint64 offset, QString& filename );
+    /**
+       @brief Get the raw image data of a tile
+
+       @param col   the tile's column
+       @param row   the tile's row
+       @param z     the zoom level
+       @return The image data. It references the mapped file if possible. An empty array if the tile does not exist.
+     */
+    QByteArray getTileData(const quint32 col, const quint32 row, const quint32 z);
+    /**
+       @brief Read data from the archive
+
+       @param address   the address of the data in the concatenated split files
+       @param size      the number of bytes to read
+       @return The data. It references the mapped file if possible. An empty array on errors.
+     */
+    QByteArray readData(const quint64 address, const quint64 size);
 
     struct source_t
     {
@@ -44,7 +76,12 @@ private:
     struct gemffile_t
     {
         QString filename;
+        /// the start address of the file in the concatenated split files
+        quint64 start;
         quint64 size;
+        QSharedPointer<QFile> file;
+        /// the mapped file, nullptr if it can't be mapped
+        const uchar* data = nullptr;
     };
     struct range_t
     {
@@ -55,8 +92,20 @@ private:
         quint32 maxY;
         quint32 sourceIdx;
         quint64 offset;
+        /// the largest maxX of this and all ranges before it in rangesByZoom
+        quint32 maxXRunning;
     };
 
+    /**
+       @brief Find the range containing a tile
+
+       The ranges starting left of the column are searched backwards. The search
+       stops as soon as no range before can reach the column, see range_t::maxXRunning.
+
+       @return The range or nullptr if there is none
+     */
+    const range_t* findRange(const quint32 col, const quint32 row, const quint32 z) const;
+
     QString filename;
     quint32 version;
     quint32 tileSize;
@@ -66,7 +115,8 @@ private:
     quint32 maxZoom;
     QList< source_t> sources;
     QList<gemffile_t> files;
-    QHash<quint32, QList<range_t> > rangesByZoom;
+    /// the ranges of each zoom level sorted by minX
+    QHash<quint32, QVector<range_t> > rangesByZoom;
 };
 
 #endif // CMAPGEMF_H
@@ -33,6 +33,7 @@
 #include "units/IUnit.h"
 
 #include <QPainterPath>
+#include <QSaveFile>
 #include <QtWidgets>
 
 #undef DEBUG_SHOW_SECT_DESC
@@ -44,6 +45,10 @@
 
 #define STREETNAME_THRESHOLD 5.0
 
+#define INDEX_DIR_NAME  "IMGIndex"
+#define INDEX_MAGIC     "QMSIMGIX"
+#define INDEX_VERSION   1
+
 int CFileExt::cnt = 0;
 
 static inline bool isCompletelyOutside(const QPolygonF& poly, const QRectF& viewport)
@@ -470,10 +475,15 @@ void CMapIMG::setupTyp()
 }
 
 void CMapIMG::readFile(CFileExt& file, quint32 offset, quint32 size, QByteArray& data)
+{
+    readFile(file, offset, size, data, mask);
+}
+
+void CMapIMG::readFile(CFileExt& file, quint32 offset, quint32 size, QByteArray& data, quint8 mask)
 {
     if(offset + size > file.size())
     {
-        throw exce_t(eErrOpen, tr("Failed to read: ") + filename);
+        throw exce_t(eErrOpen, tr("Failed to read: ") + file.fileName());
     }
 
     data = QByteArray::fromRawData(file.data(offset, size), size);
@@ -483,7 +493,19 @@ void CMapIMG::readFile(CFileExt& file, quint32 offset, quint32 size, QByteArray&
         return;
     }
 
+    quint32 mask32 = mask;
+    mask32 <<= 8;
+    mask32 |= mask;
+    mask32 <<= 8;
+    mask32 |= mask;
+    mask32 <<= 8;
+    mask32 |= mask;
+
 #ifdef HOST_IS_64_BIT
+    quint64 mask64 = mask32;
+    mask64 <<= 32;
+    mask64 |= mask32;
+
     quint64* p64 = (quint64*)data.data();
     for(quint32 i = 0; i < size / 8; ++i)
     {
@@ -509,6 +531,83 @@ void CMapIMG::readFile(CFileExt& file, quint32 offset, quint32 size, QByteArray&
 
 
 void CMapIMG::readBasics()
+{
+    index_t index;
+    if(!loadIndex(filename, index))
+    {
+        // drop whatever has been read from an invalid index
+        index = index_t();
+        parseBasics(filename, index, true);
+        saveIndex(filename, index);
+    }
+    else
+    {
+        qDebug() << "IMG: use index" << getIndexFilename(filename);
+    }
+
+    mask = index.mask;
+    mapdesc = index.mapdesc;
+    transparent = index.transparent;
+    maparea = index.maparea;
+    boundingBox = maparea.normalized();
+    copyrights = index.copyrights;
+    subfiles = index.subfiles;
+
+    for(subfile_desc_t& subfile : subfiles)
+    {
+        setupStrTbl(subfile);
+    }
+
+    // combine copyright sections
+    copyright.clear();
+    for(const QString& str : qAsConst(copyrights))
+    {
+        if(!copyright.isEmpty())
+        {
+            copyright += "\n";
+        }
+        copyright += str;
+    }
+
+    qDebug() << mapdesc;
+    qDebug() << "dimensions:\t" << "N" << (maparea.bottom() * RAD_TO_DEG) << "E" << (maparea.right() * RAD_TO_DEG) << "S" << (maparea.top() * RAD_TO_DEG) << "W" << (maparea.left() * RAD_TO_DEG);
+}
+
+void CMapIMG::setupStrTbl(subfile_desc_t& subfile)
+{
+    const strtbl_desc_t& desc = subfile.strtblDesc;
+    switch(desc.coding)
+    {
+    case 0x00:
+        // no LBL part
+        return;
+
+    case 0x06:
+        subfile.strtbl = new CGarminStrTbl6(desc.codepage, mask, this);
+        break;
+
+    case 0x09:
+        subfile.strtbl = new CGarminStrTbl8(desc.codepage, mask, this);
+        break;
+
+    case 0x0A:
+        subfile.strtbl = new CGarminStrTblUtf8(desc.codepage, mask, this);
+        break;
+
+    default:
+        qWarning() << "Unknown label coding" << hex << desc.coding;
+        return;
+    }
+
+    subfile.strtbl->registerLBL1(desc.offsetLbl1, desc.sizeLbl1, desc.shiftLbl1);
+    subfile.strtbl->registerLBL6(desc.offsetLbl6, desc.sizeLbl6);
+    if(desc.offsetNet1 != 0)
+    {
+        subfile.strtbl->registerNET1(desc.offsetNet1, desc.sizeNet1, desc.shiftNet1);
+    }
+}
+
+void CMapIMG::parseBasics(const QString& filename, index_t& index, bool showProgress)
 {
     char tmpstr[64];
     qint64 fsize = QFileInfo(filename).size();
@@ -519,23 +618,12 @@ void CMapIMG::readBasics()
         throw exce_t(eErrOpen, tr("Failed to open: ") + filename);
     }
 
-    mask = (quint8) * file.data(0, 1);
-
-    mask32 = mask;
-    mask32 <<= 8;
-    mask32 |= mask;
-    mask32 <<= 8;
-    mask32 |= mask;
-    mask32 <<= 8;
-    mask32 |= mask;
-
-    mask64 = mask32;
-    mask64 <<= 32;
-    mask64 |= mask32;
+    const quint8 mask = (quint8) * file.data(0, 1);
+    index.mask = mask;
 
     // read hdr_img_t
     QByteArray imghdr;
-    readFile(file, 0, sizeof(hdr_img_t), imghdr);
+    readFile(file, 0, sizeof(hdr_img_t), imghdr, mask);
     hdr_img_t* pImgHdr = (hdr_img_t*)imghdr.data();
 
     if(strncmp(pImgHdr->signature, "DSKIMG", 7) != 0)
@@ -547,15 +635,14 @@ void CMapIMG::readBasics()
         throw exce_t(errFormat, tr("Bad file format: ") + filename);
     }
 
-    mapdesc = QByteArray((const char*)pImgHdr->desc1, 20);
-    mapdesc += pImgHdr->desc2;
-    qDebug() << mapdesc;
+    index.mapdesc = QByteArray((const char*)pImgHdr->desc1, 20);
+    index.mapdesc += pImgHdr->desc2;
 
     size_t blocksize = pImgHdr->blocksize();
 
     // 1st read FAT
     QByteArray FATblock;
-    readFile(file, sizeof(hdr_img_t), sizeof(FATblock_t), FATblock);
+    readFile(file, sizeof(hdr_img_t), sizeof(FATblock_t), FATblock, mask);
     const FATblock_t* pFATBlock = (const FATblock_t* )FATblock.data();
 
     size_t dataoffset = sizeof(hdr_img_t);
@@ -568,7 +655,7 @@ void CMapIMG::readBasics()
             break;
         }
         dataoffset += sizeof(FATblock_t);
-        readFile(file, quint32(dataoffset), quint32(sizeof(FATblock_t)), FATblock);
+        readFile(file, quint32(dataoffset), quint32(sizeof(FATblock_t)), FATblock, mask);
         pFATBlock = (const FATblock_t* )FATblock.data();
     }
 
@@ -614,7 +701,7 @@ void CMapIMG::readBasics()
             // skip MAPSORC.MPS section
             if(strcmp(tmpstr, "MAPSOURC") && strcmp(tmpstr, "SENDMAP2"))
             {
-                subfile_desc_t& subfile = subfiles[tmpstr];
+                subfile_desc_t& subfile = index.subfiles[tmpstr];
                 subfile.name = tmpstr;
 
                 memcpy(tmpstr, pFATBlock->type, sizeof(pFATBlock->type));
@@ -627,7 +714,7 @@ void CMapIMG::readBasics()
         }
 
         dataoffset += sizeof(FATblock_t);
-        readFile(file, quint32(dataoffset), quint32(sizeof(FATblock_t)), FATblock);
+        readFile(file, quint32(dataoffset), quint32(sizeof(FATblock_t)), FATblock, mask);
         pFATBlock = (const FATblock_t* )FATblock.data();
     }
 
@@ -650,8 +737,8 @@ void CMapIMG::readBasics()
 
 #ifdef DEBUG_SHOW_SECT_DESC
     {
-        QMap<QString, subfile_desc_t>::const_iterator subfile = subfiles.begin();
-        while(subfile != subfiles.end())
+        QMap<QString, subfile_desc_t>::const_iterator subfile = index.subfiles.begin();
+        while(subfile != index.subfiles.end())
         {
             qDebug() << "--- subfile" << subfile->name << "---";
             QMap<QString, subfile_part_t>::const_iterator part = subfile->parts.begin();
@@ -666,41 +753,43 @@ void CMapIMG::readBasics()
 #endif                       //DEBUG_SHOW_SECT_DESC
 
     int cnt = 1;
-    int tot = subfiles.count();
+    int tot = index.subfiles.count();
 
-    PROGRESS_SETUP(tr("Loading %1").arg(QFileInfo(filename).fileName()), 0, tot, CMainWindow::getBestWidgetForParent());
+    // the progress dialog can't be used by worker threads
+    QScopedPointer<CProgressDialog> progress;
+    if(showProgress)
+    {
+        progress.reset(new CProgressDialog(tr("Loading %1").arg(QFileInfo(filename).fileName()), 0, tot, CMainWindow::getBestWidgetForParent()));
+    }
 
-    maparea = QRectF();
-    QMap<QString, subfile_desc_t>::iterator subfile = subfiles.begin();
-    while(subfile != subfiles.end())
+    index.maparea = QRectF();
+    QMap<QString, subfile_desc_t>::iterator subfile = index.subfiles.begin();
+    while(subfile != index.subfiles.end())
     {
-        PROGRESS(cnt++, throw exce_t(errAbort, tr("User abort: ") + filename));
+        if(!progress.isNull())
+        {
+            progress->setValue(cnt++);
+            if(progress->wasCanceled())
+            {
+                throw exce_t(errAbort, tr("User abort: ") + filename);
+            }
+        }
+
         if((*subfile).parts.contains("GMP"))
         {
             throw exce_t(errFormat, tr("File is NT format. QMapShack is unable to read map files with NT format: ") + filename);
         }
 
-        readSubfileBasics(*subfile, file);
+        parseSubfileBasics(*subfile, file, index);
 
         ++subfile;
     }
-
-    // combine copyright sections
-    copyright.clear();
-    for(const QString& str : qAsConst(copyrights))
-    {
-        if(!copyright.isEmpty())
-        {
-            copyright += "\n";
-        }
-        copyright += str;
-    }
-
-    qDebug() << "dimensions:\t" << "N" << (maparea.bottom() * RAD_TO_DEG) << "E" << (maparea.right() * RAD_TO_DEG) << "S" << (maparea.top() * RAD_TO_DEG) << "W" << (maparea.left() * RAD_TO_DEG);
 }
 
-void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
+void CMapIMG::parseSubfileBasics(subfile_desc_t& subfile, CFileExt& file, index_t& index)
 {
+    const quint8 mask = index.mask;
+
     // test for mandatory subfile parts
     if(!(subfile.parts.contains("TRE") && subfile.parts.contains("RGN")))
     {
@@ -708,11 +797,11 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
     }
 
     QByteArray trehdr;
-    readFile(file, subfile.parts["TRE"].offset, sizeof(hdr_tre_t), trehdr);
+    readFile(file, subfile.parts["TRE"].offset, sizeof(hdr_tre_t), trehdr, mask);
     hdr_tre_t* pTreHdr = (hdr_tre_t* )trehdr.data();
 
     subfile.isTransparent = pTreHdr->POI_flags & 0x02;
-    transparent = subfile.isTransparent ? true : transparent;
+    index.transparent = subfile.isTransparent ? true : index.transparent;
 
 #ifdef DEBUG_SHOW_TRE_DATA
     qDebug() << "+++" << subfile.name << "+++";
@@ -723,7 +812,7 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
     qDebug() << "TRE2 size          :" << dec << gar_load(quint32, pTreHdr->tre2_size);
 #endif                       // DEBUG_SHOW_TRE_DATA
 
-    copyrights << QString(file.data(subfile.parts["TRE"].offset + gar_load(uint16_t, pTreHdr->length), 0x7FFF));
+    index.copyrights << QString(file.data(subfile.parts["TRE"].offset + gar_load(uint16_t, pTreHdr->length), 0x7FFF));
 
     // read map boundaries from header
     qint32 i32;
@@ -748,13 +837,13 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
 
     subfile.area = QRectF(QPointF(subfile.west, subfile.north), QPointF(subfile.east, subfile.south));
 
-    if(maparea.isNull())
+    if(index.maparea.isNull())
     {
-        maparea = subfile.area;
+        index.maparea = subfile.area;
     }
     else
     {
-        maparea = maparea.united(subfile.area);
+        index.maparea = index.maparea.united(subfile.area);
     }
 
 #ifdef DEBUG_SHOW_TRE_DATA
@@ -763,7 +852,7 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
 #endif                       // DEBUG_SHOW_TRE_DATA
 
     QByteArray maplevel;
-    readFile(file, subfile.parts["TRE"].offset + gar_load(quint32, pTreHdr->tre1_offset), gar_load(quint32, pTreHdr->tre1_size), maplevel);
+    readFile(file, subfile.parts["TRE"].offset + gar_load(quint32, pTreHdr->tre1_offset), gar_load(quint32, pTreHdr->tre1_size), maplevel, mask);
     const tre_map_level_t* pMapLevel = (const tre_map_level_t* )maplevel.data();
 
     if(pTreHdr->flag & 0x80)
@@ -806,7 +895,7 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
 
     // point to first 16 byte subdivision definition entry
     QByteArray subdiv_n;
-    readFile(file, subfile.parts["TRE"].offset + gar_load(quint32, pTreHdr->tre2_offset), gar_load(quint32, pTreHdr->tre2_size), subdiv_n);
+    readFile(file, subfile.parts["TRE"].offset + gar_load(quint32, pTreHdr->tre2_offset), gar_load(quint32, pTreHdr->tre2_size), subdiv_n, mask);
     tre_subdiv_next_t* pSubDivN = (tre_subdiv_next_t*)subdiv_n.data();
 
     QVector<subdiv_desc_t> subdivs;
@@ -816,7 +905,7 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
 
     // absolute offset of RGN data
     QByteArray rgnhdr;
-    readFile(file, subfile.parts["RGN"].offset, sizeof(hdr_rgn_t), rgnhdr);
+    readFile(file, subfile.parts["RGN"].offset, sizeof(hdr_rgn_t), rgnhdr, mask);
     hdr_rgn_t* pRgnHdr = (hdr_rgn_t*)rgnhdr.data();
     quint32 rgnoff = /*subfile.parts["RGN"].offset +*/ gar_load(quint32, pRgnHdr->offset);
 
@@ -943,7 +1032,7 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
         //rgnoff = subfile.parts["RGN"].offset;
         //         qDebug() << subdivs.count() << (pTreHdr->tre7_size / pTreHdr->tre7_rec_size) << pTreHdr->tre7_rec_size;
         QByteArray subdiv2;
-        readFile(file, subfile.parts["TRE"].offset + gar_load(quint32, pTreHdr->tre7_offset), gar_load(quint32, pTreHdr->tre7_size), subdiv2);
+        readFile(file, subfile.parts["TRE"].offset + gar_load(quint32, pTreHdr->tre7_offset), gar_load(quint32, pTreHdr->tre7_size), subdiv2, mask);
         tre_subdiv2_t* pSubDiv2 = (tre_subdiv2_t*)subdiv2.data();
 
         //        const quint32 entries1 = gar_load(quint32, pTreHdr->tre7_size) / gar_load(quint32, pTreHdr->tre7_rec_size);
@@ -1032,7 +1121,7 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
     if(subfile.parts.contains("LBL"))
     {
         QByteArray lblhdr;
-        readFile(file, subfile.parts["LBL"].offset, sizeof(hdr_lbl_t), lblhdr);
+        readFile(file, subfile.parts["LBL"].offset, sizeof(hdr_lbl_t), lblhdr, mask);
         hdr_lbl_t* pLblHdr = (hdr_lbl_t*)lblhdr.data();
 
         quint32 offsetLbl1 = subfile.parts["LBL"].offset + gar_load(quint32, pLblHdr->lbl1_offset);
@@ -1043,7 +1132,7 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
         hdr_net_t* pNetHdr = nullptr;
         if(subfile.parts.contains("NET"))
         {
-            readFile(file, subfile.parts["NET"].offset, sizeof(hdr_net_t), nethdr);
+            readFile(file, subfile.parts["NET"].offset, sizeof(hdr_net_t), nethdr, mask);
             pNetHdr = (hdr_net_t*)nethdr.data();
             offsetNet1 = subfile.parts["NET"].offset + gar_load(quint32, pNetHdr->net1_offset);
         }
@@ -1056,33 +1145,255 @@ void CMapIMG::readSubfileBasics(subfile_desc_t& subfile, CFileExt& file)
 
         //         qDebug() << file.fileName() << hex << offsetLbl1 << offsetLbl6 << offsetNet1;
 
-        switch(pLblHdr->coding)
+        // the string table object itself is created by setupStrTbl()
+        strtbl_desc_t& desc = subfile.strtblDesc;
+        desc.coding = pLblHdr->coding;
+        desc.codepage = codepage;
+        desc.offsetLbl1 = offsetLbl1;
+        desc.sizeLbl1 = gar_load(quint32, pLblHdr->lbl1_length);
+        desc.shiftLbl1 = pLblHdr->addr_shift;
+        desc.offsetLbl6 = offsetLbl6;
+        desc.sizeLbl6 = gar_load(quint32, pLblHdr->lbl6_length);
+        if(nullptr != pNetHdr)
         {
-        case 0x06:
-            subfile.strtbl = new CGarminStrTbl6(codepage, mask, this);
-            break;
+            desc.offsetNet1 = offsetNet1;
+            desc.sizeNet1 = gar_load(quint32, pNetHdr->net1_length);
+            desc.shiftNet1 = pNetHdr->net1_addr_shift;
+        }
+    }
+}
 
-        case 0x09:
-            subfile.strtbl = new CGarminStrTbl8(codepage, mask, this);
-            break;
 
-        case 0x0A:
-            subfile.strtbl = new CGarminStrTblUtf8(codepage, mask, this);
-            break;
+QString CMapIMG::getIndexFilename(const QString& filename)
+{
+    const QString& root = CMapDraw::getCacheRoot();
+    if(root.isEmpty())
+    {
+        return QString();
+    }
+
+    QDir dir(root);
+    dir.mkpath(INDEX_DIR_NAME);
+    dir.cd(INDEX_DIR_NAME);
+
+    const QByteArray& hash = QCryptographicHash::hash(QFileInfo(filename).absoluteFilePath().toUtf8(), QCryptographicHash::Md5);
+    return dir.absoluteFilePath(hash.toHex() + ".idx");
+}
+
+/*
+    Layout of the sidecar index (QDataStream, Qt_5_2):
+
+        header:     magic "QMSIMGIX", version, sizeof(subdiv_desc_t), size and
+                    time of modification of the map file, absolute path of the map file
+        basics:     mask, map description, transparent flag, map area, copyrights
+        subfiles:   count and for each subfile its name, parts, boundaries, map levels,
+                    string table description and the subdivisions as raw block
+
+    The subdivisions are stored as a raw block to read them with a single copy.
+    That's why the size of subdiv_desc_t is part of the header. It changes with
+    the structure and invalidates the index as well as a new version does.
+ */
+static void writeIndexHeader(QDataStream& stream, const QFileInfo& fi, quint32 sizeSubdiv)
+{
+    stream.writeRawData(INDEX_MAGIC, sizeof(INDEX_MAGIC) - 1);
+    stream << quint32(INDEX_VERSION) << sizeSubdiv;
+    stream << qint64(fi.size()) << qint64(fi.lastModified().toMSecsSinceEpoch());
+    stream << fi.absoluteFilePath();
+}
+
+static bool checkIndexHeader(QDataStream& stream, const QFileInfo& fi, quint32 sizeSubdiv)
+{
+    char magic[sizeof(INDEX_MAGIC) - 1];
+    if(stream.readRawData(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0)
+    {
+        return false;
+    }
+
+    quint32 version = 0;
+    quint32 size = 0;
+    qint64 fileSize = 0;
+    qint64 fileTime = 0;
+    QString path;
+    stream >> version >> size >> fileSize >> fileTime >> path;
+
+    return (stream.status() == QDataStream::Ok)
+           && (version == INDEX_VERSION)
+           && (size == sizeSubdiv)
+           && (fileSize == fi.size())
+           && (fileTime == fi.lastModified().toMSecsSinceEpoch())
+           && (path == fi.absoluteFilePath());
+}
+
+bool CMapIMG::loadIndex(const QString& filename, index_t& index, bool headerOnly)
+{
+    const QString& indexFilename = getIndexFilename(filename);
+    if(indexFilename.isEmpty())
+    {
+        return false;
+    }
+
+    QFile file(indexFilename);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
 
-        default:
-            qWarning() << "Unknown label coding" << hex << pLblHdr->coding;
+    // map the index and read it without copying it as a whole
+    const qint64 size = file.size();
+    const uchar* data = file.map(0, size);
+    QByteArray buffer;
+    if(data != nullptr)
+    {
+        buffer = QByteArray::fromRawData(reinterpret_cast<const char*>(data), int(size));
+    }
+    else
+    {
+        buffer = file.readAll();
+    }
+
+    QDataStream stream(buffer);
+    stream.setVersion(QDataStream::Qt_5_2);
+
+    if(!checkIndexHeader(stream, QFileInfo(filename), sizeof(subdiv_desc_t)))
+    {
+        return false;
+    }
+
+    if(headerOnly)
+    {
+        return true;
+    }
+
+    quint32 nSubfiles = 0;
+    stream >> index.mask >> index.mapdesc >> index.transparent >> index.maparea >> index.copyrights;
+    stream >> nSubfiles;
+
+    for(quint32 n = 0; n < nSubfiles && stream.status() == QDataStream::Ok; n++)
+    {
+        QString name;
+        stream >> name;
+        subfile_desc_t& subfile = index.subfiles[name];
+        subfile.name = name;
+
+        quint32 nParts = 0;
+        stream >> nParts;
+        for(quint32 i = 0; i < nParts && stream.status() == QDataStream::Ok; i++)
+        {
+            QString type;
+            stream >> type;
+            subfile_part_t& part = subfile.parts[type];
+            stream >> part.offset >> part.size;
         }
 
-        if(nullptr != subfile.strtbl)
+        stream >> subfile.north >> subfile.east >> subfile.south >> subfile.west >> subfile.area >> subfile.isTransparent;
+
+        quint32 nLevels = 0;
+        stream >> nLevels;
+        for(quint32 i = 0; i < nLevels && stream.status() == QDataStream::Ok; i++)
         {
-            subfile.strtbl->registerLBL1(offsetLbl1, gar_load(quint32, pLblHdr->lbl1_length), pLblHdr->addr_shift);
-            subfile.strtbl->registerLBL6(offsetLbl6, gar_load(quint32, pLblHdr->lbl6_length));
-            if(nullptr != pNetHdr)
-            {
-                subfile.strtbl->registerNET1(offsetNet1, gar_load(quint32, pNetHdr->net1_length), pNetHdr->net1_addr_shift);
-            }
+            maplevel_t ml;
+            stream >> ml.inherited >> ml.level >> ml.bits;
+            subfile.maplevels << ml;
+        }
+
+        strtbl_desc_t& desc = subfile.strtblDesc;
+        stream >> desc.coding >> desc.codepage;
+        stream >> desc.offsetLbl1 >> desc.sizeLbl1 >> desc.shiftLbl1;
+        stream >> desc.offsetLbl6 >> desc.sizeLbl6;
+        stream >> desc.offsetNet1 >> desc.sizeNet1 >> desc.shiftNet1;
+
+        quint32 nSubdivs = 0;
+        stream >> nSubdivs;
+        if(stream.status() != QDataStream::Ok || quint64(nSubdivs) * sizeof(subdiv_desc_t) > quint64(size))
+        {
+            return false;
+        }
+
+        subfile.subdivs.resize(nSubdivs);
+        const int sizeSubdivs = int(nSubdivs * sizeof(subdiv_desc_t));
+        if(stream.readRawData(reinterpret_cast<char*>(subfile.subdivs.data()), sizeSubdivs) != sizeSubdivs)
+        {
+            return false;
+        }
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+void CMapIMG::saveIndex(const QString& filename, const index_t& index)
+{
+    const QString& indexFilename = getIndexFilename(filename);
+    if(indexFilename.isEmpty())
+    {
+        return;
+    }
+
+    // write to a temporary file first, to never leave a partial index
+    QSaveFile file(indexFilename);
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "IMG: failed to write index" << indexFilename;
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_2);
+
+    writeIndexHeader(stream, QFileInfo(filename), sizeof(subdiv_desc_t));
+
+    stream << index.mask << index.mapdesc << index.transparent << index.maparea << index.copyrights;
+    stream << quint32(index.subfiles.count());
+
+    for(const subfile_desc_t& subfile : index.subfiles)
+    {
+        stream << subfile.name;
+
+        stream << quint32(subfile.parts.count());
+        for(auto part = subfile.parts.constBegin(); part != subfile.parts.constEnd(); ++part)
+        {
+            stream << part.key() << part->offset << part->size;
+        }
+
+        stream << subfile.north << subfile.east << subfile.south << subfile.west << subfile.area << subfile.isTransparent;
+
+        stream << quint32(subfile.maplevels.count());
+        for(const maplevel_t& ml : subfile.maplevels)
+        {
+            stream << ml.inherited << ml.level << ml.bits;
         }
+
+        const strtbl_desc_t& desc = subfile.strtblDesc;
+        stream << desc.coding << desc.codepage;
+        stream << desc.offsetLbl1 << desc.sizeLbl1 << desc.shiftLbl1;
+        stream << desc.offsetLbl6 << desc.sizeLbl6;
+        stream << desc.offsetNet1 << desc.sizeNet1 << desc.shiftNet1;
+
+        stream << quint32(subfile.subdivs.count());
+        stream.writeRawData(reinterpret_cast<const char*>(subfile.subdivs.constData()), int(subfile.subdivs.count() * sizeof(subdiv_desc_t)));
+    }
+
+    if(stream.status() != QDataStream::Ok || !file.commit())
+    {
+        qWarning() << "IMG: failed to write index" << indexFilename;
+    }
+}
+
+void CMapIMG::prepareIndex(const QString& filename)
+{
+    index_t index;
+    if(loadIndex(filename, index, true))
+    {
+        return;
+    }
+
+    try
+    {
+        parseBasics(filename, index, false);
+        saveIndex(filename, index);
+    }
+    catch(const exce_t& e)
+    {
+        qDebug() << "IMG: failed to prepare index" << e.msg;
     }
 }
 
@@ -1995,16 +2306,6 @@ void CMapIMG::collectText(const CGarminPolygon& item, const QPolygonF& line, con
     tp.text = str;
     tp.lineWidth = lineWidth;
 
-    const int size = line.size();
-    for(int i = 1; i < size; ++i)
-    {
-        const QPointF& p1 = line[i - 1];
-        const QPointF& p2 = line[i];
-        qreal dx = p2.x() - p1.x();
-        qreal dy = p2.y() - p1.y();
-        tp.lengths << qSqrt(dx * dx + dy * dy);
-    }
-
     textpaths << tp;
 }
 
@@ -2164,125 +2465,9 @@ void CMapIMG::drawLabels(QPainter& p, const QVector<strlbl_t>& lbls)
 
 void CMapIMG::drawText(QPainter& p)
 {
-    p.setPen(Qt::black);
-
     for(const textpath_t& textpath : qAsConst(textpaths))
     {
-        QPainterPath path;
-        QFont font = textpath.font;
-        QFontMetricsF fm(font);
-
-        path.addPolygon(textpath.polyline);
-
-        // get path length and string length
-        qreal length = qAbs(path.length());
-        qreal width = fm.width(textpath.text);
-
-        // adjust font size until string fits into polyline
-        while(width > (length * 0.7))
-        {
-            font.setPixelSize(font.pixelSize() - 1);
-            fm = QFontMetricsF(font);
-            width = fm.width(textpath.text);
-
-            if((font.pixelSize() < 8))
-            {
-                break;
-            }
-        }
-
-        // no way to draw a readable string - skip
-        if((font.pixelSize() < 8))
-        {
-            continue;
-        }
-
-        fm = QFontMetricsF(font);
-        p.setFont(font);
-
-        // adjust exact offset to first half of segment
-        const QVector<qreal>& lengths = textpath.lengths;
-        const qreal ref = (length - width) / 2;
-        qreal offset = 0;
-
-        for(int i = 0; i < lengths.size(); ++i)
-        {
-            const qreal d = lengths[i];
-
-            if((offset + d / 2) >= ref)
-            {
-                offset = ref;
-                break;
-            }
-            if((offset + d) >= ref)
-            {
-                offset += d / 2;
-                break;
-            }
-            offset += d;
-        }
-
-        // get starting angle of first two letters
-        const QString& text = textpath.text;
-        qreal percent1 = offset / length;
-        qreal percent2 = (offset + fm.width(text.left(2))) / length;
-
-        QPointF point1 = path.pointAtPercent(percent1);
-        QPointF point2 = path.pointAtPercent(percent2);
-
-        qreal angle; //     = qAtan((point2.y() - point1.y()) / (point2.x() - point1.x())) * 180 / M_PI;
-
-        // flip path if string start is E->W direction
-        // this helps, sometimes, in 50 % of the cases :)
-        if(point2.x() - point1.x() < 0)
-        {
-            path = path.toReversed();
-        }
-
-        // draw string letter by letter and adjust angle
-        const int size = text.size();
-        percent2 = offset / length;
-        point2 = path.pointAtPercent(percent2);
-
-        for(int i = 0; i < size; ++i)
-        {
-            //percent1 = percent2;
-            percent2 = (offset + fm.width(text[i])) / length;
-
-            point1 = point2;
-            point2 = path.pointAtPercent(percent2);
-
-            angle = qAtan((point2.y() - point1.y()) / (point2.x() - point1.x())) * 180 / M_PI;
-
-            if(point2.x() - point1.x() < 0)
-            {
-                angle += 180;
-            }
-
-            p.save();
-            p.translate(point1);
-            p.rotate(angle);
-
-            p.translate(0, -(textpath.lineWidth + 2));
-
-            QString str = text.mid(i, 1);
-            p.setPen(Qt::white);
-            p.drawText(-1, -1, str);
-            p.drawText( 0, -1, str);
-            p.drawText(+1, -1, str);
-            p.drawText(-1, 0, str);
-            p.drawText(+1, 0, str);
-            p.drawText(-1, +1, str);
-            p.drawText( 0, +1, str);
-            p.drawText(+1, +1, str);
-
-            p.setPen(Qt::black);
-            p.drawText( 0, 0, str);
-
-            p.restore();
-
-            offset += fm.width(text[i]);
-        }
+        CDraw::textPath(textpath.text, p, textpath.polyline, textpath.font, textpath.lineWidth, Qt::black);
     }
 }
 
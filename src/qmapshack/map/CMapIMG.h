@@ -93,6 +93,21 @@ public:
         qint32 lengthPolygons2;
     };
 
+    /// everything needed to create the subfile's string table object
+    struct strtbl_desc_t
+    {
+        quint8 coding = 0;      //< label coding, 0 if there is no LBL part
+        quint16 codepage = 0;
+        quint32 offsetLbl1 = 0;
+        quint32 sizeLbl1 = 0;
+        quint8 shiftLbl1 = 0;
+        quint32 offsetLbl6 = 0;
+        quint32 sizeLbl6 = 0;
+        quint32 offsetNet1 = 0; //< 0 if there is no NET part
+        quint32 sizeNet1 = 0;
+        quint8 shiftNet1 = 0;
+    };
+
     struct subfile_desc_t
     {
         /// the name of the subfile (not really needed)
@@ -114,6 +129,8 @@ public:
         QVector<maplevel_t> maplevels;
         /// bit 1 of POI_flags (TRE header @ 0x3F)
         bool isTransparent = false;
+        /// location and coding of the string tables (LBL/NET header)
+        strtbl_desc_t strtblDesc;
         /// object to manage the string tables
         IGarminStrTbl* strtbl = nullptr;
     };
@@ -143,6 +160,19 @@ public:
      */
     bool findPolylineCloseBy(const QPointF& pt1, const QPointF& pt2, qint32 threshold, QPolygonF& polyline) override;
 
+    /**
+       @brief Create the sidecar index of a map file if there is no valid one
+
+       The index holds all basic structures parsed by readBasics(). It is stored
+       in the map cache directory and is validated by the map file's size and time
+       of modification. This function is thread safe and does not show any dialog.
+       Thus it can be used to prepare several maps in parallel before they get
+       activated. Errors are ignored. They will be reported on activation.
+
+       @param filename  the IMG file's path
+     */
+    static void prepareIndex(const QString& filename);
+
 public slots:
     void slotSetTypeFile(const QString& filename) override;
 
@@ -165,12 +195,31 @@ private:
     };
 
 
+    /// all information readBasics() gets from the file, as stored in the sidecar index
+    struct index_t
+    {
+        quint8 mask = 0;
+        QString mapdesc;
+        bool transparent = false;
+        QRectF maparea;
+        QSet<QString> copyrights;
+        QMap<QString, subfile_desc_t> subfiles;
+    };
+
     quint8 scale2bits(const QPointF& scale);
     void setupTyp();
     void readBasics();
-    void readSubfileBasics(subfile_desc_t& subfile, CFileExt& file);
+    void setupStrTbl(subfile_desc_t& subfile);
     void processPrimaryMapData();
     void readFile(CFileExt& file, quint32 offset, quint32 size, QByteArray& data);
+    static void readFile(CFileExt& file, quint32 offset, quint32 size, QByteArray& data, quint8 mask);
+
+    static void parseBasics(const QString& filename, index_t& index, bool showProgress);
+    static void parseSubfileBasics(subfile_desc_t& subfile, CFileExt& file, index_t& index);
+    /// get the path of the sidecar index, empty if there is no cache directory
+    static QString getIndexFilename(const QString& filename);
+    static bool loadIndex(const QString& filename, index_t& index, bool headerOnly = false);
+    static void saveIndex(const QString& filename, const index_t& index);
     void loadVisibleData(bool fast, polytype_t& polygons, polytype_t& polylines, pointtype_t& points, pointtype_t& pois, unsigned level, const QRectF& viewport, QPainter& p);
     void loadSubDiv(CFileExt& file, const subdiv_desc_t& subdiv, IGarminStrTbl* strtbl, const QByteArray& rgndata, bool fast, const QRectF& viewport, polytype_t& polylines, polytype_t& polygons, pointtype_t& points, pointtype_t& pois);
     bool intersectsWithExistingLabel(const QRect& rect) const;
@@ -467,9 +516,7 @@ private:
     };
 
     QString filename;
-    quint8 mask;
-    quint32 mask32;
-    quint64 mask64;
+    quint8 mask = 0;
     QString mapdesc;
     /// hold all subfile descriptors
     /**
@@ -507,7 +554,6 @@ private:
         QPolygonF polyline;
         QString text;
         QFont font;
-        QVector<qreal>  lengths;
         qint32 lineWidth;
     };
 
@@ -27,6 +27,7 @@
 #include "map/CMapVRT.h"
 #include "map/CMapWMTS.h"
 #include "map/IMapProp.h"
+#include <QtConcurrent>
 #include <QtGui>
 
 QMutex CMapItem::mutexActiveMaps(QMutex::Recursive);
@@ -44,15 +45,23 @@ CMapItem::~CMapItem()
 }
 
 void CMapItem::setFilename(const QString& name)
+{
+    setFilename(name, calcKey(name));
+}
+
+void CMapItem::setFilename(const QString& name, const QString& key)
 {
     filename = name;
+    this->key = key;
+}
 
+QString CMapItem::calcKey(const QString& filename)
+{
     QFile f(filename);
     f.open(QIODevice::ReadOnly);
     QCryptographicHash md5(QCryptographicHash::Md5);
     md5.addData(f.read(qMin(0x1000LL, f.size())));
-    key = md5.result().toHex();
-    f.close();
+    return md5.result().toHex();
 }
 
 void CMapItem::saveConfig(QSettings& cfg) const
@@ -94,7 +103,10 @@ void CMapItem::showChildren(bool yes)
     {
         QList<QTreeWidgetItem*> items = takeChildren();
         qDeleteAll(items);
-        delete mapfile->getSetup();
+        if(!mapfile.isNull())
+        {
+            delete mapfile->getSetup();
+        }
     }
 }
 
@@ -125,13 +137,13 @@ void CMapItem::updateIcon()
 bool CMapItem::isActivated()
 {
     QMutexLocker lock(&mutexActiveMaps);
-    return !mapfile.isNull();
+    return !mapfile.isNull() || deferred;
 }
 
 bool CMapItem::toggleActivate()
 {
     QMutexLocker lock(&mutexActiveMaps);
-    if(mapfile.isNull())
+    if(!isActivated())
     {
         return activate();
     }
@@ -146,6 +158,8 @@ void CMapItem::deactivate()
 {
     QMutexLocker lock(&mutexActiveMaps);
 
+    deferred = false;
+
     // remove mapfile setup dialog as child of this item
     showChildren(false);
 
@@ -164,10 +178,76 @@ void CMapItem::deactivate()
 }
 
 
+void CMapItem::defer(const QRectF& area, qreal minScale, qreal maxScale)
+{
+    QMutexLocker lock(&mutexActiveMaps);
+
+    delete mapfile;
+
+    deferredArea = area;
+    deferredMinScale = minScale;
+    deferredMaxScale = maxScale;
+    deferred = true;
+
+    // append list of active map files
+    moveToBottom();
+
+    // an active map is subject to drag-n-drop
+    setFlags(flags() | Qt::ItemIsDragEnabled);
+}
+
+bool CMapItem::isNeeded(const QRectF& area, const QPointF& scale) const
+{
+    if(!deferred)
+    {
+        return false;
+    }
+
+    if((deferredMinScale != NOFLOAT) && (scale.x() < deferredMinScale))
+    {
+        return false;
+    }
+    if((deferredMaxScale != NOFLOAT) && (scale.x() > deferredMaxScale))
+    {
+        return false;
+    }
+
+    if(deferredArea.isNull())
+    {
+        return true;
+    }
+
+    // the buffer's area can reach beyond the date line
+    const qreal wrap = 2 * M_PI;
+    return area.intersects(deferredArea)
+           || area.intersects(deferredArea.translated(-wrap, 0))
+           || area.intersects(deferredArea.translated(wrap, 0));
+}
+
+void CMapItem::prepareActivation(const QStringList& filenames)
+{
+    QStringList filenamesImg;
+    for(const QString& filename : filenames)
+    {
+        if(QFileInfo(filename).suffix().toLower() == "img")
+        {
+            filenamesImg << filename;
+        }
+    }
+    filenamesImg.removeDuplicates();
+
+    // the first activation of a large IMG file parses all of it's subfiles
+    QtConcurrent::blockingMap(filenamesImg, CMapIMG::prepareIndex);
+}
+
 bool CMapItem::activate()
 {
     QMutexLocker lock(&mutexActiveMaps);
 
+    // a deferred item is already placed in the list of active maps
+    const bool wasDeferred = deferred;
+    deferred = false;
+
     delete mapfile;
 
     // load map by suffix
@@ -207,23 +287,26 @@ bool CMapItem::activate()
 
     updateIcon();
     // no mapfiles loaded? Bad.
-    if(mapfile.isNull())
-    {
-        return false;
-    }
-
     // if map is activated successfully add to the list of map files
     // else delete all previous loaded maps and abort
-    if(!mapfile->activated())
+    if(mapfile.isNull() || !mapfile->activated())
     {
         delete mapfile;
+        if(wasDeferred)
+        {
+            deactivate();
+        }
         return false;
     }
 
     setToolTip(0, mapfile->getCopyright());
+    CMapDraw::setBoundingBox(filename, mapfile->getBoundingBox());
 
     // append list of active map files
-    moveToBottom();
+    if(!wasDeferred)
+    {
+        moveToBottom();
+    }
 
     // an active map is subject to drag-n-drop
     setFlags(flags() | Qt::ItemIsDragEnabled);
@@ -264,7 +347,7 @@ void CMapItem::moveToBottom()
     for(row = 0; row < w->topLevelItemCount(); row++)
     {
         CMapItem* item = dynamic_cast<CMapItem*>(w->topLevelItem(row));
-        if(item && item->mapfile.isNull())
+        if(item && item->mapfile.isNull() && !item->deferred)
         {
             break;
         }
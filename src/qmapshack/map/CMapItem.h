@@ -19,8 +19,10 @@
 #ifndef CMAPITEM_H
 #define CMAPITEM_H
 
+#include "units/IUnit.h"
 #include <QMutex>
 #include <QPointer>
+#include <QRectF>
 #include <QTreeWidgetItem>
 
 class IMap;
@@ -35,6 +37,10 @@ public:
     virtual ~CMapItem();
 
     void setFilename(const QString& name);
+    /// set the filename together with a key computed in advance by calcKey()
+    void setFilename(const QString& name, const QString& key);
+    /// compute the key of a map file: the MD5 hash of it's first 4k bytes
+    static QString calcKey(const QString& filename);
 
     void saveConfig(QSettings& cfg) const;
     void loadConfig(QSettings& cfg);
@@ -46,9 +52,37 @@ public:
 
     /**
        @brief Query if map objects are loaded
-       @return True if the internal list of map objects is not empty.
+       @return True if the internal list of map objects is not empty or the item is deferred.
      */
     bool isActivated();
+    /**
+       @brief Query if the item is active but the map objects are not loaded yet
+       @return True if activate() still has to be called to draw the map.
+     */
+    bool isDeferred() const
+    {
+        return deferred;
+    }
+    /**
+       @brief Add the item to the active maps without loading the map objects
+
+       The map objects are loaded by activate() as soon as the map is needed
+       to draw the view. Until then the item keeps it's place in the list of
+       active maps.
+
+       @param area      the area covered by the map in [rad] as cached by the last activation
+       @param minScale  the map's minimum scale or NOFLOAT
+       @param maxScale  the map's maximum scale or NOFLOAT
+     */
+    void defer(const QRectF& area, qreal minScale, qreal maxScale);
+    /**
+       @brief Test if a deferred item is needed to draw a buffer
+
+       @param area      the buffer's area in [rad]
+       @param scale     the buffer's scale
+       @return True if the map is unknown or visible at that area and scale.
+     */
+    bool isNeeded(const QRectF& area, const QPointF& scale) const;
     /**
        @brief Either loads or destroys internal map objects
        @return True if the internal list of maps is not empty after the operation.
@@ -63,6 +97,17 @@ public:
        @brief Delete all internal map objects
      */
     void deactivate();
+    /**
+       @brief Do the time consuming work of activating the items in parallel
+
+       Map objects have to be created by the GUI thread one by one. But some
+       map formats can preprocess their files in advance, e.g. to create an
+       index. Call this before activating a bunch of items. It does not touch
+       any item and can be called by a worker thread.
+
+       @param filenames the filenames of the items to activate next
+     */
+    static void prepareActivation(const QStringList& filenames);
     /**
        @brief Move item to top of list widget
      */
@@ -92,6 +137,8 @@ public:
 
     const QString& getKey(){return key;}
 
+    const QString& getFilename() const {return filename;}
+
 private:
     CMapDraw* map;
     /**
@@ -106,6 +153,14 @@ private:
        @brief List of loaded map objects when map is activated.
      */
     QPointer<IMap> mapfile;
+
+    /// true if the item is active but mapfile is not loaded yet
+    bool deferred = false;
+    /// the area covered by a deferred map in [rad]
+    QRectF deferredArea;
+    /// the scale range of a deferred map
+    qreal deferredMinScale = NOFLOAT;
+    qreal deferredMaxScale = NOFLOAT;
 };
 
 #endif //CMAPITEM_H
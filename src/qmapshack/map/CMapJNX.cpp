@@ -20,8 +20,10 @@
 #include "inttypes.h"
 #include "map/CMapDraw.h"
 #include "map/CMapJNX.h"
+#include "map/cache/CTileCache.h"
 #include "units/IUnit.h"
 
+#include <QtConcurrent>
 #include <QtGui>
 
 static void readCString(QDataStream& stream, QByteArray& ba)
@@ -87,6 +89,12 @@ CMapJNX::CMapJNX(const QString& filename, CMapDraw* parent)
     qint32 productId = -1;
     readFile(filename, productId);
 
+    for(const file_t& mapFile : qAsConst(files))
+    {
+        const QRectF& bbox = QRectF(mapFile.bbox.topLeft() * DEG_TO_RAD, mapFile.bbox.bottomRight() * DEG_TO_RAD).normalized();
+        boundingBox = boundingBox.isNull() ? bbox : boundingBox.united(bbox);
+    }
+
     proj.init("EPSG:3857", "EPSG:4326");
 
     isActivated = true;
@@ -235,6 +243,8 @@ void CMapJNX::readFile(const QString& fn, qint32& productId)
             tile.area.setBottom(bottom * 180.0 / 0x7FFFFFFF);
             tile.area.setLeft(left * 180.0 / 0x7FFFFFFF);
         }
+
+        buildIndex(level);
     }
 
     if(mapFile.lon1 < lon1)
@@ -273,6 +283,84 @@ qint32 CMapJNX::scale2level(qreal s, const file_t& file)
     return idxLvl;
 }
 
+void CMapJNX::buildIndex(level_t& level)
+{
+    level.area = QRectF();
+    for(const tile_t& tile : qAsConst(level.tiles))
+    {
+        level.area |= tile.area.normalized();
+    }
+
+    // aim for about one tile per cell
+    const qint32 n = qCeil(qSqrt(level.tiles.size()));
+    level.gridCols = qBound(1, n, 256);
+    level.gridRows = qBound(1, n, 256);
+    level.grid.clear();
+    level.grid.resize(level.gridCols * level.gridRows);
+
+    if(level.area.isEmpty())
+    {
+        return;
+    }
+
+    const qreal cellWidth = level.area.width() / level.gridCols;
+    const qreal cellHeight = level.area.height() / level.gridRows;
+
+    const quint32 M = level.tiles.size();
+    for(quint32 m = 0; m < M; m++)
+    {
+        const QRectF& area = level.tiles[m].area.normalized();
+        const qint32 col1 = qBound(0, qFloor((area.left() - level.area.left()) / cellWidth), level.gridCols - 1);
+        const qint32 col2 = qBound(0, qFloor((area.right() - level.area.left()) / cellWidth), level.gridCols - 1);
+        const qint32 row1 = qBound(0, qFloor((area.top() - level.area.top()) / cellHeight), level.gridRows - 1);
+        const qint32 row2 = qBound(0, qFloor((area.bottom() - level.area.top()) / cellHeight), level.gridRows - 1);
+
+        for(qint32 row = row1; row <= row2; row++)
+        {
+            for(qint32 col = col1; col <= col2; col++)
+            {
+                level.grid[row * level.gridCols + col] << m;
+            }
+        }
+    }
+}
+
+void CMapJNX::findTiles(const level_t& level, const QRectF& area, QVector<quint32>& tiles)
+{
+    tiles.clear();
+
+    const QRectF& searchArea = area.normalized() & level.area;
+    if(searchArea.isEmpty())
+    {
+        return;
+    }
+
+    const qreal cellWidth = level.area.width() / level.gridCols;
+    const qreal cellHeight = level.area.height() / level.gridRows;
+    const qint32 col1 = qBound(0, qFloor((searchArea.left() - level.area.left()) / cellWidth), level.gridCols - 1);
+    const qint32 col2 = qBound(0, qFloor((searchArea.right() - level.area.left()) / cellWidth), level.gridCols - 1);
+    const qint32 row1 = qBound(0, qFloor((searchArea.top() - level.area.top()) / cellHeight), level.gridRows - 1);
+    const qint32 row2 = qBound(0, qFloor((searchArea.bottom() - level.area.top()) / cellHeight), level.gridRows - 1);
+
+    for(qint32 row = row1; row <= row2; row++)
+    {
+        for(qint32 col = col1; col <= col2; col++)
+        {
+            for(quint32 m : level.grid[row * level.gridCols + col])
+            {
+                if(area.intersects(level.tiles[m].area))
+                {
+                    tiles << m;
+                }
+            }
+        }
+    }
+
+    // tiles spanning several cells are found multiple times
+    std::sort(tiles.begin(), tiles.end());
+    tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+}
+
 
 void CMapJNX::draw(IDrawContext::buffer_t& buf) /* override */
 {
@@ -350,47 +438,81 @@ void CMapJNX::draw(IDrawContext::buffer_t& buf) /* override */
             continue;
         }
 
-        QByteArray data(1024 * 1024 * 4, 0);
-        //(char) typecast needed to avoid MSVC compiler warning
-        //in MSVC, char is a signed type.
-        //Maybe the QByteArray declaration should be fixed ;-)
-        data[0] = (char) 0xFF;
-        data[1] = (char) 0xD8;
-        char* pData = data.data() + 2;
+        struct job_t
+        {
+            quint32 idx;
+            QString key;
+            QByteArray data;
+            QImage img;
+        };
+
+        QVector<quint32> visibleTiles;
+        findTiles(mapFile.levels[level], viewport, visibleTiles);
+
+        const QVector<tile_t>& tiles = mapFile.levels[level].tiles;
+        QVector<job_t> jobs(visibleTiles.size());
+        QVector<job_t*> pendingJobs;
 
         QFile file(mapFile.filename);
         file.open(QIODevice::ReadOnly);
 
-        const QVector<tile_t>& tiles = mapFile.levels[level].tiles;
-        const quint32 M = tiles.size();
-        for(quint32 m = 0; m < M; m++)
+        // Get decoded tiles from the cache and read all others from the file.
+        // The JPEG data in JNX files misses the SOI marker. It has to be prepended.
+        for(int i = 0; i < visibleTiles.size(); i++)
         {
-            if(map->needsRedraw())
+            job_t& job = jobs[i];
+            job.idx = visibleTiles[i];
+            job.key = CTileCache::key(mapFile.filename, level, job.idx);
+
+            if(CTileCache::self().find(job.key, job.img))
             {
-                break;
+                continue;
             }
 
-            const tile_t& tile = tiles[m];
+            const tile_t& tile = tiles[job.idx];
+            job.data.resize(tile.size + 2);
+            //(char) typecast needed to avoid MSVC compiler warning
+            //in MSVC, char is a signed type.
+            job.data[0] = (char) 0xFF;
+            job.data[1] = (char) 0xD8;
+            file.seek(tile.offset);
+            file.read(job.data.data() + 2, tile.size);
+            pendingJobs << &job;
+        }
+
+        if(map->needsRedraw())
+        {
+            break;
+        }
 
-            if(viewport.intersects(tile.area))
+        // decode all missing tiles in parallel
+        QtConcurrent::blockingMap(pendingJobs, [](job_t* job)
+        {
+            job->img.loadFromData(job->data);
+            job->data.clear();
+            CTileCache::self().insert(job->key, job->img);
+        });
+
+        for(const job_t& job : qAsConst(jobs))
+        {
+            if(map->needsRedraw())
             {
-                QImage img;
-                file.seek(tile.offset);
-                file.read(pData, tile.size);
-                img.loadFromData(data);
-
-                QPolygonF l(4);
-                l[0].rx() = tile.area.left() * DEG_TO_RAD;
-                l[0].ry() = tile.area.top() * DEG_TO_RAD;
-                l[1].rx() = tile.area.right() * DEG_TO_RAD;
-                l[1].ry() = tile.area.top() * DEG_TO_RAD;
-                l[2].rx() = tile.area.right() * DEG_TO_RAD;
-                l[2].ry() = tile.area.bottom() * DEG_TO_RAD;
-                l[3].rx() = tile.area.left() * DEG_TO_RAD;
-                l[3].ry() = tile.area.bottom() * DEG_TO_RAD;
-
-                drawTile(img, l, p);
+                break;
             }
+
+            const tile_t& tile = tiles[job.idx];
+
+            QPolygonF l(4);
+            l[0].rx() = tile.area.left() * DEG_TO_RAD;
+            l[0].ry() = tile.area.top() * DEG_TO_RAD;
+            l[1].rx() = tile.area.right() * DEG_TO_RAD;
+            l[1].ry() = tile.area.top() * DEG_TO_RAD;
+            l[2].rx() = tile.area.right() * DEG_TO_RAD;
+            l[2].ry() = tile.area.bottom() * DEG_TO_RAD;
+            l[3].rx() = tile.area.left() * DEG_TO_RAD;
+            l[3].ry() = tile.area.bottom() * DEG_TO_RAD;
+
+            drawTile(job.img, l, p);
         }
     }
 }
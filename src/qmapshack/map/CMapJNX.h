@@ -79,6 +79,14 @@ private:
         QString copyright2;
 
         QVector<tile_t> tiles;
+
+        /// bounding box of all tiles
+        QRectF area;
+        /// number of columns and rows of the spatial index
+        qint32 gridCols = 0;
+        qint32 gridRows = 0;
+        /// spatial index: for each grid cell the indices of all tiles intersecting it
+        QVector<QVector<quint32>> grid;
     };
 
 
@@ -96,6 +104,20 @@ private:
 
     void readFile(const QString& fn, qint32& productId);
     qint32 scale2level(qreal s, const file_t& file);
+    /**
+       @brief Build a uniform grid index over the tiles of a level
+
+       @param level     the level with all tiles read
+     */
+    static void buildIndex(level_t& level);
+    /**
+       @brief Find the tiles of a level intersecting with an area
+
+       @param level     the level to search
+       @param area      the area in degree
+       @param tiles     a list to receive the tile indices in ascending order
+     */
+    static void findTiles(const level_t& level, const QRectF& area, QVector<quint32>& tiles);
 
     QList<file_t> files;
 
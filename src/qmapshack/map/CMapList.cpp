@@ -68,6 +68,7 @@ CMapList::CMapList(QWidget* parent)
 {
     setupUi(this);
     lineFilter->addAction(actionClearFilter, QLineEdit::TrailingPosition);
+    progressActivate->hide();
 
     connect(treeWidget, &CMapTreeWidget::customContextMenuRequested, this, &CMapList::slotContextMenu);
     connect(treeWidget, &CMapTreeWidget::sigChanged, this, &CMapList::sigChanged);
@@ -133,9 +134,15 @@ void CMapList::updateHelpText()
 {
     bool haveMaps = (treeWidget->topLevelItemCount() > 0);
 
-    labelHelpFillMapList->setVisible(!haveMaps);
+    labelSearching->setVisible(searching);
+    labelHelpFillMapList->setVisible(!haveMaps && !searching);
 
-    if(!haveMaps)
+    if(searching)
+    {
+        labelIcon->hide();
+        labelHelpActivateMap->hide();
+    }
+    else if(!haveMaps)
     {
         labelIcon->show();
         labelHelpActivateMap->hide();
@@ -150,6 +157,19 @@ void CMapList::updateHelpText()
     }
 }
 
+void CMapList::setSearching(bool yes)
+{
+    searching = yes;
+    updateHelpText();
+}
+
+void CMapList::setActivating(int done, int total)
+{
+    progressActivate->setMaximum(total);
+    progressActivate->setValue(done);
+    progressActivate->setVisible(done < total);
+}
+
 void CMapList::slotActivate()
 {
     CMapItem* item = dynamic_cast<CMapItem*>(treeWidget->currentItem());
@@ -61,6 +61,17 @@ public:
     }
 
     void updateHelpText();
+    /// show a hint while the map folders are searched
+    void setSearching(bool yes);
+    /**
+       @brief Show the progress of the maps activated in the background
+
+       The progress bar is hidden as soon as all maps are done.
+
+       @param done      the number of maps already activated
+       @param total     the number of maps to activate
+     */
+    void setActivating(int done, int total);
 
 signals:
     void sigChanged();
@@ -78,6 +89,7 @@ private slots:
 
 private:
     QMenu* menu;
+    bool searching = false;
 };
 
 #endif //CMAPLIST_H
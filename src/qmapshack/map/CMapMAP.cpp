@@ -16,37 +16,45 @@
 
 **********************************************************************************************/
 
+#include "canvas/CCanvas.h"
 #include "CMainWindow.h"
-#include "gis/proj_x.h"
-#include "helpers/CFileExt.h"
+#include "helpers/CDraw.h"
 #include "map/CMapDraw.h"
 #include "map/CMapMAP.h"
 
+#include <QtConcurrent>
 #include <QtWidgets>
 
-#define INT_TO_DEG(x) (qreal(x) / 1e6)
-
-#define INT_TO_RAD(x) (qreal(x) / (1e6 * RAD_TO_DEG))
+#undef DEBUG_SHOW_TIMING
 
+/// don't decode more tiles than that for a single view
+#define MAX_TILES               1024
+/// the maximum memory used by decoded tiles [byte]
+#define MAX_TILE_CACHE          (64 * 1024 * 1024)
 
+#define DEFAULT_THEME           ":/map/mapsforge/default.xml"
 
 CMapMAP::CMapMAP(const QString& filename, CMapDraw* parent)
-    : IMap(eFeatVisibility | eFeatVectorItems, parent)
+    : IMap(eFeatVisibility | eFeatVectorItems | eFeatTypFile, parent)
     , filename(filename)
+    , mapFile(filename)
+    , tileCache(MAX_TILE_CACHE)
 {
     qDebug() << "------------------------------";
     qDebug() << "MAP: try to open" << filename;
 
     try
     {
-        readBasics();
+        mapFile.open();
     }
-    catch(const exce_t& e)
+    catch(const CMapsforgeFile::exce_t& e)
     {
         QMessageBox::critical(CMainWindow::getBestWidgetForParent(), tr("Failed ..."), e.msg, QMessageBox::Abort);
         return;
     }
 
+    boundingBox = mapFile.getBoundingBox();
+    setupTheme();
 
     isActivated = true;
 }
@@ -55,98 +63,463 @@ CMapMAP::~CMapMAP()
 {
 }
 
-void CMapMAP::readBasics()
+void CMapMAP::loadConfig(QSettings& cfg)
+{
+    IMap::loadConfig(cfg);
+
+    if(!typeFile.isEmpty())
+    {
+        setupTheme();
+    }
+}
+
+void CMapMAP::slotSetTypeFile(const QString& filename)
+{
+    IMap::slotSetTypeFile(filename);
+    setupTheme();
+    CCanvas::triggerCompleteUpdate(CCanvas::eRedrawMap);
+}
+
+void CMapMAP::setupTheme()
+{
+    QMutexLocker lock(&mutex);
+
+    if(!typeFile.isEmpty())
+    {
+        if(theme.load(typeFile))
+        {
+            return;
+        }
+
+        QMessageBox::warning(CMainWindow::self().getBestWidgetForParent(), tr("Read external render theme..."), tr("Failed to read render theme: %1\nFall back to internal theme.").arg(typeFile), QMessageBox::Ok);
+        typeFile.clear();
+    }
+
+    theme.load(DEFAULT_THEME);
+}
+
+void CMapMAP::draw(IDrawContext::buffer_t& buf) /* override */
 {
-    CFileExt file(filename);
-    if(!file.open(QIODevice::ReadOnly))
+    QMutexLocker lock(&mutex);
+
+    if(map->needsRedraw())
     {
-        throw exce_t(eErrOpen, tr("Failed to open: ") + filename);
+        return;
     }
 
-    QDataStream stream(&file);
-    stream.setByteOrder(QDataStream::BigEndian);
+    QPointF bufferScale = buf.scale * buf.zoomFactor;
 
-    // ---------- start file header ----------------------
-    stream.readRawData(header.signature, sizeof(header.signature));
-    if(strncmp(header.signature, "mapsforge binary OSM", sizeof(header.signature)) != 0)
+    if(isOutOfScale(bufferScale))
     {
-        throw exce_t(errFormat, tr("Bad file format: ") + filename);
+        return;
     }
 
-    stream >> header.sizeHeader;
-    stream >> header.version;
-    stream >> header.sizeFile;
-    stream >> header.timestamp;
-    stream >> header.minLat;
-    stream >> header.minLon;
-    stream >> header.maxLat;
-    stream >> header.maxLon;
+#ifdef DEBUG_SHOW_TIMING
+    QElapsedTimer timer;
+    timer.start();
+#endif
 
-    qDebug() << INT_TO_DEG(header.minLat) << INT_TO_DEG(header.minLon) << INT_TO_DEG(header.maxLat) << INT_TO_DEG(header.maxLon);
-    ref1 = QPointF(INT_TO_RAD(header.minLon), INT_TO_RAD(header.maxLat));
-    ref2 = QPointF(INT_TO_RAD(header.maxLon), INT_TO_RAD(header.minLat));
+    // the same relation of scale and zoom level as for TMS maps
+    const quint8 zoom = qBound(0, 21 - qRound(qLn(bufferScale.x() / 0.055) / M_LN2), 21);
+    const CMapsforgeFile::layer_t& layer = mapFile.getLayers()[mapFile.findLayer(zoom)];
 
-    stream >> header.sizeTile;
-    stream >> header.projection;
-    stream >> header.flags;
+    // calculate maximum viewport
+    qreal u1 = qMin(buf.ref1.x(), buf.ref4.x());
+    qreal u2 = qMax(buf.ref2.x(), buf.ref3.x());
+    qreal v1 = qMax(buf.ref1.y(), buf.ref2.y());
+    qreal v2 = qMin(buf.ref4.y(), buf.ref3.y());
 
-    if(header.flags & eHeaderFlagStartPosition)
+    quint32 x1, y1, x2, y2;
+    if(!mapFile.findTiles(layer, QRectF(QPointF(u1, v1), QPointF(u2, v2)), x1, y1, x2, y2) || quint64(x2 - x1 + 1) * (y2 - y1 + 1) > MAX_TILES)
     {
-        stream >> header.latStart >> header.lonStart;
+        return;
     }
 
-    if(header.flags & eHeaderFlagStartZoomLevel)
+    struct job_t
+    {
+        quint32 x;
+        quint32 y;
+        quint64 key;
+        QSharedPointer<tile_t> tile;
+    };
+
+    // get decoded tiles from the cache and collect all others
+    const quint8 row = qBound(layer.minZoom, zoom, layer.maxZoom);
+    QVector<job_t> jobs;
+    QVector<job_t*> pendingJobs;
+    for(quint32 y = y1; y <= y2; y++)
+    {
+        for(quint32 x = x1; x <= x2; x++)
+        {
+            job_t job;
+            job.x = x;
+            job.y = y;
+            job.key = (quint64(layer.baseZoom) << 56) | (quint64(row) << 48) | (quint64(y) << 24) | x;
+
+            QSharedPointer<tile_t>* tile = tileCache.object(job.key);
+            if(tile != nullptr)
+            {
+                job.tile = *tile;
+            }
+            jobs << job;
+        }
+    }
+
+    for(job_t& job : jobs)
+    {
+        if(job.tile.isNull())
+        {
+            pendingJobs << &job;
+        }
+    }
+
+    // decode all missing tiles in parallel
+    QtConcurrent::blockingMap(pendingJobs, [this, &layer, zoom](job_t* job)
+    {
+        job->tile = mapFile.decodeTile(layer, job->x, job->y, zoom);
+    });
+
+    QVector<QSharedPointer<tile_t> > tiles;
+    for(const job_t* job : qAsConst(pendingJobs))
+    {
+        tileCache.insert(job->key, new QSharedPointer<tile_t>(job->tile), job->tile->cost);
+    }
+    for(const job_t& job : qAsConst(jobs))
+    {
+        tiles << job.tile;
+    }
+
+#ifdef DEBUG_SHOW_TIMING
+    qDebug() << "MAP: decoded" << pendingJobs.count() << "of" << jobs.count() << "tiles in" << timer.elapsed() << "ms";
+#endif
+
+    if(map->needsRedraw())
+    {
+        return;
+    }
+
+    QPainter p(&buf.image);
+    p.setOpacity(getOpacity() / 100.0);
+    USE_ANTI_ALIASING(p, true);
+
+    /**
+       convertRad2Px() converts positions into screen coordinates. However the painter
+       devices paints into the buffer which is a little bit larger than the screen.
+       Thus we need the offset of the buffer's top left corner to the top left corner
+       of the screen to adjust all drawings.
+     */
+    QPointF pp = buf.ref1;
+    map->convertRad2Px(pp);
+    p.translate(-pp);
+
+    drawTiles(p, tiles, zoom);
+
+#ifdef DEBUG_SHOW_TIMING
+    qDebug() << "MAP: rendered zoom level" << zoom << "in" << timer.elapsed() << "ms";
+#endif
+}
+
+void CMapMAP::drawTiles(QPainter& p, const QVector<QSharedPointer<tile_t> >& tiles, quint8 zoom)
+{
+    typedef CMapsforgeTheme::instr_t instr_t;
+    const QVector<instr_t>& instructions = theme.getInstructions();
+    const qreal scale = CMapsforgeTheme::strokeScale(zoom);
+
+    struct wayref_t
+    {
+        const way_t* way;
+        const QVector<qint32>* instr;
+        QVector<QPolygonF> pixel;
+    };
+
+    struct item_t
     {
-        stream >> header.zoomStart;
+        quint8 layer;
+        qint32 level;
+        qint32 idxWay;
+        const instr_t* instr;
+    };
+
+    // match all objects and sort the line and area instructions by layer and drawing order
+    QVector<wayref_t> ways;
+    QVector<item_t> items;
+    for(const QSharedPointer<tile_t>& tile : tiles)
+    {
+        for(const way_t& way : qAsConst(tile->ways))
+        {
+            const QVector<qint32>& matches = theme.match(way.tags, mapFile.getTagTableWays(), true, way.isClosed, zoom);
+            if(matches.isEmpty())
+            {
+                continue;
+            }
+
+            wayref_t ref {&way, &matches, way.polygons};
+            for(QPolygonF& polygon : ref.pixel)
+            {
+                map->convertRad2Px(polygon);
+            }
+
+            for(qint32 idx : matches)
+            {
+                const instr_t& instr = instructions[idx];
+                if(instr.type == instr_t::eArea || instr.type == instr_t::eLine)
+                {
+                    items << item_t {way.layer, instr.level, ways.count(), &instr};
+                }
+            }
+            ways << ref;
+        }
     }
 
-    if(header.flags & eHeaderFlagLanguage)
+    std::stable_sort(items.begin(), items.end(), [](const item_t& i1, const item_t& i2) -> bool
+    {
+        return i1.layer < i2.layer || (i1.layer == i2.layer && i1.level < i2.level);
+    });
+
+    if(map->needsRedraw())
     {
-        stream >> header.language;
+        return;
     }
 
-    if(header.flags & eHeaderFlagComment)
+    if(showPolygons || showPolylines)
     {
-        stream >> header.comment;
+        for(const item_t& item : qAsConst(items))
+        {
+            const instr_t& instr = *item.instr;
+            const QVector<QPolygonF>& pixel = ways[item.idxWay].pixel;
+
+            QPen pen = instr.pen;
+            if(pen.style() != Qt::NoPen)
+            {
+                const qreal width = instr.strokeWidth * scale;
+                pen.setWidthF(width);
+                if(!instr.dashes.isEmpty() && width > 0)
+                {
+                    // Qt's dash pattern is in units of the pen width
+                    QVector<qreal> dashes;
+                    for(qreal dash : instr.dashes)
+                    {
+                        dashes << dash * scale / width;
+                    }
+                    pen.setDashPattern(dashes);
+                }
+            }
+
+            if(instr.type == instr_t::eArea && showPolygons)
+            {
+                QPainterPath path;
+                path.setFillRule(Qt::OddEvenFill);
+                for(const QPolygonF& polygon : pixel)
+                {
+                    path.addPolygon(polygon);
+                }
+
+                p.setPen(pen);
+                p.setBrush(instr.brush);
+                p.drawPath(path);
+            }
+            else if(instr.type == instr_t::eLine && showPolylines)
+            {
+                p.setPen(pen);
+                p.setBrush(Qt::NoBrush);
+                for(const QPolygonF& polygon : pixel)
+                {
+                    p.drawPolyline(polygon);
+                }
+            }
+        }
     }
 
-    if(header.flags & eHeaderFlagCreator)
+    if(map->needsRedraw())
     {
-        stream >> header.creator;
+        return;
     }
 
-    quint16 size;
-    utf8 tag;
-    stream >> size;
-    for(int i = 0; i < size; i++)
+    // the same collision handling as for Garmin maps: symbols first, labels
+    // must not overlap with other labels
+    QList<QRectF> rectSymbols;
+    QList<QRectF> rectLabels;
+    struct label_t
+    {
+        QString str;
+        QPointF pos;
+        const instr_t* instr;
+    };
+    QVector<label_t> labels;
+
+    auto addSymbol = [&](const instr_t& instr, const QPointF& pos)
+    {
+        QRectF rect;
+        if(instr.type == instr_t::eSymbol)
+        {
+            rect = QRectF(QPointF(), instr.symbol.size());
+        }
+        else
+        {
+            rect = QRectF(0, 0, 2 * instr.radius, 2 * instr.radius);
+        }
+        rect.moveCenter(pos);
+
+        if(CDraw::doesOverlap(rectSymbols, rect))
+        {
+            return;
+        }
+        rectSymbols << rect;
+
+        if(instr.type == instr_t::eSymbol)
+        {
+            p.drawImage(rect.topLeft(), instr.symbol);
+        }
+        else
+        {
+            p.setPen(instr.pen);
+            p.setBrush(instr.brush);
+            p.drawEllipse(rect);
+        }
+    };
+
+    if(showPOIs)
     {
-        stream >> tag;
-        header.tagsPOIs << tag;
+        for(const QSharedPointer<tile_t>& tile : tiles)
+        {
+            for(const node_t& node : qAsConst(tile->nodes))
+            {
+                const QVector<qint32>& matches = theme.match(node.tags, mapFile.getTagTablePOIs(), false, false, zoom);
+                if(matches.isEmpty())
+                {
+                    continue;
+                }
+
+                QPointF pos = node.pos;
+                map->convertRad2Px(pos);
+
+                for(qint32 idx : matches)
+                {
+                    const instr_t& instr = instructions[idx];
+                    if(instr.type == instr_t::eSymbol || instr.type == instr_t::eCircle)
+                    {
+                        addSymbol(instr, pos);
+                    }
+                    else if(instr.type == instr_t::eCaption)
+                    {
+                        const QString& str = getLabel(instr.key, node.name, node.houseNumber, QString(), node.ele, node.tags, mapFile.getTagTablePOIs());
+                        if(!str.isEmpty())
+                        {
+                            labels << label_t {str, pos, &instr};
+                        }
+                    }
+                }
+            }
+        }
     }
-    stream >> size;
-    for(int i = 0; i < size; i++)
+
+    // symbols and captions of ways are placed at the label position or the center of the area
+    for(const wayref_t& ref : qAsConst(ways))
     {
-        stream >> tag;
-        header.tagsWays << tag;
+        const way_t& way = *ref.way;
+        for(qint32 idx : *ref.instr)
+        {
+            const instr_t& instr = instructions[idx];
+            if(instr.type == instr_t::ePathText)
+            {
+                if(ref.pixel.first().count() < 2)
+                {
+                    continue;
+                }
+
+                const QString& str = getLabel(instr.key, way.name, way.houseNumber, way.ref, NOINT, way.tags, mapFile.getTagTableWays());
+                if(!str.isEmpty() && !map->needsRedraw())
+                {
+                    CDraw::textPath(str, p, ref.pixel.first(), instr.font, qRound(instr.strokeWidth * scale), instr.fill);
+                }
+                continue;
+            }
+
+            if(instr.type != instr_t::eSymbol && instr.type != instr_t::eCircle && instr.type != instr_t::eCaption)
+            {
+                continue;
+            }
+
+            QPointF pos = way.labelPos;
+            if(pos == NOPOINTF)
+            {
+                pos = ref.pixel.first().boundingRect().center();
+            }
+            else
+            {
+                map->convertRad2Px(pos);
+            }
+
+            if(instr.type == instr_t::eCaption)
+            {
+                const QString& str = getLabel(instr.key, way.name, way.houseNumber, way.ref, NOINT, way.tags, mapFile.getTagTableWays());
+                if(!str.isEmpty())
+                {
+                    labels << label_t {str, pos, &instr};
+                }
+            }
+            else
+            {
+                addSymbol(instr, pos);
+            }
+        }
     }
 
+    if(map->needsRedraw() || !CMainWindow::self().isPoiText())
+    {
+        return;
+    }
 
-    quint8 N;
-    stream >> N;
-    for(int i = 0; i < N; i++)
+    for(const label_t& label : qAsConst(labels))
     {
-        layer_t layer;
-        stream >> layer.baseZoom;
-        stream >> layer.minZoom;
-        stream >> layer.maxZoom;
-        stream >> layer.offsetSubFile;
-        stream >> layer.sizeSubFile;
+        const QFontMetricsF fm(label.instr->font);
+        QRectF rect = fm.boundingRect(label.str);
+        rect.adjust(-2, -2, 2, 2);
+        rect.moveCenter(label.pos + QPointF(0, label.instr->dy));
 
-        layers << layer;
+        if(CDraw::doesOverlap(rectLabels, rect))
+        {
+            continue;
+        }
+        rectLabels << rect;
+
+        CDraw::text(label.str, p, rect.center(), label.instr->fill, label.instr->font);
     }
-    // ---------- end file header ----------------------
 }
 
-void CMapMAP::draw(IDrawContext::buffer_t& buf) /* override */
+QString CMapMAP::getLabel(const QString& key, const QString& name, const QString& houseNumber, const QString& ref, qint32 ele, const QVector<quint16>& tags, const QVector<CMapsforgeTheme::tag_t>& table)
 {
+    if(key == "name")
+    {
+        return name;
+    }
+    if(key == "addr:housenumber")
+    {
+        return houseNumber;
+    }
+    if(key == "ref")
+    {
+        return ref;
+    }
+    if(key == "ele")
+    {
+        if(ele == NOINT)
+        {
+            return QString();
+        }
+
+        QString val, unit;
+        IUnit::self().meter2elevation(ele, val, unit);
+        return val + unit;
+    }
+
+    // any other key is looked up in the object's tags
+    for(quint16 id : tags)
+    {
+        if(table[id].key == key)
+        {
+            return table[id].value;
+        }
+    }
+    return QString();
 }
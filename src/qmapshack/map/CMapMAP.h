@@ -20,92 +20,57 @@
 #define CMAPMAP_H
 
 #include "map/IMap.h"
-#include "map/mapsforge/types.h"
+#include "map/mapsforge/CMapsforgeFile.h"
+#include "map/mapsforge/CMapsforgeTheme.h"
 
-#include <QList>
+#include <QCache>
+#include <QMutex>
+#include <QSharedPointer>
 
 class CMapDraw;
 
+/**
+   @brief Reader and renderer for Mapsforge vector maps (*.map)
+
+   The map file is read by CMapsforgeFile. The tiles covering the viewport
+   are decoded in parallel into vector data and kept in a LRU cache. The
+   vector data is drawn with a subset of the Mapsforge render theme, see
+   CMapsforgeTheme. The built-in theme can be replaced by the map's type file.
+ */
 class CMapMAP : public IMap
 {
-    Q_DECLARE_TR_FUNCTIONS(CMapMAP)
+    Q_OBJECT
 public:
     CMapMAP(const QString& filename, CMapDraw* parent);
     virtual ~CMapMAP();
 
+    void loadConfig(QSettings& cfg) override;
+
     void draw(IDrawContext::buffer_t& buf) override;
 
+public slots:
+    void slotSetTypeFile(const QString& filename) override;
+
 private:
-    enum exce_e {eErrOpen, eErrAccess, errFormat, errAbort};
-    struct exce_t
-    {
-        exce_t(exce_e err, const QString& msg) : err(err), msg(msg)
-        {
-        }
-        exce_e err;
-        QString msg;
-    };
-
-    struct layer_t
-    {
-        quint8 baseZoom;
-        quint8 minZoom;
-        quint8 maxZoom;
-        quint64 offsetSubFile;
-        quint64 sizeSubFile;
-    };
-
-    enum header_flags_e
-    {
-        eHeaderFlagDebugInfo = 0x80
-        , eHeaderFlagStartPosition = 0x40
-        , eHeaderFlagStartZoomLevel = 0x20
-        , eHeaderFlagLanguage = 0x10
-        , eHeaderFlagComment = 0x08
-        , eHeaderFlagCreator = 0x04
-    };
-
-    struct header_t
-    {
-        header_t() : latStart(0), lonStart(0), zoomStart(0)
-        {
-        }
-        char signature[20];
-        quint32 sizeHeader = 0;
-        quint32 version = 0;
-        quint64 sizeFile = 0;
-        quint64 timestamp = 0;
-        qint32 minLat = 0;
-        qint32 minLon = 0;
-        qint32 maxLat = 0;
-        qint32 maxLon = 0;
-        quint16 sizeTile = 0;
-        utf8 projection;
-        quint8 flags = 0;
-        // optional fields
-        qint32 latStart;
-        qint32 lonStart;
-        quint8 zoomStart;
-        utf8 language;
-        utf8 comment;
-        utf8 creator;
-
-        QStringList tagsPOIs;
-        QStringList tagsWays;
-    };
-
-    QList<layer_t> layers;
-
-    void readBasics();
+    typedef CMapsforgeFile::node_t node_t;
+    typedef CMapsforgeFile::way_t way_t;
+    typedef CMapsforgeFile::tile_t tile_t;
+
+    void setupTheme();
+    void drawTiles(QPainter& p, const QVector<QSharedPointer<tile_t> >& tiles, quint8 zoom);
+    static QString getLabel(const QString& key, const QString& name, const QString& houseNumber, const QString& ref, qint32 ele, const QVector<quint16>& tags, const QVector<CMapsforgeTheme::tag_t>& table);
 
     QString filename;
 
-    header_t header;
+    /// the map file, its tile index and the tile decoder
+    CMapsforgeFile mapFile;
+
+    /// serialize the access of the draw thread and the GUI thread to the theme
+    QMutex mutex;
+    CMapsforgeTheme theme;
 
-    /// top left point of the map
-    QPointF ref1;
-    /// bottom right point of the map
-    QPointF ref2;
+    /// the most recently used decoded tiles
+    QCache<quint64, QSharedPointer<tile_t> > tileCache;
 };
 
 #endif //CMAPMAP_H
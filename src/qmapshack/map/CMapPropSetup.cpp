@@ -50,6 +50,9 @@ CMapPropSetup::CMapPropSetup(IMap* mapfile, CMapDraw* map)
 
     connect(spinCacheSize, static_cast<void (QSpinBox::*)(int) >(&QSpinBox::valueChanged), mapfile, &IMap::slotSetCacheSize);
     connect(spinCacheExpiration, static_cast<void (QSpinBox::*)(int) >(&QSpinBox::valueChanged), mapfile, &IMap::slotSetCacheExpiration);
+    connect(spinPrefetchRing, static_cast<void (QSpinBox::*)(int) >(&QSpinBox::valueChanged), mapfile, &IMap::slotSetPrefetchRing);
+    connect(checkPrefetchLevels, &QCheckBox::toggled, mapfile, &IMap::slotSetPrefetchLevels);
+    connect(spinMaxRequests, static_cast<void (QSpinBox::*)(int) >(&QSpinBox::valueChanged), mapfile, &IMap::slotSetMaxRequestsPerHost);
 
     connect(toolOpenTypFile, &QToolButton::pressed, this, &CMapPropSetup::slotLoadTypeFile);
     connect(toolClearTypFile, &QToolButton::pressed, this, &CMapPropSetup::slotClearTypeFile);
@@ -101,6 +104,9 @@ void CMapPropSetup::slotPropertiesChanged() /* override */
     labelCachePath->setToolTip(lbl);
     spinCacheSize->setValue(mapfile->getCacheSize());
     spinCacheExpiration->setValue(mapfile->getCacheExpiration());
+    spinPrefetchRing->setValue(mapfile->getPrefetchRing());
+    checkPrefetchLevels->setChecked(mapfile->getPrefetchLevels());
+    spinMaxRequests->setValue(mapfile->getMaxRequestsPerHost());
 
     // type file
     QFileInfo fi(mapfile->getTypeFile());
@@ -137,7 +143,7 @@ void CMapPropSetup::slotLoadTypeFile()
 {
     SETTINGS;
     QString path = cfg.value("Paths/lastTypePath", QDir::homePath()).toString();
-    QString filename = QFileDialog::getOpenFileName(this, tr("Select type file..."), path, "Garmin type file (*.typ)");
+    QString filename = QFileDialog::getOpenFileName(this, tr("Select type file..."), path, "Garmin type file (*.typ);;Mapsforge render theme (*.xml)");
     if(filename.isEmpty())
     {
         return;
@@ -20,20 +20,26 @@
 #include "helpers/CDraw.h"
 #include "map/CMapDraw.h"
 #include "map/CMapRMAP.h"
+#include "map/cache/CTileCache.h"
 #include "units/IUnit.h"
 
+#include <QtConcurrent>
 #include <QtGui>
 #include <QtWidgets>
 
+/// the number of tile corners to cache, about 100 bytes each
+#define MAX_CORNERS 20000
+
 CMapRMAP::CMapRMAP(const QString& filename, CMapDraw* parent)
     : IMap(eFeatVisibility, parent)
     , filename(filename)
+    , file(filename)
+    , corners(MAX_CORNERS)
 {
     qDebug() << "------------------------------";
     qDebug() << "RMAP: try to open" << filename;
 
 
-    QFile file(filename);
     file.open(QIODevice::ReadOnly);
 //    qDebug() << file.errorString();
 
@@ -298,6 +304,12 @@ CMapRMAP::CMapRMAP(const QString& filename, CMapDraw* parent)
         //qDebug() << i << level.xscale << level.yscale;
     }
 
+    data = file.map(0, file.size());
+    if(data == nullptr)
+    {
+        qDebug() << "RMAP: Failed to map" << filename << "fall back to read";
+    }
+
     isActivated = true;
 
 //    qDebug() << "xref1:" << xref1 << "yref1:" << yref1;
@@ -307,6 +319,14 @@ CMapRMAP::CMapRMAP(const QString& filename, CMapDraw* parent)
 //    qDebug() << "scale x:  " << scale.x() << "y:" << scale.y();
 }
 
+CMapRMAP::~CMapRMAP()
+{
+    if(data != nullptr)
+    {
+        file.unmap(const_cast<uchar*>(data));
+    }
+}
+
 bool CMapRMAP::setProjection(const QString& projection, const QString& datum)
 {
     QString projstr;
@@ -436,58 +456,129 @@ void CMapRMAP::draw(IDrawContext::buffer_t& buf) /* override */
     p.setOpacity(getOpacity() / 100.0);
     p.translate(-pp);
 
-    QFile file(filename);
-    file.open(QIODevice::ReadOnly);
-
-    QDataStream stream(&file);
-    stream.setByteOrder(QDataStream::LittleEndian);
-
+    struct job_t
+    {
+        qint32 idxx;
+        qint32 idxy;
+        quint64 offset;
+        QString key;
+        QByteArray data;
+        QImage img;
+    };
+
+    QVector<job_t> jobs;
     for(int idxy = idxy1; idxy < idxy2; idxy++)
     {
-        if(map->needsRedraw())
-        {
-            break;
-        }
-
         for(int idxx = idxx1; idxx < idxx2; idxx++)
         {
-            if(map->needsRedraw())
+            job_t job;
+            job.idxx = idxx;
+            job.idxy = idxy;
+            // the offset identifies the tile within the file
+            job.offset = level.getOffsetJpeg(idxx, idxy);
+            job.key = CTileCache::key(filename, 0, job.offset);
+            if(job.offset != 0)
             {
-                break;
+                jobs << job;
             }
+        }
+    }
 
-            quint32 tag;
-            quint32 len;
-            quint64 offset = level.getOffsetJpeg(idxx, idxy);
-            file.seek(offset);
-            stream >> tag >> len;
+    // Get decoded tiles from the cache and collect the data of all others.
+    QVector<job_t*> pendingJobs;
+    for(job_t& job : jobs)
+    {
+        if(CTileCache::self().find(job.key, job.img))
+        {
+            continue;
+        }
 
-            QImage img;
-            img.load(&file, "JPG");
+        job.data = getTileData(job.offset);
+        if(!job.data.isEmpty())
+        {
+            pendingJobs << &job;
+        }
+    }
 
-            if(img.isNull())
-            {
-                continue;
-            }
+    if(map->needsRedraw())
+    {
+        return;
+    }
+
+    // decode all missing tiles in parallel
+    QtConcurrent::blockingMap(pendingJobs, [](job_t* job)
+    {
+        job->img.loadFromData(job->data, "JPG");
+        job->data.clear();
+        CTileCache::self().insert(job->key, job->img);
+    });
+
+    for(const job_t& job : qAsConst(jobs))
+    {
+        if(map->needsRedraw())
+        {
+            break;
+        }
+
+        if(job.img.isNull())
+        {
+            continue;
+        }
 
-            qreal imgw = img.width();
-            qreal imgh = img.height();
+        QPolygonF* c = corners.object(job.offset);
+        if(c == nullptr)
+        {
+            qreal imgw = job.img.width();
+            qreal imgh = job.img.height();
 
             // derive tile's corner coordinate
             QPolygonF l(4);
-            l[0].rx() = xref1 + idxx * tileSizeX * level.xscale;
-            l[0].ry() = yref1 + idxy * tileSizeY * level.yscale;
-            l[1].rx() = xref1 + (idxx * tileSizeX + imgw) * level.xscale;
-            l[1].ry() = yref1 + idxy * tileSizeY * level.yscale;
-            l[2].rx() = xref1 + (idxx * tileSizeX + imgw) * level.xscale;
-            l[2].ry() = yref1 + (idxy * tileSizeY + imgh) * level.yscale;
-            l[3].rx() = xref1 + idxx * tileSizeX * level.xscale;
-            l[3].ry() = yref1 + (idxy * tileSizeY + imgh) * level.yscale;
+            l[0].rx() = xref1 + job.idxx * tileSizeX * level.xscale;
+            l[0].ry() = yref1 + job.idxy * tileSizeY * level.yscale;
+            l[1].rx() = xref1 + (job.idxx * tileSizeX + imgw) * level.xscale;
+            l[1].ry() = yref1 + job.idxy * tileSizeY * level.yscale;
+            l[2].rx() = xref1 + (job.idxx * tileSizeX + imgw) * level.xscale;
+            l[2].ry() = yref1 + (job.idxy * tileSizeY + imgh) * level.yscale;
+            l[3].rx() = xref1 + job.idxx * tileSizeX * level.xscale;
+            l[3].ry() = yref1 + (job.idxy * tileSizeY + imgh) * level.yscale;
 
             proj.transform(l, PJ_FWD);
-
-            drawTile(img, l, p);
+            c = new QPolygonF(l);
+            corners.insert(job.offset, c);
         }
+
+        // drawTile() converts the corners to px in place
+        QPolygonF l = *c;
+        drawTile(job.img, l, p);
     }
 }
 
+QByteArray CMapRMAP::getTileData(quint64 offset)
+{
+    const quint64 size = file.size();
+
+    // each tile starts with a tag and the length of the JPEG data
+    if(offset == 0 || offset + 8 > size)
+    {
+        return QByteArray();
+    }
+
+    if(data != nullptr)
+    {
+        const quint32 len = qFromLittleEndian<quint32>(data + offset + 4);
+        if(offset + 8 + len > size)
+        {
+            return QByteArray();
+        }
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(data + offset + 8), len);
+    }
+
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 tag;
+    quint32 len;
+    file.seek(offset);
+    stream >> tag >> len;
+    return file.read(len);
+}
@@ -21,13 +21,28 @@
 
 #include "IMap.h"
 
+#include <QCache>
+#include <QFile>
+
 class CMapDraw;
 
+/**
+   @brief TwoNav RMAP raster map
+
+   The file is memory mapped for the lifetime of the map. If it can't be
+   mapped (e.g. on 32 bit systems) the tiles are read by seek and read
+   instead.
+
+   Decoded tiles are stored in CTileCache. Missing tiles of the viewport
+   are decoded in parallel. The tile's corners projected to WGS84 do not
+   depend on the view. They are cached, too.
+ */
 class CMapRMAP : public IMap
 {
     Q_OBJECT
 public:
     CMapRMAP(const QString& filename, CMapDraw* parent);
+    virtual ~CMapRMAP();
 
     void draw(IDrawContext::buffer_t& buf) override;
 
@@ -56,8 +71,20 @@ private:
 
     bool setProjection(const QString& projection, const QString& datum);
     level_t& findBestLevel(const QPointF& s);
+    /**
+       @brief Get the JPEG data of a tile
+
+       @param offset    the tile's offset in the file as stored in level_t::offsetJpegs
+       @return The data. It references the mapped file if possible. An empty array if the tile does not exist.
+     */
+    QByteArray getTileData(quint64 offset);
 
     QString filename;
+    QFile file;
+    /// the mapped file, nullptr if it can't be mapped
+    const uchar* data = nullptr;
+    /// the corners of the tiles in [rad], the key is the tile's offset
+    QCache<quint64, QPolygonF> corners;
 
     /// total width in number of px
     qint32 xsize_px = 0;
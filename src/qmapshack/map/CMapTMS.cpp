@@ -365,28 +365,12 @@ void CMapTMS::draw(IDrawContext::buffer_t& buf) /* override */
             continue;
         }
 
-        qint32 z = 20;
-        QPointF s1 = buf.scale * buf.zoomFactor;
-        qreal d = NOFLOAT;
-
-        for(qint32 i = layer.minZoomLevel; i < 21; i++)
-        {
-            qreal s2 = 0.055 * (1 << i);
-            if(qAbs(s2 - s1.x()) < d)
-            {
-                z = i;
-                d = qAbs(s2 - s1.x());
-            }
-        }
-
-        if(z > layer.maxZoomLevel)
+        const qint32 z = zoomLevel(layer, bufferScale);
+        if(z < 0)
         {
             continue;
         }
 
-        z = 21 - z;
-
-
         qint32 row1, row2, col1, col2;
 
         col1 = lon2tile(x1 * RAD_TO_DEG, z) / 256;
@@ -428,4 +412,87 @@ void CMapTMS::draw(IDrawContext::buffer_t& buf) /* override */
 
         emit sigQueueChanged();
     }
+
+    lastScale = bufferScale;
+    queuePrefetch(QRectF(QPointF(x1, y1), QPointF(x2, y2)));
+    emit sigQueueChanged();
+}
+
+qint32 CMapTMS::zoomLevel(const layer_t& layer, const QPointF& scale)
+{
+    qint32 z = 20;
+    qreal d = NOFLOAT;
+
+    for(qint32 i = layer.minZoomLevel; i < 21; i++)
+    {
+        qreal s2 = 0.055 * (1 << i);
+        if(qAbs(s2 - scale.x()) < d)
+        {
+            z = i;
+            d = qAbs(s2 - scale.x());
+        }
+    }
+
+    if(z > layer.maxZoomLevel)
+    {
+        return -1;
+    }
+
+    return 21 - z;
+}
+
+void CMapTMS::getTileUrls(const QRectF& area, qint32 levelOffset, qint32 ring, qint32 maxUrls, QStringList& urls) /* override */
+{
+    QMutexLocker lock(&mutex);
+
+    if(lastScale.x() == NOFLOAT)
+    {
+        return;
+    }
+
+    const qreal x1 = qMax(area.left(), -180.0 * DEG_TO_RAD);
+    const qreal x2 = qMin(area.right(), 180.0 * DEG_TO_RAD);
+    const qreal y1 = area.top();
+    const qreal y2 = area.bottom();
+
+    for(const layer_t& layer : qAsConst(layers))
+    {
+        if(!layer.enabled)
+        {
+            continue;
+        }
+
+        const qint32 z0 = zoomLevel(layer, lastScale);
+        if(z0 < 0)
+        {
+            continue;
+        }
+
+        // the valid range of zoom levels is [21 - maxZoomLevel, 21 - minZoomLevel]
+        const qint32 z = z0 + levelOffset;
+        if((z < qMax(1, 21 - layer.maxZoomLevel)) || (z > 21 - layer.minZoomLevel))
+        {
+            continue;
+        }
+
+        const qint32 maxTile = (1 << z) - 1;
+        const qint32 col1 = qMax(0, qint32(lon2tile(x1 * RAD_TO_DEG, z) / 256) - ring);
+        const qint32 col2 = qMin(maxTile, qint32(lon2tile(x2 * RAD_TO_DEG, z) / 256) + ring);
+        const qint32 row1 = qMax(0, qint32(lat2tile(y1 * RAD_TO_DEG, z) / 256) - ring);
+        const qint32 row2 = qMin(maxTile, qint32(lat2tile(y2 * RAD_TO_DEG, z) / 256) + ring);
+
+        // do not add a layer partially
+        if((qint64(row2 - row1 + 1) * (col2 - col1 + 1)) > (maxUrls - urls.size()))
+        {
+            continue;
+        }
+
+        for(qint32 row = row1; row <= row2; row++)
+        {
+            for(qint32 col = col1; col <= col2; col++)
+            {
+                urls << createUrl(layer, col, row, z);
+            }
+        }
+    }
 }
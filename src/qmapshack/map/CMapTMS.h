@@ -20,6 +20,7 @@
 #define CMAPTMS_H
 
 #include "map/IMapOnline.h"
+#include "units/IUnit.h"
 
 class CDiskCache;
 class QListWidgetItem;
@@ -40,12 +41,23 @@ public:
     void saveConfig(QSettings& cfg) override;
     void loadConfig(QSettings& cfg) override;
 
+protected:
+    void getTileUrls(const QRectF& area, qint32 levelOffset, qint32 ring, qint32 maxUrls, QStringList& urls) override;
+
 private slots:
     void slotLayersChanged(QListWidgetItem* item);
 
 private:
     struct layer_t;
     QString createUrl(const layer_t& layer, int x, int y, int z);
+    /**
+       @brief Get the TMS zoom level of a layer best matching a map scale
+
+       @param layer     the layer
+       @param scale     the map scale as used by draw()
+       @return The zoom level or -1 if the layer has no tiles for that scale
+     */
+    static qint32 zoomLevel(const layer_t& layer, const QPointF& scale);
 
     struct layer_t
     {
@@ -64,6 +76,9 @@ private:
 
     qint32 minZoomLevel = 1;
     qint32 maxZoomLevel = 21;
+
+    /// the scale used by the last call of draw()
+    QPointF lastScale {NOFLOAT, NOFLOAT};
 };
 
 #endif //CMAPTMS_H
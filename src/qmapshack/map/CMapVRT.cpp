@@ -20,10 +20,12 @@
 #include "helpers/CDraw.h"
 #include "map/CMapDraw.h"
 #include "map/CMapVRT.h"
+#include "map/cache/CTileCache.h"
 #include "units/IUnit.h"
 
 #include <gdal_priv.h>
 #include <ogr_spatialref.h>
+#include <QtConcurrent>
 #include <QtWidgets>
 
 #define TILELIMIT 2500
@@ -101,6 +103,43 @@ CMapVRT::CMapVRT(const QString& filename, CMapDraw* parent)
             }
         }
     }
+    else
+    {
+        // Try to read all color bands by a single pixel interleaved RasterIO() call.
+        // For that the bands have to map to consecutive bytes of a QImage::Format_ARGB32
+        // pixel. The byte order of that pixel depends on the endianness of the system.
+        const QRgb testPix = qRgba(GCI_RedBand, GCI_GreenBand, GCI_BlueBand, GCI_AlphaBand);
+        QVector<int> bands(sizeof(testPix), 0);
+        for(int b = 1; b <= rasterBandCount; ++b)
+        {
+            const int pbandColour = dataset->GetRasterBand(b)->GetColorInterpretation();
+            for(unsigned int offset = 0; offset < sizeof(testPix); offset++)
+            {
+                if(*(((quint8*)&testPix) + offset) == pbandColour)
+                {
+                    bands[offset] = b;
+                }
+            }
+        }
+
+        int first = 0;
+        int last = bands.size() - 1;
+        while(first <= last && bands[first] == 0)
+        {
+            first++;
+        }
+        while(last >= first && bands[last] == 0)
+        {
+            last--;
+        }
+
+        const QVector<int>& used = bands.mid(first, last - first + 1);
+        if(!used.isEmpty() && !used.contains(0))
+        {
+            bandMap = used;
+            bandMapOffset = first;
+        }
+    }
 
     if(dataset->GetRasterCount() > 0)
     {
@@ -175,6 +214,14 @@ CMapVRT::CMapVRT(const QString& filename, CMapDraw* parent)
     ref3 = trFwd.map(QPointF(xsize_px, ysize_px));
     ref4 = trFwd.map(QPointF(0, ysize_px));
 
+    QPolygonF area;
+    area << ref1 << ref2 << ref3 << ref4;
+    for(QPointF& pt : area)
+    {
+        convertM2Rad(pt);
+    }
+    boundingBox = area.boundingRect();
+
     qDebug() << "FF" << trFwd;
     qDebug() << "RR" << trInv;
 
@@ -184,6 +231,122 @@ CMapVRT::CMapVRT(const QString& filename, CMapDraw* parent)
 CMapVRT::~CMapVRT()
 {
     GDALClose(dataset);
+    for(GDALDataset* ds : qAsConst(freeDatasets))
+    {
+        GDALClose(ds);
+    }
+}
+
+GDALDataset* CMapVRT::acquireDataset()
+{
+    QMutexLocker lock(&mutexDatasets);
+    if(!freeDatasets.isEmpty())
+    {
+        return freeDatasets.takeLast();
+    }
+    lock.unlock();
+
+    // GDAL datasets must not be shared between threads. Each
+    // thread reading in parallel gets it's own instance.
+    return (GDALDataset*)GDALOpen(filename.toUtf8(), GA_ReadOnly);
+}
+
+void CMapVRT::releaseDataset(GDALDataset* ds)
+{
+    QMutexLocker lock(&mutexDatasets);
+    freeDatasets << ds;
+}
+
+void CMapVRT::readTile(tile_t& tile)
+{
+    GDALDataset* ds = acquireDataset();
+    if(ds == nullptr)
+    {
+        return;
+    }
+
+    CPLErr err = CE_Failure;
+    QImage img;
+    if(rasterBandCount == 1)
+    {
+        img = QImage(QSize(tile.imgw, tile.imgh), QImage::Format_Indexed8);
+        img.setColorTable(colortable);
+
+        err = ds->GetRasterBand(1)->RasterIO(GF_Read
+                                             , tile.x, tile.y
+                                             , tile.dx, tile.dy
+                                             , img.bits()
+                                             , tile.imgw, tile.imgh
+                                             , GDT_Byte, 0, img.bytesPerLine());
+    }
+    else if(!bandMap.isEmpty())
+    {
+        img = QImage(tile.imgw, tile.imgh, QImage::Format_ARGB32);
+        img.fill(qRgba(255, 255, 255, 255));
+
+        // read all bands straight into the image
+        QVector<int> bands = bandMap;
+        err = ds->RasterIO(GF_Read
+                           , tile.x, tile.y
+                           , tile.dx, tile.dy
+                           , img.bits() + bandMapOffset
+                           , tile.imgw, tile.imgh
+                           , GDT_Byte
+                           , bands.size(), bands.data()
+                           , sizeof(QRgb), img.bytesPerLine(), 1);
+    }
+    else
+    {
+        img = QImage(tile.imgw, tile.imgh, QImage::Format_ARGB32);
+        img.fill(qRgba(255, 255, 255, 255));
+
+        QVector<quint8> buffer(tile.imgw * tile.imgh);
+
+        QRgb testPix = qRgba(GCI_RedBand, GCI_GreenBand, GCI_BlueBand, GCI_AlphaBand);
+
+        for(int b = 1; b <= rasterBandCount; ++b)
+        {
+            GDALRasterBand* pBand;
+            pBand = ds->GetRasterBand(b);
+
+            err = pBand->RasterIO(GF_Read
+                                  , tile.x, tile.y
+                                  , tile.dx, tile.dy
+                                  , buffer.data()
+                                  , tile.imgw, tile.imgh
+                                  , GDT_Byte, 0, 0);
+
+            if(!err)
+            {
+                int pbandColour = pBand->GetColorInterpretation();
+                unsigned int offset;
+
+                for (offset = 0; offset < sizeof(testPix) && *(((quint8*)&testPix) + offset) != pbandColour; offset++)
+                {
+                }
+                if(offset < sizeof(testPix))
+                {
+                    quint8* pTar = img.bits() + offset;
+                    quint8* pSrc = buffer.data();
+                    const int size = buffer.size();
+
+                    for(int i = 0; i < size; ++i)
+                    {
+                        *pTar = *pSrc;
+                        pTar += sizeof(testPix);
+                        pSrc += 1;
+                    }
+                }
+            }
+        }
+    }
+
+    releaseDataset(ds);
+
+    if(!err)
+    {
+        tile.img = img;
+    }
 }
 
 bool CMapVRT::testForOverviews(const QString& filename)
@@ -397,6 +560,10 @@ void CMapVRT::draw(IDrawContext::buffer_t& buf) /* override */
         nTiles = getMaxScale() == NOFLOAT ? nTiles : 0;
     }
 
+    // align tiles to a grid to get hits in the tile cache
+    left = qFloor(left / dx) * dx;
+    top = qFloor(top / dy) * dy;
+
     // start to draw the map
     QPainter p(&buf.image);
     USE_ANTI_ALIASING(p, true);
@@ -408,23 +575,11 @@ void CMapVRT::draw(IDrawContext::buffer_t& buf) /* override */
     // limit number of tiles to keep performance
     if(!isOutOfScale(bufferScale) && (nTiles < TILELIMIT))
     {
+        QVector<tile_t> tiles;
         for(qint32 y = top; y < bottom; y += dy)
         {
-            if(map->needsRedraw())
-            {
-                break;
-            }
-
             for(qint32 x = left; x < right; x += dx)
             {
-                if(map->needsRedraw())
-                {
-                    break;
-                }
-
-                // read tile from file
-                CPLErr err = CE_Failure;
-
                 // reduce tile size at the border of the file
                 qreal dx_used = dx;
                 qreal dy_used = dy;
@@ -452,82 +607,57 @@ void CMapVRT::draw(IDrawContext::buffer_t& buf) /* override */
                     continue;
                 }
 
-                QImage img;
-                if(rasterBandCount == 1)
-                {
-                    GDALRasterBand* pBand;
-                    pBand = dataset->GetRasterBand(1);
-
-                    img = QImage(QSize(imgw_used, imgh_used), QImage::Format_Indexed8);
-                    img.setColorTable(colortable);
-
-                    err = pBand->RasterIO(GF_Read
-                                          , x, y
-                                          , dx_used, dy_used
-                                          , img.bits()
-                                          , imgw_used, imgh_used
-                                          , GDT_Byte, 0, 0);
-                }
-                else
-                {
-                    img = QImage(imgw_used, imgh_used, QImage::Format_ARGB32);
-                    img.fill(qRgba(255, 255, 255, 255));
-
-                    QVector<quint8> buffer(imgw_used* imgh_used);
+                tile_t tile;
+                tile.x = x;
+                tile.y = y;
+                tile.dx = dx_used;
+                tile.dy = dy_used;
+                tile.imgw = imgw_used;
+                tile.imgh = imgh_used;
+                tile.key = CTileCache::key(filename, dx, (quint64(y) << 32) | quint32(x));
+                tiles << tile;
+            }
+        }
 
-                    QRgb testPix = qRgba(GCI_RedBand, GCI_GreenBand, GCI_BlueBand, GCI_AlphaBand);
+        QVector<tile_t*> missingTiles;
+        for(tile_t& tile : tiles)
+        {
+            if(!CTileCache::self().find(tile.key, tile.img))
+            {
+                missingTiles << &tile;
+            }
+        }
 
-                    for(int b = 1; b <= rasterBandCount; ++b)
-                    {
-                        GDALRasterBand* pBand;
-                        pBand = dataset->GetRasterBand(b);
-
-                        err = pBand->RasterIO(GF_Read
-                                              , x, y
-                                              , dx_used, dy_used
-                                              , buffer.data()
-                                              , imgw_used, imgh_used
-                                              , GDT_Byte, 0, 0);
-
-                        if(!err)
-                        {
-                            int pbandColour = pBand->GetColorInterpretation();
-                            unsigned int offset;
-
-                            for (offset = 0; offset < sizeof(testPix) && *(((quint8*)&testPix) + offset) != pbandColour; offset++)
-                            {
-                            }
-                            if(offset < sizeof(testPix))
-                            {
-                                quint8* pTar = img.bits() + offset;
-                                quint8* pSrc = buffer.data();
-                                const int size = buffer.size();
-
-                                for(int i = 0; i < size; ++i)
-                                {
-                                    *pTar = *pSrc;
-                                    pTar += sizeof(testPix);
-                                    pSrc += 1;
-                                }
-                            }
-                        }
-                    }
-                }
+        // read all missing tiles in parallel
+        QtConcurrent::blockingMap(missingTiles, [this](tile_t* tile)
+        {
+            if(map->needsRedraw())
+            {
+                return;
+            }
+            readTile(*tile);
+            CTileCache::self().insert(tile->key, tile->img);
+        });
 
-                if(err)
-                {
-                    continue;
-                }
+        for(const tile_t& tile : qAsConst(tiles))
+        {
+            if(map->needsRedraw())
+            {
+                break;
+            }
 
+            if(tile.img.isNull())
+            {
+                continue;
+            }
 
-                QPolygonF l;
-                l << QPointF(x, y) << QPointF(x + dx_used, y) << QPointF(x + dx_used, y + dy_used) << QPointF(x, y + dy_used);
-                l = trFwd.map(l);
+            QPolygonF l;
+            l << QPointF(tile.x, tile.y) << QPointF(tile.x + tile.dx, tile.y) << QPointF(tile.x + tile.dx, tile.y + tile.dy) << QPointF(tile.x, tile.y + tile.dy);
+            l = trFwd.map(l);
 
-                proj.transform(l, PJ_FWD);
+            proj.transform(l, PJ_FWD);
 
-                drawTile(img, l, p);
-            }
+            drawTile(tile.img, l, p);
         }
     }
 
@@ -21,6 +21,7 @@
 
 #include "map/IMap.h"
 
+#include <QMutex>
 
 class CMapDraw;
 class GDALDataset;
@@ -35,6 +36,34 @@ public:
     void draw(IDrawContext::buffer_t& buf) override;
 
 private:
+    struct tile_t
+    {
+        /// the area to read in px of the file
+        qint32 x = 0;
+        qint32 y = 0;
+        qint32 dx = 0;
+        qint32 dy = 0;
+        /// the size of the image
+        qint32 imgw = 0;
+        qint32 imgh = 0;
+
+        QString key;
+        QImage img;
+    };
+
+    /**
+       @brief Read a tile from the file
+
+       This is thread safe as each call uses it's own dataset.
+
+       @param tile  the tile definition. The image is stored in tile.img. On errors it is a null image.
+     */
+    void readTile(tile_t& tile);
+    /// get a dataset instance not used by any other thread
+    GDALDataset* acquireDataset();
+    /// return a dataset instance acquired by acquireDataset()
+    void releaseDataset(GDALDataset* ds);
+
     /**
        @brief Test subfiles of VRT for overviews
        @param filename The VRT filename to inspect
@@ -48,6 +77,14 @@ private:
     int rasterBandCount = 0;
     /// QT representation of the vrt's color table
     QVector<QRgb> colortable;
+    /// the band numbers to read pixel interleaved for RGB(A) files, empty if not possible
+    QVector<int> bandMap;
+    /// the byte offset of the first band in bandMap within a ARGB32 pixel
+    qint32 bandMapOffset = 0;
+
+    /// additional datasets for parallel reads, not in use
+    QList<GDALDataset*> freeDatasets;
+    QMutex mutexDatasets;
 
     /// width in number of px
     qint32 xsize_px = 0;
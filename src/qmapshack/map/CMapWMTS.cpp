@@ -426,7 +426,6 @@ void CMapWMTS::draw(IDrawContext::buffer_t& buf) /* override */
         }
 
         const tileset_t& tileset = tilesets[layer.tileMatrixSet];
-        const QMap<QString, limit_t>& limits = layer.limits;
 
         // convert viewport to layer's coordinate system
         QPointF pt1(x1, y1);
@@ -460,88 +459,25 @@ void CMapWMTS::draw(IDrawContext::buffer_t& buf) /* override */
         }
 
 
-        // get min/max col/row values for that level
-        qint32 minRow, maxRow, minCol, maxCol;
-        const tilematrix_t& tilematrix = tileset.tilematrix[tileMatrixId];
-        if(!limits.isEmpty())
-        {
-            if(limits.contains(tileMatrixId))
-            {
-                const limit_t& limit = limits[tileMatrixId];
-                minCol = limit.minTileCol;
-                maxCol = limit.maxTileCol;
-                minRow = limit.minTileRow;
-                maxRow = limit.maxTileRow;
-            }
-            else
-            {
-                // layer has limits but not for the selected tileMatrixId -> skip layer
-                continue;
-            }
-        }
-        else
+        lastTileMatrixIds[layer.title] = tileMatrixId;
+
+        qint32 col1, row1, col2, row2;
+        if(!getTileRange(layer, tileMatrixId, pt1, pt2, 0, col1, row1, col2, row2))
         {
-            minCol = 0;
-            maxCol = tilematrix.matrixWidth;
-            minRow = 0;
-            maxRow = tilematrix.matrixHeight;
+            // layer has limits but not for the selected tileMatrixId -> skip layer
+            continue;
         }
 
-
-        // derive range of col/row to request tiles
+        const tilematrix_t& tilematrix = tileset.tilematrix[tileMatrixId];
         qreal xscale = tilematrix.scale * 0.28e-3;
         qreal yscale = -tilematrix.scale * 0.28e-3;
 
-        qint32 col1 = qFloor((pt1.x() - tilematrix.topLeft.x()) / ( xscale * tilematrix.tileWidth));
-        qint32 row1 = qFloor((pt1.y() - tilematrix.topLeft.y()) / ( yscale * tilematrix.tileHeight));
-        qint32 col2 = qFloor((pt2.x() - tilematrix.topLeft.x()) / ( xscale * tilematrix.tileWidth));
-        qint32 row2 = qFloor((pt2.y() - tilematrix.topLeft.y()) / ( yscale * tilematrix.tileHeight));
-
-
-        if(col1 < minCol)
-        {
-            col1 = minCol;
-        }
-        if(col1 > maxCol)
-        {
-            col1 = maxCol;
-        }
-        if(row1 < minRow)
-        {
-            row1 = minRow;
-        }
-        if(row1 > maxRow)
-        {
-            row1 = maxRow;
-        }
-
-        if(col2 < minCol)
-        {
-            col2 = minCol;
-        }
-        if(col2 > maxCol)
-        {
-            col2 = maxCol;
-        }
-        if(row2 < minRow)
-        {
-            row2 = minRow;
-        }
-        if(row2 > maxRow)
-        {
-            row2 = maxRow;
-        }
-
-
         // start to request tiles. draw tiles in cache, queue urls of tile yet to be requested
         for(qint32 row = row1; row <= row2; row++)
         {
             for(qint32 col = col1; col <= col2; col++)
             {
-                QString url = layer.resourceURL;
-                url = url.replace("{TileMatrix}", tileMatrixId, Qt::CaseInsensitive);
-                url = url.replace("{TileRow}", QString::number(row), Qt::CaseInsensitive);
-                url = url.replace("{TileCol}", QString::number(col), Qt::CaseInsensitive);
+                const QString& url = createUrl(layer, tileMatrixId, col, row);
 
                 if(diskCache->contains(url))
                 {
@@ -570,4 +506,129 @@ void CMapWMTS::draw(IDrawContext::buffer_t& buf) /* override */
 
         emit sigQueueChanged();
     }
+
+    queuePrefetch(QRectF(QPointF(x1, y1), QPointF(x2, y2)));
+    emit sigQueueChanged();
+}
+
+QString CMapWMTS::createUrl(const layer_t& layer, const QString& tileMatrixId, qint32 col, qint32 row)
+{
+    QString url = layer.resourceURL;
+    url = url.replace("{TileMatrix}", tileMatrixId, Qt::CaseInsensitive);
+    url = url.replace("{TileRow}", QString::number(row), Qt::CaseInsensitive);
+    url = url.replace("{TileCol}", QString::number(col), Qt::CaseInsensitive);
+    return url;
+}
+
+bool CMapWMTS::getTileRange(const layer_t& layer, const QString& tileMatrixId, const QPointF& pt1, const QPointF& pt2, qint32 ring,
+                            qint32& col1, qint32& row1, qint32& col2, qint32& row2)
+{
+    const tileset_t& tileset = tilesets[layer.tileMatrixSet];
+    const QMap<QString, limit_t>& limits = layer.limits;
+
+    // get min/max col/row values for that level
+    qint32 minRow, maxRow, minCol, maxCol;
+    const tilematrix_t& tilematrix = tileset.tilematrix[tileMatrixId];
+    if(!limits.isEmpty())
+    {
+        if(limits.contains(tileMatrixId))
+        {
+            const limit_t& limit = limits[tileMatrixId];
+            minCol = limit.minTileCol;
+            maxCol = limit.maxTileCol;
+            minRow = limit.minTileRow;
+            maxRow = limit.maxTileRow;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else
+    {
+        minCol = 0;
+        maxCol = tilematrix.matrixWidth;
+        minRow = 0;
+        maxRow = tilematrix.matrixHeight;
+    }
+
+    // derive range of col/row to request tiles
+    qreal xscale = tilematrix.scale * 0.28e-3;
+    qreal yscale = -tilematrix.scale * 0.28e-3;
+
+    col1 = qFloor((pt1.x() - tilematrix.topLeft.x()) / ( xscale * tilematrix.tileWidth)) - ring;
+    row1 = qFloor((pt1.y() - tilematrix.topLeft.y()) / ( yscale * tilematrix.tileHeight)) - ring;
+    col2 = qFloor((pt2.x() - tilematrix.topLeft.x()) / ( xscale * tilematrix.tileWidth)) + ring;
+    row2 = qFloor((pt2.y() - tilematrix.topLeft.y()) / ( yscale * tilematrix.tileHeight)) + ring;
+
+    col1 = qBound(minCol, col1, maxCol);
+    row1 = qBound(minRow, row1, maxRow);
+    col2 = qBound(minCol, col2, maxCol);
+    row2 = qBound(minRow, row2, maxRow);
+
+    return true;
+}
+
+void CMapWMTS::getTileUrls(const QRectF& area, qint32 levelOffset, qint32 ring, qint32 maxUrls, QStringList& urls) /* override */
+{
+    QMutexLocker lock(&mutex);
+
+    const QRectF viewport(area.topLeft() * RAD_TO_DEG, area.bottomRight() * RAD_TO_DEG);
+
+    for(const layer_t& layer : qAsConst(layers))
+    {
+        if(!layer.boundingBox.intersects(viewport) || !layer.enabled || !lastTileMatrixIds.contains(layer.title))
+        {
+            continue;
+        }
+
+        const tileset_t& tileset = tilesets[layer.tileMatrixSet];
+
+        // sort the tile matrices from coarse to fine to find the adjacent levels
+        QStringList keys = tileset.tilematrix.keys();
+        std::sort(keys.begin(), keys.end(), [&tileset](const QString& key1, const QString& key2)
+        {
+            return tileset.tilematrix[key1].scale > tileset.tilematrix[key2].scale;
+        });
+
+        const qint32 idx = keys.indexOf(lastTileMatrixIds[layer.title]) + levelOffset;
+        if((idx < 0) || (idx >= keys.size()))
+        {
+            continue;
+        }
+        const QString& tileMatrixId = keys[idx];
+
+        // convert area to layer's coordinate system
+        QPointF pt1 = area.topLeft();
+        QPointF pt2 = area.bottomRight();
+
+        tileset.proj.transform(pt1, PJ_INV);
+        tileset.proj.transform(pt2, PJ_INV);
+
+        if(tileset.proj.isSrcLatLong())
+        {
+            pt1 *= RAD_TO_DEG;
+            pt2 *= RAD_TO_DEG;
+        }
+
+        qint32 col1, row1, col2, row2;
+        if(!getTileRange(layer, tileMatrixId, pt1, pt2, ring, col1, row1, col2, row2))
+        {
+            continue;
+        }
+
+        // do not add a layer partially
+        if((qint64(row2 - row1 + 1) * (col2 - col1 + 1)) > (maxUrls - urls.size()))
+        {
+            continue;
+        }
+
+        for(qint32 row = row1; row <= row2; row++)
+        {
+            for(qint32 col = col1; col <= col2; col++)
+            {
+                urls << createUrl(layer, tileMatrixId, col, row);
+            }
+        }
+    }
 }
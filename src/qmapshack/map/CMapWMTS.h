@@ -43,6 +43,9 @@ public:
     void saveConfig(QSettings& cfg) override;
     void loadConfig(QSettings& cfg) override;
 
+protected:
+    void getTileUrls(const QRectF& area, qint32 levelOffset, qint32 ring, qint32 maxUrls, QStringList& urls) override;
+
 private slots:
     void slotLayersChanged(QListWidgetItem* item);
 
@@ -85,6 +88,25 @@ private:
     };
 
     QMap<QString, tileset_t> tilesets;
+
+    /// the tile matrix ID of each layer (by title) used by the last call of draw()
+    QMap<QString, QString> lastTileMatrixIds;
+
+    /**
+       @brief Get the range of tiles covering an area
+
+       @param layer         the layer
+       @param tileMatrixId  the tile matrix (level) of the layer's tile matrix set
+       @param pt1           top left corner of the area in the tile set's coordinate system
+       @param pt2           bottom right corner of the area in the tile set's coordinate system
+       @param ring          number of additional tiles to each side of the area
+       @param col1, row1, col2, row2    the range of tiles, inclusive
+       @return False if the layer has no tiles for the tile matrix
+     */
+    bool getTileRange(const layer_t& layer, const QString& tileMatrixId, const QPointF& pt1, const QPointF& pt2, qint32 ring,
+                      qint32& col1, qint32& row1, qint32& col2, qint32& row2);
+
+    static QString createUrl(const layer_t& layer, const QString& tileMatrixId, qint32 col, qint32 row);
 };
 
 #endif //CMAPWMTS_H
@@ -51,6 +51,9 @@ void IMap::saveConfig(QSettings& cfg) /* override */
     {
         cfg.setValue("cacheSizeMB", cacheSizeMB);
         cfg.setValue("cacheExpiration", cacheExpiration);
+        cfg.setValue("prefetchRing", prefetchRing);
+        cfg.setValue("prefetchLevels", prefetchLevels);
+        cfg.setValue("maxRequestsPerHost", maxRequestsPerHost);
     }
 
     if(hasFeatureTypFile())
@@ -69,6 +72,9 @@ void IMap::loadConfig(QSettings& cfg) /* override */
     slotSetAdjustDetailLevel(cfg.value("adjustDetailLevel", getAdjustDetailLevel()).toInt());
     slotSetCacheSize(cfg.value("cacheSizeMB", getCacheSize()).toInt());
     slotSetCacheExpiration(cfg.value("cacheExpiration", getCacheExpiration()).toInt());
+    slotSetPrefetchRing(cfg.value("prefetchRing", getPrefetchRing()).toInt());
+    slotSetPrefetchLevels(cfg.value("prefetchLevels", getPrefetchLevels()).toBool());
+    slotSetMaxRequestsPerHost(cfg.value("maxRequestsPerHost", getMaxRequestsPerHost()).toInt());
     slotSetTypeFile(cfg.value("typeFile", getTypeFile()).toString());
 }
 
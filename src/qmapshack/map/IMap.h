@@ -87,6 +87,16 @@ public:
         return copyright;
     }
 
+    /**
+       @brief Get the area covered by the map
+
+       @return The area in [rad]. The rectangle is null if the area is unknown or world wide.
+     */
+    const QRectF& getBoundingBox() const
+    {
+        return boundingBox;
+    }
+
     bool hasFeatureVisibility() const
     {
         return flagsFeature & eFeatVisibility;
@@ -139,6 +149,21 @@ public:
         return cacheExpiration;
     }
 
+    qint32 getPrefetchRing() const
+    {
+        return prefetchRing;
+    }
+
+    bool getPrefetchLevels() const
+    {
+        return prefetchLevels;
+    }
+
+    qint32 getMaxRequestsPerHost() const
+    {
+        return maxRequestsPerHost;
+    }
+
     qint32 getAdjustDetailLevel() const
     {
         return adjustDetailLevel;
@@ -193,6 +218,19 @@ public slots:
         configureCache();
     }
 
+    void slotSetPrefetchRing(qint32 tiles)
+    {
+        prefetchRing = tiles;
+    }
+    void slotSetPrefetchLevels(bool yes)
+    {
+        prefetchLevels = yes;
+    }
+    void slotSetMaxRequestsPerHost(qint32 n)
+    {
+        maxRequestsPerHost = n;
+    }
+
     void slotSetAdjustDetailLevel(qint32 level)
     {
         adjustDetailLevel = level;
@@ -253,8 +291,12 @@ protected:
     QString cachePath;            //< streaming map only: path to cached tiles
     qint32 cacheSizeMB = 100;     //< streaming map only: maximum size of all tiles in cache [MByte]
     qint32 cacheExpiration = 8;   //< streaming map only: maximum age of tiles in cache [days]
+    qint32 prefetchRing = 1;      //< streaming map only: number of tiles to prefetch around the visible area
+    bool prefetchLevels = true;   //< streaming map only: prefetch the visible area of the next and previous level
+    qint32 maxRequestsPerHost = 6; //< streaming map only: maximum number of parallel requests per host
 
     QString copyright; //< a copyright string to be displayed as tool tip
+    QRectF boundingBox; //< the area covered by the map in [rad], to be set by the subclass if known
 
     QString typeFile;
 };
@@ -25,6 +25,8 @@
 #include <QMessageBox>
 #include <QtNetwork>
 
+#define MAX_SEED_TILES 20000
+
 IMapOnline::IMapOnline(CMapDraw* parent)
     : IMap(eFeatVisibility | eFeatTileCache, parent)
 {
@@ -51,34 +53,74 @@ bool IMapOnline::httpsCheck(const QString& url)
 }
 
 
+void IMapOnline::request(const QString& url, bool lowPrio)
+{
+    QNetworkRequest request;
+    request.setUrl(url);
+    for(const rawHeaderItem_t& item : qAsConst(rawHeaderItems))
+    {
+        request.setRawHeader(item.name.toLatin1(), item.value.toLatin1());
+    }
+    QNetworkReply* reply = accessManager->get(request);
+    urlPending << url;
+    pendingPerHost[request.url().host()]++;
+
+    if(lowPrio)
+    {
+        repliesLowPrio[url] = reply;
+    }
+}
+
 void IMapOnline::slotQueueChanged()
 {
     QMutexLocker lock(&mutex);
 
-    if(!urlQueue.isEmpty() && urlPending.size() < 6)
+    // cancel prefetch requests no longer needed for the current view
+    // abort() will call slotRequestFinished() and this method recursively
+    QSet<QString> stale;
+    stale.swap(urlStale);
+    for(const QString& url : qAsConst(stale))
     {
-        // request up to 6 pending request
-        for(int i = 0; i < (6 - urlPending.size()); i++)
+        QNetworkReply* reply = repliesLowPrio.value(url, nullptr);
+        if(reply != nullptr)
         {
-            QString url = urlQueue.dequeue();
-            lastRequest = urlQueue.isEmpty();
+            reply->abort();
+        }
+    }
 
-            QNetworkRequest request;
-            request.setUrl(url);
-            for(const rawHeaderItem_t& item : qAsConst(rawHeaderItems))
+    // request tiles of the visible area first, then prefetch and seed tiles
+    const qint32 maxPerHost = getMaxRequestsPerHost();
+    for(QQueue<QString>* queue : {&urlQueue, &urlPrefetch, &urlSeed})
+    {
+        qint32 cntSkipped = 0;
+        auto url = queue->begin();
+        // Do not search the whole queue if the hosts are busy.
+        while((url != queue->end()) && (cntSkipped < 64))
+        {
+            if(pendingPerHost.value(QUrl(*url).host()) >= maxPerHost)
             {
-                request.setRawHeader(item.name.toLatin1(), item.value.toLatin1());
+                ++url;
+                ++cntSkipped;
+                continue;
             }
-            accessManager->get(request);
-            urlPending << url;
 
-            if(lastRequest)
+            request(*url, queue != &urlQueue);
+            if(queue == &urlSeed)
             {
-                break;
+                urlSeedPending << *url;
+            }
+            url = queue->erase(url);
+            cntSkipped = 0;
+
+            if(queue == &urlQueue)
+            {
+                lastRequest = urlQueue.isEmpty();
             }
         }
     }
-    else if(lastRequest && urlPending.isEmpty())
+
+    const int pending = urlQueue.size() + urlPending.size() - repliesLowPrio.size();
+    if(lastRequest && (pending == 0))
     {
         lastRequest = false;
         // if all tiles are received the map layer can be redrawn with all tiles from cache
@@ -92,10 +134,11 @@ void IMapOnline::slotQueueChanged()
     }
 
     // report status of pending tiles
-    int pending = urlQueue.size() + urlPending.size();
-    if(pending)
+    const int prefetching = urlPrefetch.size() + urlSeed.size() + repliesLowPrio.size();
+    if(pending || prefetching)
     {
-        map->reportStatusToCanvas(name, tr("<b>%1</b>: %2 tiles pending<br/>").arg(name).arg(pending));
+        map->reportStatusToCanvas(name, tr("<b>%1</b>: %2 tiles pending, %3 prefetching (%4 received, %5 failed)<br/>")
+                                  .arg(name).arg(pending).arg(prefetching).arg(cntReceived).arg(cntFailed));
     }
     else
     {
@@ -108,24 +151,33 @@ void IMapOnline::slotRequestFinished(QNetworkReply* reply)
 {
     QMutexLocker lock(&mutex);
 
-    QString url = reply->url().toString();
+    QString url = reply->request().url().toString();
     if(urlPending.contains(url))
     {
-        QImage img;
-        // only take good responses
-        if(!reply->error())
+        // cancelled prefetch requests are not stored as failed tiles
+        if(reply->error() != QNetworkReply::OperationCanceledError)
         {
-            // read image data
-            img.loadFromData(reply->readAll());
+            QImage img;
+            // only take good responses
+            if(!reply->error())
+            {
+                // read image data
+                img.loadFromData(reply->readAll());
+            }
+            // always store image to cache, the cache will take care of NULL images
+            diskCache->store(url, img);
+
+            img.isNull() ? cntFailed++ : cntReceived++;
         }
-        // always store image to cache, the cache will take care of NULL images
-        diskCache->store(url, img);
 
         urlPending.removeAll(url);
+        repliesLowPrio.remove(url);
+        urlSeedPending.remove(url);
+        pendingPerHost[reply->request().url().host()]--;
     }
 
     // debug output any error
-    if(reply->error())
+    if(reply->error() && reply->error() != QNetworkReply::OperationCanceledError)
     {
         qDebug() << "Request to" << url << "failed:" << reply->errorString();
     }
@@ -137,6 +189,155 @@ void IMapOnline::slotRequestFinished(QNetworkReply* reply)
     slotQueueChanged();
 }
 
+void IMapOnline::queuePrefetch(const QRectF& viewport)
+{
+    QMutexLocker lock(&mutex);
+
+    urlPrefetch.clear();
+
+    QStringList urls;
+    if(getPrefetchRing() > 0)
+    {
+        getTileUrls(viewport, 0, getPrefetchRing(), NOINT, urls);
+    }
+    if(getPrefetchLevels())
+    {
+        getTileUrls(viewport, -1, 0, NOINT, urls);
+        getTileUrls(viewport, 1, 0, NOINT, urls);
+    }
+
+    QSet<QString> wanted;
+    for(const QString& url : qAsConst(urls))
+    {
+        if(wanted.contains(url) || urlQueue.contains(url))
+        {
+            continue;
+        }
+        wanted << url;
+
+        if(!urlPending.contains(url) && !diskCache->contains(url))
+        {
+            urlPrefetch << url;
+        }
+    }
+
+    // mark pending prefetch requests outside the new view. They are cancelled by slotQueueChanged()
+    const QList<QString>& keys = repliesLowPrio.keys();
+    for(const QString& url : keys)
+    {
+        if(!wanted.contains(url) && !urlSeedPending.contains(url))
+        {
+            urlStale << url;
+        }
+    }
+}
+
+void IMapOnline::seedArea(const QRectF& area)
+{
+    QMutexLocker lock(&mutex);
+
+    // make sure top left is north west
+    const QRectF& rect = area.normalized();
+    const QRectF north(rect.bottomLeft(), rect.topRight());
+
+    // Start with the coarse levels. Skip levels once the number of tiles
+    // gets out of hand. Tile servers do not like bulk downloads.
+    QStringList urls;
+    for(qint32 levelOffset = -3; levelOffset <= 2; levelOffset++)
+    {
+        getTileUrls(north, levelOffset, 0, MAX_SEED_TILES, urls);
+    }
+
+    queueSeed(urls);
+}
+
+void IMapOnline::seedCorridor(const QPolygonF& line, qreal width)
+{
+    if(line.isEmpty() || width <= 0)
+    {
+        return;
+    }
+
+    QMutexLocker lock(&mutex);
+
+    // corridor width in [rad] on the surface
+    const qreal d = width / 6378137.0;
+
+    // split the corridor into small areas along the line
+    QList<QRectF> areas;
+    const int N = line.size();
+    for(int n = 0; n < N; n++)
+    {
+        const QPointF& pt1 = line[n];
+        const QPointF& pt2 = n + 1 < N ? line[n + 1] : line[n];
+
+        // split long segments to keep the areas close to the line
+        const qreal length = qSqrt(qPow(pt2.x() - pt1.x(), 2) + qPow(pt2.y() - pt1.y(), 2));
+        const qint32 steps = qMax(1, qCeil(length / (4 * d)));
+        for(qint32 step = 0; step < steps; step++)
+        {
+            const QPointF& p1 = pt1 + (pt2 - pt1) * step / steps;
+            const QPointF& p2 = pt1 + (pt2 - pt1) * (step + 1) / steps;
+
+            const qreal dx = d / qMax(0.01, qCos(p1.y()));
+            areas << QRectF(QPointF(qMin(p1.x(), p2.x()) - dx, qMax(p1.y(), p2.y()) + d),
+                            QPointF(qMax(p1.x(), p2.x()) + dx, qMin(p1.y(), p2.y()) - d));
+        }
+    }
+
+    // Like seedArea() a level is skipped if the tiles along the complete
+    // corridor would exceed the limit.
+    QStringList urls;
+    for(qint32 levelOffset = -3; levelOffset <= 2; levelOffset++)
+    {
+        QStringList level;
+        QSet<QString> known;
+        for(const QRectF& area : qAsConst(areas))
+        {
+            // neighbouring areas share most of their tiles
+            QStringList tiles;
+            getTileUrls(area, levelOffset, 0, NOINT, tiles);
+            for(const QString& tile : qAsConst(tiles))
+            {
+                if(!known.contains(tile))
+                {
+                    known << tile;
+                    level << tile;
+                }
+            }
+
+            if(urls.size() + level.size() > MAX_SEED_TILES)
+            {
+                break;
+            }
+        }
+
+        if(urls.size() + level.size() <= MAX_SEED_TILES)
+        {
+            urls += level;
+        }
+    }
+
+    queueSeed(urls);
+}
+
+void IMapOnline::queueSeed(const QStringList& urls)
+{
+    QStringList unique = urls;
+    unique.removeDuplicates();
+
+    const QStringList& missing = diskCache->missing(unique);
+    for(const QString& url : missing)
+    {
+        if(!urlPending.contains(url))
+        {
+            urlSeed << url;
+        }
+    }
+
+    emit sigQueueChanged();
+}
+
 
 void IMapOnline::configureCache()
 {
@@ -20,8 +20,10 @@
 #ifndef IMAPONLINE_H
 #define IMAPONLINE_H
 #include "map/IMap.h"
+#include <QHash>
 #include <QMutex>
 #include <QQueue>
+#include <QSet>
 #include <QTime>
 
 class CDiskCache;
@@ -46,14 +48,29 @@ signals:
 protected:
     /// Mutex to control access to url queue
     QMutex mutex {QMutex::Recursive};
-    /// a queue with all tile urls to request
+    /// a queue with all tile urls of the visible area to request
     QQueue<QString> urlQueue;
+    /// a queue with tile urls around the visible area and of adjacent levels, low priority
+    QQueue<QString> urlPrefetch;
+    /// a queue with tile urls to seed the cache for offline use, lowest priority
+    QQueue<QString> urlSeed;
     /// the tile cache
     CDiskCache* diskCache = nullptr;
     /// access manager to request tiles
     QNetworkAccessManager* accessManager = nullptr;
+    /// all requested urls not answered yet
     QList<QString> urlPending;
-
+    /// the replies of pending prefetch and seed requests
+    QHash<QString, QNetworkReply*> repliesLowPrio;
+    /// pending seed requests, never cancelled
+    QSet<QString> urlSeedPending;
+    /// pending prefetch requests no longer needed for the current view
+    QSet<QString> urlStale;
+    /// number of pending requests for each host
+    QHash<QString, qint32> pendingPerHost;
+
+    quint32 cntReceived = 0;
+    quint32 cntFailed = 0;
 
     bool lastRequest = false;
     QTime timeLastUpdate;
@@ -71,13 +88,61 @@ protected:
 
     void configureCache() override;
 
+    /**
+       @brief Get the urls of all tiles covering an area
+
+       The level is relative to the level used by the last call of draw().
+
+       @param area          the area in [rad], top left is north west
+       @param levelOffset   0 for the current level, +1 for the next level with more details, -1 for the next coarser level...
+       @param ring          number of additional tiles to each side of the area
+       @param maxUrls       the maximum size of urls, layers that would exceed it are skipped
+       @param urls          list to append the urls to
+     */
+    virtual void getTileUrls(const QRectF& area, qint32 levelOffset, qint32 ring, qint32 maxUrls, QStringList& urls) = 0;
+
+    /**
+       @brief Replace the prefetch queue by the tiles around the viewport and of adjacent levels
+
+       Call this at the end of draw() after urlQueue has been filled. Pending prefetch
+       requests no longer needed will be cancelled.
+
+       @param viewport      the visible area in [rad], top left is north west
+     */
+    void queuePrefetch(const QRectF& viewport);
+
 public:
     void slotQueueChanged();
     void slotRequestFinished(QNetworkReply* reply);
 
+    /**
+       @brief Download all tiles of an area for offline use
+
+       The tiles of the current level, the two levels with more details and
+       the three coarser levels are queued at lowest priority. Levels are
+       skipped once the number of tiles exceeds a sane limit.
+
+       @param area          the area in [rad], top left is north west
+     */
+    void seedArea(const QRectF& area);
+
+    /**
+       @brief Download all tiles along a line for offline use
+
+       Like seedArea() but for the corridor along a track or route.
+
+       @param line          the line's points in [rad]
+       @param width         the corridor's width to each side of the line in [m]
+     */
+    void seedCorridor(const QPolygonF& line, qreal width);
 
     IMapOnline(CMapDraw* parent);
     virtual ~IMapOnline() {}
+
+private:
+    /// queue all urls not in the cache or pending already
+    void queueSeed(const QStringList& urls);
+    void request(const QString& url, bool lowPrio);
 };
 
 #endif //IMAPONLINE_H
@@ -20,8 +20,17 @@
 #include "map/CMapDraw.h"
 #include "version.h"
 
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QtConcurrent>
 #include <QtWidgets>
 
+#define CACHE_DB_NAME   "cache.db"
+#define FLUSH_INTERVAL  2000
+#define CLEANUP_CYCLES  10
+#define IMPORT_CHUNK    1000
+#define MISSING_CHUNK   500
+
 CDiskCache::CDiskCache(const QString& path, qint32 maxSizeMB, qint32 expirationDays, QObject* parent)
     : QObject(parent)
     , dir(path)
@@ -29,6 +38,7 @@ CDiskCache::CDiskCache(const QString& path, qint32 maxSizeMB, qint32 expirationD
     , expirationDays(expirationDays)
 {
     dummy.fill(Qt::transparent);
+    cache.setMaxCost(32 * 1024);
 
     dir.mkpath(dir.path());
 
@@ -41,126 +51,486 @@ CDiskCache::CDiskCache(const QString& path, qint32 maxSizeMB, qint32 expirationD
         }
     }
 
-    const QFileInfoList& files = dir.entryInfoList(QStringList("*.png"), QDir::Files);
-    for(const QFileInfo& fileinfo : files)
+    QSqlDatabase db = getDatabase();
+    if(db.isOpen())
     {
-        QString hash = fileinfo.baseName();
-        table[hash] = fileinfo.fileName();
+        QSqlQuery query(db);
+        // allow readers while the background job is writing
+        query.exec("PRAGMA journal_mode=WAL");
+        if(!query.exec("CREATE TABLE IF NOT EXISTS tiles ("
+                       "hash TEXT PRIMARY KEY NOT NULL, "
+                       "data BLOB NOT NULL, "
+                       "size INTEGER NOT NULL, "
+                       "created INTEGER NOT NULL, "
+                       "accessed INTEGER NOT NULL)"))
+        {
+            qDebug() << "failed to create tile table" << query.lastError();
+        }
+        // both indices cover the size to sum it up without touching the tiles
+        query.exec("CREATE INDEX IF NOT EXISTS idx_accessed ON tiles(accessed, size)");
+        query.exec("CREATE INDEX IF NOT EXISTS idx_created ON tiles(created, size)");
     }
 
+    // check for a cache of a previous version with one file per tile
+    importPending = QDirIterator(dir.path(), QStringList("*.png"), QDir::Files).hasNext();
+
     timer = new QTimer(this);
     timer->setSingleShot(false);
-    timer->start(20000);
-    connect(timer, &QTimer::timeout, this, &CDiskCache::slotCleanup);
+    timer->start(FLUSH_INTERVAL);
+    connect(timer, &QTimer::timeout, this, &CDiskCache::slotFlush);
 }
 
-void CDiskCache::store(const QString& key, QImage& img)
+CDiskCache::~CDiskCache()
 {
-    QMutexLocker lock(&mutex);
+    timer->stop();
+    future.waitForFinished();
+    flush(false);
 
+    for(const QString& connectionName : qAsConst(dbConnections))
+    {
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+QString CDiskCache::hash(const QString& key)
+{
     QCryptographicHash md5(QCryptographicHash::Md5);
     md5.addData(key.toLatin1());
+    return md5.result().toHex();
+}
 
-    QString hash = md5.result().toHex();
-    QString filename = QString("%1.png").arg(hash);
+QSqlDatabase CDiskCache::getDatabase() const
+{
+    // Use the QThread object as identifier as draw threads
+    // are restarted but keep their QThread object.
+    const QString& connectionName = QString("cache_%1_%2_%3")
+                                    .arg(dir.path())
+                                    .arg(quintptr(this), 0, 16)
+                                    .arg(quintptr(QThread::currentThread()), 0, 16);
 
+    {
+        QMutexLocker lock(&mutex);
+        if(dbConnections.contains(connectionName))
+        {
+            return QSqlDatabase::database(connectionName);
+        }
+        dbConnections << connectionName;
+    }
+
+    return openDatabase(connectionName);
+}
+
+QSqlDatabase CDiskCache::openDatabase(const QString& connectionName) const
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(dir.absoluteFilePath(CACHE_DB_NAME));
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if(!db.open())
+    {
+        qDebug() << "failed to open tile cache" << db.lastError();
+    }
+    return db;
+}
+
+void CDiskCache::store(const QString& key, QImage& img)
+{
+    const QString& hash = CDiskCache::hash(key);
+
+    QMutexLocker lock(&mutex);
     if(!img.isNull())
     {
-        img.save(dir.absoluteFilePath(filename));
-        table[hash] = filename;
-        cache[hash] = img;
+        // the image is written to the database by the next flush
+        pending[hash] = img;
+        failed.remove(hash);
+        cache.insert(hash, new QImage(img), qMax(1, img.bytesPerLine() * img.height() / 1024));
     }
     else
     {
-        cache[hash] = dummy;
+        failed << hash;
     }
 }
 
 void CDiskCache::restore(const QString& key, QImage& img)
 {
-    QMutexLocker lock(&mutex);
+    if(!readTile(hash(key), img))
+    {
+        img = QImage();
+    }
+}
 
-    QCryptographicHash md5(QCryptographicHash::Md5);
-    md5.addData(key.toLatin1());
+bool CDiskCache::contains(const QString& key) const
+{
+    // Do not decode the tile. This is called for a lot
+    // of tiles when prefetching or seeding the cache.
+    const QString& hash = CDiskCache::hash(key);
+    {
+        QMutexLocker lock(&mutex);
+        if(failed.contains(hash) || pending.contains(hash) || cache.contains(hash))
+        {
+            return true;
+        }
+    }
 
-    QString hash = md5.result().toHex();
+    QSqlDatabase db = getDatabase();
+    if(db.isOpen())
+    {
+        QSqlQuery query(db);
+        query.prepare("SELECT 1 FROM tiles WHERE hash=:hash");
+        query.bindValue(":hash", hash);
+        if(query.exec() && query.next())
+        {
+            return true;
+        }
+    }
 
-    if(cache.contains(hash))
+    return importPending && QFile::exists(dir.absoluteFilePath(hash + ".png"));
+}
+
+QStringList CDiskCache::missing(const QStringList& keys) const
+{
+    QStringList hashes;
+    QSet<QString> candidates;
     {
-        img = cache[hash];
+        QMutexLocker lock(&mutex);
+        for(const QString& key : keys)
+        {
+            const QString& hash = CDiskCache::hash(key);
+            hashes << hash;
+            if(!(failed.contains(hash) || pending.contains(hash) || cache.contains(hash)))
+            {
+                candidates << hash;
+            }
+        }
     }
-    else if(table.contains(hash))
+
+    // query the tiles in chunks to stay below SQLite's limit of parameters
+    QSqlDatabase db = getDatabase();
+    if(db.isOpen() && !candidates.isEmpty())
     {
-        img.load(dir.absoluteFilePath(table[hash]));
-        if(!cache.contains(hash))
+        const QStringList& list = candidates.toList();
+        QSqlQuery query(db);
+        for(int i = 0; i < list.size(); i += MISSING_CHUNK)
         {
-            cache[hash] = img;
+            const QStringList& chunk = list.mid(i, MISSING_CHUNK);
+            QStringList placeholders;
+            for(int n = 0; n < chunk.size(); n++)
+            {
+                placeholders << "?";
+            }
+
+            query.prepare(QString("SELECT hash FROM tiles WHERE hash IN (%1)").arg(placeholders.join(",")));
+            for(const QString& hash : chunk)
+            {
+                query.addBindValue(hash);
+            }
+            if(!query.exec())
+            {
+                continue;
+            }
+            while(query.next())
+            {
+                candidates.remove(query.value(0).toString());
+            }
         }
     }
-    else
+
+    // keep the order of the keys
+    QStringList result;
+    for(int i = 0; i < keys.size(); i++)
     {
-        img = QImage();
+        const QString& hash = hashes[i];
+        if(candidates.contains(hash) && !(importPending && QFile::exists(dir.absoluteFilePath(hash + ".png"))))
+        {
+            result << keys[i];
+        }
     }
+    return result;
 }
 
-bool CDiskCache::contains(const QString& key) const
+bool CDiskCache::readTile(const QString& hash, QImage& img) const
 {
+    {
+        QMutexLocker lock(&mutex);
+        if(failed.contains(hash))
+        {
+            img = dummy;
+            return true;
+        }
+
+        const QImage* cached = cache.object(hash);
+        if(cached != nullptr)
+        {
+            img = *cached;
+            accessed << hash;
+            return true;
+        }
+
+        if(pending.contains(hash))
+        {
+            img = pending[hash];
+            return true;
+        }
+    }
+
+    QByteArray data;
+    QSqlDatabase db = getDatabase();
+    if(db.isOpen())
+    {
+        QSqlQuery query(db);
+        query.prepare("SELECT data FROM tiles WHERE hash=:hash");
+        query.bindValue(":hash", hash);
+        if(query.exec() && query.next())
+        {
+            data = query.value(0).toByteArray();
+        }
+    }
+
+    if(data.isEmpty() && importPending)
+    {
+        // not imported yet
+        QFile file(dir.absoluteFilePath(hash + ".png"));
+        if(file.open(QIODevice::ReadOnly))
+        {
+            data = file.readAll();
+        }
+    }
+
+    if(data.isEmpty() || !img.loadFromData(data, "PNG"))
+    {
+        return false;
+    }
+
     QMutexLocker lock(&mutex);
+    cache.insert(hash, new QImage(img), qMax(1, img.bytesPerLine() * img.height() / 1024));
+    accessed << hash;
+    return true;
+}
 
-    QCryptographicHash md5(QCryptographicHash::Md5);
-    md5.addData(key.toLatin1());
+void CDiskCache::slotFlush()
+{
+    if(future.isRunning())
+    {
+        return;
+    }
 
-    QString hash = md5.result().toHex();
-    return table.contains(hash) || cache.contains(hash);
+    const bool doCleanup = (++cntFlush % CLEANUP_CYCLES) == 0;
+    future = QtConcurrent::run([this, doCleanup](){
+        flush(doCleanup);
+    });
 }
 
-void CDiskCache::removeCacheFile(const QFileInfo& fileinfo)
+void CDiskCache::flush(bool doCleanup)
 {
-    QString hash = fileinfo.baseName();
-    table.remove(hash);
-    cache.remove(hash);
-    QFile::remove(fileinfo.absoluteFilePath());
+    // Pool threads expire and their addresses are reused. Therefore the
+    // connection must not outlive a single run.
+    const QString& connectionName = QString("cache_flush_%1_%2")
+                                    .arg(dir.path())
+                                    .arg(quintptr(this), 0, 16);
+    {
+        QSqlDatabase db = openDatabase(connectionName);
+        if(db.isOpen())
+        {
+            flush(db, doCleanup);
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
 }
 
-void CDiskCache::slotCleanup()
+void CDiskCache::flush(QSqlDatabase& db, bool doCleanup)
 {
-    QMutexLocker lock(&mutex);
+    QHash<QString, QImage> tiles;
+    QSet<QString> touched;
+    {
+        QMutexLocker lock(&mutex);
+        tiles = pending;
+        touched.swap(accessed);
+    }
 
-    const QFileInfoList& files = dir.entryInfoList(QStringList("*.png"), QDir::Files);
-    QDateTime now = QDateTime::currentDateTime();
-    qint32 maxSizeBytes = maxSizeMB * 1024 * 1024;
-    qint32 tmpSize = 0;
-    // expire old files and calculate cache size
-    for(const QFileInfo& fileinfo : files)
+    QSqlQuery query(db);
+    if(totalSize < 0)
     {
-        if(fileinfo.lastModified().daysTo(now) > expirationDays)
+        query.exec("SELECT SUM(size) FROM tiles");
+        totalSize = query.next() ? query.value(0).toLongLong() : 0;
+    }
+
+    if(!tiles.isEmpty() || !touched.isEmpty())
+    {
+        const qint64 now = QDateTime::currentSecsSinceEpoch();
+
+        db.transaction();
+        for(auto tile = tiles.constBegin(); tile != tiles.constEnd(); ++tile)
         {
-            removeCacheFile(fileinfo);
-            qDebug() << "remove tile" << fileinfo.lastModified() << fileinfo.absoluteFilePath() << "(reason: expired)";
+            QByteArray data;
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::WriteOnly);
+            tile.value().save(&buffer, "PNG");
+
+            query.prepare("SELECT size FROM tiles WHERE hash=:hash");
+            query.bindValue(":hash", tile.key());
+            if(query.exec() && query.next())
+            {
+                totalSize -= query.value(0).toLongLong();
+            }
+
+            query.prepare("INSERT OR REPLACE INTO tiles (hash, data, size, created, accessed) VALUES (:hash, :data, :size, :created, :accessed)");
+            query.bindValue(":hash", tile.key());
+            query.bindValue(":data", data);
+            query.bindValue(":size", data.size());
+            query.bindValue(":created", now);
+            query.bindValue(":accessed", now);
+            if(query.exec())
+            {
+                totalSize += data.size();
+            }
+            else
+            {
+                qDebug() << "failed to store tile" << query.lastError();
+            }
+
+            touched.remove(tile.key());
+        }
+
+        query.prepare("UPDATE tiles SET accessed=:accessed WHERE hash=:hash");
+        for(const QString& hash : qAsConst(touched))
+        {
+            query.bindValue(":accessed", now);
+            query.bindValue(":hash", hash);
+            query.exec();
         }
-        else
+        db.commit();
+
+        QMutexLocker lock(&mutex);
+        for(auto tile = tiles.constBegin(); tile != tiles.constEnd(); ++tile)
         {
-            tmpSize += fileinfo.size();
+            // the tile might have been replaced in the meantime
+            if(pending.value(tile.key()).cacheKey() == tile.value().cacheKey())
+            {
+                pending.remove(tile.key());
+            }
         }
     }
 
-    if(tmpSize > maxSizeBytes)
+    if(importPending)
     {
-        const QFileInfoList& files = dir.entryInfoList(QStringList("*.png"), QDir::Files, QDir::Time | QDir::Reversed);
-        // if cache is still too large remove oldest files
-        for(const QFileInfo& fileinfo : files)
-        {
-            removeCacheFile(fileinfo);
-            qDebug() << "remove tile" << fileinfo.lastModified() << fileinfo.absoluteFilePath() << "(reason: cache size limit)";
+        importFiles(db);
+    }
 
-            tmpSize -= fileinfo.size();
+    if(doCleanup)
+    {
+        cleanup(db);
+    }
+}
 
-            if(tmpSize < maxSizeBytes)
+void CDiskCache::importFiles(QSqlDatabase& db)
+{
+    QStringList imported;
+    QDirIterator it(dir.path(), QStringList("*.png"), QDir::Files);
+
+    QSqlQuery query(db);
+    db.transaction();
+    while(it.hasNext() && (imported.size() < IMPORT_CHUNK))
+    {
+        const QString& filename = it.next();
+        const QFileInfo& fileinfo = it.fileInfo();
+
+        QFile file(filename);
+        if(!file.open(QIODevice::ReadOnly))
+        {
+            continue;
+        }
+        const QByteArray& data = file.readAll();
+        const qint64 timestamp = fileinfo.lastModified().toSecsSinceEpoch();
+
+        // tiles stored by this version are newer than the ones imported
+        query.prepare("INSERT OR IGNORE INTO tiles (hash, data, size, created, accessed) VALUES (:hash, :data, :size, :created, :accessed)");
+        query.bindValue(":hash", fileinfo.baseName());
+        query.bindValue(":data", data);
+        query.bindValue(":size", data.size());
+        query.bindValue(":created", timestamp);
+        query.bindValue(":accessed", timestamp);
+        if(query.exec())
+        {
+            if(query.numRowsAffected() > 0)
             {
-                break;
+                totalSize += data.size();
             }
+            imported << filename;
+        }
+    }
+    const bool done = !it.hasNext();
+    if(!db.commit())
+    {
+        qDebug() << "failed to import tiles" << db.lastError();
+        return;
+    }
+
+    // only remove the files after they are safely in the database
+    for(const QString& filename : qAsConst(imported))
+    {
+        QFile::remove(filename);
+    }
+
+    qDebug() << "imported" << imported.size() << "tiles into" << dir.absoluteFilePath(CACHE_DB_NAME);
+
+    if(done)
+    {
+        importPending = false;
+    }
+}
+
+void CDiskCache::cleanup(QSqlDatabase& db)
+{
+    QSqlQuery query(db);
+
+    // expire old tiles
+    const qint64 limit = QDateTime::currentDateTime().addDays(-expirationDays).toSecsSinceEpoch();
+    query.prepare("SELECT SUM(size), COUNT(*) FROM tiles WHERE created<:limit");
+    query.bindValue(":limit", limit);
+    if(query.exec() && query.next() && query.value(1).toInt() > 0)
+    {
+        const qint64 size = query.value(0).toLongLong();
+        qDebug() << "remove" << query.value(1).toInt() << "tiles from" << dir.path() << "(reason: expired)";
+
+        query.prepare("DELETE FROM tiles WHERE created<:limit");
+        query.bindValue(":limit", limit);
+        if(query.exec())
+        {
+            totalSize -= size;
         }
     }
+
+    // if cache is still too large remove least recently used tiles
+    const qint64 maxSizeBytes = qint64(maxSizeMB) * 1024 * 1024;
+    while(totalSize > maxSizeBytes)
+    {
+        QStringList hashes;
+        qint64 size = 0;
+        query.exec("SELECT hash, size FROM tiles ORDER BY accessed LIMIT 500");
+        while(query.next() && (totalSize - size) > maxSizeBytes)
+        {
+            hashes << query.value(0).toString();
+            size += query.value(1).toLongLong();
+        }
+
+        if(hashes.isEmpty())
+        {
+            break;
+        }
+
+        qDebug() << "remove" << hashes.size() << "tiles from" << dir.path() << "(reason: cache size limit)";
+
+        db.transaction();
+        query.prepare("DELETE FROM tiles WHERE hash=:hash");
+        for(const QString& hash : qAsConst(hashes))
+        {
+            query.bindValue(":hash", hash);
+            query.exec();
+        }
+        db.commit();
+
+        totalSize -= size;
+    }
 }
 
 
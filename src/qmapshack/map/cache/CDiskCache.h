@@ -19,43 +19,95 @@
 #ifndef CDISKCACHE_H
 #define CDISKCACHE_H
 
+#include <QCache>
 #include <QDir>
+#include <QFuture>
 #include <QHash>
 #include <QImage>
 #include <QMutex>
+#include <QSet>
+#include <QSqlDatabase>
+
+#include <atomic>
 
 class QTimer;
 
+/**
+   @brief Tile cache for online maps
+
+   The tiles are stored as PNG blobs in a SQLite database within the
+   cache directory. The database has an index on the last access time
+   and the creation time of each tile. That way expiration and the
+   size limit can be handled without touching all tiles.
+
+   New tiles are kept in memory first and written in batches by a
+   background job triggered by a timer. The same job updates the access
+   times and does the cleanup. Tile caches of previous versions (one
+   PNG file per tile) are imported on the fly.
+
+   The cache can be used from several threads. Each thread uses it's
+   own database connection. The background job opens a connection of
+   it's own for each run, as the pool threads it runs on come and go.
+ */
 class CDiskCache : public QObject
 {
     Q_OBJECT
 public:
     CDiskCache(const QString& path, qint32 size, qint32 days, QObject* parent);
-    virtual ~CDiskCache() = default;
+    virtual ~CDiskCache();
 
     void store(const QString& key, QImage& img);
     void restore(const QString& key, QImage& img);
     bool contains(const QString& key) const;
+    /// like contains() for many tiles at once, returns the keys of the tiles not in the cache
+    QStringList missing(const QStringList& keys) const;
 
     static void cleanupRemovedMaps(const QSet<QString>& maps);
 
 private slots:
-    void slotCleanup();
+    void slotFlush();
 
 private:
-    void removeCacheFile(const QFileInfo& fileinfo);
+    static QString hash(const QString& key);
+    /// get the database connection of the calling thread
+    QSqlDatabase getDatabase() const;
+    /// open a new connection to the database
+    QSqlDatabase openDatabase(const QString& connectionName) const;
+    /// read a tile from memory or database, return true if the tile is known
+    bool readTile(const QString& hash, QImage& img) const;
+    /// run flush() with a connection of it's own
+    void flush(bool cleanup);
+    /// write pending tiles, update access times and do cleanup if requested
+    void flush(QSqlDatabase& db, bool cleanup);
+    /// move a chunk of PNG files from previous cache versions into the database
+    void importFiles(QSqlDatabase& db);
+    /// remove expired tiles and least recently used tiles exceeding the size limit
+    void cleanup(QSqlDatabase& db);
 
     QDir dir;
 
     const qint32 maxSizeMB;      //< maximum cache size in MB
     const qint32 expirationDays; //< expiration time in days
 
-    /// hash table to cache images as files on disc
-    QHash<QString, QString> table;
-    /// hash table to cache loaded images in memory
-    QHash<QString, QImage>  cache;
-
+    /// tiles received but not written to the database yet
+    QHash<QString, QImage> pending;
+    /// hashes of tiles read since the last flush, to update their access time
+    mutable QSet<QString> accessed;
+    /// tiles that failed to load, kept for this session only
+    QSet<QString> failed;
+    /// recently used tiles in memory, cost in kB
+    mutable QCache<QString, QImage> cache;
+
+    /// names of the database connections opened by the threads using the cache
+    mutable QSet<QString> dbConnections;
+    /// total size of all tiles in the database, only used by the background job
+    qint64 totalSize = -1;
+    /// true as long as there are tiles of a previous cache version to import
+    std::atomic<bool> importPending {false};
+
+    QFuture<void> future;
     QTimer* timer;
+    qint32 cntFlush = 0;
 
     QImage dummy {256, 256, QImage::Format_ARGB32};
 
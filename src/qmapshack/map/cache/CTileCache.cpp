@@ -0,0 +1,63 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "map/cache/CTileCache.h"
+
+CTileCache& CTileCache::self()
+{
+    static CTileCache instance;
+    return instance;
+}
+
+CTileCache::CTileCache()
+{
+    setMaxSize(256);
+}
+
+bool CTileCache::find(const QString& key, QImage& img)
+{
+    QMutexLocker lock(&mutex);
+    QImage* cached = cache.object(key);
+    if(cached == nullptr)
+    {
+        return false;
+    }
+
+    // QImage is implicitly shared. This is just a reference.
+    img = *cached;
+    return true;
+}
+
+void CTileCache::insert(const QString& key, const QImage& img)
+{
+    if(img.isNull())
+    {
+        return;
+    }
+
+    const int cost = qMax(1, img.bytesPerLine() * img.height() / 1024);
+
+    QMutexLocker lock(&mutex);
+    cache.insert(key, new QImage(img), cost);
+}
+
+void CTileCache::setMaxSize(qint32 sizeMB)
+{
+    QMutexLocker lock(&mutex);
+    cache.setMaxCost(sizeMB * 1024);
+}
@@ -0,0 +1,76 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CTILECACHE_H
+#define CTILECACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+
+/**
+   @brief A process wide LRU of decoded map tiles
+
+   Raster maps decoding compressed tiles (JNX, GEMF, RMAP, ...) store the
+   decoded images here. The key has to identify the tile uniquely across all
+   maps. Use key() to build it from the map's file name and the tile's address.
+   That way all map objects referencing the same file share the decoded tiles.
+
+   The cache is limited by the size of the images in memory. All methods are
+   thread safe.
+ */
+class CTileCache
+{
+public:
+    static CTileCache& self();
+
+    static QString key(const QString& filename, qint32 level, quint64 tile)
+    {
+        return QString("%1|%2|%3").arg(filename).arg(level).arg(tile);
+    }
+
+    /**
+       @brief Get a decoded tile
+
+       @param key   the tile's key
+       @param img   the image to receive the tile
+       @return True if the tile was found.
+     */
+    bool find(const QString& key, QImage& img);
+
+    /**
+       @brief Store a decoded tile. Least recently used tiles are dropped if the cache exceeds it's limit.
+
+       @param key   the tile's key
+       @param img   the decoded image. Null images are not stored.
+     */
+    void insert(const QString& key, const QImage& img);
+
+    /// set the limit of the cache in MB
+    void setMaxSize(qint32 sizeMB);
+
+private:
+    CTileCache();
+
+    QMutex mutex;
+    /// decoded images, cost in kB
+    QCache<QString, QImage> cache;
+};
+
+#endif //CTILECACHE_H
+
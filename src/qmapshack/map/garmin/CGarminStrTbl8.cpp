@@ -31,7 +31,7 @@ CGarminStrTbl8::~CGarminStrTbl8()
 }
 
 
-void CGarminStrTbl8::get(CFileExt& file, quint32 offset, type_e t, QStringList& info)
+void CGarminStrTbl8::decode(CFileExt& file, quint32 offset, type_e t, QStringList& info)
 {
     info.clear();
     offset = calcOffset(file, offset, t);
@@ -27,6 +27,7 @@ public:
     CGarminStrTbl8(const quint16 codepage, const quint8 mask, QObject* parent);
     virtual ~CGarminStrTbl8();
 
-    void get(CFileExt& file, quint32 offset, type_e t, QStringList& info) override;
+protected:
+    void decode(CFileExt& file, quint32 offset, type_e t, QStringList& info) override;
 };
 #endif                           //CGARMINSTRTBL8_H
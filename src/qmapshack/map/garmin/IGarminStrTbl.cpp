@@ -23,10 +23,14 @@
 
 #include <QtCore>
 
+/// the maximum number of label sets cached per string table
+#define MAX_LABELS  100000
+
 IGarminStrTbl::IGarminStrTbl(const quint16 codepage, const quint8 mask, QObject* parent)
     : QObject(parent)
     , codepage(codepage)
     , mask(mask)
+    , labels(MAX_LABELS)
 {
     if(codepage != 0)
     {
@@ -74,6 +78,27 @@ IGarminStrTbl::~IGarminStrTbl()
 }
 
 
+void IGarminStrTbl::get(CFileExt& file, quint32 offset, type_e t, QStringList& info)
+{
+    if(unitType != IUnit::self().type)
+    {
+        labels.clear();
+        unitType = IUnit::self().type;
+    }
+
+    const quint64 key = (quint64(t) << 32) | offset;
+    const QStringList* cached = labels.object(key);
+    if(cached != nullptr)
+    {
+        info = *cached;
+        return;
+    }
+
+    decode(file, offset, t, info);
+    labels.insert(key, new QStringList(info));
+}
+
+
 void IGarminStrTbl::readFile(CFileExt& file, quint32 offset, quint32 size, QByteArray& data)
 {
     if(offset + size > file.size())
@@ -19,11 +19,12 @@
 #ifndef IGARMINSTRTBL_H
 #define IGARMINSTRTBL_H
 
+#include <QCache>
 #include <QObject>
+#include <QStringList>
 
 class CFileExt;
 class QByteArray;
-class QStringList;
 
 class IGarminStrTbl : public QObject
 {
@@ -51,8 +52,22 @@ public:
         addrshift2 = shift;
     }
 
-    virtual void get(CFileExt& file, quint32 offset, type_e t, QStringList& info) = 0;
+    /**
+       @brief Get the labels at an offset
+
+       The decoded labels are cached by offset and type. Thus labels shown with
+       each redraw are decoded once only.
+
+       @param file      the map file
+       @param offset    the offset into the table selected by t
+       @param t         the type of the offset
+       @param info      the list to receive the labels
+     */
+    void get(CFileExt& file, quint32 offset, type_e t, QStringList& info);
+
 protected:
+    /// decode the labels at an offset, see get() for the parameters
+    virtual void decode(CFileExt& file, quint32 offset, type_e t, QStringList& info) = 0;
     void readFile(CFileExt& file, quint32 offset, quint32 size, QByteArray& data);
     quint32 calcOffset(CFileExt& file, const quint32 offset, type_e t);
 
@@ -76,5 +91,11 @@ protected:
     quint64 mask64;
 
     char buffer[1025];
+
+private:
+    /// the decoded labels, the key is the type and the offset
+    QCache<quint64, QStringList> labels;
+    /// elevations are converted while decoding, the unit type the cached labels use
+    qint32 unitType = -1;
 };
 #endif                           //IGARMINSTRTBL_H
@@ -0,0 +1,525 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "gis/proj_x.h"
+#include "map/mapsforge/CMapsforgeFile.h"
+
+#include <QtCore>
+
+#define INT_TO_DEG(x) (qreal(x) / 1e6)
+
+#define INT_TO_RAD(x) (qreal(x) / (1e6 * RAD_TO_DEG))
+
+/// the signatures of a map with debug information
+#define SIZE_INDEX_SIGNATURE    16
+#define SIZE_BLOCK_SIGNATURE    32
+
+#define SIZE_INDEX_ENTRY        5
+#define INDEX_OFFSET_MASK       0x7FFFFFFFFFull
+
+static inline quint32 lon2tile(qreal lon, int z)
+{
+    return quint32(qBound(0.0, (lon + 180.0) / 360.0 * (1 << z), qreal((1 << z) - 1)));
+}
+
+static inline quint32 lat2tile(qreal lat, int z)
+{
+    lat = qBound(-85.0511, lat, 85.0511);
+    const qreal y = (1.0 - qLn(qTan(lat * DEG_TO_RAD) + 1.0 / qCos(lat * DEG_TO_RAD)) / M_PI) / 2.0 * (1 << z);
+    return quint32(qBound(0.0, y, qreal((1 << z) - 1)));
+}
+
+static inline qreal tile2lon(quint32 x, int z)
+{
+    return qreal(x) / (1 << z) * 360.0 - 180;
+}
+
+static inline qreal tile2lat(quint32 y, int z)
+{
+    qreal n = M_PI - 2.0 * M_PI * y / (1 << z);
+    return 180.0 / M_PI * qAtan(0.5 * (qExp(n) - qExp(-n)));
+}
+
+CMapsforgeFile::CMapsforgeFile(const QString& filename)
+    : filename(filename)
+    , file(filename)
+{
+}
+
+CMapsforgeFile::~CMapsforgeFile()
+{
+    if(data != nullptr)
+    {
+        file.unmap(const_cast<uchar*>(data));
+    }
+}
+
+void CMapsforgeFile::open()
+{
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        throw exce_t(eErrOpen, tr("Failed to open: ") + filename);
+    }
+
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::BigEndian);
+
+    // ---------- start file header ----------------------
+    stream.readRawData(header.signature, sizeof(header.signature));
+    if(strncmp(header.signature, "mapsforge binary OSM", sizeof(header.signature)) != 0)
+    {
+        throw exce_t(errFormat, tr("Bad file format: ") + filename);
+    }
+
+    stream >> header.sizeHeader;
+    stream >> header.version;
+    stream >> header.sizeFile;
+    stream >> header.timestamp;
+    stream >> header.minLat;
+    stream >> header.minLon;
+    stream >> header.maxLat;
+    stream >> header.maxLon;
+
+    qDebug() << INT_TO_DEG(header.minLat) << INT_TO_DEG(header.minLon) << INT_TO_DEG(header.maxLat) << INT_TO_DEG(header.maxLon);
+    ref1 = QPointF(INT_TO_RAD(header.minLon), INT_TO_RAD(header.maxLat));
+    ref2 = QPointF(INT_TO_RAD(header.maxLon), INT_TO_RAD(header.minLat));
+
+    stream >> header.sizeTile;
+    stream >> header.projection;
+    stream >> header.flags;
+
+    if(header.flags & eHeaderFlagStartPosition)
+    {
+        stream >> header.latStart >> header.lonStart;
+    }
+
+    if(header.flags & eHeaderFlagStartZoomLevel)
+    {
+        stream >> header.zoomStart;
+    }
+
+    if(header.flags & eHeaderFlagLanguage)
+    {
+        stream >> header.language;
+    }
+
+    if(header.flags & eHeaderFlagComment)
+    {
+        stream >> header.comment;
+    }
+
+    if(header.flags & eHeaderFlagCreator)
+    {
+        stream >> header.creator;
+    }
+
+    quint16 size;
+    utf8 tag;
+    stream >> size;
+    for(int i = 0; i < size; i++)
+    {
+        stream >> tag;
+        header.tagsPOIs << tag;
+    }
+    stream >> size;
+    for(int i = 0; i < size; i++)
+    {
+        stream >> tag;
+        header.tagsWays << tag;
+    }
+
+
+    quint8 N;
+    stream >> N;
+    for(int i = 0; i < N; i++)
+    {
+        layer_t layer;
+        stream >> layer.baseZoom;
+        stream >> layer.minZoom;
+        stream >> layer.maxZoom;
+        stream >> layer.offsetSubFile;
+        stream >> layer.sizeSubFile;
+
+        layers << layer;
+    }
+    // ---------- end file header ----------------------
+
+    if(stream.status() != QDataStream::Ok || layers.isEmpty())
+    {
+        throw exce_t(errFormat, tr("Bad file format: ") + filename);
+    }
+
+    // split the tag tables into key and value for the render theme
+    for(const QString& tag : qAsConst(header.tagsPOIs))
+    {
+        tagTablePOIs << CMapsforgeTheme::tag_t {tag.section('=', 0, 0), tag.section('=', 1)};
+    }
+    for(const QString& tag : qAsConst(header.tagsWays))
+    {
+        tagTableWays << CMapsforgeTheme::tag_t {tag.section('=', 0, 0), tag.section('=', 1)};
+    }
+
+    // the tile index of each sub-file covers the map's bounding box at the base zoom level
+    for(layer_t& layer : layers)
+    {
+        layer.tileX1 = lon2tile(INT_TO_DEG(header.minLon), layer.baseZoom);
+        layer.tileX2 = lon2tile(INT_TO_DEG(header.maxLon), layer.baseZoom);
+        layer.tileY1 = lat2tile(INT_TO_DEG(header.maxLat), layer.baseZoom);
+        layer.tileY2 = lat2tile(INT_TO_DEG(header.minLat), layer.baseZoom);
+        layer.offsetIndex = layer.offsetSubFile + ((header.flags & eHeaderFlagDebugInfo) ? SIZE_INDEX_SIGNATURE : 0);
+
+        const quint64 nTiles = quint64(layer.tileX2 - layer.tileX1 + 1) * (layer.tileY2 - layer.tileY1 + 1);
+        if(layer.offsetSubFile + layer.sizeSubFile > quint64(file.size()) || (layer.offsetIndex - layer.offsetSubFile) + nTiles * SIZE_INDEX_ENTRY > layer.sizeSubFile)
+        {
+            throw exce_t(errFormat, tr("Bad file format: ") + filename);
+        }
+
+        qDebug() << "MAP: zoom" << layer.minZoom << layer.baseZoom << layer.maxZoom << "tiles" << nTiles;
+    }
+
+    // all tiles are read directly from memory
+    sizeData = file.size();
+    data = file.map(0, sizeData);
+    if(data == nullptr)
+    {
+        throw exce_t(eErrAccess, tr("Failed to access: ") + filename);
+    }
+}
+
+qint32 CMapsforgeFile::findLayer(quint8 zoom) const
+{
+    qint32 idxMin = 0;
+    qint32 idxMax = 0;
+    for(qint32 i = 0; i < layers.count(); i++)
+    {
+        const layer_t& layer = layers[i];
+        if(zoom >= layer.minZoom && zoom <= layer.maxZoom)
+        {
+            return i;
+        }
+
+        if(layer.minZoom < layers[idxMin].minZoom)
+        {
+            idxMin = i;
+        }
+        if(layer.maxZoom > layers[idxMax].maxZoom)
+        {
+            idxMax = i;
+        }
+    }
+
+    // out of all zoom intervals, use the closest one
+    return zoom < layers[idxMin].minZoom ? idxMin : idxMax;
+}
+
+bool CMapsforgeFile::findTiles(const layer_t& layer, const QRectF& area, quint32& x1, quint32& y1, quint32& x2, quint32& y2) const
+{
+    const QRectF& rect = area.normalized().intersected(getBoundingBox());
+    if(rect.isEmpty())
+    {
+        return false;
+    }
+
+    x1 = qMax(layer.tileX1, lon2tile(rect.left() * RAD_TO_DEG, layer.baseZoom));
+    x2 = qMin(layer.tileX2, lon2tile(rect.right() * RAD_TO_DEG, layer.baseZoom));
+    y1 = qMax(layer.tileY1, lat2tile(rect.bottom() * RAD_TO_DEG, layer.baseZoom));
+    y2 = qMin(layer.tileY2, lat2tile(rect.top() * RAD_TO_DEG, layer.baseZoom));
+
+    return x1 <= x2 && y1 <= y2;
+}
+
+QSharedPointer<CMapsforgeFile::tile_t> CMapsforgeFile::decodeTile(const layer_t& layer, quint32 x, quint32 y, quint8 zoom) const
+{
+    QSharedPointer<tile_t> tile(new tile_t());
+
+    // the tile index entry: 1 bit water flag and 39 bit offset relative to the sub-file
+    const quint32 cols = layer.tileX2 - layer.tileX1 + 1;
+    const quint64 nTiles = quint64(cols) * (layer.tileY2 - layer.tileY1 + 1);
+    const quint64 idx = quint64(y - layer.tileY1) * cols + (x - layer.tileX1);
+
+    auto readIndex = [&](quint64 i) -> quint64
+    {
+        const uchar* p = data + layer.offsetIndex + i * SIZE_INDEX_ENTRY;
+        quint64 v = 0;
+        for(int n = 0; n < SIZE_INDEX_ENTRY; n++)
+        {
+            v = (v << 8) | p[n];
+        }
+        return v & INDEX_OFFSET_MASK;
+    };
+
+    const quint64 offset = readIndex(idx);
+    const quint64 end = (idx + 1 < nTiles) ? readIndex(idx + 1) : layer.sizeSubFile;
+    if(end <= offset || end > layer.sizeSubFile)
+    {
+        // empty tile
+        return tile;
+    }
+
+    CBlockReader reader(reinterpret_cast<const char*>(data + layer.offsetSubFile + offset), qint32(end - offset));
+    const bool hasDebugInfo = header.flags & eHeaderFlagDebugInfo;
+    if(hasDebugInfo)
+    {
+        reader.skip(SIZE_BLOCK_SIGNATURE);
+    }
+
+    // the zoom table holds the number of objects per zoom level. Objects of
+    // lower zoom levels are stored first. Thus the sum up to the requested
+    // zoom level is the number of objects to read.
+    const quint8 row = qBound(layer.minZoom, zoom, layer.maxZoom) - layer.minZoom;
+    quint64 nNodes = 0;
+    quint64 nWays = 0;
+    for(quint8 i = 0; i <= layer.maxZoom - layer.minZoom; i++)
+    {
+        const quint64 n1 = reader.readUIntX();
+        const quint64 n2 = reader.readUIntX();
+        if(i <= row)
+        {
+            nNodes += n1;
+            nWays += n2;
+        }
+    }
+
+    const quint64 offsetWays = reader.readUIntX();
+    const qint32 posWays = reader.getPos() + qint32(offsetWays);
+
+    // the offsets of the coordinates are relative to the tile's top left corner
+    const QPointF tileRef(tile2lon(x, layer.baseZoom), tile2lat(y, layer.baseZoom));
+
+    for(quint64 i = 0; i < nNodes && reader.isOk(); i++)
+    {
+        node_t node;
+        if(!decodeNode(reader, tileRef, node))
+        {
+            break;
+        }
+        tile->nodes << node;
+    }
+
+    reader.setPos(posWays);
+    for(quint64 i = 0; i < nWays && reader.isOk(); i++)
+    {
+        if(!decodeWay(reader, tileRef, tile->ways))
+        {
+            break;
+        }
+    }
+
+    if(!reader.isOk())
+    {
+        qWarning() << "MAP: failed to decode tile" << x << y << "at zoom" << layer.baseZoom;
+        tile->nodes.clear();
+        tile->ways.clear();
+        return tile;
+    }
+
+    tile->cost = qint32(sizeof(tile_t) + tile->nodes.count() * sizeof(node_t));
+    for(const way_t& way : qAsConst(tile->ways))
+    {
+        tile->cost += sizeof(way_t);
+        for(const QPolygonF& polygon : way.polygons)
+        {
+            tile->cost += polygon.count() * sizeof(QPointF);
+        }
+    }
+
+    return tile;
+}
+
+bool CMapsforgeFile::decodeTags(CBlockReader& reader, qint32 count, const QVector<CMapsforgeTheme::tag_t>& table, QVector<quint16>& tags) const
+{
+    tags.reserve(count);
+    for(qint32 i = 0; i < count; i++)
+    {
+        const quint64 id = reader.readUIntX();
+        if(id >= quint64(table.count()))
+        {
+            return false;
+        }
+        tags << quint16(id);
+
+        // since version 5 a tag can have a value stored with the object
+        const QString& value = table[int(id)].value;
+        if(header.version >= 5 && value.size() == 2 && value[0] == '%')
+        {
+            switch(value[1].toLatin1())
+            {
+            case 'b':
+                reader.skip(1);
+                break;
+
+            case 'h':
+                reader.skip(2);
+                break;
+
+            case 'i':
+            case 'f':
+                reader.skip(4);
+                break;
+
+            case 's':
+                reader.readString();
+                break;
+            }
+        }
+    }
+    return reader.isOk();
+}
+
+bool CMapsforgeFile::decodeNode(CBlockReader& reader, const QPointF& tileRef, node_t& node) const
+{
+    if(header.flags & eHeaderFlagDebugInfo)
+    {
+        reader.skip(SIZE_BLOCK_SIGNATURE);
+    }
+
+    const qreal lat = tileRef.y() + INT_TO_DEG(reader.readIntX());
+    const qreal lon = tileRef.x() + INT_TO_DEG(reader.readIntX());
+    node.pos = QPointF(lon, lat) * DEG_TO_RAD;
+
+    // upper nibble: layer, lower nibble: number of tags
+    const quint8 special = reader.readUInt8();
+    node.layer = special >> 4;
+    if(!decodeTags(reader, special & 0x0F, tagTablePOIs, node.tags))
+    {
+        return false;
+    }
+
+    const quint8 flags = reader.readUInt8();
+    if(flags & 0x80)
+    {
+        node.name = reader.readString().section('\r', 0, 0);
+    }
+    if(flags & 0x40)
+    {
+        node.houseNumber = reader.readString();
+    }
+    if(flags & 0x20)
+    {
+        node.ele = qint32(reader.readIntX());
+    }
+
+    return reader.isOk();
+}
+
+bool CMapsforgeFile::decodeWay(CBlockReader& reader, const QPointF& tileRef, QVector<way_t>& ways) const
+{
+    if(header.flags & eHeaderFlagDebugInfo)
+    {
+        reader.skip(SIZE_BLOCK_SIGNATURE);
+    }
+
+    const quint64 size = reader.readUIntX();
+    const qint32 posNext = reader.getPos() + qint32(size);
+
+    // skip the sub-tile bitmap, the viewport is used to filter
+    reader.skip(2);
+
+    way_t way;
+    const quint8 special = reader.readUInt8();
+    way.layer = special >> 4;
+    if(!decodeTags(reader, special & 0x0F, tagTableWays, way.tags))
+    {
+        return false;
+    }
+
+    const quint8 flags = reader.readUInt8();
+    if(flags & 0x80)
+    {
+        way.name = reader.readString().section('\r', 0, 0);
+    }
+    if(flags & 0x40)
+    {
+        way.houseNumber = reader.readString();
+    }
+    if(flags & 0x20)
+    {
+        way.ref = reader.readString();
+    }
+
+    // the label position is relative to the first node
+    qint64 labelLat = 0;
+    qint64 labelLon = 0;
+    const bool hasLabelPos = flags & 0x10;
+    if(hasLabelPos)
+    {
+        labelLat = reader.readIntX();
+        labelLon = reader.readIntX();
+    }
+
+    const quint64 nBlocks = (flags & 0x08) ? reader.readUIntX() : 1;
+    const bool doubleDelta = flags & 0x04;
+
+    for(quint64 b = 0; b < nBlocks && reader.isOk(); b++)
+    {
+        way_t wayBlock = way;
+
+        const quint64 nPolygons = reader.readUIntX();
+        for(quint64 n = 0; n < nPolygons && reader.isOk(); n++)
+        {
+            const quint64 nPoints = reader.readUIntX();
+            // each point needs at least two bytes
+            if(nPoints * 2 > quint64(posNext - reader.getPos()))
+            {
+                return false;
+            }
+
+            QPolygonF polygon(int(nPoints));
+            qint64 lat = 0;
+            qint64 lon = 0;
+            qint64 deltaLat = 0;
+            qint64 deltaLon = 0;
+            for(quint64 i = 0; i < nPoints; i++)
+            {
+                const qint64 dLat = reader.readIntX();
+                const qint64 dLon = reader.readIntX();
+                if(i == 0 || !doubleDelta)
+                {
+                    lat += dLat;
+                    lon += dLon;
+                }
+                else
+                {
+                    deltaLat += dLat;
+                    deltaLon += dLon;
+                    lat += deltaLat;
+                    lon += deltaLon;
+                }
+
+                polygon[int(i)] = QPointF(tileRef.x() + INT_TO_DEG(lon), tileRef.y() + INT_TO_DEG(lat)) * DEG_TO_RAD;
+            }
+
+            if(n == 0 && b == 0 && hasLabelPos && nPoints)
+            {
+                wayBlock.labelPos = polygon.first() + QPointF(INT_TO_RAD(labelLon), INT_TO_RAD(labelLat));
+            }
+
+            wayBlock.polygons << polygon;
+        }
+
+        if(!wayBlock.polygons.isEmpty() && wayBlock.polygons.first().count() > 1)
+        {
+            const QPolygonF& outer = wayBlock.polygons.first();
+            wayBlock.isClosed = outer.first() == outer.last();
+            ways << wayBlock;
+        }
+    }
+
+    reader.setPos(posNext);
+    return reader.isOk();
+}
@@ -0,0 +1,236 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CMAPSFORGEFILE_H
+#define CMAPSFORGEFILE_H
+
+#include "map/mapsforge/CMapsforgeTheme.h"
+#include "map/mapsforge/types.h"
+#include "units/IUnit.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QList>
+#include <QPolygonF>
+#include <QSharedPointer>
+
+/**
+   @brief Read access to a Mapsforge vector map file (*.map)
+
+   The map file is memory mapped. For each zoom interval (sub-file) the tile
+   index is used to find the tiles covering a viewport. The tiles are decoded
+   into vector data with all coordinates in [rad].
+
+   This class has no dependencies to the map rendering. Thus it can be used
+   standalone, e.g. to benchmark the decoding.
+ */
+class CMapsforgeFile
+{
+    Q_DECLARE_TR_FUNCTIONS(CMapsforgeFile)
+public:
+    enum exce_e {eErrOpen, eErrAccess, errFormat, errAbort};
+    struct exce_t
+    {
+        exce_t(exce_e err, const QString& msg) : err(err), msg(msg)
+        {
+        }
+        exce_e err;
+        QString msg;
+    };
+
+    struct layer_t
+    {
+        quint8 baseZoom;
+        quint8 minZoom;
+        quint8 maxZoom;
+        quint64 offsetSubFile;
+        quint64 sizeSubFile;
+
+        /// the range of tiles at the base zoom level covering the map
+        quint32 tileX1 = 0;
+        quint32 tileY1 = 0;
+        quint32 tileX2 = 0;
+        quint32 tileY2 = 0;
+        /// absolute offset of the tile index
+        quint64 offsetIndex = 0;
+    };
+
+    /// a point of interest
+    struct node_t
+    {
+        /// position in [rad]
+        QPointF pos;
+        quint8 layer = 0;
+        /// ids into the POI tag table
+        QVector<quint16> tags;
+        QString name;
+        QString houseNumber;
+        qint32 ele = NOINT;
+    };
+
+    /// a line or a polygon, the first polygon is the outer one, all others are holes
+    struct way_t
+    {
+        quint8 layer = 0;
+        /// ids into the way tag table
+        QVector<quint16> tags;
+        QString name;
+        QString houseNumber;
+        QString ref;
+        /// optional position for labels in [rad], NOPOINTF if not set
+        QPointF labelPos = QPointF(NOFLOAT, NOFLOAT);
+        /// coordinates in [rad]
+        QVector<QPolygonF> polygons;
+        bool isClosed = false;
+    };
+
+    /// the content of a tile for a zoom level
+    struct tile_t
+    {
+        QVector<node_t> nodes;
+        QVector<way_t> ways;
+        /// approximate memory usage, the cost in the tile cache
+        qint32 cost = 0;
+    };
+
+    CMapsforgeFile(const QString& filename);
+    virtual ~CMapsforgeFile();
+
+    /**
+       @brief Read the file header and map the file into memory
+
+       Throws exce_t on errors.
+     */
+    void open();
+
+    const QList<layer_t>& getLayers() const
+    {
+        return layers;
+    }
+
+    /// the area covered by the map in [rad]
+    QRectF getBoundingBox() const
+    {
+        return QRectF(ref1, ref2).normalized();
+    }
+
+    const QVector<CMapsforgeTheme::tag_t>& getTagTablePOIs() const
+    {
+        return tagTablePOIs;
+    }
+
+    const QVector<CMapsforgeTheme::tag_t>& getTagTableWays() const
+    {
+        return tagTableWays;
+    }
+
+    /// get the index of the layer to use for a zoom level
+    qint32 findLayer(quint8 zoom) const;
+
+    /**
+       @brief Get the range of tiles of a layer covering an area
+
+       @param layer     the sub-file
+       @param area      the area in [rad]
+       @param x1        first tile column
+       @param y1        first tile row
+       @param x2        last tile column
+       @param y2        last tile row
+       @return Return false if the area does not intersect with the map.
+     */
+    bool findTiles(const layer_t& layer, const QRectF& area, quint32& x1, quint32& y1, quint32& x2, quint32& y2) const;
+
+    /**
+       @brief Decode a tile
+
+       This is thread safe as it only reads the mapped file and the header.
+
+       @param layer     the sub-file the tile belongs to
+       @param x         tile column at the layer's base zoom level
+       @param y         tile row at the layer's base zoom level
+       @param zoom      the zoom level to read the objects for
+       @return The decoded tile. On errors the tile is empty.
+     */
+    QSharedPointer<tile_t> decodeTile(const layer_t& layer, quint32 x, quint32 y, quint8 zoom) const;
+
+private:
+    enum header_flags_e
+    {
+        eHeaderFlagDebugInfo = 0x80
+        , eHeaderFlagStartPosition = 0x40
+        , eHeaderFlagStartZoomLevel = 0x20
+        , eHeaderFlagLanguage = 0x10
+        , eHeaderFlagComment = 0x08
+        , eHeaderFlagCreator = 0x04
+    };
+
+    struct header_t
+    {
+        header_t() : latStart(0), lonStart(0), zoomStart(0)
+        {
+        }
+        char signature[20];
+        quint32 sizeHeader = 0;
+        quint32 version = 0;
+        quint64 sizeFile = 0;
+        quint64 timestamp = 0;
+        qint32 minLat = 0;
+        qint32 minLon = 0;
+        qint32 maxLat = 0;
+        qint32 maxLon = 0;
+        quint16 sizeTile = 0;
+        utf8 projection;
+        quint8 flags = 0;
+        // optional fields
+        qint32 latStart;
+        qint32 lonStart;
+        quint8 zoomStart;
+        utf8 language;
+        utf8 comment;
+        utf8 creator;
+
+        QStringList tagsPOIs;
+        QStringList tagsWays;
+    };
+
+    bool decodeNode(CBlockReader& reader, const QPointF& tileRef, node_t& node) const;
+    bool decodeWay(CBlockReader& reader, const QPointF& tileRef, QVector<way_t>& ways) const;
+    bool decodeTags(CBlockReader& reader, qint32 count, const QVector<CMapsforgeTheme::tag_t>& table, QVector<quint16>& tags) const;
+
+    QString filename;
+
+    /// the complete map file mapped into memory
+    QFile file;
+    const uchar* data = nullptr;
+    quint64 sizeData = 0;
+
+    header_t header;
+    QList<layer_t> layers;
+
+    /// the header's tag tables split into key and value for the render theme
+    QVector<CMapsforgeTheme::tag_t> tagTablePOIs;
+    QVector<CMapsforgeTheme::tag_t> tagTableWays;
+
+    /// top left point of the map
+    QPointF ref1;
+    /// bottom right point of the map
+    QPointF ref2;
+};
+
+#endif //CMAPSFORGEFILE_H
+
@@ -0,0 +1,301 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "map/mapsforge/CMapsforgeTheme.h"
+
+#include <QtGui>
+#include <QtXml>
+
+/// Mapsforge increases stroke widths by this factor per zoom level above 12
+#define STROKE_INCREASE     1.5
+#define STROKE_MIN_ZOOM     12
+
+bool CMapsforgeTheme::load(const QString& filename)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "MAP: failed to open render theme" << filename;
+        return false;
+    }
+
+    QDomDocument dom;
+    QString msg;
+    int line;
+    int column;
+    if(!dom.setContent(&file, false, &msg, &line, &column))
+    {
+        qWarning() << "MAP: failed to read render theme" << filename << msg << line << column;
+        return false;
+    }
+
+    const QDomElement& xmlTheme = dom.documentElement();
+    if(xmlTheme.tagName() != "rendertheme")
+    {
+        qWarning() << "MAP: not a render theme" << filename;
+        return false;
+    }
+
+    rules.clear();
+    instructions.clear();
+    cache.clear();
+
+    background = QColor(xmlTheme.attribute("map-background", "#ffffff"));
+
+    // symbols are relative to the theme file
+    const QString& path = QFileInfo(filename).absolutePath();
+
+    const QDomNodeList& xmlRules = xmlTheme.childNodes();
+    for(int i = 0; i < xmlRules.count(); i++)
+    {
+        const QDomElement& xmlRule = xmlRules.at(i).toElement();
+        if(xmlRule.tagName() == "rule")
+        {
+            rule_t rule;
+            parseRule(xmlRule, rule, path);
+            rules << rule;
+        }
+    }
+
+    qDebug() << "MAP: render theme" << filename << "with" << instructions.count() << "instructions";
+    return true;
+}
+
+void CMapsforgeTheme::parseRule(const QDomElement& xml, rule_t& rule, const QString& path)
+{
+    const QString& e = xml.attribute("e", "any");
+    rule.element = e == "node" ? rule_t::eNode : e == "way" ? rule_t::eWay : rule_t::eAny;
+
+    const QString& closed = xml.attribute("closed", "any");
+    rule.closed = closed == "yes" ? rule_t::eClosedYes : closed == "no" ? rule_t::eClosedNo : rule_t::eClosedAny;
+
+    rule.keys = xml.attribute("k", "*").split("|");
+    rule.values = xml.attribute("v", "*").split("|");
+    rule.zoomMin = xml.attribute("zoom-min", "0").toUInt();
+    rule.zoomMax = xml.attribute("zoom-max", "127").toUInt();
+
+    const QDomNodeList& xmlChildren = xml.childNodes();
+    for(int i = 0; i < xmlChildren.count(); i++)
+    {
+        const QDomElement& xmlChild = xmlChildren.at(i).toElement();
+        if(xmlChild.isNull())
+        {
+            continue;
+        }
+
+        if(xmlChild.tagName() == "rule")
+        {
+            rule_t child;
+            parseRule(xmlChild, child, path);
+            rule.children << child;
+        }
+        else
+        {
+            parseInstruction(xmlChild, rule, path);
+        }
+    }
+}
+
+void CMapsforgeTheme::parseInstruction(const QDomElement& xml, rule_t& rule, const QString& path)
+{
+    const QString& tag = xml.tagName();
+
+    instr_t instr;
+    instr.level = instructions.count();
+
+    if(tag == "area" || tag == "line" || tag == "circle")
+    {
+        if(tag == "area")
+        {
+            instr.type = instr_t::eArea;
+        }
+        else if(tag == "line")
+        {
+            instr.type = instr_t::eLine;
+        }
+        else
+        {
+            instr.type = instr_t::eCircle;
+            instr.radius = xml.attribute("radius", xml.attribute("r", "4")).toDouble();
+        }
+
+        if(xml.hasAttribute("fill"))
+        {
+            instr.brush = QBrush(QColor(xml.attribute("fill")));
+        }
+
+        if(xml.hasAttribute("stroke"))
+        {
+            instr.strokeWidth = xml.attribute("stroke-width", "1").toDouble();
+            instr.pen = QPen(QColor(xml.attribute("stroke")), instr.strokeWidth);
+
+            const QString& cap = xml.attribute("stroke-linecap", "round");
+            instr.pen.setCapStyle(cap == "butt" ? Qt::FlatCap : cap == "square" ? Qt::SquareCap : Qt::RoundCap);
+            const QString& join = xml.attribute("stroke-linejoin", "round");
+            instr.pen.setJoinStyle(join == "miter" ? Qt::MiterJoin : join == "bevel" ? Qt::BevelJoin : Qt::RoundJoin);
+
+            const QStringList& dashes = xml.attribute("stroke-dasharray").split(",", QString::SkipEmptyParts);
+            for(const QString& dash : dashes)
+            {
+                instr.dashes << dash.trimmed().toDouble();
+            }
+        }
+    }
+    else if(tag == "symbol")
+    {
+        instr.type = instr_t::eSymbol;
+
+        QString src = xml.attribute("src");
+        src.remove(QRegExp("^file:"));
+        if(QFileInfo(src).isRelative())
+        {
+            src = QDir(path).absoluteFilePath(src);
+        }
+
+        instr.symbol = QImage(src);
+        if(instr.symbol.isNull())
+        {
+            qDebug() << "MAP: failed to load symbol" << src;
+            return;
+        }
+
+        if(xml.hasAttribute("symbol-width") || xml.hasAttribute("symbol-height"))
+        {
+            const int w = xml.attribute("symbol-width", "0").toInt();
+            const int h = xml.attribute("symbol-height", "0").toInt();
+            instr.symbol = w && h ? instr.symbol.scaled(w, h, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                           : w ? instr.symbol.scaledToWidth(w, Qt::SmoothTransformation)
+                           : instr.symbol.scaledToHeight(h, Qt::SmoothTransformation);
+        }
+    }
+    else if(tag == "caption" || tag == "pathText")
+    {
+        instr.type = tag == "caption" ? instr_t::eCaption : instr_t::ePathText;
+        instr.key = xml.attribute("k", "name");
+        instr.dy = xml.attribute("dy", "0").toDouble();
+        instr.fill = QColor(xml.attribute("fill", "#000000"));
+        instr.stroke = QColor(xml.attribute("stroke", "#ffffff"));
+
+        const QString& style = xml.attribute("font-style", "normal");
+        instr.font = QFont();
+        instr.font.setPixelSize(qRound(xml.attribute("font-size", "12").toDouble()));
+        instr.font.setBold(style.contains("bold"));
+        instr.font.setItalic(style.contains("italic"));
+    }
+    else
+    {
+        // not part of the supported subset
+        return;
+    }
+
+    rule.instructions << instructions.count();
+    instructions << instr;
+}
+
+const QVector<qint32>& CMapsforgeTheme::match(const QVector<quint16>& tags, const QVector<tag_t>& table, bool isWay, bool isClosed, quint8 zoom)
+{
+    QByteArray key(reinterpret_cast<const char*>(tags.constData()), tags.count() * sizeof(quint16));
+    key += char(isWay);
+    key += char(isClosed);
+    key += char(zoom);
+
+    auto it = cache.find(key);
+    if(it != cache.end())
+    {
+        return *it;
+    }
+
+    QVector<qint32> result;
+    for(const rule_t& rule : qAsConst(rules))
+    {
+        matchRule(rule, tags, table, isWay, isClosed, zoom, result);
+    }
+    std::sort(result.begin(), result.end());
+
+    return *cache.insert(key, result);
+}
+
+bool CMapsforgeTheme::matchRule(const rule_t& rule, const QVector<quint16>& tags, const QVector<tag_t>& table, bool isWay, bool isClosed, quint8 zoom, QVector<qint32>& result) const
+{
+    if(zoom < rule.zoomMin || zoom > rule.zoomMax)
+    {
+        return false;
+    }
+
+    if((rule.element == rule_t::eNode && isWay) || (rule.element == rule_t::eWay && !isWay))
+    {
+        return false;
+    }
+
+    if((rule.closed == rule_t::eClosedYes && !isClosed) || (rule.closed == rule_t::eClosedNo && isClosed))
+    {
+        return false;
+    }
+
+    /*
+        "*" matches any key or value. "~" as value matches objects without
+        any of the keys. "-" as value inverts the rule: it matches objects
+        without a tag of the listed keys and values.
+     */
+    const bool anyKey = rule.keys.contains("*");
+    const bool anyValue = rule.values.contains("*");
+    if(!(anyKey && anyValue))
+    {
+        bool hasKey = false;
+        bool hasMatch = false;
+        for(quint16 id : tags)
+        {
+            const tag_t& tag = table[id];
+            if(anyKey || rule.keys.contains(tag.key))
+            {
+                hasKey = true;
+                if(anyValue || rule.values.contains(tag.value))
+                {
+                    hasMatch = true;
+                    break;
+                }
+            }
+        }
+
+        if(rule.values.contains("-"))
+        {
+            hasMatch = !hasMatch;
+        }
+        else if(!hasKey && rule.values.contains("~"))
+        {
+            hasMatch = true;
+        }
+
+        if(!hasMatch)
+        {
+            return false;
+        }
+    }
+
+    result += rule.instructions;
+    for(const rule_t& child : rule.children)
+    {
+        matchRule(child, tags, table, isWay, isClosed, zoom, result);
+    }
+    return true;
+}
+
+qreal CMapsforgeTheme::strokeScale(quint8 zoom)
+{
+    return qPow(STROKE_INCREASE, qMax(0, zoom - STROKE_MIN_ZOOM));
+}
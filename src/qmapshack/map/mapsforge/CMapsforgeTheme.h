@@ -0,0 +1,147 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CMAPSFORGETHEME_H
+#define CMAPSFORGETHEME_H
+
+#include <QBrush>
+#include <QCoreApplication>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QPen>
+#include <QVector>
+
+class QDomElement;
+
+/**
+   @brief A subset of the Mapsforge XML render theme
+
+   Supported are nested <rule> elements with the attributes e, k, v, closed,
+   zoom-min and zoom-max and the render instructions <area>, <line>, <circle>,
+   <symbol>, <caption> and <pathText>. All other elements are ignored.
+
+   The instructions of a rule apply if the rule and all it's parents match.
+   The order of the instructions in the theme is the drawing order. As the
+   matching is expensive the result is cached for each combination of tags,
+   zoom level and element type.
+
+   An object of this class must not be shared between threads.
+ */
+class CMapsforgeTheme
+{
+    Q_DECLARE_TR_FUNCTIONS(CMapsforgeTheme)
+public:
+    /// a key/value pair from the map file's tag tables
+    struct tag_t
+    {
+        QString key;
+        QString value;
+    };
+
+    struct instr_t
+    {
+        enum type_e {eArea, eLine, eCircle, eSymbol, eCaption, ePathText};
+        type_e type = eArea;
+        /// the instruction's index in the theme, used as drawing order
+        qint32 level = 0;
+
+        QPen pen = Qt::NoPen;
+        QBrush brush = Qt::NoBrush;
+        /// stroke width at zoom level 12 and below
+        qreal strokeWidth = 0;
+        QVector<qreal> dashes;
+
+        qreal radius = 0;
+        QImage symbol;
+
+        /// caption and path text: the tag to display, e.g. name, ref or ele
+        QString key;
+        QFont font;
+        QColor fill = Qt::black;
+        QColor stroke = Qt::white;
+        qreal dy = 0;
+    };
+
+    CMapsforgeTheme() = default;
+    virtual ~CMapsforgeTheme() = default;
+
+    /**
+       @brief Load a render theme
+
+       @param filename  the XML file, resources are allowed
+       @return Return false if the file could not be read. The previous theme is kept in that case.
+     */
+    bool load(const QString& filename);
+
+    const QColor& getBackground() const
+    {
+        return background;
+    }
+
+    /**
+       @brief Get all instructions matching an object
+
+       @param tags      the object's tag ids
+       @param table     the tag table the ids refer to
+       @param isWay     true for ways, false for nodes (POIs)
+       @param isClosed  true for closed ways
+       @param zoom      the current zoom level
+       @return A list of indices into getInstructions(), sorted by level
+     */
+    const QVector<qint32>& match(const QVector<quint16>& tags, const QVector<tag_t>& table, bool isWay, bool isClosed, quint8 zoom);
+
+    const QVector<instr_t>& getInstructions() const
+    {
+        return instructions;
+    }
+
+    /// the factor to scale stroke widths with at a zoom level
+    static qreal strokeScale(quint8 zoom);
+
+private:
+    struct rule_t
+    {
+        enum element_e {eAny, eNode, eWay};
+        enum closed_e {eClosedAny, eClosedYes, eClosedNo};
+
+        element_e element = eAny;
+        closed_e closed = eClosedAny;
+        QStringList keys;
+        QStringList values;
+        quint8 zoomMin = 0;
+        quint8 zoomMax = 127;
+
+        QVector<qint32> instructions;
+        QVector<rule_t> children;
+    };
+
+    void parseRule(const QDomElement& xml, rule_t& rule, const QString& path);
+    void parseInstruction(const QDomElement& xml, rule_t& rule, const QString& path);
+    bool matchRule(const rule_t& rule, const QVector<quint16>& tags, const QVector<tag_t>& table, bool isWay, bool isClosed, quint8 zoom, QVector<qint32>& result) const;
+
+    QColor background = Qt::white;
+    QVector<rule_t> rules;
+    QVector<instr_t> instructions;
+
+    /// cache of match() results
+    QHash<QByteArray, QVector<qint32> > cache;
+};
+
+#endif //CMAPSFORGETHEME_H
+
@@ -72,3 +72,68 @@ QDataStream& operator>>(QDataStream& s, utf8& v)
 
     return s;
 }
+
+qint16 CBlockReader::readInt16()
+{
+    quint16 v = quint16(readUInt8()) << 8;
+    v |= readUInt8();
+    return qint16(v);
+}
+
+qint32 CBlockReader::readInt32()
+{
+    quint32 v = 0;
+    for(int i = 0; i < 4; i++)
+    {
+        v = (v << 8) | readUInt8();
+    }
+    return qint32(v);
+}
+
+quint64 CBlockReader::readUIntX()
+{
+    quint64 v = 0;
+    int shift = 0;
+
+    quint8 tmp = readUInt8();
+    while((tmp & 0x80) && ok)
+    {
+        v |= quint64(tmp & 0x7F) << shift;
+        shift += 7;
+        tmp = readUInt8();
+    }
+
+    return v | (quint64(tmp) << shift);
+}
+
+qint64 CBlockReader::readIntX()
+{
+    qint64 v = 0;
+    int shift = 0;
+
+    quint8 tmp = readUInt8();
+    while((tmp & 0x80) && ok)
+    {
+        v |= qint64(tmp & 0x7F) << shift;
+        shift += 7;
+        tmp = readUInt8();
+    }
+
+    // the 2nd most significant bit of the last byte is the sign
+    v |= qint64(tmp & 0x3F) << shift;
+    return (tmp & 0x40) ? -v : v;
+}
+
+QString CBlockReader::readString()
+{
+    const qint32 len = qint32(readUIntX());
+    if(!ok || len < 0 || len > size - pos)
+    {
+        ok = false;
+        return QString();
+    }
+
+    const QString& str = QString::fromUtf8(data + pos, len);
+    pos += len;
+    return str;
+}
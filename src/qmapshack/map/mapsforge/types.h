@@ -58,5 +58,71 @@ extern QDataStream& operator>>(QDataStream& s, uintX& v);
 extern QDataStream& operator>>(QDataStream& s, intX& v);
 extern QDataStream& operator>>(QDataStream& s, utf8& v);
 
+/**
+   @brief Decode the Mapsforge data types from a memory block
+
+   QDataStream is too slow to decode the many small numbers of a tile's
+   content. This reader works on a plain pointer. Reading beyond the end
+   of the block returns zero values and sets the error flag. The caller
+   has to check isOk() after decoding a block.
+ */
+class CBlockReader
+{
+public:
+    CBlockReader(const char* data, qint32 size) : data(data), size(size)
+    {
+    }
+
+    bool isOk() const
+    {
+        return ok;
+    }
+
+    qint32 getPos() const
+    {
+        return pos;
+    }
+
+    void setPos(qint32 p)
+    {
+        if(p < 0 || p > size)
+        {
+            ok = false;
+            return;
+        }
+        pos = p;
+    }
+
+    void skip(qint32 n)
+    {
+        setPos(pos + n);
+    }
+
+    quint8 readUInt8()
+    {
+        if(pos >= size)
+        {
+            ok = false;
+            return 0;
+        }
+        return quint8(data[pos++]);
+    }
+
+    qint16 readInt16();
+    qint32 readInt32();
+    /// variable byte encoded unsigned integer
+    quint64 readUIntX();
+    /// variable byte encoded signed integer
+    qint64 readIntX();
+    /// variable byte encoded length followed by the UTF-8 string
+    QString readString();
+
+private:
+    const char* data;
+    qint32 size;
+    qint32 pos = 0;
+    bool ok = true;
+};
+
 #endif //TYPES_H
 
@@ -71,6 +71,7 @@ void CMouseEditArea::slotCopyToOrig()
 void CMouseEditArea::slotCopyToNew()
 {
     canvas->reportStatus(key.item, "");
+    finishRouting();
 
     if(points.size() < 3)
     {
@@ -86,6 +86,7 @@ void CMouseEditTrk::slotCopyToOrig()
 void CMouseEditTrk::slotCopyToNew()
 {
     canvas->reportStatus(key.item, "");
+    finishRouting();
 
     if(points.size() < 2)
     {
@@ -54,6 +54,7 @@ CMouseSelect::CMouseSelect(CGisDraw* gis, CCanvas* canvas, CMouseAdapter* mouse)
     connect(scrOptSelect->toolActivityTrk, &QToolButton::clicked, this, &CMouseSelect::slotActivityTrk);
     connect(scrOptSelect->toolColorTrk, &QToolButton::clicked, this, &CMouseSelect::slotColorTrk);
     connect(scrOptSelect->toolDelete, &QToolButton::clicked, this, &CMouseSelect::slotDelete);
+    connect(scrOptSelect->toolSeedCache, &QToolButton::clicked, this, &CMouseSelect::slotSeedCache);
 }
 
 CMouseSelect::~CMouseSelect()
@@ -159,7 +160,7 @@ void CMouseSelect::findItems(QList<IGisItem*>& items)
         modeLastSel = modeSelection;
     }
 
-    scrOptSelect->frameFunction->setDisabled(items.isEmpty() && poisFound.isEmpty());
+    scrOptSelect->toolCopy->setDisabled(items.isEmpty() && poisFound.isEmpty());
     scrOptSelect->toolDelete->setDisabled(items.isEmpty());
     scrOptSelect->toolSymWpt->setEnabled(cntWpt);
     scrOptSelect->toolRoute->setEnabled(cntWpt > 1);
@@ -225,6 +226,13 @@ void CMouseSelect::slotDelete() const
     canvas->resetMouse();
 }
 
+void CMouseSelect::slotSeedCache() const
+{
+    QMutexLocker lock(&mutex);
+    canvas->seedMapCache(rectSelection);
+    canvas->resetMouse();
+}
+
 void CMouseSelect::slotRoute() const
 {
     QMutexLocker lock(&mutex);
@@ -47,6 +47,7 @@ private slots:
     void slotActivityTrk() const;
     void slotColorTrk() const;
     void slotDelete() const;
+    void slotSeedCache() const;
 
 private:
     /**
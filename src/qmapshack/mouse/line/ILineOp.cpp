@@ -22,7 +22,6 @@
 #include "gis/CGisDraw.h"
 #include "gis/CGisWorkspace.h"
 #include "gis/GeoMath.h"
-#include "gis/rte/router/CRouterSetup.h"
 #include "mouse/line/ILineOp.h"
 #include "mouse/line/IMouseEditLine.h"
 
@@ -232,6 +231,9 @@ void ILineOp::cancelDelayedRouting()
 
 void ILineOp::startDelayedRouting()
 {
+    // results for legs of the old position are of no use anymore
+    parentHandler->cancelSupersededRouting();
+
     if(parentHandler->useAutoRouting())
     {
         timerRouting->start();
@@ -380,30 +382,6 @@ void ILineOp::showRoutingErrorMessage(const QString& msg) const
     }
 }
 
-void ILineOp::tryRouting(IGisLine::point_t& pt1, IGisLine::point_t& pt2) const
-{
-    QPolygonF subs;
-
-    try
-    {
-        if(CRouterSetup::self().calcRoute(pt1.coord, pt2.coord, subs) >= 0)
-        {
-            pt1.subpts.clear();
-            for(const QPointF& sub : qAsConst(subs))
-            {
-                pt1.subpts << IGisLine::subpt_t(sub);
-            }
-        }
-        showRoutingErrorMessage(QString());
-    }
-    catch(const QString& msg)
-    {
-        showRoutingErrorMessage(msg);
-    }
-    // that is a workaround for canvas loosing mouse tracking caused by CProgressDialog being modal:
-    canvas->setMouseTracking(true);
-}
-
 void ILineOp::finalizeOperation(qint32 idx)
 {
     if(idx == NOIDX)
@@ -413,15 +391,8 @@ void ILineOp::finalizeOperation(qint32 idx)
 
     if(parentHandler->useAutoRouting())
     {
-        CCanvasCursorLock cursorLock(Qt::WaitCursor, __func__);
-        if(idx > 0)
-        {
-            tryRouting(points[idx - 1], points[idx]);
-        }
-        if(idx < (points.size() - 1))
-        {
-            tryRouting(points[idx], points[idx + 1]);
-        }
+        // both legs are routed in the background and applied as soon as they are ready
+        parentHandler->routeLegs({idx - 1, idx});
     }
     else if(parentHandler->useVectorRouting() || parentHandler->useTrackRouting())
     {
@@ -117,8 +117,6 @@ protected:
     QPolygonF subLinePixel2;
 
 private:
-    void tryRouting(IGisLine::point_t& pt1, IGisLine::point_t& pt2) const;
-
     QTimer* timerRouting;
     QTime buttonPressTime;
 
@@ -23,6 +23,7 @@
 #include "gis/GeoMath.h"
 #include "gis/IGisLine.h"
 #include "gis/rte/router/CRouterOptimization.h"
+#include "gis/rte/router/CRouterSetup.h"
 #include "gis/trk/CGisItemTrk.h"
 #include "helpers/CDraw.h"
 #include "helpers/CSettings.h"
@@ -69,6 +70,11 @@ IMouseEditLine::IMouseEditLine(const IGisItem::key_t& key, IGisLine& src, bool e
 
 IMouseEditLine::~IMouseEditLine()
 {
+    for(qint32 id : routingRequests.keys())
+    {
+        CRouterSetup::self().cancelRoutesAsync(id);
+    }
+
     canvas->reportStatus("IMouseEditLine", "");
     canvas->reportStatus(key.item, "");
     canvas->reportStatus("Optimization", "");
@@ -121,6 +127,9 @@ void IMouseEditLine::commonSetup()
     connect(scrOptEditLine->toolUndo, &QPushButton::clicked, this, &IMouseEditLine::slotUndo         );
     connect(scrOptEditLine->toolRedo, &QPushButton::clicked, this, &IMouseEditLine::slotRedo         );
 
+    connect(&CRouterSetup::self(), &CRouterSetup::sigRouteLegFinished, this, &IMouseEditLine::slotRouteLegFinished);
+    connect(&CRouterSetup::self(), &CRouterSetup::sigRoutesFinished, this, &IMouseEditLine::slotRoutesFinished);
+
     SETTINGS;
     int mode = cfg.value("Route/drawMode", 0).toInt();
     switch(mode)
@@ -415,6 +424,8 @@ void IMouseEditLine::slotAbortEx(bool showMB)
 
 void IMouseEditLine::slotCopyToOrig()
 {
+    finishRouting();
+
     QMutexLocker lock(&IGisItem::mutexItems);
 
     IGisLine* line = getGisLine();
@@ -429,6 +440,165 @@ void IMouseEditLine::slotCopyToOrig()
     canvas->slotTriggerCompleteUpdate(CCanvas::eRedrawGis);
 }
 
+bool IMouseEditLine::applyLeg(SGisLine& line, const IRouter::leg_t& leg)
+{
+    auto isLeg = [&](qint32 i)
+    {
+        return (i >= 0) && (i < (line.size() - 1)) && (line[i].coord == leg.p1) && (line[i + 1].coord == leg.p2);
+    };
+
+    qint32 idx = leg.idx;
+    if(!isLeg(idx))
+    {
+        // points might have been added or removed in front of the leg
+        idx = NOIDX;
+        for(qint32 i = 0; i < (line.size() - 1); i++)
+        {
+            if(isLeg(i))
+            {
+                idx = i;
+                break;
+            }
+        }
+    }
+
+    if(idx == NOIDX)
+    {
+        return false;
+    }
+
+    if(leg.result >= 0)
+    {
+        IGisLine::point_t& pt1 = line[idx];
+        pt1.subpts.clear();
+        for(const QPointF& sub : leg.coords)
+        {
+            pt1.subpts << IGisLine::subpt_t(sub);
+        }
+    }
+    return true;
+}
+
+void IMouseEditLine::routeLegs(const QList<qint32>& idxs)
+{
+    cancelSupersededRouting();
+
+    QVector<IRouter::leg_t> legs;
+    for(qint32 idx : idxs)
+    {
+        if(idx < 0 || idx >= (points.size() - 1))
+        {
+            continue;
+        }
+
+        IRouter::leg_t leg;
+        leg.p1 = points[idx].coord;
+        leg.p2 = points[idx + 1].coord;
+        leg.idx = idx;
+        legs << leg;
+    }
+
+    if(legs.isEmpty())
+    {
+        return;
+    }
+
+    routingRequests[CRouterSetup::self().calcRoutesAsync(legs)] = legs;
+}
+
+void IMouseEditLine::cancelSupersededRouting()
+{
+    const QList<qint32>& ids = routingRequests.keys();
+    for(qint32 id : ids)
+    {
+        bool superseded = true;
+        for(const IRouter::leg_t& leg : routingRequests[id])
+        {
+            for(qint32 i = 0; superseded && (i < (points.size() - 1)); i++)
+            {
+                superseded = (points[i].coord != leg.p1) || (points[i + 1].coord != leg.p2);
+            }
+        }
+
+        if(superseded)
+        {
+            CRouterSetup::self().cancelRoutesAsync(id);
+            routingRequests.remove(id);
+        }
+    }
+}
+
+void IMouseEditLine::finishRouting()
+{
+    if(routingRequests.isEmpty())
+    {
+        return;
+    }
+
+    QVector<IRouter::leg_t> legs;
+    for(qint32 id : routingRequests.keys())
+    {
+        CRouterSetup::self().cancelRoutesAsync(id);
+        legs += routingRequests[id];
+    }
+    routingRequests.clear();
+
+    try
+    {
+        CRouterSetup::self().calcRoutes(legs, [](){return false; });
+        for(const IRouter::leg_t& leg : qAsConst(legs))
+        {
+            applyLeg(points, leg);
+        }
+    }
+    catch(const QString& msg)
+    {
+        lineOp->showRoutingErrorMessage(msg);
+    }
+    // that is a workaround for canvas loosing mouse tracking caused by CProgressDialog being modal:
+    canvas->setMouseTracking(true);
+}
+
+void IMouseEditLine::slotRouteLegFinished(qint32 id, const IRouter::leg_t& leg)
+{
+    if(!routingRequests.contains(id))
+    {
+        return;
+    }
+
+    QVector<IRouter::leg_t>& legs = routingRequests[id];
+    for(qint32 i = 0; i < legs.size(); i++)
+    {
+        if((legs[i].p1 == leg.p1) && (legs[i].p2 == leg.p2))
+        {
+            legs.remove(i);
+            break;
+        }
+    }
+
+    // the result is valid for the last stored state, too
+    if(applyLeg(points, leg) && (idxHistory != NOIDX))
+    {
+        applyLeg(history[idxHistory], leg);
+    }
+
+    canvas->slotTriggerCompleteUpdate(CCanvas::eRedrawMouse);
+    updateStatus();
+}
+
+void IMouseEditLine::slotRoutesFinished(qint32 id, const QString& error)
+{
+    if(routingRequests.remove(id) == 0)
+    {
+        return;
+    }
+
+    if(lineOp != nullptr)
+    {
+        lineOp->showRoutingErrorMessage(error);
+    }
+}
+
 void IMouseEditLine::restoreFromHistory(SGisLine& line)
 {
     line = history[idxHistory];
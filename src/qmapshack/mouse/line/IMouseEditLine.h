@@ -23,6 +23,7 @@
 #include "gis/IGisItem.h"
 #include "gis/IGisLine.h"
 #include "gis/rte/router/CRouterOptimization.h"
+#include "gis/rte/router/IRouter.h"
 #include "mouse/IMouse.h"
 #include <QDebug>
 #include <QPointer>
@@ -78,6 +79,18 @@ public:
     void storeToHistory(const SGisLine& line);
     void restoreFromHistory(SGisLine& line);
 
+    /**
+       @brief Calculate the subpoints of legs with the current router in the background
+
+       The results are applied to the line as they arrive, as long as the
+       leg's points did not change meanwhile.
+
+       @param idxs  the index of each leg's first point
+     */
+    void routeLegs(const QList<qint32>& idxs);
+    /// cancel all pending routing requests with none of their legs left in the line
+    void cancelSupersededRouting();
+
     virtual void updateStatus();
 
 protected slots:
@@ -113,6 +126,10 @@ protected slots:
     void slotUndo();
     void slotRedo();
 
+private slots:
+    void slotRouteLegFinished(qint32 id, const IRouter::leg_t& leg);
+    void slotRoutesFinished(qint32 id, const QString& error);
+
 protected:
     virtual void drawLine(const QPolygonF& l, const QColor color, int width, QPainter& p);
     /**
@@ -123,6 +140,9 @@ protected:
 
     virtual void startNewLine(const QPointF& point);
 
+    /// calculate the legs of pending routing requests synchronously, to be called before the line is saved
+    void finishRouting();
+
     /// shadow cursor needed to restore cursor after some actions providing their own cursor.
     QCursor cursor1;
 
@@ -144,6 +164,8 @@ protected:
 private:
     void commonSetup();
     void changeCursor();
+    /// find the leg in the line and replace it's subpoints by the route, returns false if the leg is not found
+    static bool applyLeg(SGisLine& line, const IRouter::leg_t& leg);
 
     QPolygonF pixelLine;
     QPolygonF pixelPts;
@@ -157,6 +179,9 @@ private:
     QString type;
 
     CRouterOptimization optimizer;
+
+    /// the legs of the pending routing requests still waiting for a result
+    QHash<qint32, QVector<IRouter::leg_t> > routingRequests;
 };
 
 #endif //IMOUSEEDITLINE_H
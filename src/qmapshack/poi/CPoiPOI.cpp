@@ -45,20 +45,17 @@ CPoiPOI::CPoiPOI(const QString& filename, CPoiDraw* parent)
     loadTimer->setInterval(500);
     connect(loadTimer, &QTimer::timeout, poi, &CPoiDraw::emitSigCanvasUpdate);
 
-    // Open database here so it belongs to the right thread
-    if(!QSqlDatabase::contains(filename + "_bbox"))
+    // cost of a cell is an estimate of its size in bytes
+    loadedCells.setMaxCost(64 * 1024 * 1024);
+
+    QSqlDatabase db = getDatabase();
+    if(!db.isOpen())
     {
-        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", filename + "_bbox");
-        db.setDatabaseName(filename);
-        if(!db.open())
-        {
-            qDebug() << "failed to open database" << db.lastError();
-            isActivated = false;
-            return;
-        }
+        isActivated = false;
+        return;
     }
 
-    QSqlQuery query("SELECT value FROM main.metadata WHERE name='bounds'", QSqlDatabase::database(filename + "_bbox"));
+    QSqlQuery query("SELECT value FROM main.metadata WHERE name='bounds'", db);
 
     if(query.next())
     {
@@ -74,10 +71,54 @@ CPoiPOI::CPoiPOI(const QString& filename, CPoiDraw* parent)
         qDebug() << "failed to retrieve bounding box of " << filename;
         isActivated = false;
     }
-    //Database is no longer needed
-    QSqlDatabase::removeDatabase(filename + "_bbox");
 }
 
+CPoiPOI::~CPoiPOI()
+{
+    for(const QString& connectionName : qAsConst(dbConnections))
+    {
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+QSqlDatabase CPoiPOI::getDatabase()
+{
+    QMutexLocker lock(&mutex);
+
+    // Use the QThread object as identifier as it owns the driver.
+    QThread* thread = QThread::currentThread();
+    const QString& connectionName = QString("%1_%2").arg(filename).arg(quintptr(thread), 0, 16);
+    if(QSqlDatabase::contains(connectionName))
+    {
+        return QSqlDatabase::database(connectionName);
+    }
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    dbConnections << connectionName;
+    if(thread != qApp->thread())
+    {
+        // Once the thread is done the thread object might be destroyed and
+        // it's address reused by another thread. Do not keep the connection.
+        connect(thread, &QThread::finished, this, [this, connectionName]()
+        {
+            removeDatabase(connectionName);
+        }, Qt::DirectConnection);
+    }
+    db.setDatabaseName(filename);
+    db.setConnectOptions("QSQLITE_OPEN_READONLY");
+    if(!db.open())
+    {
+        qDebug() << "failed to open database" << db.lastError();
+    }
+    return db;
+}
+
+void CPoiPOI::removeDatabase(const QString& connectionName)
+{
+    QMutexLocker lock(&mutex);
+    dbConnections.remove(connectionName);
+    QSqlDatabase::removeDatabase(connectionName);
+}
 
 void CPoiPOI::draw(IDrawContext::buffer_t& buf)
 {
@@ -125,32 +166,41 @@ void CPoiPOI::draw(IDrawContext::buffer_t& buf)
     QMutexLocker lock(&mutex);
     displayedPois.clear();
     QRectF freeSpaceRect (QPointF(), IPoi::iconSize() * 2);
-    //Find POIs in view
+
+    QList<quint64> categoryIDs;
     const QList<quint64>& keys = categoryActivated.keys();
     for(quint64 categoryID : keys)
     {
-        if(categoryActivated[categoryID] != Qt::Checked)
+        if(categoryActivated[categoryID] == Qt::Checked)
         {
-            continue;
+            categoryIDs << categoryID;
         }
-        for(int minLonM10 = qFloor(xMin * RAD_TO_DEG * 10); minLonM10 < qCeil(xMax * RAD_TO_DEG * 10); minLonM10++)
+    }
+
+    const QRect cellsM10(QPoint(qFloor(xMin * RAD_TO_DEG * 10), qFloor(yMin * RAD_TO_DEG * 10)),
+                         QPoint(qCeil(xMax * RAD_TO_DEG * 10) - 1, qCeil(yMax * RAD_TO_DEG * 10) - 1));
+    loadPOIsFromFile(categoryIDs, cellsM10);
+    if(poi->needsRedraw())
+    {
+        return;
+    }
+
+    //Find POIs in view
+    for(quint64 categoryID : qAsConst(categoryIDs))
+    {
+        for(int minLonM10 = cellsM10.left(); minLonM10 <= cellsM10.right(); minLonM10++)
         {
-            for(int minLatM10 = qFloor(yMin * RAD_TO_DEG * 10); minLatM10 < qCeil(yMax * RAD_TO_DEG * 10); minLatM10++)
+            for(int minLatM10 = cellsM10.top(); minLatM10 <= cellsM10.bottom(); minLatM10++)
             {
-                if(!loadedPoisByArea.contains(categoryID) ||
-                   !loadedPoisByArea[categoryID].contains(minLonM10) ||
-                   !loadedPoisByArea[categoryID][minLonM10].contains(minLatM10))
+                const poiCell_t* cell = loadedCells.object(cellKey(categoryID, minLonM10, minLatM10));
+                if(cell == nullptr)
                 {
-                    loadPOIsFromFile(categoryID, minLonM10, minLatM10);
+                    // out of bounds or already evicted again
+                    continue;
                 }
-                if(poi->needsRedraw())
+                for(const QSharedPointer<const CRawPoi>& poiToDraw : cell->pois)
                 {
-                    return;
-                }
-                for(quint64 poiToDrawID : qAsConst(loadedPoisByArea)[categoryID][minLonM10][minLatM10])
-                {
-                    const CRawPoi& poiToDraw = loadedPois[poiToDrawID];
-                    QPointF pt = poiToDraw.getCoordinates();
+                    QPointF pt = poiToDraw->getCoordinates();
                     poi->convertRad2Px(pt);
 
                     freeSpaceRect.moveCenter(pt);
@@ -161,7 +211,7 @@ void CPoiPOI::draw(IDrawContext::buffer_t& buf)
                         if(poiGroup.iconLocation.intersects(freeSpaceRect))
                         {
                             foundIntersection = true;
-                            poiGroup.pois.insert(poiToDrawID);
+                            poiGroup.pois.insert(poiToDraw->getKey(), poiToDraw);
                             break;
                         }
                     }
@@ -172,12 +222,16 @@ void CPoiPOI::draw(IDrawContext::buffer_t& buf)
                         QRectF iconRect (QPointF(), IPoi::iconSize());
                         iconRect.moveCenter(pt);
                         poiGroup.iconLocation = iconRect;
-                        poiGroup.iconCenter = poiToDraw.getCoordinates();
-                        poiGroup.pois.insert(poiToDrawID);
+                        poiGroup.iconCenter = poiToDraw->getCoordinates();
+                        poiGroup.pois.insert(poiToDraw->getKey(), poiToDraw);
                         displayedPois.append(poiGroup);
                     }
                 }
             }
+            if(poi->needsRedraw())
+            {
+                return;
+            }
         }
     }
 
@@ -207,7 +261,7 @@ void CPoiPOI::draw(IDrawContext::buffer_t& buf)
         else if(CMainWindow::self().isPoiText())
         {
             //Draw Name
-            const QString& name = loadedPois[*poiGroup.pois.begin()].getName();
+            const QString& name = poiGroup.pois.first()->getName();
             QRectF rect = fm.boundingRect(name);
             rect.adjust(-2, -2, 2, 2);
 
@@ -256,9 +310,9 @@ bool CPoiPOI::findPoiCloseBy(const QPoint& px, QSet<poi_t>& poiItems, QList<QPoi
     poiGroup_t poiGroup;
     if(getPoiGroupCloseBy(px, poiGroup))
     {
-        for(quint64 key : qAsConst(poiGroup.pois))
+        for(const QSharedPointer<const CRawPoi>& poiFound : qAsConst(poiGroup.pois))
         {
-            poiItems.insert(loadedPois[key].toPoi());
+            poiItems.insert(poiFound->toPoi());
         }
         posPoiHighlight.append(poiGroup.iconCenter);
         return true;
@@ -277,35 +331,42 @@ void CPoiPOI::findPoisIn(const QRectF& degRect, QSet<poi_t>& pois, QList<QPointF
     //Treat highlighting and POIs seperately, as highlighting only applies to items in the current view
 
     //Find POIs
-    QSet<quint64> copiedItems; //Some Items may appear in multiple categories. We only want to copy those once.
+    QList<quint64> categoryIDs;
     const QList<quint64>& keys = categoryActivated.keys();
     for(quint64 categoryID : keys)
     {
-        if(categoryActivated[categoryID] != Qt::Checked)
+        if(categoryActivated[categoryID] == Qt::Checked)
         {
-            continue;
+            categoryIDs << categoryID;
         }
-        for(int minLonM10 = qFloor(degRect.left() * 10); minLonM10 <= qFloor(degRect.right() * 10); minLonM10++)
+    }
+
+    const QRect cellsM10(QPoint(qFloor(degRect.left() * 10), qFloor(degRect.bottom() * 10)),
+                         QPoint(qFloor(degRect.right() * 10), qFloor(degRect.top() * 10)));
+    //Imagine the user moves the screen in an l-shape while updating the selection rectangle. It is possible that some tiles are not laded then
+    loadPOIsFromFile(categoryIDs, cellsM10);
+
+    QSet<quint64> copiedItems; //Some Items may appear in multiple categories. We only want to copy those once.
+    for(quint64 categoryID : qAsConst(categoryIDs))
+    {
+        for(int minLonM10 = cellsM10.left(); minLonM10 <= cellsM10.right(); minLonM10++)
         {
-            for(int minLatM10 = qFloor(degRect.bottom() * 10); minLatM10 <= qFloor(degRect.top() * 10); minLatM10++)
+            for(int minLatM10 = cellsM10.top(); minLatM10 <= cellsM10.bottom(); minLatM10++)
             {
-                //Imagine the user moves the screen in an l-shape while updating the selection rectangle. It is possible that some tiles are not laded then
-                if(!loadedPoisByArea.contains(categoryID) ||
-                   !loadedPoisByArea[categoryID].contains(minLonM10) ||
-                   !loadedPoisByArea[categoryID][minLonM10].contains(minLatM10))
+                const poiCell_t* cell = loadedCells.object(cellKey(categoryID, minLonM10, minLatM10));
+                if(cell == nullptr)
                 {
-                    loadPOIsFromFile(categoryID, minLonM10, minLatM10);
+                    continue;
                 }
-                for(quint64 poiFoundID : qAsConst(loadedPoisByArea)[categoryID][minLonM10][minLatM10])
+                for(const QSharedPointer<const CRawPoi>& poiItemFound : cell->pois)
                 {
-                    const CRawPoi& poiItemFound = loadedPois[poiFoundID];
-                    if(!copiedItems.contains(poiItemFound.getKey()))
+                    if(!copiedItems.contains(poiItemFound->getKey()))
                     {
                         //Maybe look through the whole code of selecting items from a map to avoid this conversion
-                        if(degRect.contains(poiItemFound.getCoordinates() * RAD_TO_DEG))
+                        if(degRect.contains(poiItemFound->getCoordinates() * RAD_TO_DEG))
                         {
-                            pois.insert(poiItemFound.toPoi());
-                            copiedItems.insert(poiItemFound.getKey());
+                            pois.insert(poiItemFound->toPoi());
+                            copiedItems.insert(poiItemFound->getKey());
                         }
                     }
                 }
@@ -337,7 +398,7 @@ bool CPoiPOI::getToolTip(const QPoint& px, QString& str) const
     {
         if(poiGroup.pois.count() == 1)
         {
-            const CRawPoi& poiFound = loadedPois[*poiGroup.pois.begin()];
+            const CRawPoi& poiFound = *poiGroup.pois.first();
             const QString& name = poiFound.getName(false);
             if(!name.isEmpty())
             {
@@ -371,9 +432,9 @@ bool CPoiPOI::getToolTip(const QPoint& px, QString& str) const
             if(poiGroup.pois.count() <= 10)
             {
                 str += "<br>\n" + tr("POIs at this point:");
-                for(quint64 poiID : qAsConst(poiGroup.pois))
+                for(const QSharedPointer<const CRawPoi>& poiFound : qAsConst(poiGroup.pois))
                 {
-                    str += "<br>\n<b>" + loadedPois[poiID].getName() + "</b>";
+                    str += "<br>\n<b>" + poiFound->getName() + "</b>";
                 }
             }
         }
@@ -385,20 +446,14 @@ void CPoiPOI::addTreeWidgetItems(QTreeWidget* widget)
 {
     QMutexLocker lock(&mutex);
 
-    // Open database here so it belongs to the right thread
-    if(!QSqlDatabase::contains(filename + "_widget"))
+    QSqlDatabase db = getDatabase();
+    if(!db.isOpen())
     {
-        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", filename + "_widget");
-        db.setDatabaseName(filename);
-        if(!db.open())
-        {
-            qDebug() << "failed to open database" << db.lastError();
-            isActivated = false;
-            return;
-        }
+        isActivated = false;
+        return;
     }
 
-    QSqlQuery query("SELECT id, name, parent FROM main.poi_categories ORDER BY id DESC", QSqlDatabase::database(filename + "_widget"));
+    QSqlQuery query("SELECT id, name, parent FROM main.poi_categories ORDER BY id DESC", db);
 
     QMap<uint, CPoiCategory*> categoryMap;
 
@@ -448,7 +503,7 @@ void CPoiPOI::getPoiIcon(QPixmap& icon, const CPoiPOI::poiGroup_t& poiGroup)
     }
     else
     {
-        getPoiIcon(icon, loadedPois[*poiGroup.pois.begin()]);
+        getPoiIcon(icon, *poiGroup.pois.first());
     }
 }
 
@@ -495,74 +550,149 @@ bool CPoiPOI::getPoiGroupCloseBy(const QPoint& px, CPoiPOI::poiGroup_t& poiItem)
     return false;
 }
 
-void CPoiPOI::loadPOIsFromFile(quint64 categoryID, int minLonM10, int minLatM10)
+void CPoiPOI::loadPOIsFromFile(const QList<quint64>& categoryIDs, const QRect& cellsM10)
 {
     QMutexLocker lock(&mutex);
 
-    // check if query is within bounds
-    if(!bbox.intersects({minLonM10 / 10.0, minLatM10 / 10.0, 0.1, 0.1}))
+    // collect all cells not loaded yet and the range they cover
+    QSet<quint64> missingCells;
+    QSet<quint64> missingCategories;
+    QRect missingRange;
+    for(quint64 categoryID : categoryIDs)
+    {
+        for(int minLonM10 = cellsM10.left(); minLonM10 <= cellsM10.right(); minLonM10++)
+        {
+            for(int minLatM10 = cellsM10.top(); minLatM10 <= cellsM10.bottom(); minLatM10++)
+            {
+                // check if cell is within bounds
+                if(!bbox.intersects({minLonM10 / 10.0, minLatM10 / 10.0, 0.1, 0.1}))
+                {
+                    continue;
+                }
+
+                const quint64 key = cellKey(categoryID, minLonM10, minLatM10);
+                if(loadedCells.contains(key))
+                {
+                    continue;
+                }
+
+                missingCells << key;
+                missingCategories << categoryID;
+                missingRange |= QRect(minLonM10, minLatM10, 1, 1);
+            }
+        }
+    }
+
+    if(missingCells.isEmpty())
     {
         return;
     }
 
-    //Open Database here so it is owned by the right thread
-    if(!QSqlDatabase::contains(filename))
+    QSqlDatabase db = getDatabase();
+    if(!db.isOpen())
     {
-        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", filename);
-        db.setDatabaseName(filename);
-        if(!db.open())
-        {
-            qDebug() << "failed to open database" << db.lastError();
-            isActivated = false;
-            return;
-        }
+        return;
+    }
+
+    QStringList categories;
+    for(quint64 categoryID : qAsConst(missingCategories))
+    {
+        categories << QString::number(categoryID);
+    }
+
+    // One range query over the R-tree for all missing cells and categories. Cells
+    // already loaded are part of the range, too. Their POIs are skipped below.
+    QSqlQuery query(db);
+    query.prepare(QString("SELECT main.poi_index.maxLat, main.poi_index.maxLon, main.poi_index.minLat, main.poi_index.minLon, main.poi_data.data, main.poi_data.id, main.poi_category_map.category "
+                          "FROM main.poi_index "
+                          "JOIN main.poi_category_map ON main.poi_category_map.id = main.poi_index.id "
+                          "JOIN main.poi_data ON main.poi_data.id = main.poi_index.id "
+                          "WHERE main.poi_index.maxLat<:maxLat "
+                          "AND main.poi_index.minLat>=:minLat "
+                          "AND main.poi_index.maxLon<:maxLon "
+                          "AND main.poi_index.minLon>=:minLon "
+                          "AND main.poi_category_map.category IN (%1)").arg(categories.join(",")));
+    query.bindValue(":maxLat", QString::number((missingRange.bottom() + 1) / 10., 'f'));
+    query.bindValue(":minLat", QString::number(missingRange.top() / 10., 'f'));
+    query.bindValue(":maxLon", QString::number((missingRange.right() + 1) / 10., 'f'));
+    query.bindValue(":minLon", QString::number(missingRange.left() / 10., 'f'));
+    if(!query.exec())
+    {
+        qDebug() << "failed to query POIs" << query.lastError();
+        return;
     }
 
-    QSqlQuery query(QSqlDatabase::database(filename));
-    query.prepare("SELECT main.poi_index.maxLat, main.poi_index.maxLon, main.poi_index.minLat, main.poi_index.minLon, main.poi_data.data, main.poi_data.id "
-                  "FROM main.poi_data, main.poi_index "
-                  "WHERE main.poi_data.id IN "
-                  "("
-                  "    SELECT main.poi_category_map.id "
-                  "    FROM main.poi_category_map "
-                  "    WHERE main.poi_category_map.id IN "
-                  "    ( "
-                  "        SELECT main.poi_index.id "
-                  "        FROM main.poi_index "
-                  "        WHERE main.poi_index.maxLat<:maxLat "
-                  "        AND main.poi_index.minLat>=:minLat "
-                  "        AND main.poi_index.maxLon<:maxLon "
-                  "        AND main.poi_index.minLon>=:minLon "
-                  "    ) "
-                  "    AND main.poi_category_map.category=:categoryID "
-                  ") "
-                  "AND main.poi_data.id = main.poi_index.id");
-    query.bindValue(":maxLat", QString::number((minLatM10 + 1) / 10., 'f'));
-    query.bindValue(":minLat", QString::number(minLatM10 / 10., 'f'));
-    query.bindValue(":maxLon", QString::number((minLonM10 + 1) / 10., 'f'));
-    query.bindValue(":minLon", QString::number(minLonM10 / 10., 'f'));
-    query.bindValue(":categoryID", categoryID);
-    query.exec();
+    QHash<quint64, poiCell_t*> cells;
+    QHash<quint64, int> costs;
     while (query.next())
     {
-        quint64 key = query.value(eSqlColumnPoiId).toUInt();
-        const QStringList& data = query.value(eSqlColumnPoiData).toString().split("\r");
-        QString garminIcon;
-        for(const QString& tag : data)
+        const qreal minLon = query.value(eSqlColumnPoiMinLon).toDouble();
+        const qreal minLat = query.value(eSqlColumnPoiMinLat).toDouble();
+        const quint64 categoryID = query.value(eSqlColumnPoiCategory).toULongLong();
+        const quint64 key = cellKey(categoryID, qFloor(minLon * 10), qFloor(minLat * 10));
+        if(!missingCells.contains(key))
         {
-            if(tagMap.contains(tag))
+            continue;
+        }
+
+        poiCell_t*& cell = cells[key];
+        if(cell == nullptr)
+        {
+            cell = new poiCell_t();
+        }
+
+        const quint64 poiID = query.value(eSqlColumnPoiId).toULongLong();
+        QSharedPointer<const CRawPoi> rawPoi = loadedPois.value(poiID).toStrongRef();
+        if(rawPoi.isNull())
+        {
+            const QStringList& data = query.value(eSqlColumnPoiData).toString().split("\r");
+            QString garminIcon;
+            for(const QString& tag : data)
             {
-                garminIcon = tagMap[tag].getGarminSym();
-                break;
+                if(tagMap.contains(tag))
+                {
+                    garminIcon = tagMap[tag].getGarminSym();
+                    break;
+                }
             }
+
+            // A POI in several categories is decoded once and shared by
+            // all of them. It keeps the name of the category it was loaded
+            // with first, just as the POI's icon is defined by the first
+            // known tag.
+            rawPoi = QSharedPointer<const CRawPoi>(new CRawPoi(data,
+                                                               QPointF((query.value(eSqlColumnPoiMaxLon).toDouble() + minLon) / 2 * DEG_TO_RAD,
+                                                                       (query.value(eSqlColumnPoiMaxLat).toDouble() + minLat) / 2 * DEG_TO_RAD),
+                                                               poiID, categoryNames[categoryID], garminIcon));
+            loadedPois[poiID] = rawPoi;
+        }
+
+        cell->pois << rawPoi;
+        // rough estimate: the raw data is stored twice (raw and as key/value map)
+        costs[key] += sizeof(CRawPoi) + 4 * rawPoi->getRawData().join("").size();
+    }
+
+    // Add all missing cells, even the empty ones, to avoid querying them again
+    for(quint64 key : qAsConst(missingCells))
+    {
+        poiCell_t* cell = cells.value(key, nullptr);
+        if(cell == nullptr)
+        {
+            cell = new poiCell_t();
         }
-        loadedPoisByArea[categoryID][minLonM10][minLatM10].append(key);
-        // TODO: this overwrites a POI if it already was loaded. The difference between those will be the category. Some better handling should be done
-        loadedPois[key] = CRawPoi(data,
-                                  QPointF((query.value(eSqlColumnPoiMaxLon).toDouble() + query.value(eSqlColumnPoiMinLon).toDouble()) / 2 * DEG_TO_RAD,
-                                          (query.value(eSqlColumnPoiMaxLat).toDouble() + query.value(eSqlColumnPoiMinLat).toDouble()) / 2 * DEG_TO_RAD),
-                                  key, categoryNames[categoryID], garminIcon);
-    }
-    // Close database, as this method is called from mutiple threads.
-    QSqlDatabase::removeDatabase(filename);
+        loadedCells.insert(key, cell, qMax(costs.value(key), int(sizeof(poiCell_t))));
+    }
+
+    // drop the entries of POIs no longer referenced by any cell
+    for(auto it = loadedPois.begin(); it != loadedPois.end();)
+    {
+        if(it->isNull())
+        {
+            it = loadedPois.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
 }
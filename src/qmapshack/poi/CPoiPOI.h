@@ -24,8 +24,11 @@
 #include "poi/CRawPoi.h"
 #include "poi/IPoi.h"
 
+#include <QCache>
 #include <QCoreApplication>
 #include <QMutex>
+#include <QSharedPointer>
+#include <QSqlDatabase>
 #include <QTimer>
 
 class CPoiPOI : public IPoi
@@ -33,11 +36,20 @@ class CPoiPOI : public IPoi
     Q_DECLARE_TR_FUNCTIONS(CPoiPOI)
 public:
     CPoiPOI(const QString& filename, CPoiDraw* parent);
-    virtual ~CPoiPOI() = default;
+    virtual ~CPoiPOI();
 
     void addTreeWidgetItems(QTreeWidget* widget) override;
-    // category, minLon multiplied by 10, minLat multiplied by 10. POIs are loaded in squares of degrees (should be fine enough to not hang the system)
-    void loadPOIsFromFile(quint64 categoryID, int minLonM10, int minLatM10);
+    /**
+       @brief Load all cells of the given categories that are not in the cell cache yet
+
+       POIs are loaded in cells of 0.1°x0.1°. A cell is addressed by its minimum
+       longitude and latitude multiplied by 10. All missing cells are fetched by a
+       single range query.
+
+       @param categoryIDs   the categories to load
+       @param cellsM10      the range of cells (inclusive) in degrees multiplied by 10
+     */
+    void loadPOIsFromFile(const QList<quint64>& categoryIDs, const QRect& cellsM10);
 
     void draw(IDrawContext::buffer_t& buf) override;
 
@@ -64,7 +76,13 @@ private:
         QRectF iconLocation;
         ///Location of the center of the icon in rad
         QPointF iconCenter;
-        QSet<quint64> pois;
+        QMap<quint64, QSharedPointer<const CRawPoi>> pois;
+    };
+
+    /// all POIs of one category within a 0.1°x0.1° cell
+    struct poiCell_t
+    {
+        QList<QSharedPointer<const CRawPoi>> pois;
     };
 
     enum SqlColumnPoi_e
@@ -74,7 +92,8 @@ private:
         eSqlColumnPoiMinLat,
         eSqlColumnPoiMinLon,
         eSqlColumnPoiData,
-        eSqlColumnPoiId
+        eSqlColumnPoiId,
+        eSqlColumnPoiCategory
     };
     enum SqlColumnCategory_e
     {
@@ -87,6 +106,21 @@ private:
     void getPoiIcon(QPixmap& icon, const CRawPoi& poi, const QString& definingTag = "");
     bool overlapsWithIcon(const QRectF& rect) const;
     bool getPoiGroupCloseBy(const QPoint& px, poiGroup_t& poiItem) const;
+    /**
+       @brief Get the database connection of the calling thread
+
+       The connection is created and opened on the first call of each thread.
+       It is removed as soon as the thread finishes, or with the object for
+       the main thread.
+     */
+    QSqlDatabase getDatabase();
+    /// close and remove a connection opened by getDatabase()
+    void removeDatabase(const QString& connectionName);
+
+    static quint64 cellKey(quint64 categoryID, int lonM10, int latM10)
+    {
+        return (categoryID << 24) | (quint64((lonM10 + 2048) & 0x0FFF) << 12) | quint64((latM10 + 2048) & 0x0FFF);
+    }
 
     mutable QMutex mutex {QMutex::Recursive};
     QString filename;
@@ -95,9 +129,12 @@ private:
 
     QMap<quint64, Qt::CheckState> categoryActivated;
     QMap<quint64, QString> categoryNames;
-    // category, minLon multiplied by 10, minLat multiplied by 10. POIs are loaded in squares of degrees (should be fine enough to not hang the system)
-    QMap<quint64, QMap<int, QMap<int, QList<quint64>>>> loadedPoisByArea;
-    QMap<quint64, CRawPoi> loadedPois;
+    /// names of the database connections opened by the threads using this object
+    QSet<QString> dbConnections;
+    /// LRU of loaded cells, addressed by cellKey(), cost in bytes
+    QCache<quint64, poiCell_t> loadedCells;
+    /// decoded POIs by key, shared by all cells and categories referencing them
+    QHash<quint64, QWeakPointer<const CRawPoi>> loadedPois;
     QList<poiGroup_t> displayedPois;
     QRectF bbox;
 
@@ -22,10 +22,11 @@
 #include "gis/GeoMath.h"
 #include "gis/rte/CGisItemRte.h"
 #include "gis/trk/CGisItemTrk.h"
-#include "helpers/CDraw.h"
 #include "helpers/CProgressDialog.h"
 #include "helpers/CSettings.h"
 #include "print/CPrintDialog.h"
+#include "print/CTiledExport.h"
+#include "print/CTiledImageWriter.h"
 
 #include <QtPrintSupport>
 #include <QtWidgets>
@@ -178,67 +179,42 @@ void CPrintDialog::slotUpdateMetrics()
 
 void CPrintDialog::slotPrint()
 {
-    qreal wPage = rectPrinterPage.width();
-    qreal hPage = rectPrinterPage.height();
+    const qreal wPage = rectPrinterPage.width();
+    const qreal hPage = rectPrinterPage.height();
 
-    QPointF p11 = rectSelAreaPixel.topLeft();
-    QPointF p22 = p11 + QPointF(wPage, hPage);
-
-    canvas->convertPx2Rad(p11);
-    canvas->convertPx2Rad(p22);
-
-
-    QPointF pxCenter0 = QRectF(p11, p22).center();
-    canvas->convertRad2Px(pxCenter0);
-
-    QList<QPointF> centers;
-
-    qreal yoff = 0;
+    QList<QRectF> pages;
     for(int y = 0; y < qCeil(yPages); y++)
     {
-        qreal xoff = 0;
         for(int x = 0; x < qCeil(xPages); x++)
         {
-            QPointF center = pxCenter0 + QPointF(xoff, yoff);
-            canvas->convertPx2Rad(center);
-            centers << center;
-
-            xoff += wPage;
+            pages << QRectF(rectSelAreaPixel.topLeft() + QPointF(x * wPage, y * hPage), QSizeF(wPage, hPage));
         }
-
-        yoff += hPage;
     }
 
-    QRectF rectPage(0, 0, wPage, hPage);
+    CTiledExport exporter(canvas, this);
 
-    bool first = true;
     QPainter p;
     p.begin(&printer);
-    p.setClipRect(rectPage);
-    USE_ANTI_ALIASING(p, true);
 
-    int N = centers.size();
+    int N = pages.size();
     int n = 0;
     PROGRESS_SETUP(tr("Printing pages."), 0, N, this);
 
-    for(const QPointF& pt : qAsConst(centers))
+    for(const QRectF& page : qAsConst(pages))
     {
-        if(!first)
+        if(n != 0)
         {
             printer.newPage();
         }
-        else
-        {
-            first = false;
-        }
-        if(printScaleOnAllPages || pt == centers.last())
-        {
-            canvas->print(p, rectPage, pt, true);
-        }
-        else
+
+        // each page is rendered in tiles to keep the memory footprint small for high resolutions
+        auto drawTile = [&p](const CTiledExport::tile_t& tile) -> bool
         {
-            canvas->print(p, rectPage, pt, false);
-        }
+            p.drawImage(tile.rect.topLeft(), tile.image);
+            return true;
+        };
+        exporter.render(page, printScaleOnAllPages || (n == N - 1), drawTile);
+
         PROGRESS(++n, break);
     }
 
@@ -249,41 +225,18 @@ void CPrintDialog::slotPrint()
 
 void CPrintDialog::slotSave()
 {
-    QPointF pt1 = rectSelArea.topLeft();
-    QPointF pt2 = rectSelArea.bottomRight();
-
-    canvas->convertRad2Px(pt1);
-    canvas->convertRad2Px(pt2);
-
-    QRectF rect(pt1, pt2);
-    QImage img(rect.size().toSize(), QImage::Format_ARGB32);
-
-    QPainter p(&img);
-    USE_ANTI_ALIASING(p, true);
-
-    canvas->print(p, rect, rectSelArea.center());
-
     SETTINGS;
     QString path = cfg.value("Paths/lastImagePath", "./").toString();
 
-    QString filterPNG = "PNG Image (*.png)";
-    QString filterJPG = "JPEG Image (*.jpg)";
-    QString filter = filterPNG;
-    QString filename = QFileDialog::getSaveFileName(this, tr("Save map..."), path, filterPNG + ";; " + filterJPG, &filter);
+    const QStringList& filters = CTiledImageWriter::getFilters();
+    QString filter = filters.first();
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save map..."), path, filters.join(";; "), &filter);
     if(filename.isEmpty())
     {
         return;
     }
 
-    QString expectedSuffix;
-    if(filter == filterPNG)
-    {
-        expectedSuffix = "png";
-    }
-    else if(filter == filterJPG)
-    {
-        expectedSuffix = "jpg";
-    }
+    const QString& expectedSuffix = CTiledImageWriter::getSuffix(filter);
 
     QFileInfo fi(filename);
     if(fi.suffix().toLower() != expectedSuffix)
@@ -291,7 +244,42 @@ void CPrintDialog::slotSave()
         filename += "." + expectedSuffix;
     }
 
-    img.save(filename);
+    QPointF pt1 = rectSelArea.topLeft();
+    QPointF pt2 = rectSelArea.bottomRight();
+
+    canvas->convertRad2Px(pt1);
+    canvas->convertRad2Px(pt2);
+
+    const QRectF rect(pt1, pt2);
+
+    // the image is streamed to the file tile by tile, thus it's size is only limited by the file format
+    const int N = qCeil(rect.width() / CTiledExport::tileSize) * qCeil(rect.height() / CTiledExport::tileSize);
+    int n = 0;
+    PROGRESS_SETUP(tr("Saving map."), 0, N, this);
+
+    try
+    {
+        CTiledExport exporter(canvas, this);
+        CTiledImageWriter writer(filename, rect.size().toSize());
+
+        auto writeTile = [&](const CTiledExport::tile_t& tile) -> bool
+        {
+            writer.write(tile.rect, tile.image);
+            PROGRESS(++n, return false);
+            return true;
+        };
+
+        if(!exporter.render(rect, true, writeTile))
+        {
+            return;
+        }
+        writer.close();
+    }
+    catch(const QString& msg)
+    {
+        QMessageBox::critical(this, tr("Error..."), msg, QMessageBox::Ok);
+        return;
+    }
 
     cfg.setValue("Paths/lastImagePath", fi.absolutePath());
 
@@ -23,6 +23,7 @@
 #include "helpers/CSettings.h"
 #include "plot/CPlotProfile.h"
 #include "print/CScreenshotDialog.h"
+#include "print/CTiledImageWriter.h"
 
 #include <QtPrintSupport>
 #include <QtWidgets>
@@ -53,24 +54,16 @@ void CScreenshotDialog::slotSave()
 {
     SETTINGS;
     QString path = cfg.value("Paths/lastScreenshotPath", "./").toString();
-    QString filterPNG = "PNG Image (*.png)";
-    QString filterJPG = "JPEG Image (*.jpg)";
-    QString filter = filterPNG;
-    QString filename = QFileDialog::getSaveFileName(this, tr("Save screenshot..."), path, filterPNG + ";; " + filterJPG, &filter);
+
+    const QStringList& filters = CTiledImageWriter::getFilters();
+    QString filter = filters.first();
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save screenshot..."), path, filters.join(";; "), &filter);
     if(filename.isEmpty())
     {
         return;
     }
 
-    QString expectedSuffix;
-    if(filter == filterPNG)
-    {
-        expectedSuffix = "png";
-    }
-    else if(filter == filterJPG)
-    {
-        expectedSuffix = "jpg";
-    }
+    const QString& expectedSuffix = CTiledImageWriter::getSuffix(filter);
 
     QFileInfo fi(filename);
     if(fi.suffix().toLower() != expectedSuffix)
@@ -78,8 +71,18 @@ void CScreenshotDialog::slotSave()
         filename += "." + expectedSuffix;
     }
 
-    const QPixmap& pixmap = getScreenshot(getTrackForProfile());
-    pixmap.save(filename);
+    const QImage& image = getScreenshot(getTrackForProfile()).toImage();
+    try
+    {
+        CTiledImageWriter writer(filename, image.size());
+        writer.write(image.rect(), image);
+        writer.close();
+    }
+    catch(const QString& msg)
+    {
+        QMessageBox::critical(this, tr("Error..."), msg, QMessageBox::Ok);
+        return;
+    }
 
     cfg.setValue("Paths/lastScreenshotPath", fi.absolutePath());
     QDialog::accept();
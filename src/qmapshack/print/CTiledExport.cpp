@@ -0,0 +1,126 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "canvas/CCanvas.h"
+#include "helpers/CDraw.h"
+#include "print/CTiledExport.h"
+
+#include <QtWidgets>
+
+/// more clones do not pay off as the draw contexts of each clone already run in parallel
+#define MAX_CLONES 4
+
+CTiledExport::CTiledExport(CCanvas* source, QWidget* parent)
+    : source(source)
+{
+    // clone canvas by a temporary configuration file
+    QTemporaryFile temp;
+    temp.open();
+    temp.close();
+
+    QSettings view(temp.fileName(), QSettings::IniFormat);
+    view.clear();
+
+    source->saveConfig(view);
+
+    const qint32 N = qBound(1, QThread::idealThreadCount(), MAX_CLONES);
+    for(qint32 n = 0; n < N; n++)
+    {
+        CCanvas* canvas = new CCanvas(parent, "print");
+        canvas->loadConfig(view);
+        canvas->allowShowTrackOverlays(false);
+        canvas->hide();
+        canvases << canvas;
+    }
+}
+
+CTiledExport::~CTiledExport()
+{
+    qDeleteAll(canvases);
+}
+
+bool CTiledExport::render(const QRectF& area, bool printScale, const fTileDone& tileDone)
+{
+    struct job_t
+    {
+        QRect rect;
+        QPointF focus;
+    };
+
+    const QSize size = area.size().toSize();
+
+    QList<job_t> jobs;
+    for(qint32 y = 0; y < size.height(); y += tileSize)
+    {
+        for(qint32 x = 0; x < size.width(); x += tileSize)
+        {
+            job_t job;
+            job.rect = QRect(x, y, qMin(tileSize, size.width() - x), qMin(tileSize, size.height() - y));
+            job.focus = area.topLeft() + QRectF(job.rect).center();
+            source->convertPx2Rad(job.focus);
+            jobs << job;
+        }
+    }
+
+    const qint32 N = canvases.size();
+    auto startJob = [&](qint32 j)
+    {
+        if(j < jobs.size())
+        {
+            canvases[j % N]->startPrintTile(jobs[j].rect.size(), jobs[j].focus);
+        }
+    };
+
+    for(qint32 j = 0; j < N; j++)
+    {
+        startJob(j);
+    }
+
+    for(qint32 j = 0; j < jobs.size(); j++)
+    {
+        const job_t& job = jobs[j];
+
+        tile_t tile;
+        tile.rect = job.rect;
+        tile.image = QImage(job.rect.size(), QImage::Format_ARGB32);
+        tile.image.fill(Qt::transparent);
+
+        QPainter p(&tile.image);
+        USE_ANTI_ALIASING(p, true);
+        canvases[j % N]->finishPrintTile(p, job.rect.size(), job.focus, false);
+        if(printScale)
+        {
+            // The scale is placed relative to the whole area. Each tile
+            // gets the part of it that it covers.
+            p.translate(-job.rect.topLeft());
+            source->printScale(p, area);
+        }
+        p.end();
+
+        // keep the clone busy while the tile is processed
+        startJob(j + N);
+
+        if(!tileDone(tile))
+        {
+            // tiles still rendered are stopped by the destruction of the clones
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,85 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CTILEDEXPORT_H
+#define CTILEDEXPORT_H
+
+#include <functional>
+#include <QCoreApplication>
+#include <QImage>
+#include <QList>
+
+class CCanvas;
+class QWidget;
+
+/**
+   @brief Render large areas of a canvas in tiles of fixed size
+
+   Rendering the complete area at once needs an image of the full output
+   size for each draw context. For large prints this easily exceeds the
+   available memory. Instead the area is split into tiles of fixed size.
+   Several clones of the source canvas render the tiles in parallel, each
+   with its own set of draw contexts. The tiles are passed to the caller
+   one by one in row major order. Thus the memory needed is bound by the
+   tile size and the number of clones, no matter how large the output is.
+ */
+class CTiledExport
+{
+    Q_DECLARE_TR_FUNCTIONS(CTiledExport)
+public:
+    /**
+       @brief Clone the source canvas
+
+       @param source    the canvas to clone, the clones will use the same maps, zoom level and projection
+       @param parent    the parent widget of the clones, they stay hidden
+     */
+    CTiledExport(CCanvas* source, QWidget* parent);
+    virtual ~CTiledExport();
+
+    struct tile_t
+    {
+        /// the tile's position and size relative to the top left corner of the rendered area [pixel]
+        QRect rect;
+        QImage image;
+    };
+
+    /// called for each tile, return false to abort the rendering
+    using fTileDone = std::function<bool(const tile_t& tile)>;
+
+    /**
+       @brief Render an area tile by tile
+
+       The tiles at the right and bottom border are cropped to the area.
+
+       @param area          the area in pixel coordinates of the source canvas
+       @param printScale    set true to draw the scale into the bottom right corner of the area
+       @param tileDone      the function to receive the tiles
+
+       @return False if the rendering has been aborted.
+     */
+    bool render(const QRectF& area, bool printScale, const fTileDone& tileDone);
+
+    static constexpr qint32 tileSize = 1024;
+
+private:
+    CCanvas* source;
+    QList<CCanvas*> canvases;
+};
+
+#endif //CTILEDEXPORT_H
+
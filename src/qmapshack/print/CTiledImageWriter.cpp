@@ -0,0 +1,164 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "print/CTiledImageWriter.h"
+
+#include <gdal_priv.h>
+#include <QtGui>
+
+static const QString filterPNG  = "PNG Image (*.png)";
+static const QString filterJPG  = "JPEG Image (*.jpg)";
+static const QString filterTIFF = "TIFF Image (*.tif)";
+
+CTiledImageWriter::CTiledImageWriter(const QString& filename, const QSize& size)
+    : filename(filename)
+    , filenameTiff(filename)
+    , size(size)
+{
+    const QString& suffix = QFileInfo(filename).suffix().toLower();
+    if(suffix == "png")
+    {
+        driver = "PNG";
+    }
+    else if(suffix == "jpg" || suffix == "jpeg")
+    {
+        driver = "JPEG";
+        // JPEG has no alpha channel
+        nBands = 3;
+    }
+
+    if(!driver.isEmpty())
+    {
+        filenameTiff = filename + ".tmp.tif";
+    }
+
+    char** options = nullptr;
+    options = CSLSetNameValue(options, "TILED", "YES");
+    options = CSLSetNameValue(options, "BIGTIFF", "IF_SAFER");
+    options = CSLSetNameValue(options, "COMPRESS", driver.isEmpty() ? "DEFLATE" : "NONE");
+    options = CSLSetNameValue(options, "PHOTOMETRIC", "RGB");
+    if(nBands == 4)
+    {
+        options = CSLSetNameValue(options, "ALPHA", "YES");
+    }
+
+    GDALDriver* gtiff = GetGDALDriverManager()->GetDriverByName("GTiff");
+    dataset = gtiff->Create(filenameTiff.toUtf8(), size.width(), size.height(), nBands, GDT_Byte, options);
+    CSLDestroy(options);
+
+    if(dataset == nullptr)
+    {
+        throw tr("Failed to create image file %1: %2").arg(filenameTiff, CPLGetLastErrorMsg());
+    }
+}
+
+CTiledImageWriter::~CTiledImageWriter()
+{
+    if(dataset != nullptr)
+    {
+        // not closed properly, drop the incomplete file
+        GDALClose(dataset);
+        QFile::remove(filenameTiff);
+    }
+}
+
+QStringList CTiledImageWriter::getFilters()
+{
+    return {filterPNG, filterJPG, filterTIFF};
+}
+
+QString CTiledImageWriter::getSuffix(const QString& filter)
+{
+    if(filter == filterJPG)
+    {
+        return "jpg";
+    }
+    if(filter == filterTIFF)
+    {
+        return "tif";
+    }
+    return "png";
+}
+
+void CTiledImageWriter::write(const QRect& rect, const QImage& img)
+{
+    const QRect& r = rect.intersected(QRect(QPoint(0, 0), size));
+    if(r.isEmpty() || (dataset == nullptr))
+    {
+        return;
+    }
+
+    QImage buffer;
+    if(nBands == 4)
+    {
+        buffer = img.convertToFormat(QImage::Format_RGBA8888);
+    }
+    else
+    {
+        buffer = QImage(img.size(), QImage::Format_RGB888);
+        buffer.fill(Qt::white);
+        QPainter p(&buffer);
+        p.drawImage(0, 0, img);
+    }
+
+    const qint32 bpl = buffer.bytesPerLine();
+    uchar* bits = buffer.bits() + (r.y() - rect.y()) * bpl + (r.x() - rect.x()) * nBands;
+
+    CPLErr err = dataset->RasterIO(GF_Write, r.x(), r.y(), r.width(), r.height(), bits, r.width(), r.height(), GDT_Byte, nBands, nullptr, nBands, bpl, 1);
+    if(err != CE_None)
+    {
+        throw tr("Failed to write image file %1: %2").arg(filenameTiff, CPLGetLastErrorMsg());
+    }
+}
+
+void CTiledImageWriter::close()
+{
+    if(dataset == nullptr)
+    {
+        return;
+    }
+
+    if(driver.isEmpty())
+    {
+        GDALClose(dataset);
+        dataset = nullptr;
+        return;
+    }
+
+    char** options = nullptr;
+    if(driver == "JPEG")
+    {
+        options = CSLSetNameValue(options, "QUALITY", "90");
+    }
+
+    GDALDriver* drv = GetGDALDriverManager()->GetDriverByName(driver.toLatin1());
+    GDALDataset* copy = drv->CreateCopy(filename.toUtf8(), dataset, false, options, nullptr, nullptr);
+    CSLDestroy(options);
+
+    GDALClose(dataset);
+    dataset = nullptr;
+    QFile::remove(filenameTiff);
+
+    if(copy == nullptr)
+    {
+        throw tr("Failed to create image file %1: %2").arg(filename, CPLGetLastErrorMsg());
+    }
+    GDALClose(copy);
+    // drop the auxiliary file GDAL creates for some formats
+    QFile::remove(filename + ".aux.xml");
+}
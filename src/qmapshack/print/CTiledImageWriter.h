@@ -0,0 +1,77 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CTILEDIMAGEWRITER_H
+#define CTILEDIMAGEWRITER_H
+
+#include <QCoreApplication>
+#include <QImage>
+
+class GDALDataset;
+
+/**
+   @brief Write an image piece by piece without holding it in memory
+
+   The image is written as tiled (Big)TIFF by GDAL. If the file's suffix
+   asks for PNG or JPEG the TIFF is a temporary file converted on close().
+   GDAL converts line by line, so the memory needed does not depend on the
+   image size either.
+
+   All methods throw a QString on errors.
+ */
+class CTiledImageWriter
+{
+    Q_DECLARE_TR_FUNCTIONS(CTiledImageWriter)
+public:
+    /**
+       @brief Create the image file
+
+       @param filename  the file name, the suffix selects the format (tif, png or jpg)
+       @param size      the image's size in [pixel]
+     */
+    CTiledImageWriter(const QString& filename, const QSize& size);
+    virtual ~CTiledImageWriter();
+
+    /// the file dialog filters of all supported formats
+    static QStringList getFilters();
+    /// get the suffix belonging to one of the filters returned by getFilters()
+    static QString getSuffix(const QString& filter);
+
+    /**
+       @brief Write a piece of the image
+
+       @param rect  the piece's position and size in the image, parts outside the image are ignored
+       @param img   the piece's content
+     */
+    void write(const QRect& rect, const QImage& img);
+
+    /// flush all data and convert the image to the final format
+    void close();
+
+private:
+    QString filename;
+    QString filenameTiff;
+    QString driver;
+    QSize size;
+    qint32 nBands = 4;
+
+    GDALDataset* dataset = nullptr;
+};
+
+#endif //CTILEDIMAGEWRITER_H
+
@@ -0,0 +1,45 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "realtime/CRtTimeWindowDialog.h"
+
+#include <QtWidgets>
+
+CRtTimeWindowDialog::CRtTimeWindowDialog(QWidget* parent, QDateTime& start, QDateTime& end)
+    : QDialog(parent)
+    , start(start)
+    , end(end)
+{
+    setupUi(this);
+
+    dateTimeStart->setDateTimeRange(start, end);
+    dateTimeEnd->setDateTimeRange(start, end);
+    dateTimeStart->setDateTime(start);
+    dateTimeEnd->setDateTime(end);
+
+    connect(dateTimeStart, &QDateTimeEdit::dateTimeChanged, dateTimeEnd, &QDateTimeEdit::setMinimumDateTime);
+}
+
+void CRtTimeWindowDialog::accept()
+{
+    // the edits show seconds only, include the whole last second
+    start = dateTimeStart->dateTime();
+    end = dateTimeEnd->dateTime().addMSecs(999);
+
+    QDialog::accept();
+}
@@ -0,0 +1,44 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CRTTIMEWINDOWDIALOG_H
+#define CRTTIMEWINDOWDIALOG_H
+
+#include "ui_IRtTimeWindowDialog.h"
+#include <QDialog>
+
+/**
+   @brief Select the time window of a record to be converted into a track
+ */
+class CRtTimeWindowDialog : public QDialog, private Ui::IRtTimeWindowDialog
+{
+    Q_OBJECT
+public:
+    CRtTimeWindowDialog(QWidget* parent, QDateTime& start, QDateTime& end);
+    virtual ~CRtTimeWindowDialog() = default;
+
+public slots:
+    void accept() override;
+
+private:
+    QDateTime& start;
+    QDateTime& end;
+};
+
+#endif //CRTTIMEWINDOWDIALOG_H
+
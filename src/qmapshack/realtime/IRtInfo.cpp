@@ -19,6 +19,7 @@
 #include "gis/CGisWorkspace.h"
 #include "gis/trk/CGisItemTrk.h"
 #include "helpers/CSettings.h"
+#include "realtime/CRtTimeWindowDialog.h"
 #include "realtime/IRtInfo.h"
 
 #include <QtWidgets>
@@ -74,6 +75,18 @@ void IRtInfo::slotToTrack()
         return;
     }
 
+    QDateTime start, end;
+    if(!record->getTimeRange(start, end))
+    {
+        return;
+    }
+
+    CRtTimeWindowDialog dlg(this, start, end);
+    if(dlg.exec() != QDialog::Accepted)
+    {
+        return;
+    }
+
     IGisProject* prj = CGisWorkspace::self().selectProject(false);
     if(prj == nullptr)
     {
@@ -81,7 +94,7 @@ void IRtInfo::slotToTrack()
     }
 
     CTrackData data;
-    fillTrackData(data);
+    fillTrackData(data, start, end);
 
     new CGisItemTrk(data, prj);
 }
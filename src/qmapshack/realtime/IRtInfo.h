@@ -43,7 +43,14 @@ protected slots:
 
 protected:
     virtual void startRecord(const QString& filename) = 0;
-    virtual void fillTrackData(CTrackData& data) = 0;
+    /**
+       @brief Fill the track data with the recorded points of a time window
+
+       @param data      the track data to fill
+       @param start     the start of the time window
+       @param end       the end of the time window
+     */
+    virtual void fillTrackData(CTrackData& data, const QDateTime& start, const QDateTime& end) = 0;
 
     QPointer<IRtSource> source;
     QPointer<IRtRecord> record;
@@ -21,24 +21,123 @@
 
 #include <QtCore>
 
+/// the first bytes of a record file of the segmented format
+#define RECORD_MAGIC        "QMSREC02"
+#define RECORD_MAGIC_SIZE   8
+#define SEGMENT_MAGIC       0x47455352
+/// magic, count, size, crc, start, end
+#define SEGMENT_HEADER_SIZE (4 + 4 + 4 + 2 + 8 + 8)
+/// buffered entries are written at least with this interval [ms]
+#define FLUSH_INTERVAL      10000
+/// the maximum number of entries in a segment
+#define FLUSH_ENTRIES       256
+
 IRtRecord::IRtRecord(QObject* parent)
     : QObject(parent)
+    , trailEnd(std::numeric_limits<qint64>::min())
 {
+    bufferSegment.count = 0;
+
+    timerFlush = new QTimer(this);
+    timerFlush->setSingleShot(true);
+    timerFlush->setInterval(FLUSH_INTERVAL);
+    connect(timerFlush, &QTimer::timeout, this, [this]()
+    {
+        if(!flush())
+        {
+            qDebug() << filename << error;
+        }
+    });
+}
+
+IRtRecord::~IRtRecord()
+{
+    flush();
 }
 
 bool IRtRecord::setFile(const QString& fn)
 {
-    track.clear();
+    flush();
+
+    trail.clear();
+    trailEnd = std::numeric_limits<qint64>::min();
+    segments.clear();
     filename = fn;
 
-    if(QFile::exists(filename))
+    QFile file(filename);
+    if(!file.exists() || file.size() == 0)
+    {
+        return true;
+    }
+
+    if(!file.open(QIODevice::ReadOnly))
     {
-        return readFile(filename);
+        error = tr("Failed to open record for reading.");
+        return false;
+    }
+    const QByteArray& magic = file.read(RECORD_MAGIC_SIZE);
+    file.close();
+
+    if(magic != RECORD_MAGIC)
+    {
+        return convertFile(filename);
+    }
+
+    return readIndex(filename);
+}
+
+bool IRtRecord::readIndex(const QString& filename)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        error = tr("Failed to open record for reading.");
+        return false;
+    }
+
+    const qint64 size = file.size();
+    const uchar* ptr = file.map(0, size);
+    if(ptr == nullptr)
+    {
+        error = tr("Failed to open record for reading.");
+        return false;
+    }
+
+    qint64 pos = RECORD_MAGIC_SIZE;
+    while(pos + SEGMENT_HEADER_SIZE <= size)
+    {
+        QDataStream stream(QByteArray::fromRawData(reinterpret_cast<const char*>(ptr + pos), SEGMENT_HEADER_SIZE));
+        stream.setVersion(QDataStream::Qt_5_2);
+        stream.setByteOrder(QDataStream::LittleEndian);
+
+        quint32 magic;
+        segment_t segment;
+        stream >> magic >> segment.count >> segment.size >> segment.crc >> segment.start >> segment.end;
+        segment.offset = pos + SEGMENT_HEADER_SIZE;
+
+        if((magic != SEGMENT_MAGIC) || (segment.offset + segment.size > size))
+        {
+            break;
+        }
+
+        segments << segment;
+        pos = segment.offset + segment.size;
     }
+
+    file.unmap(const_cast<uchar*>(ptr));
+    file.close();
+
+    if(pos != size)
+    {
+        error = tr("Failed to read entry. Truncate record to last valid entry.");
+        QFile::resize(filename, pos);
+        return false;
+    }
+
     return true;
 }
 
-bool IRtRecord::readFile(const QString& filename)
+bool IRtRecord::convertFile(const QString& filename)
 {
     QFile file(filename);
     if(!file.open(QIODevice::ReadOnly))
@@ -51,31 +150,68 @@ bool IRtRecord::readFile(const QString& filename)
     stream.setVersion(QDataStream::Qt_5_2);
     stream.setByteOrder(QDataStream::LittleEndian);
 
+    bool truncated = false;
+    QList<QByteArray> entries;
     while(!stream.atEnd())
     {
-        quint64 size = stream.device()->pos();
-
         quint16 crc;
         QByteArray data;
         stream >> crc >> data;
 
         if((qChecksum(data.data(), data.size()) != crc) || (stream.status() != QDataStream::Ok))
         {
-            error = tr("Failed to read entry. Truncate record to last valid entry.");
-            file.close();
-            QFile::resize(filename, size);
-            return false;
+            truncated = true;
+            break;
         }
 
-        readEntry(data);
+        entries << data;
     }
-
     file.close();
+
+    // write all valid entries into a new file of the segmented format
+    this->filename = filename + ".tmp";
+    QFile::remove(this->filename);
+    for(QByteArray& data : entries)
+    {
+        QVector<CTrackData::trkpt_t> pts;
+        if(readEntry(data, pts) && !pts.isEmpty())
+        {
+            writeEntry(data, pts.first());
+        }
+    }
+
+    const bool success = flush();
+    this->filename = filename;
+    if(!success)
+    {
+        return false;
+    }
+
+    QFile::remove(filename);
+    QFile::rename(filename + ".tmp", filename);
+
+    if(truncated)
+    {
+        error = tr("Failed to read entry. Truncate record to last valid entry.");
+        return false;
+    }
     return true;
 }
 
-bool IRtRecord::writeEntry(const QByteArray& data)
+bool IRtRecord::writeHeader(QFile& file)
+{
+    return file.write(RECORD_MAGIC, RECORD_MAGIC_SIZE) == RECORD_MAGIC_SIZE;
+}
+
+bool IRtRecord::flush()
 {
+    if(bufferSegment.count == 0 || filename.isEmpty())
+    {
+        return true;
+    }
+
+    timerFlush->stop();
+
     QFile file(filename);
     if(!file.open(QIODevice::Append))
     {
@@ -83,12 +219,24 @@ bool IRtRecord::writeEntry(const QByteArray& data)
         return false;
     }
 
+    if((file.size() == 0) && !writeHeader(file))
+    {
+        error = tr("Failed to write entry.");
+        file.close();
+        return false;
+    }
+
     QDataStream stream(&file);
     stream.setVersion(QDataStream::Qt_5_2);
     stream.setByteOrder(QDataStream::LittleEndian);
 
-    quint16 crc = qChecksum(data.data(), data.size());
-    stream << crc << data;
+    segment_t segment = bufferSegment;
+    segment.size = buffer.size();
+    segment.crc = qChecksum(buffer.constData(), buffer.size());
+
+    stream << quint32(SEGMENT_MAGIC) << segment.count << segment.size << segment.crc << segment.start << segment.end;
+    segment.offset = file.pos();
+    stream.writeRawData(buffer.constData(), buffer.size());
 
     if(stream.status() != QDataStream::Ok)
     {
@@ -98,10 +246,51 @@ bool IRtRecord::writeEntry(const QByteArray& data)
     }
 
     file.close();
+
+    segments << segment;
+    buffer.clear();
+    bufferSegment.count = 0;
+    return true;
+}
+
+bool IRtRecord::writeEntry(const QByteArray& data, const CTrackData::trkpt_t& trkpt)
+{
+    if(!trkpt.time.isValid())
+    {
+        return true;
+    }
+
+    QDataStream stream(&buffer, QIODevice::Append);
+    stream.setVersion(QDataStream::Qt_5_2);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream << data;
+
+    const qint64 timestamp = trkpt.time.toMSecsSinceEpoch();
+    if(bufferSegment.count == 0)
+    {
+        bufferSegment.start = timestamp;
+        bufferSegment.end = timestamp;
+    }
+    else
+    {
+        bufferSegment.start = qMin(bufferSegment.start, timestamp);
+        bufferSegment.end = qMax(bufferSegment.end, timestamp);
+    }
+    bufferSegment.count++;
+
+    if(bufferSegment.count >= FLUSH_ENTRIES)
+    {
+        return flush();
+    }
+
+    if(!timerFlush->isActive())
+    {
+        timerFlush->start();
+    }
     return true;
 }
 
-bool IRtRecord::readEntry(QByteArray& data)
+bool IRtRecord::readEntry(QByteArray& data, QVector<CTrackData::trkpt_t>& pts) const
 {
     QDataStream stream(&data, QIODevice::ReadOnly);
     stream.setVersion(QDataStream::Qt_5_2);
@@ -112,27 +301,156 @@ bool IRtRecord::readEntry(QByteArray& data)
 
     CTrackData::trkpt_t trkpt;
     stream >> trkpt;
-    track << trkpt;
+    pts << trkpt;
     return true;
 }
 
+void IRtRecord::readSegmentData(const QByteArray& data, QVector<CTrackData::trkpt_t>& pts) const
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_2);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    while(!stream.atEnd())
+    {
+        QByteArray entry;
+        stream >> entry;
+        if(stream.status() != QDataStream::Ok)
+        {
+            break;
+        }
+        readEntry(entry, pts);
+    }
+}
+
+void IRtRecord::readSegments(qint64 start, qint64 end, QVector<CTrackData::trkpt_t>& pts) const
+{
+    if(segments.isEmpty())
+    {
+        return;
+    }
+
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    const qint64 size = file.size();
+    const uchar* ptr = file.map(0, size);
+    if(ptr == nullptr)
+    {
+        return;
+    }
+
+    for(const segment_t& segment : segments)
+    {
+        if((segment.end < start) || (segment.start > end))
+        {
+            continue;
+        }
+
+        if(segment.offset + segment.size > size)
+        {
+            break;
+        }
+
+        const QByteArray& data = QByteArray::fromRawData(reinterpret_cast<const char*>(ptr + segment.offset), segment.size);
+        if(qChecksum(data.constData(), data.size()) != segment.crc)
+        {
+            qDebug() << "Skip broken segment in record" << filename << "at" << segment.offset;
+            continue;
+        }
+
+        readSegmentData(data, pts);
+    }
+
+    file.unmap(const_cast<uchar*>(ptr));
+}
+
+void IRtRecord::readWindow(qint64 start, qint64 end, QVector<CTrackData::trkpt_t>& pts) const
+{
+    QVector<CTrackData::trkpt_t> decoded;
+    readSegments(start, end, decoded);
+    if((bufferSegment.count != 0) && (bufferSegment.end >= start) && (bufferSegment.start <= end))
+    {
+        readSegmentData(buffer, decoded);
+    }
+
+    // the segments overlapping the window can hold entries outside of it
+    for(const CTrackData::trkpt_t& trkpt : qAsConst(decoded))
+    {
+        const qint64 t = trkpt.time.isValid() ? trkpt.time.toMSecsSinceEpoch() : 0;
+        if((t >= start) && (t <= end))
+        {
+            pts << trkpt;
+        }
+    }
+}
+
+bool IRtRecord::getTimeRange(QDateTime& start, QDateTime& end) const
+{
+    qint64 t1 = std::numeric_limits<qint64>::max();
+    qint64 t2 = std::numeric_limits<qint64>::min();
+    for(const segment_t& segment : segments)
+    {
+        t1 = qMin(t1, segment.start);
+        t2 = qMax(t2, segment.end);
+    }
+
+    if(bufferSegment.count != 0)
+    {
+        t1 = qMin(t1, bufferSegment.start);
+        t2 = qMax(t2, bufferSegment.end);
+    }
+
+    if(t1 > t2)
+    {
+        return false;
+    }
+
+    start = QDateTime::fromMSecsSinceEpoch(t1);
+    end = QDateTime::fromMSecsSinceEpoch(t2);
+    return true;
+}
+
+QVector<CTrackData::trkpt_t> IRtRecord::getTrack(const QDateTime& start, const QDateTime& end) const
+{
+    QVector<CTrackData::trkpt_t> pts;
+    readWindow(start.toMSecsSinceEpoch(), end.toMSecsSinceEpoch(), pts);
+    return pts;
+}
+
 void IRtRecord::reset()
 {
-    track.clear();
+    timerFlush->stop();
+    buffer.clear();
+    bufferSegment.count = 0;
+
+    trail.clear();
+    trailEnd = std::numeric_limits<qint64>::min();
+    segments.clear();
     QFile::resize(filename, 0);
 }
 
 void IRtRecord::draw(QPainter& p, const QPolygonF& viewport, QList<QRectF>& blockedAreas, CRtDraw* rt)
 {
-    QPolygonF tmp;
-    for(const CTrackData::trkpt_t& trkpt : qAsConst(track))
+    // only the entries recorded since the last paint have to be decoded
+    if(trailEnd < std::numeric_limits<qint64>::max())
     {
-        tmp << QPointF(trkpt.lon * DEG_TO_RAD, trkpt.lat * DEG_TO_RAD);
+        QVector<CTrackData::trkpt_t> pts;
+        readWindow(trailEnd + 1, std::numeric_limits<qint64>::max(), pts);
+        for(const CTrackData::trkpt_t& trkpt : qAsConst(pts))
+        {
+            trail << QPointF(trkpt.lon * DEG_TO_RAD, trkpt.lat * DEG_TO_RAD);
+            trailEnd = qMax(trailEnd, trkpt.time.isValid() ? trkpt.time.toMSecsSinceEpoch() : 0);
+        }
     }
 
+    QPolygonF tmp = trail;
+
     rt->convertRad2Px(tmp);
     p.setPen(QPen(Qt::black, 3));
     p.drawPolyline(tmp);
 }
 
-
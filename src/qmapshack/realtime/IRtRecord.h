@@ -24,16 +24,34 @@
 #include <QDataStream>
 #include <QFile>
 #include <QObject>
+#include <QPolygonF>
 
 class CRtDraw;
 class QPainter;
+class QTimer;
 
+/**
+   @brief Base class for records of realtime data
+
+   The record file is a log of segments. Each segment holds a block of
+   entries together with a checksum and the time range of the entries.
+   New entries are buffered and written as a new segment periodically.
+   This way the file is not opened for each entry.
+
+   On startup only the segment headers are read to build an index of
+   the time ranges. Only the segments overlapping a requested time window
+   are decoded. The record is drawn incrementally. Each paint decodes the
+   entries recorded since the last one, only.
+
+   Files of the old format (one entry with checksum after the other)
+   are converted on the fly.
+ */
 class IRtRecord : public QObject
 {
     Q_OBJECT
 public:
     IRtRecord(QObject* parent);
-    virtual ~IRtRecord() = default;
+    virtual ~IRtRecord();
 
     /**
        @brief Set record file size to 0.
@@ -42,7 +60,7 @@ public:
     /**
        @brief Set file name to record into
 
-       If the file exists this will read the file and append new data.
+       If the file exists this will read the file's index and append new data.
 
        @param fn  the filename as string
 
@@ -67,53 +85,114 @@ public:
      */
     virtual void draw(QPainter& p, const QPolygonF& viewport, QList<QRectF>& blockedAreas, CRtDraw* rt);
 
-    virtual const QVector<CTrackData::trkpt_t>& getTrack() const
-    {
-        return track;
-    }
+    /**
+       @brief Get the time range of all entries in the record
+
+       @param start     the time of the first entry
+       @param end       the time of the last entry
+
+       @return Return false if the record is empty.
+     */
+    bool getTimeRange(QDateTime& start, QDateTime& end) const;
+
+    /**
+       @brief Get the track points of a time window
+
+       Only the segments overlapping the time window are decoded.
+
+       @param start     the start of the time window
+       @param end       the end of the time window
+
+       @return A list of track points.
+     */
+    QVector<CTrackData::trkpt_t> getTrack(const QDateTime& start, const QDateTime& end) const;
+
+    /**
+       @brief Write all buffered entries to the file
+
+       @return Return true on success.
+     */
+    bool flush();
 
 protected:
     /**
        @brief Write block of data to file
 
-       A crc16 is calculated and stored together with the byte array into the file.
+       The data is buffered and written together with other entries as a segment.
+       Entries without a valid timestamp are dropped as they would break the
+       segment's time range.
 
-       @param data  the byte array to store
+       @param data      the byte array to store
+       @param trkpt     the track point represented by the data
 
        @return Return true on success.
      */
-    virtual bool writeEntry(const QByteArray& data);
+    virtual bool writeEntry(const QByteArray& data, const CTrackData::trkpt_t& trkpt);
 
     /**
        @brief A block data has been read and needs further processing
 
        If a filename is set and the file exists, the data entries in the file are read
-       one by one and passed to this API. If the method returns with false the file will
-       be truncated to the last valid entry.
+       one by one and passed to this API.
 
        @param data  the byte array with the data entry.
+       @param pts   the list of track points to append the entry to
 
        @return Return true on success.
      */
-    virtual bool readEntry(QByteArray& data);
-
-protected:
-    QVector<CTrackData::trkpt_t> track;
+    virtual bool readEntry(QByteArray& data, QVector<CTrackData::trkpt_t>& pts) const;
 
 private:
+    struct segment_t
+    {
+        /// offset of the segment's entries in the file
+        qint64 offset;
+        quint32 size;
+        quint32 count;
+        quint16 crc;
+        /// time range of the entries in [ms] since epoch
+        qint64 start;
+        qint64 end;
+    };
 
     /**
-       @brief Reads file content entry by entry and tests for the checksum
+       @brief Read the segment index from the file
+
+       A broken segment at the end, e.g. caused by a crash, is truncated.
 
        @param filename  the file name to open and read.
 
        @return Return true on success.
      */
-    virtual bool readFile(const QString& filename);
+    bool readIndex(const QString& filename);
+    /// read a file of the old format and convert it
+    bool convertFile(const QString& filename);
+    /// decode the entries of all segments overlapping the time range [ms] and keep those within
+    void readWindow(qint64 start, qint64 end, QVector<CTrackData::trkpt_t>& pts) const;
+    /// decode the entries of all segments overlapping the time range [ms]
+    void readSegments(qint64 start, qint64 end, QVector<CTrackData::trkpt_t>& pts) const;
+    /// decode all entries in a block of segment data
+    void readSegmentData(const QByteArray& data, QVector<CTrackData::trkpt_t>& pts) const;
+    /// write the file header to an empty file
+    bool writeHeader(QFile& file);
 
     QString filename;
 
     QString error;
+
+    /// index of all segments in the file
+    QVector<segment_t> segments;
+
+    /// entries not written to the file yet
+    QByteArray buffer;
+    segment_t bufferSegment;
+
+    QTimer* timerFlush;
+
+    /// the record's positions drawn so far [rad]
+    QPolygonF trail;
+    /// the time of the latest entry in trail [ms]
+    qint64 trailEnd;
 };
 
 #endif //IRTRECORD_H
@@ -461,10 +461,10 @@ void CRtGpsTetherInfo::startRecord(const QString& filename)
     toolRecord->setEnabled(true);
 }
 
-void CRtGpsTetherInfo::fillTrackData(CTrackData& data)
+void CRtGpsTetherInfo::fillTrackData(CTrackData& data, const QDateTime& start, const QDateTime& end)
 {
     CTrackData::trkseg_t seg;
-    seg.pts = record->getTrack();
+    seg.pts = record->getTrack(start, end);
     data.segs << seg;
     data.name = lineHost->text();
 }
@@ -72,7 +72,7 @@ private:
 
 private:
     void startRecord(const QString& filename) override;
-    void fillTrackData(CTrackData& data) override;
+    void fillTrackData(CTrackData& data, const QDateTime& start, const QDateTime& end) override;
 
     QTcpSocket* socket;
     QTimer* timer;
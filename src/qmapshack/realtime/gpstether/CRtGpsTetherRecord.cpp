@@ -45,9 +45,8 @@ bool CRtGpsTetherRecord::writeEntry(qreal lon, qreal lat, qreal ele, qreal speed
     }
 
     stream << trkpt;
-    track << trkpt;
 
-    return writeEntry(data);
+    return writeEntry(data, trkpt);
 }
 
 
@@ -29,6 +29,11 @@
 
 const QString CRtOpenSky::strIcon("://icons/48x48/OpenSky.png");
 
+/// the interval to update the extrapolated aircraft positions [ms]
+#define ANIMATION_INTERVAL  1000
+/// the maximum time a position is extrapolated [s]
+#define MAX_EXTRAPOLATION   60
+
 CRtOpenSky::CRtOpenSky(QTreeWidget* parent)
     : IRtSource(eTypeOpenSky, true, parent)
 {
@@ -44,6 +49,12 @@ CRtOpenSky::CRtOpenSky(QTreeWidget* parent)
     timer->start();
     connect(timer, &QTimer::timeout, this, &CRtOpenSky::slotUpdate);
 
+    timerAnimation = new QTimer(this);
+    timerAnimation->setInterval(ANIMATION_INTERVAL);
+    timerAnimation->setSingleShot(false);
+    timerAnimation->start();
+    connect(timerAnimation, &QTimer::timeout, this, &CRtOpenSky::slotAnimate);
+
     networkAccessManager = new QNetworkAccessManager(this);
     connect(networkAccessManager, &QNetworkAccessManager::finished, this, &CRtOpenSky::slotRequestFinished);
 
@@ -69,6 +80,7 @@ void CRtOpenSky::loadSettings(QSettings& cfg)
 
     IRtSource::loadSettings(cfg);
     showNames = cfg.value("showNames", showNames).toBool();
+    setFeed(cfg.value("feed", "").toString());
 
     if(info != nullptr)
     {
@@ -84,6 +96,10 @@ void CRtOpenSky::saveSettings(QSettings& cfg) const
 
     IRtSource::saveSettings(cfg);
     cfg.setValue("showNames", showNames);
+    if(!feedPath.isEmpty())
+    {
+        cfg.setValue("feed", feedPath);
+    }
 
     if(info != nullptr)
     {
@@ -119,14 +135,95 @@ bool CRtOpenSky::getShowNames() const
 CRtOpenSky::aircraft_t CRtOpenSky::getAircraftByKey(const QString& key, bool& ok) const
 {
     QMutexLocker lock(&IRtSource::mutex);
-    ok = false;
-    if(aircrafts.contains(key))
+    const qint32 idx = aircraftIndex.value(key, NOIDX);
+    ok = idx != NOIDX;
+    return ok ? aircrafts[idx] : aircraft_t();
+}
+
+void CRtOpenSky::setFeed(const QString& path)
+{
+    feedPath = path;
+    feedFiles.clear();
+    feedIndex = 0;
+
+    if(feedPath.isEmpty())
+    {
+        return;
+    }
+
+    QFileInfo fi(feedPath);
+    if(fi.isDir())
+    {
+        QDir dir(feedPath);
+        for(const QString& filename : dir.entryList({"*.json"}, QDir::Files, QDir::Name))
+        {
+            feedFiles << dir.absoluteFilePath(filename);
+        }
+    }
+    else if(fi.isFile())
+    {
+        feedFiles << fi.absoluteFilePath();
+    }
+
+    qDebug() << "OpenSky: play" << feedFiles.size() << "local files from" << feedPath;
+}
+
+void CRtOpenSky::updateGrid()
+{
+    grid.clear();
+    for(qint32 idx = 0; idx < aircrafts.size(); idx++)
+    {
+        const aircraft_t& aircraft = aircrafts[idx];
+        if(aircraft.pos == NOPOINTF)
+        {
+            continue;
+        }
+
+        const qint32 lon = qBound(-180, qFloor(aircraft.pos.x()), 179);
+        const qint32 lat = qBound(-90, qFloor(aircraft.pos.y()), 89);
+        grid[gridKey(lon, lat)] << idx;
+    }
+}
+
+void CRtOpenSky::getAircraftsInArea(const QRectF& area, QVector<qint32>& indices) const
+{
+    // one more cell on each side for the aircrafts moved since the last update
+    const qint32 lon1 = qMax(-180, qFloor(area.left()) - 1);
+    const qint32 lon2 = qMin(179, qFloor(area.right()) + 1);
+    const qint32 lat1 = qMax(-90, qFloor(area.top()) - 1);
+    const qint32 lat2 = qMin(89, qFloor(area.bottom()) + 1);
+
+    for(qint32 lat = lat1; lat <= lat2; lat++)
+    {
+        for(qint32 lon = lon1; lon <= lon2; lon++)
+        {
+            auto cell = grid.constFind(gridKey(lon, lat));
+            if(cell != grid.constEnd())
+            {
+                indices += *cell;
+            }
+        }
+    }
+}
+
+QPointF CRtOpenSky::getPosition(const aircraft_t& aircraft, qint64 time) const
+{
+    if(aircraft.onGround || (aircraft.timePosition == NOINT) || (aircraft.velocity == NOFLOAT) || (aircraft.heading == NOFLOAT))
     {
-        ok = true;
-        return aircrafts[key];
+        return aircraft.pos;
     }
 
-    return aircraft_t();
+    // the age of the position at the time of the data set plus the time passed since it was received
+    qreal dt = (timestamp.toMSecsSinceEpoch() - qint64(aircraft.timePosition) * 1000 + time - timeReceived) / 1000.0;
+    dt = qBound(0.0, dt, qreal(MAX_EXTRAPOLATION));
+
+    // a flat earth is good enough for the short distance
+    const qreal d = aircraft.velocity * dt / 6371000.0;
+    const qreal h = aircraft.heading * DEG_TO_RAD;
+    const qreal lat = aircraft.pos.y() + d * qCos(h) * RAD_TO_DEG;
+    const qreal lon = aircraft.pos.x() + d * qSin(h) * RAD_TO_DEG / qCos(aircraft.pos.y() * DEG_TO_RAD);
+
+    return QPointF(lon, lat);
 }
 
 void CRtOpenSky::drawItem(QPainter& p, const QPolygonF& viewport, QList<QRectF>& blockedAreas, CRtDraw* rt)
@@ -136,33 +233,64 @@ void CRtOpenSky::drawItem(QPainter& p, const QPolygonF& viewport, QList<QRectF>&
         return;
     }
 
-    QPolygonF tmp2 = viewport;
-    rt->convertRad2Px(tmp2);
+    // the aircrafts are drawn by fastDraw() to move them between the updates
+
+    if(info != nullptr)
+    {
+        info->draw(p, viewport, blockedAreas, rt);
+    }
+}
+
+void CRtOpenSky::fastDraw(QPainter& p, const QRectF& viewport, CRtDraw* rt)
+{
+    aircraftsVisible.clear();
+    if(checkState(eColumnCheckBox) != Qt::Checked)
+    {
+        return;
+    }
+
+    // get the viewport's area in [°]
+    QPolygonF area;
+    area << viewport.topLeft() << viewport.topRight() << viewport.bottomRight() << viewport.bottomLeft();
+    for(QPointF& pt : area)
+    {
+        rt->convertPx2Rad(pt);
+        pt *= RAD_TO_DEG;
+    }
+
+    QVector<qint32> indices;
+    getAircraftsInArea(area.boundingRect(), indices);
 
     QFontMetrics fm(p.font());
 
+    p.save();
     p.setPen(Qt::yellow);
     p.setBrush(Qt::yellow);
     QPixmap icon("://icons/16x16/Aircraft.png");
     QRect rectIcon = icon.rect();
     rectIcon.moveCenter(QPoint(0, 0));
 
-    const QStringList& keys = aircrafts.keys();
-    for(const QString& key : keys)
+    QList<QRectF> blockedAreas;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for(qint32 idx : qAsConst(indices))
     {
-        aircraft_t& aircraft = aircrafts[key];
+        aircraft_t& aircraft = aircrafts[idx];
 
-        aircraft.point = aircraft.pos * DEG_TO_RAD;
+        aircraft.point = getPosition(aircraft, now) * DEG_TO_RAD;
         rt->convertRad2Px(aircraft.point);
 
-        if(!tmp2.boundingRect().contains(aircraft.point))
+        if(!viewport.contains(aircraft.point))
         {
             continue;
         }
+        aircraftsVisible << idx;
 
         p.save();
         p.translate(aircraft.point);
-        p.rotate(aircraft.heading);
+        if(aircraft.heading != NOFLOAT)
+        {
+            p.rotate(aircraft.heading);
+        }
         p.drawPixmap(rectIcon, icon);
         p.restore();
 
@@ -179,20 +307,14 @@ void CRtOpenSky::drawItem(QPainter& p, const QPolygonF& viewport, QList<QRectF>&
             }
         }
     }
+    p.restore();
 
-    if(info != nullptr)
-    {
-        info->draw(p, viewport, blockedAreas, rt);
-    }
-}
-
-void CRtOpenSky::fastDraw(QPainter& p, const QRectF& viewport, CRtDraw* rt)
-{
-    if(!keyFocus.isEmpty() && aircrafts.contains(keyFocus))
+    const qint32 idxFocus = aircraftIndex.value(keyFocus, NOIDX);
+    if(idxFocus != NOIDX)
     {
         p.save();
 
-        const aircraft_t& aircraft = aircrafts[keyFocus];
+        const aircraft_t& aircraft = aircrafts[idxFocus];
         p.setPen(Qt::red);
         p.setBrush(Qt::NoBrush);
         p.drawEllipse(aircraft.point, 10, 10);
@@ -202,14 +324,14 @@ void CRtOpenSky::fastDraw(QPainter& p, const QRectF& viewport, CRtDraw* rt)
         text += "<tr><td>" + tr("key:") + "</td><td>" + aircraft.key + "</td></tr>";
         text += "<tr><td>" + tr("callsign:") + "</td><td>" + aircraft.callsign + "</td></tr>";
         text += "<tr><td>" + tr("origin country:") + "</td><td>" + aircraft.originCountry + "</td></tr>";
-        text += "<tr><td>" + tr("time position:") + "</td><td>" + QDateTime::fromTime_t(aircraft.timePosition).toString() + "</td></tr>";
+        text += "<tr><td>" + tr("time position:") + "</td><td>" + (aircraft.timePosition == NOINT ? "-" : QDateTime::fromTime_t(aircraft.timePosition).toString()) + "</td></tr>";
         text += "<tr><td>" + tr("last contact:") + "</td><td>" + QDateTime::fromTime_t(aircraft.lastContact).toString() + "</td></tr>";
         text += "<tr><td>" + tr("longitude:") + "</td><td>" + QString::number(aircraft.longitude) + "°</td></tr>";
         text += "<tr><td>" + tr("latitude:") + "</td><td>" + QString::number(aircraft.latitude) + "°</td></tr>";
         text += "<tr><td>" + tr("geo. alt.:") + "</td><td>" + QString::number(aircraft.geoAltitude) + "m</td></tr>";
         text += "<tr><td>" + tr("on ground:") + "</td><td>" + QString::number(aircraft.onGround) + "</td></tr>";
-        text += "<tr><td>" + tr("velocity:") + "</td><td>" + QString::number(aircraft.velocity * 3.6) + "km/h</td></tr>";
-        text += "<tr><td>" + tr("heading:") + "</td><td>" + QString::number(aircraft.heading) + "°</td></tr>";
+        text += "<tr><td>" + tr("velocity:") + "</td><td>" + (aircraft.velocity == NOFLOAT ? "-" : QString::number(aircraft.velocity * 3.6) + "km/h") + "</td></tr>";
+        text += "<tr><td>" + tr("heading:") + "</td><td>" + (aircraft.heading == NOFLOAT ? "-" : QString::number(aircraft.heading) + "°") + "</td></tr>";
         text += "<tr><td>" + tr("vert. rate:") + "</td><td>" + QString::number(aircraft.verticalRate) + "m/s</td></tr>";
         text += "<tr><td>" + tr("baro. alt.:") + "</td><td>" + QString::number(aircraft.baroAltitude) + "m</td></tr>";
         text += "<tr><td>" + tr("squawk:") + "</td><td>" + aircraft.squawk + "</td></tr>";
@@ -247,18 +369,28 @@ void CRtOpenSky::mouseMove(const QPointF& pos)
     QMutexLocker lock(&IRtSource::mutex);
 
     keyFocus.clear();
-    const QStringList& keys = aircrafts.keys();
-    for(const QString& key : keys)
+    for(qint32 idx : qAsConst(aircraftsVisible))
     {
-        const aircraft_t& aircraft = aircrafts[key];
+        const aircraft_t& aircraft = aircrafts[idx];
         if((aircraft.point - pos).manhattanLength() < 20)
         {
-            keyFocus = key;
+            keyFocus = aircraft.key;
             break;
         }
     }
 }
 
+void CRtOpenSky::slotAnimate()
+{
+    if((checkState(eColumnCheckBox) != Qt::Checked) || aircrafts.isEmpty())
+    {
+        return;
+    }
+
+    // a fast update is sufficient as the aircrafts are drawn by fastDraw()
+    CCanvas::triggerCompleteUpdate(CCanvas::eRedrawNone);
+}
+
 void CRtOpenSky::slotSetShowNames(bool yes)
 {
     QMutexLocker lock(&IRtSource::mutex);
@@ -273,6 +405,17 @@ void CRtOpenSky::slotUpdate()
         return;
     }
 
+    if(!feedFiles.isEmpty())
+    {
+        QFile file(feedFiles[feedIndex]);
+        feedIndex = (feedIndex + 1) % feedFiles.size();
+        if(file.open(QIODevice::ReadOnly))
+        {
+            updateAircrafts(file.readAll());
+        }
+        return;
+    }
+
     QUrl url("https://opensky-network.org/");
     url.setPath("/api/states/all");
 
@@ -293,6 +436,11 @@ void CRtOpenSky::slotRequestFinished(QNetworkReply* reply)
     QByteArray data = reply->readAll();
     reply->deleteLater();
 
+    updateAircrafts(data);
+}
+
+void CRtOpenSky::updateAircrafts(const QByteArray& data)
+{
     if(data.isEmpty())
     {
         return;
@@ -308,38 +456,83 @@ void CRtOpenSky::slotRequestFinished(QNetworkReply* reply)
 
     {
         QMutexLocker lock(&IRtSource::mutex);
-        aircrafts.clear();
 
         timestamp = QDateTime::fromTime_t(json.object().value("time").toInt());
+        timeReceived = QDateTime::currentMSecsSinceEpoch();
+
+        QVector<bool> seen(aircrafts.size(), false);
+
         const QJsonArray& jsonStates = json.object().value("states").toArray();
         for(const QJsonValue& jsonState : jsonStates)
         {
-            aircraft_t aircraft;
             const QJsonArray& jsonStateArray = jsonState.toArray();
             QString key = jsonStateArray[0].toString();
 
+            qint32 idx = aircraftIndex.value(key, NOIDX);
+            if(idx == NOIDX)
+            {
+                idx = aircrafts.size();
+                aircrafts << aircraft_t();
+                aircraftIndex[key] = idx;
+                seen << true;
+            }
+            else
+            {
+                seen[idx] = true;
+            }
+
+            aircraft_t& aircraft = aircrafts[idx];
             aircraft.key = key;
             aircraft.callsign = jsonStateArray[1].toString();
             aircraft.originCountry = jsonStateArray[2].toString();
-            aircraft.timePosition = jsonStateArray[3].toInt();
+            aircraft.timePosition = jsonStateArray[3].isNull() ? NOINT : jsonStateArray[3].toInt();
             aircraft.lastContact = jsonStateArray[4].toInt();
             aircraft.longitude = jsonStateArray[5].toDouble();
             aircraft.latitude = jsonStateArray[6].toDouble();
             aircraft.geoAltitude = jsonStateArray[7].toDouble();
             aircraft.onGround = jsonStateArray[8].toBool();
-            aircraft.velocity = jsonStateArray[9].toDouble();
-            aircraft.heading = jsonStateArray[10].toDouble();
+            aircraft.velocity = jsonStateArray[9].isNull() ? NOFLOAT : jsonStateArray[9].toDouble();
+            aircraft.heading = jsonStateArray[10].isNull() ? NOFLOAT : jsonStateArray[10].toDouble();
             aircraft.verticalRate = jsonStateArray[11].toDouble();
             aircraft.baroAltitude = jsonStateArray[13].toDouble();
             aircraft.squawk = jsonStateArray[14].toString();
             aircraft.spi = jsonStateArray[15].toBool();
             aircraft.positionSource = jsonStateArray[16].toInt();
 
-            aircraft.pos = QPointF(aircraft.longitude, aircraft.latitude);
-            aircrafts[key] = aircraft;
+            const bool hasPosition = !jsonStateArray[5].isNull() && !jsonStateArray[6].isNull();
+            aircraft.pos = hasPosition ? QPointF(aircraft.longitude, aircraft.latitude) : NOPOINTF;
         }
+
+        // remove the aircrafts not in the data set anymore
+        qint32 n = 0;
+        for(qint32 idx = 0; idx < aircrafts.size(); idx++)
+        {
+            if(!seen[idx])
+            {
+                continue;
+            }
+            if(idx != n)
+            {
+                aircrafts[n] = aircrafts[idx];
+            }
+            n++;
+        }
+
+        if(n != aircrafts.size())
+        {
+            aircrafts.resize(n);
+            aircraftIndex.clear();
+            for(qint32 idx = 0; idx < aircrafts.size(); idx++)
+            {
+                aircraftIndex[aircrafts[idx].key] = idx;
+            }
+        }
+
+        // the indices might have changed
+        aircraftsVisible.clear();
+        updateGrid();
     }
 
-    emit sigChanged();
+    emit sigAircraftsUpdated();
+    CCanvas::triggerCompleteUpdate(CCanvas::eRedrawNone);
 }
-
@@ -30,6 +30,20 @@ class QNetworkAccessManager;
 class QNetworkReply;
 class CRtOpenSkyInfo;
 
+/**
+   @brief Realtime source for the aircraft positions provided by OpenSky
+
+   The aircrafts are updated in place with each poll and sorted into a grid
+   of 1°x1° cells. Drawing and the tooltip only process the aircrafts of
+   the visible cells. Between the polls the positions are extrapolated by
+   speed and heading. This is done by the fast draw with a periodic canvas
+   update. The realtime layer itself is not redrawn for a new poll.
+
+   For testing the online service can be replaced by local data. Set the
+   value "feed" in the source's settings to a JSON file or a directory of
+   JSON files in the format of the OpenSky API. The files are played one
+   by one in alphabetical order at the poll interval.
+ */
 class CRtOpenSky : public IRtSource
 {
     Q_OBJECT
@@ -98,6 +112,11 @@ public:
     void fastDraw(QPainter& p, const QRectF& viewport, CRtDraw* rt)  override;
     void mouseMove(const QPointF& pos) override;
     static const QString strIcon;
+
+signals:
+    /// emitted after new aircraft data has been received
+    void sigAircraftsUpdated();
+
 public slots:
     /**
        @brief Set visibility of callsign names
@@ -116,17 +135,56 @@ private slots:
        @param reply
      */
     void slotRequestFinished(QNetworkReply* reply);
+    /**
+       @brief Trigger a canvas update to move the aircrafts to their extrapolated position
+     */
+    void slotAnimate();
 
 private:
+    /**
+       @brief Update the aircrafts by a data set in the format of the OpenSky API
+
+       Known aircrafts are updated in place. Aircrafts missing in the data set are removed.
+
+       @param data  the JSON data
+     */
+    void updateAircrafts(const QByteArray& data);
+    /// sort all aircrafts into the grid
+    void updateGrid();
+    /// get the indices of all aircrafts in the grid cells overlapping an area in [°]
+    void getAircraftsInArea(const QRectF& area, QVector<qint32>& indices) const;
+    /// get the position in [°] extrapolated to a time in [ms]
+    QPointF getPosition(const aircraft_t& aircraft, qint64 time) const;
+    /// get the key of an aircraft's grid cell
+    static quint32 gridKey(qint32 lon, qint32 lat)
+    {
+        return quint32(lat + 90) * 360 + quint32(lon + 180);
+    }
+    /// setup the list of local files to be used instead of the online service
+    void setFeed(const QString& path);
+
     QPointer<CRtOpenSkyInfo> info;
     QTimer* timer;
+    QTimer* timerAnimation;
     QNetworkAccessManager* networkAccessManager;
 
     QDateTime timestamp;
-    QMap<QString, aircraft_t> aircrafts;
+    /// the time the last data set was received [ms]
+    qint64 timeReceived = 0;
+    QVector<aircraft_t> aircrafts;
+    /// the index of each aircraft in aircrafts by it's key
+    QHash<QString, qint32> aircraftIndex;
+    /// the indices of all aircrafts in a 1°x1° cell
+    QHash<quint32, QVector<qint32> > grid;
+    /// the indices of all aircrafts drawn by the last fast draw
+    QVector<qint32> aircraftsVisible;
     bool showNames = true;
 
     QString keyFocus;
+
+    QString feedPath;
+    QStringList feedFiles;
+    qint32 feedIndex = 0;
 };
 
 #endif //CRTOPENSKY_H
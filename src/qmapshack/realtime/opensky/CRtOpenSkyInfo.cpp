@@ -16,6 +16,7 @@
 
 **********************************************************************************************/
 
+#include "canvas/CCanvas.h"
 #include "gis/CGisWorkspace.h"
 #include "gis/trk/CGisItemTrk.h"
 #include "helpers/CSettings.h"
@@ -30,6 +31,7 @@ CRtOpenSkyInfo::CRtOpenSkyInfo(CRtOpenSky& source, QWidget* parent)
 {
     setupUi(this);
     connect(&source, &CRtOpenSky::sigChanged, this, &CRtOpenSkyInfo::slotUpdate);
+    connect(&source, &CRtOpenSky::sigAircraftsUpdated, this, &CRtOpenSkyInfo::slotUpdate);
     connect(checkShowNames, &QCheckBox::toggled, &source, &CRtOpenSky::slotSetShowNames);
     connect(toolPause, &QToolButton::toggled, toolReset, &QToolButton::setEnabled);
     connect(toolPause, &QToolButton::toggled, toolFile, &QToolButton::setEnabled);
@@ -72,6 +74,8 @@ void CRtOpenSkyInfo::slotUpdate()
                 QMessageBox::critical(this, tr("Error..."), record->getError(), QMessageBox::Ok);
                 toolPause->setChecked(true);
             }
+            // the record is drawn by the realtime layer
+            CCanvas::triggerCompleteUpdate(CCanvas::eRedrawRt);
         }
     }
 }
@@ -101,10 +105,10 @@ void CRtOpenSkyInfo::startRecord(const QString& filename)
     toolRecord->setEnabled(true);
 }
 
-void CRtOpenSkyInfo::fillTrackData(CTrackData& data)
+void CRtOpenSkyInfo::fillTrackData(CTrackData& data, const QDateTime& start, const QDateTime& end)
 {
     CTrackData::trkseg_t seg;
-    seg.pts = record->getTrack();
+    seg.pts = record->getTrack(start, end);
     data.segs << seg;
     data.name = lineKey->text();
 }
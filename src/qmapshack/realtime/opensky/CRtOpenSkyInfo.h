@@ -43,7 +43,7 @@ public slots:
 
 private:
     void startRecord(const QString& filename) override;
-    void fillTrackData(CTrackData& data) override;
+    void fillTrackData(CTrackData& data, const QDateTime& start, const QDateTime& end) override;
 };
 
 #endif //CRTOPENSKYINFO_H
@@ -26,6 +26,12 @@ CRtOpenSkyRecord::CRtOpenSkyRecord(QObject* parent)
 
 bool CRtOpenSkyRecord::writeEntry(const CRtOpenSky::aircraft_t& aircraft)
 {
+    // nothing to record without a position or its time
+    if((aircraft.timePosition == NOINT) || (aircraft.pos == NOPOINTF))
+    {
+        return true;
+    }
+
     QByteArray data;
     QDataStream stream(&data, QIODevice::WriteOnly);
     stream.setVersion(QDataStream::Qt_5_2);
@@ -41,8 +47,7 @@ bool CRtOpenSkyRecord::writeEntry(const CRtOpenSky::aircraft_t& aircraft)
     trkpt.time = QDateTime::fromTime_t(aircraft.timePosition);
 
     stream << trkpt;
-    track << trkpt;
 
-    return writeEntry(data);
+    return writeEntry(data, trkpt);
 }
 
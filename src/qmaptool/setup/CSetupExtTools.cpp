@@ -48,6 +48,9 @@ CSetupExtTools::CSetupExtTools(QWidget* parent)
     connect(toolResetGdalbuildvrt, &QToolButton::pressed, this, slot2(resetGdalbuildvrtOverride));
     connect(toolResetQmtrgb2pct, &QToolButton::pressed, this, slot2(resetQmtrgb2pctOverride));
     connect(toolResetQmtmap2jnx, &QToolButton::pressed, this, slot2(resetQmtmap2jnxOverride));
+
+    spinMaxProcesses->setValue(IAppSetup::self().getMaxProcesses());
+    connect(spinMaxProcesses, static_cast<void (QSpinBox::*)(int) >(&QSpinBox::valueChanged), this, [](int n){IAppSetup::self().setMaxProcesses(n); });
 }
 
 void CSetupExtTools::setupGui()
@@ -174,6 +174,17 @@ public:
         return !pathQmtmap2jnxOverride.isEmpty();
     }
 
+    /// the maximum number of external processes to run in parallel
+    qint32 getMaxProcesses() const
+    {
+        return maxProcesses;
+    }
+
+    void setMaxProcesses(qint32 n)
+    {
+        maxProcesses = qMax(1, n);
+    }
+
 
     virtual QString helpFile() = 0;
 signals:
@@ -207,6 +218,8 @@ protected:
     QString pathGdalbuildvrtOverride;
     QString pathQmtrgb2pctOverride;
     QString pathQmtmap2jnxOverride;
+
+    qint32 maxProcesses = 1;
 };
 
 #endif // IAPPSETUP_H
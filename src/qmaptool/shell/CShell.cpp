@@ -17,6 +17,7 @@
 **********************************************************************************************/
 
 #include "CMainWindow.h"
+#include "setup/IAppSetup.h"
 #include "shell/CShell.h"
 
 #include <QtWidgets>
@@ -27,23 +28,25 @@ CShell::CShell(QWidget* parent)
     : QTextBrowser(parent)
 {
     pSelf = this;
-
-    connect(&cmd, &QProcess::readyReadStandardError, this, &CShell::slotStderr);
-    connect(&cmd, &QProcess::readyReadStandardOutput, this, &CShell::slotStdout);
-
-    connect(&cmd, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &CShell::slotFinished);
-    connect(&cmd, static_cast<void (QProcess::*)(QProcess::ProcessError)   >(&QProcess::error), this, &CShell::slotError);
 }
 
 void CShell::slotError(QProcess::ProcessError error)
 {
+    QProcess* proc = qobject_cast<QProcess*>(sender());
+    if(proc == nullptr)
+    {
+        return;
+    }
+
     setTextColor(Qt::red);
-    insertPlainText(QString(tr("Execution of external program `%1` failed: ")).arg(cmd.program()));
+    insertPlainText(QString(tr("Execution of external program `%1` failed: ")).arg(proc->program()));
     switch(error)
     {
     case QProcess::FailedToStart:
         insertPlainText(QString(tr("Process cannot be started.\n")));
-        insertPlainText(QString(tr("Make sure the required packages are installed, `%1` exists and is executable.\n")).arg(cmd.program()));
+        insertPlainText(QString(tr("Make sure the required packages are installed, `%1` exists and is executable.\n")).arg(proc->program()));
+        // there will be no finished signal
+        finishCommand(proc, false);
         break;
 
     case QProcess::Crashed:
@@ -58,44 +61,60 @@ void CShell::slotError(QProcess::ProcessError error)
 
 void CShell::slotStderr()
 {
-    QString str;
-    setTextColor(Qt::red);
-    str = cmd.readAllStandardError();
+    QProcess* proc = qobject_cast<QProcess*>(sender());
+    if(proc != nullptr)
+    {
+        output(proc, proc->readAllStandardError(), Qt::red, buffersStderr);
+    }
+}
 
-    if(str[0] == '\r')
+void CShell::slotStdout()
+{
+    QProcess* proc = qobject_cast<QProcess*>(sender());
+    if(proc != nullptr)
     {
-#ifdef Q_OS_WIN64
-        if(str.contains("\n"))
-        {
-            insertPlainText("\n");
-        }
-        else
-#endif // Q_OS_WIN64
-        {
-            moveCursor( QTextCursor::End, QTextCursor::MoveAnchor );
-            moveCursor( QTextCursor::StartOfLine, QTextCursor::MoveAnchor );
-            moveCursor( QTextCursor::End, QTextCursor::KeepAnchor );
-            textCursor().removeSelectedText();
-        }
+        output(proc, proc->readAllStandardOutput(), Qt::blue, buffersStdout);
+    }
+}
 
+void CShell::output(QProcess* proc, const QString& str, const QColor& color, QHash<QProcess*, QString>& buffers)
+{
+    if(str.isEmpty())
+    {
+        return;
+    }
 
-#ifdef Q_OS_WIN64
-        str = str.split("\r").last().remove("\r").remove("\n");
-#else
-        str = str.split("\r").last();
-#endif
+    setTextColor(color);
+
+    if(maxProcesses == 1)
+    {
+        outputLive(str);
+        return;
+    }
+
+    // Processes run in parallel. Paste complete lines only. A carriage
+    // return in the line is a progress update. Use the last one.
+    const CShellCmd& command = commands[running.value(proc)];
+    const QString& prefix = QString("[%1] ").arg(command.getChain());
+
+    QString& buffer = buffers[proc];
+    buffer += str;
+
+    qint32 idx;
+    while((idx = buffer.indexOf('\n')) >= 0)
+    {
+        const QString& line = buffer.left(idx).split('\r').last();
+        buffer.remove(0, idx + 1);
+
+        moveCursor(QTextCursor::End, QTextCursor::MoveAnchor);
+        insertPlainText(prefix + line + "\n");
     }
 
-    insertPlainText(str);
     verticalScrollBar()->setValue(verticalScrollBar()->maximum());
 }
 
-void CShell::slotStdout()
+void CShell::outputLive(QString str)
 {
-    QString str;
-    setTextColor(Qt::blue);
-    str = cmd.readAllStandardOutput();
-
     if(str[0] == '\r')
     {
 #ifdef Q_OS_WIN64
@@ -139,60 +158,165 @@ void CShell::stdErr(const QString& str)
 
 void CShell::slotFinished(int exitCode, QProcess::ExitStatus status)
 {
-    if(exitCode || status)
+    QProcess* proc = qobject_cast<QProcess*>(sender());
+    if(proc != nullptr)
+    {
+        finishCommand(proc, !(exitCode || status));
+    }
+}
+
+void CShell::finishCommand(QProcess* proc, bool success)
+{
+    if(!running.contains(proc))
     {
-        emit sigFinishedJob(jobId);
-        setTextColor(Qt::red);
-        append(tr("!!! failed !!!\n"));
         return;
     }
 
-    ++idxCommand;
+    const qint32 idx = running.take(proc);
+    states[idx] = eStateDone;
+
+    // flush incomplete lines
+    const QString& prefix = QString("[%1] ").arg(commands[idx].getChain());
+    const QString& out = buffersStdout.take(proc);
+    if(!out.isEmpty())
+    {
+        setTextColor(Qt::blue);
+        append(prefix + out.split('\r').last());
+    }
+    const QString& err = buffersStderr.take(proc);
+    if(!err.isEmpty())
+    {
+        setTextColor(Qt::red);
+        append(prefix + err.split('\r').last());
+    }
+
+    proc->deleteLater();
+
+    if(!success && !failed)
+    {
+        failed = true;
+        if(maxProcesses > 1)
+        {
+            stdErr(tr("%1Command failed: %2").arg(prefix).arg(commands[idx].getCmd()));
+        }
+    }
+
     nextCommand();
 }
 
 void CShell::slotCancel()
 {
-    if(cmd.state() == QProcess::NotRunning)
+    if(running.isEmpty())
     {
         return;
     }
 
     stdOut(tr("\nCanceled by user's request.\n"));
-    cmd.kill();
-    cmd.waitForFinished(10000);
+
+    // no more commands will be started
+    failed = true;
+    const QList<QProcess*>& procs = running.keys();
+    for(QProcess* proc : procs)
+    {
+        proc->kill();
+    }
 }
 
 int CShell::execute(QList<CShellCmd> cmds)
 {
     CMainWindow::self().makeShellVisible();
 
-    if(cmd.state() != QProcess::NotRunning)
+    if(busy)
     {
         return -1;
     }
 
     clear();
 
-    idxCommand = 0;
     commands = cmds;
+    states.fill(eStatePending, commands.size());
+    maxProcesses = IAppSetup::self().getMaxProcesses();
+    busy = true;
+    failed = false;
 
-    nextCommand();
+    // start with the event loop, the caller has to get the job ID first
+    QTimer::singleShot(0, this, [this](){nextCommand(); });
     return ++jobId;
 }
 
+bool CShell::isReady(qint32 idx) const
+{
+    const CShellCmd& command = commands[idx];
+
+    for(qint32 i = idx - 1; i >= 0; i--)
+    {
+        if(command.isBarrier())
+        {
+            if(states[i] != eStateDone)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        // The previous command of the same chain or the last barrier decides.
+        // Everything before has been done before these could start.
+        const CShellCmd& other = commands[i];
+        if(other.isBarrier() || (other.getChain() == command.getChain()))
+        {
+            return states[i] == eStateDone;
+        }
+    }
+
+    return true;
+}
+
+void CShell::startCommand(qint32 idx)
+{
+    const CShellCmd& command = commands[idx];
+
+    QProcess* proc = new QProcess(this);
+    connect(proc, &QProcess::readyReadStandardError, this, &CShell::slotStderr);
+    connect(proc, &QProcess::readyReadStandardOutput, this, &CShell::slotStdout);
+    connect(proc, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &CShell::slotFinished);
+    connect(proc, static_cast<void (QProcess::*)(QProcess::ProcessError)   >(&QProcess::error), this, &CShell::slotError);
+
+    states[idx] = eStateRunning;
+    running[proc] = idx;
+
+    const QString& prefix = maxProcesses > 1 ? QString("[%1] ").arg(command.getChain()) : QString();
+    stdOut(prefix + command.getCmd() + " " + command.getArgs().join(" ") + "\n");
+    proc->start(command.getCmd(), command.getArgs());
+}
 
 void CShell::nextCommand()
 {
-    if(idxCommand >= commands.size())
+    if(!failed)
+    {
+        for(qint32 idx = 0; (idx < commands.size()) && (running.size() < maxProcesses); idx++)
+        {
+            if((states[idx] == eStatePending) && isReady(idx))
+            {
+                startCommand(idx);
+            }
+        }
+    }
+
+    if(!running.isEmpty() || !busy)
     {
-        emit sigFinishedJob(jobId);
-        setTextColor(Qt::darkGreen);
-        append(tr("!!! done !!!\n"));
         return;
     }
 
-    const CShellCmd& command = commands[idxCommand];
-    stdOut(command.getCmd() + " " + command.getArgs().join(" ") + "\n");
-    cmd.start(command.getCmd(), command.getArgs());
+    busy = false;
+    emit sigFinishedJob(jobId);
+    if(failed)
+    {
+        setTextColor(Qt::red);
+        append(tr("!!! failed !!!\n"));
+    }
+    else
+    {
+        setTextColor(Qt::darkGreen);
+        append(tr("!!! done !!!\n"));
+    }
 }
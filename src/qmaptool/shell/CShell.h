@@ -21,10 +21,22 @@
 
 #include "shell/CShellCmd.h"
 
+#include <QHash>
 #include <QList>
 #include <QProcess>
 #include <QTextBrowser>
+#include <QVector>
 
+/**
+   @brief Execute a list of commands
+
+   Commands of different chains run in parallel up to the maximum number
+   of processes set by IAppSetup::getMaxProcesses(). See CShellCmd for
+   the rules of execution order.
+
+   If processes run in parallel, their output is collected line by line
+   and prefixed by the command's chain ID.
+ */
 class CShell : public QTextBrowser
 {
     Q_OBJECT
@@ -52,6 +64,7 @@ protected slots:
     virtual void slotFinished(int exitCode, QProcess::ExitStatus status);
 
 protected:
+    /// start all commands ready to run, report the end of the job if all commands are done
     void nextCommand();
 
     /// write text to stdout color channel of the text browser
@@ -59,17 +72,43 @@ protected:
     /// write text to stderr color channel of the text browser
     void stdErr(const QString& str);
 
-    QProcess cmd;
-
     QList<CShellCmd> commands;
-    qint32 idxCommand = 0;
     qint32 jobId = 0;
 
 private:
     friend class Ui_IMainWindow;
     CShell(QWidget* parent);
     static CShell* pSelf;
+
+    enum state_e
+    {
+        eStatePending
+        , eStateRunning
+        , eStateDone
+    };
+
+    /// true if all commands the command depends on are done
+    bool isReady(qint32 idx) const;
+    void startCommand(qint32 idx);
+    /// remove the process and schedule the next commands
+    void finishCommand(QProcess* proc, bool success);
+    /// paste output of a process into the text browser
+    void output(QProcess* proc, const QString& str, const QColor& color, QHash<QProcess*, QString>& buffers);
+    /// paste output into the text browser, handle carriage returns of progress output
+    void outputLive(QString str);
+
+    /// the state of each command in the list
+    QVector<state_e> states;
+    /// all running processes and the index of their command
+    QHash<QProcess*, qint32> running;
+    /// incomplete lines of stdout per process
+    QHash<QProcess*, QString> buffersStdout;
+    /// incomplete lines of stderr per process
+    QHash<QProcess*, QString> buffersStderr;
+    /// the maximum number of processes of the current job
+    qint32 maxProcesses = 1;
+    bool busy = false;
+    bool failed = false;
 };
 
 #endif //CSHELL_H
-
@@ -24,4 +24,12 @@ CShellCmd::CShellCmd(const QString& cmd, const QStringList& args)
 {
 }
 
+void CShellCmd::setChain(QList<CShellCmd>& cmds, qint32 first, qint32 chain)
+{
+    for(qint32 i = first; i < cmds.size(); i++)
+    {
+        cmds[i].setChain(chain);
+    }
+}
+
 
@@ -19,15 +19,53 @@
 #ifndef CSHELLCMD_H
 #define CSHELLCMD_H
 
+#include <QList>
 #include <QString>
 #include <QStringList>
 
+/**
+   @brief A single command to be executed by CShell
+
+   Commands with the same chain ID are executed one after another in
+   the order of the command list. Commands of different chains can run
+   in parallel. A barrier command waits for all commands before it to
+   finish. All commands after it wait for the barrier.
+ */
 class CShellCmd
 {
 public:
     CShellCmd(const QString& cmd, const QStringList& args);
     virtual ~CShellCmd() = default;
 
+    /**
+       @brief Set the chain ID of a range of commands
+
+       @param cmds      the command list
+       @param first     the index of the first command in the list
+       @param chain     the chain ID to set
+     */
+    static void setChain(QList<CShellCmd>& cmds, qint32 first, qint32 chain);
+
+    qint32 getChain() const
+    {
+        return chain;
+    }
+
+    void setChain(qint32 id)
+    {
+        chain = id;
+    }
+
+    bool isBarrier() const
+    {
+        return barrier;
+    }
+
+    void setBarrier(bool yes)
+    {
+        barrier = yes;
+    }
+
     const QString& getCmd() const
     {
         return cmd;
@@ -41,6 +79,8 @@ public:
 private:
     QString cmd;
     QStringList args;
+    qint32 chain = 0;
+    bool barrier = false;
 };
 
 #endif //CSHELLCMD_H
@@ -194,6 +194,8 @@ void CToolPalettize::buildCmdFinal(QList<CShellCmd>& cmds)
     args << "--sct" << pctFilename;
     args << vrtFilename;
     cmds << CShellCmd(IAppSetup::self().getQmtrgb2pct(), args);
+    // all files need the color table
+    cmds.last().setBarrier(true);
 
     // ---- command 2..2 + N ----------------------
     if(radioCombined->isChecked())
@@ -219,6 +221,7 @@ void CToolPalettize::buildCmdFinal(QList<CShellCmd>& cmds)
             args << inFilename;
             args << outFilename;
             cmds << CShellCmd(IAppSetup::self().getQmtrgb2pct(), args);
+            cmds.last().setChain(n + 1);
         }
 
         inputFileList2->close();
@@ -229,6 +232,7 @@ void CToolPalettize::buildCmdFinal(QList<CShellCmd>& cmds)
         args << vrtFilename;
         args << "-input_file_list" << inputFileList2->fileName();
         cmds << CShellCmd(IAppSetup::self().getGdalbuildvrt(), args);
+        cmds.last().setBarrier(true);
 
         // ---- command 2 + N + 2 ----------------------
         QString outFilename = lineFilename->text();
@@ -276,6 +280,7 @@ void CToolPalettize::buildCmdFinal(QList<CShellCmd>& cmds)
             QString outFilename = fi.absoluteDir().absoluteFilePath(fi.completeBaseName() + lineSuffix->text() + "." + fi.suffix());
 
             // ---- command n*3 ----------------------
+            const qint32 first = cmds.size();
             args.clear();
             args << "--pct" << pctFilename;
             args << inFilename;
@@ -296,6 +301,9 @@ void CToolPalettize::buildCmdFinal(QList<CShellCmd>& cmds)
 
             // ---- command n*3 + 2 ----------------------
             groupOverviews->buildCmd(cmds, lastOutFilname, "nearest");
+
+            // the commands of each file can run in parallel to the others
+            CShellCmd::setChain(cmds, first, n + 1);
         }
     }
 }
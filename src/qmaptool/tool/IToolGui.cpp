@@ -55,6 +55,7 @@ bool IToolGui::finished(qint32 id)
 void IToolGui::start(CItemTreeWidget* itemTree)
 {
     QList<CShellCmd> cmds;
+    qint32 chain = 0;
     const int N = itemTree->topLevelItemCount();
     for(int n = 0; n < N; n++)
     {
@@ -69,12 +70,21 @@ void IToolGui::start(CItemTreeWidget* itemTree)
             IItem* item = dynamic_cast<IItem*>(layer->child(m));
             if(nullptr != item)
             {
+                // the commands of each file can run in parallel to the others
+                const qint32 first = cmds.size();
                 buildCmd(cmds, item);
+                CShellCmd::setChain(cmds, first, ++chain);
             }
         }
     }
 
+    // the final commands have to wait for the commands of all files
+    const qint32 first = cmds.size();
     buildCmdFinal(cmds);
+    if(first < cmds.size())
+    {
+        cmds[first].setBarrier(true);
+    }
 
     jobId = CShell::self().execute(cmds);
 }
@@ -82,6 +92,7 @@ void IToolGui::start(CItemTreeWidget* itemTree)
 void IToolGui::start(CItemListWidget* itemList, bool allFiles)
 {
     QList<CShellCmd> cmds;
+    qint32 chain = 0;
 
     if(allFiles)
     {
@@ -91,7 +102,10 @@ void IToolGui::start(CItemListWidget* itemList, bool allFiles)
             const IItem* item = dynamic_cast<const IItem*>(itemList->item(n));
             if(nullptr != item)
             {
+                // the commands of each file can run in parallel to the others
+                const qint32 first = cmds.size();
                 buildCmd(cmds, item);
+                CShellCmd::setChain(cmds, first, ++chain);
             }
         }
     }
@@ -104,7 +118,13 @@ void IToolGui::start(CItemListWidget* itemList, bool allFiles)
         }
     }
 
+    // the final commands have to wait for the commands of all files
+    const qint32 first = cmds.size();
     buildCmdFinal(cmds);
+    if(first < cmds.size())
+    {
+        cmds[first].setBarrier(true);
+    }
 
     jobId = CShell::self().execute(cmds);
 }
@@ -32,8 +32,14 @@
 #include <wctype.h>
 
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <list>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <gdal_priv.h>
@@ -165,14 +171,63 @@ static std::list<file_t> files;
 static jnx_hdr_t jnx_hdr;
 /// the tile information table for all 5 levels
 static jnx_tile_t tileTable[JNX_MAX_TILES * 5];
-/// tile buffer for 8 bit palette tiles, private to readTile
-static uint8_t tileBuf8Bit[JNX_MAX_TILE_SIZE * JNX_MAX_TILE_SIZE] = {0};
-/// tile buffer for 24 bit raw RGB tiles, private to writeTile
-static uint8_t tileBuf24Bit[JNX_MAX_TILE_SIZE * JNX_MAX_TILE_SIZE * 3] = {0};
-/// tile buffer for 32 bit raw RGBA tiles
-static uint32_t tileBuf32Bit[JNX_MAX_TILE_SIZE * JNX_MAX_TILE_SIZE] = {0};
-/// internal jpeg buffer used by write tile.
-static std::vector<JOCTET> jpgbuf;
+
+/// a tile to be read from an input file and encoded by one of the worker threads
+struct job_t
+{
+    file_t* file = nullptr;
+    uint32_t xoff = 0;
+    uint32_t yoff = 0;
+    uint32_t xsize = 0;
+    uint32_t ysize = 0;
+
+    /// the JPEG coded tile, written by the worker, consumed by the writer
+    std::vector<JOCTET> jpg;
+    bool done = false;
+    bool error = false;
+};
+
+/// all data private to a worker thread
+struct worker_t
+{
+    worker_t()
+        : tileBuf8Bit(JNX_MAX_TILE_SIZE * JNX_MAX_TILE_SIZE)
+        , tileBuf24Bit(JNX_MAX_TILE_SIZE * JNX_MAX_TILE_SIZE * 3)
+        , tileBuf32Bit(JNX_MAX_TILE_SIZE * JNX_MAX_TILE_SIZE)
+    {
+    }
+
+    /// GDAL datasets must not be shared between threads. Each worker opens the input files again.
+    std::map<const file_t*, GDALDataset*> datasets;
+    /// tile buffer for 8 bit palette tiles, private to readTile
+    std::vector<uint8_t> tileBuf8Bit;
+    /// tile buffer for 24 bit raw RGB tiles, private to encodeTile
+    std::vector<uint8_t> tileBuf24Bit;
+    /// tile buffer for 32 bit raw RGBA tiles
+    std::vector<uint32_t> tileBuf32Bit;
+};
+
+/// JPEG destination manager writing to a vector of the calling thread
+struct jpeg_dest_t
+{
+    jpeg_destination_mgr mgr;
+    std::vector<JOCTET>* buffer;
+};
+
+/// all tiles in the order they are written to the output file
+static std::vector<job_t> jobs;
+/// index of the next job to be processed by a worker
+static uint32_t nextJob = 0;
+/// index of the next job to be written to the output file
+static uint32_t nextWrite = 0;
+/// maximum number of encoded tiles waiting to be written
+static uint32_t maxJobsAhead = 0;
+/// controls access to all of the job data above
+static std::mutex mutexJobs;
+/// wakes up the workers if the writer has made room for more tiles
+static std::condition_variable condWorker;
+/// wakes up the writer if a tile is done
+static std::condition_variable condWriter;
 
 static void prinfFileinfo(const file_t& file)
 {
@@ -193,9 +248,25 @@ static void prinfFileinfo(const file_t& file)
     printf("\nreal scale: %f m/px", file.scale);
 }
 
-bool readTile(uint32_t xoff, uint32_t yoff, uint32_t xsize, uint32_t ysize, file_t& file, uint32_t* output)
+static GDALDataset* getDataset(worker_t& worker, const file_t& file)
+{
+    GDALDataset*& dataset = worker.datasets[&file];
+    if(dataset == nullptr)
+    {
+        dataset = (GDALDataset*)GDALOpen(file.filename.c_str(), GA_ReadOnly);
+    }
+    return dataset;
+}
+
+static bool readTile(uint32_t xoff, uint32_t yoff, uint32_t xsize, uint32_t ysize, const file_t& file, worker_t& worker, uint32_t* output)
 {
-    GDALDataset* dataset = file.dataset;
+    GDALDataset* dataset = getDataset(worker, file);
+    if(dataset == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t* tileBuf8Bit = worker.tileBuf8Bit.data();
     int32_t rasterBandCount = dataset->GetRasterCount();
 
     memset(output, -1, sizeof(uint32_t) * xsize * ysize);
@@ -246,6 +317,7 @@ bool readTile(uint32_t xoff, uint32_t yoff, uint32_t xsize, uint32_t ysize, file
 
 static void init_destination(j_compress_ptr cinfo)
 {
+    std::vector<JOCTET>& jpgbuf = *((jpeg_dest_t*)cinfo->dest)->buffer;
     jpgbuf.resize(JPG_BLOCK_SIZE);
     cinfo->dest->next_output_byte = &jpgbuf[0];
     cinfo->dest->free_in_buffer = jpgbuf.size();
@@ -253,6 +325,7 @@ static void init_destination(j_compress_ptr cinfo)
 
 static boolean empty_output_buffer(j_compress_ptr cinfo)
 {
+    std::vector<JOCTET>& jpgbuf = *((jpeg_dest_t*)cinfo->dest)->buffer;
     size_t oldsize = jpgbuf.size();
     jpgbuf.resize(oldsize + JPG_BLOCK_SIZE);
     cinfo->dest->next_output_byte = &jpgbuf[oldsize];
@@ -262,21 +335,23 @@ static boolean empty_output_buffer(j_compress_ptr cinfo)
 
 static void term_destination(j_compress_ptr cinfo)
 {
+    std::vector<JOCTET>& jpgbuf = *((jpeg_dest_t*)cinfo->dest)->buffer;
     jpgbuf.resize(jpgbuf.size() - cinfo->dest->free_in_buffer);
 }
 
 
-static uint32_t writeTile(uint32_t xsize, uint32_t ysize, uint32_t* raw_image, FILE* fid, int quality, int subsampling)
+static void encodeTile(uint32_t xsize, uint32_t ysize, const uint32_t* raw_image, worker_t& worker, std::vector<JOCTET>& jpgbuf, int quality, int subsampling)
 {
-    uint32_t size = 0;
     struct jpeg_compress_struct cinfo;
     struct jpeg_error_mgr jerr;
     JSAMPROW row_pointer[1];
 
-    jpeg_destination_mgr destmgr = {0};
-    destmgr.init_destination = init_destination;
-    destmgr.empty_output_buffer = empty_output_buffer;
-    destmgr.term_destination = term_destination;
+    jpeg_dest_t destmgr = {{0}, &jpgbuf};
+    destmgr.mgr.init_destination = init_destination;
+    destmgr.mgr.empty_output_buffer = empty_output_buffer;
+    destmgr.mgr.term_destination = term_destination;
+
+    uint8_t* tileBuf24Bit = worker.tileBuf24Bit.data();
 
     // convert from RGBA to RGB
     for(uint32_t r = 0; r < ysize; r++)
@@ -293,7 +368,7 @@ static uint32_t writeTile(uint32_t xsize, uint32_t ysize, uint32_t* raw_image, F
     cinfo.err = jpeg_std_error( &jerr );
     jpeg_create_compress(&cinfo);
 
-    cinfo.dest = &destmgr;
+    cinfo.dest = &destmgr.mgr;
     cinfo.image_width = xsize;
     cinfo.image_height = ysize;
     cinfo.input_components = 3;
@@ -355,12 +430,46 @@ static uint32_t writeTile(uint32_t xsize, uint32_t ysize, uint32_t* raw_image, F
     /* similar to read file, clean up after we're done compressing */
     jpeg_finish_compress( &cinfo );
     jpeg_destroy_compress( &cinfo );
+}
+
+/// the worker thread: read and encode tiles in the order of the job list
+static void processTiles(int quality, int subsampling)
+{
+    worker_t worker;
+
+    while(true)
+    {
+        std::unique_lock<std::mutex> lock(mutexJobs);
+        // do not run too far ahead of the writer, each tile can take up to 4MB
+        condWorker.wait(lock, []{
+            return (nextJob >= jobs.size()) || (nextJob < nextWrite + maxJobsAhead);
+        });
+        if(nextJob >= jobs.size())
+        {
+            break;
+        }
+        job_t& job = jobs[nextJob++];
+        lock.unlock();
 
-    // write data to output file
-    size = jpgbuf.size() - 2;
-    fwrite(&jpgbuf[2], size, 1, fid);
+        bool success = readTile(job.xoff, job.yoff, job.xsize, job.ysize, *job.file, worker, worker.tileBuf32Bit.data());
+        if(success)
+        {
+            encodeTile(job.xsize, job.ysize, worker.tileBuf32Bit.data(), worker, job.jpg, quality, subsampling);
+        }
+
+        lock.lock();
+        job.done = true;
+        job.error = !success;
+        condWriter.notify_one();
+    }
 
-    return size;
+    for(const auto& dataset : worker.datasets)
+    {
+        if(dataset.second != nullptr)
+        {
+            GDALClose(dataset.second);
+        }
+    }
 }
 
 static double distance(const double u1, const double v1, const double u2, const double v2)
@@ -523,6 +632,7 @@ int main(int argc, char** argv)
     OGRSpatialReference oSRS;
     int quality = -1;
     int subsampling = -1;
+    int nThreads = std::thread::hardware_concurrency();
 
     const char* copyright = "Unknown";
     const char* subscname = "BirdsEye";
@@ -538,7 +648,7 @@ int main(int argc, char** argv)
 
     if(argc < 2)
     {
-        fprintf(stderr, "\nusage: qmt_map2jnx -q <1..100> -s <411|422|444> -p <0..> -c \"copyright notice\" -m \"BirdsEye\" -n \"Unknown\" -x file1_scale,file2_scale,...,fileN_scale <file1> <file2> ... <fileN> <outputfile>\n");
+        fprintf(stderr, "\nusage: qmt_map2jnx -q <1..100> -s <411|422|444> -p <0..> -c \"copyright notice\" -m \"BirdsEye\" -n \"Unknown\" -x file1_scale,file2_scale,...,fileN_scale -j <1..> <file1> <file2> ... <fileN> <outputfile>\n");
         fprintf(stderr, "\n");
         fprintf(stderr, "  -q The JPEG quality from 1 to 100. Default is 75 \n");
         fprintf(stderr, "  -s The chroma subsampling. Default is 411  \n");
@@ -548,6 +658,7 @@ int main(int argc, char** argv)
         fprintf(stderr, "  -n The map name. Default is \"Unknown\"  \n");
         fprintf(stderr, "  -z The z order (drawing order). Default is 25\n");
         fprintf(stderr, "  -x Override levels scale. Default: autodetect\n");
+        fprintf(stderr, "  -j The number of threads to read and encode tiles. Default is the number of CPU cores\n");
         fprintf(stderr, "\n");
         fprintf(stderr, "\nThe projection of the input files must have the same latitude along");
         fprintf(stderr, "\na pixel row. Mecator and Longitude/Latitude projections match this");
@@ -638,6 +749,12 @@ int main(int argc, char** argv)
                 skip_next_arg = 1;
                 continue;
             }
+            else if (towupper(argv[i][1]) == 'J')
+            {
+                nThreads = atol(argv[i + 1]);
+                skip_next_arg = 1;
+                continue;
+            }
             else if (towupper(argv[i][1]) == 'X')
             {
                 skip_next_arg = 1;
@@ -928,8 +1045,8 @@ int main(int argc, char** argv)
     fwrite(tileTable, sizeof(jnx_tile_t), tilesTotal, fid);
 
     // --------------------------------------------------------------
-    // read tiles from input files and write jpeg coded tiles to output file
-    printf("\n\nStart conversion:\n");
+    // create the list of all tiles and their coordinates in the order they are written
+    jobs.resize(tilesTotal);
     for(int l = 0; l < nLevels; l++)
     {
         level_t& level = levels[l];
@@ -962,12 +1079,12 @@ int main(int argc, char** argv)
                         xsize = (file.width - xoff);
                     }
 
-                    // //
-                    if(!readTile(xoff, yoff, xsize, ysize, file, tileBuf32Bit))
-                    {
-                        fprintf(stderr, "\nError reading tiles from map file\n");
-                        exit(-1);
-                    }
+                    job_t& job = jobs[tileCnt];
+                    job.file = &file;
+                    job.xoff = xoff;
+                    job.yoff = yoff;
+                    job.xsize = xsize;
+                    job.ysize = ysize;
 
                     jnx_tile_t& tile = tileTable[tileCnt++];
                     if(file.proj.isSrcLatLong())
@@ -1001,11 +1118,7 @@ int main(int argc, char** argv)
 
                     tile.width = xsize;
                     tile.height = ysize;
-                    tile.offset = (uint32_t)(ftello(fid) & 0x0FFFFFFFF);
-                    tile.size = writeTile(xsize, ysize, tileBuf32Bit, fid, quality, subsampling);
 
-                    printProgress(tileCnt, tilesTotal);
-                    // //
                     xoff += xsize;
                 }
 
@@ -1014,6 +1127,67 @@ int main(int argc, char** argv)
         }
     }
 
+    // --------------------------------------------------------------
+    // read tiles from input files and jpeg encode them in parallel, write tiles in order to output file
+    if(nThreads < 1)
+    {
+        nThreads = 1;
+    }
+    maxJobsAhead = 4 * nThreads;
+
+    printf("\n\nStart conversion with %i threads:\n", nThreads);
+    const std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    uint64_t bytesTotal = 0;
+
+    std::vector<std::thread> workers;
+    for(int i = 0; i < nThreads; i++)
+    {
+        workers.emplace_back(processTiles, quality, subsampling);
+    }
+
+    for(uint32_t i = 0; i < tilesTotal; i++)
+    {
+        job_t& job = jobs[i];
+        {
+            std::unique_lock<std::mutex> lock(mutexJobs);
+            condWriter.wait(lock, [&job]{
+                return job.done;
+            });
+        }
+
+        if(job.error)
+        {
+            fprintf(stderr, "\nError reading tiles from map file\n");
+            exit(-1);
+        }
+
+        // write data to output file, without the JPEG SOI marker
+        jnx_tile_t& tile = tileTable[i];
+        tile.offset = (uint32_t)(ftello(fid) & 0x0FFFFFFFF);
+        tile.size = job.jpg.size() - 2;
+        fwrite(&job.jpg[2], tile.size, 1, fid);
+        bytesTotal += tile.size;
+
+        // release memory and let the workers go on
+        std::vector<JOCTET>().swap(job.jpg);
+        {
+            std::lock_guard<std::mutex> lock(mutexJobs);
+            nextWrite = i + 1;
+        }
+        condWorker.notify_all();
+
+        printProgress(i + 1, tilesTotal);
+    }
+
+    for(std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+    printf("\n%u tiles, %.1f MB in %.1f s (%.1f tiles/s, %.2f MB/s)\n", tilesTotal, bytesTotal / 1048576.0, seconds,
+           tilesTotal / std::max(seconds, 0.001), bytesTotal / 1048576.0 / std::max(seconds, 0.001));
+
     // terminate output file
     fwrite("BirdsEye", 8, 1, fid);
 
@@ -17,6 +17,7 @@
 **********************************************************************************************/
 
 #include "CApp.h"
+#include "CQuantizer.h"
 
 #include <gdal_alg.h>
 #include <gdal_priv.h>
@@ -40,12 +41,14 @@ void printStderrQString(const QString& str)
 
 
 
-CApp::CApp(qint32 ncolors, const QString& pctFilename, const QString& sctFilename, const QString& srcFilename, const QString& tarFilename)
+CApp::CApp(qint32 ncolors, const QString& pctFilename, const QString& sctFilename, const QString& srcFilename, const QString& tarFilename, bool useGdal, qint32 nThreads)
     : ncolors(ncolors)
     , pctFilename(pctFilename)
     , sctFilename(sctFilename)
     , srcFilename(srcFilename)
     , tarFilename(tarFilename)
+    , useGdal(useGdal)
+    , nThreads(nThreads)
 {
     GDALAllRegister();
 }
@@ -73,9 +76,12 @@ qint32 CApp::exec()
             QFile::remove(tarFilename);
         }
 
-        ct = createColorTable(ncolors, pctFilename, dsSrc);
+        CQuantizer quantizer(nThreads);
+        CQuantizer* native = useGdal ? nullptr : &quantizer;
+
+        ct = createColorTable(ncolors, pctFilename, dsSrc, native);
         saveColorTable(ct, sctFilename);
-        ditherMap(dsSrc, tarFilename, ct);
+        ditherMap(dsSrc, tarFilename, ct, native);
     }
     catch(const QString& msg)
     {
@@ -89,12 +95,17 @@ qint32 CApp::exec()
     return res;
 }
 
-GDALColorTable* CApp::createColorTable(qint32 ncolors, const QString& pctFilename, GDALDataset* dataset)
+GDALColorTable* CApp::createColorTable(qint32 ncolors, const QString& pctFilename, GDALDataset* dataset, CQuantizer* quantizer)
 {
     GDALColorTable* ct = nullptr;
     try
     {
-        if(pctFilename.isEmpty())
+        if(pctFilename.isEmpty() && (quantizer != nullptr))
+        {
+            printStdoutQString(tr("Calculate optimal color table from source file"));
+            ct = quantizer->createColorTable(dataset, ncolors);
+        }
+        else if(pctFilename.isEmpty())
         {
             ct = (GDALColorTable*)GDALCreateColorTable(GPI_RGB);
 
@@ -177,7 +188,7 @@ void CApp::saveColorTable(GDALColorTable* ct, QString& sctFilename)
     GDALClose(dataset);
 }
 
-void CApp::ditherMap(GDALDataset* dsSrc, const QString& tarFilename, GDALColorTable* ct)
+void CApp::ditherMap(GDALDataset* dsSrc, const QString& tarFilename, GDALColorTable* ct, CQuantizer* quantizer)
 {
     if(tarFilename.isEmpty())
     {
@@ -212,6 +223,15 @@ void CApp::ditherMap(GDALDataset* dsSrc, const QString& tarFilename, GDALColorTa
         dataset->SetGeoTransform(adfGeoTransform);
 
         printStdoutQString(tr("Dither source file to target file"));
+        if(quantizer != nullptr)
+        {
+            // the alpha channel is applied, too
+            quantizer->dither(dsSrc, dataset->GetRasterBand(1), ct);
+            dataset->FlushCache();
+            GDALClose(dataset);
+            return;
+        }
+
         int res = GDALDitherRGB2PCT(dsSrc->GetRasterBand(1),
                                     dsSrc->GetRasterBand(2),
                                     dsSrc->GetRasterBand(3),
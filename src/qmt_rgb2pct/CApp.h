@@ -22,6 +22,7 @@
 #include <gdal.h>
 #include <QtCore>
 
+class CQuantizer;
 class GDALColorTable;
 class GDALDataset;
 
@@ -29,21 +30,25 @@ class CApp
 {
     Q_DECLARE_TR_FUNCTIONS(CApp)
 public:
-    CApp(qint32 ncolors, const QString& pctFilename, const QString& sctFilename, const QString& srcFilename, const QString& tarFilename);
+    CApp(qint32 ncolors, const QString& pctFilename, const QString& sctFilename, const QString& srcFilename, const QString& tarFilename, bool useGdal, qint32 nThreads);
     virtual ~CApp() = default;
 
     qint32 exec();
 
 private:
-    static GDALColorTable* createColorTable(qint32 ncolors, const QString& pctFilename, GDALDataset* dataset);
+    /// create the color table with the native quantizer or with GDAL if quantizer is a nullptr
+    static GDALColorTable* createColorTable(qint32 ncolors, const QString& pctFilename, GDALDataset* dataset, CQuantizer* quantizer);
     static void saveColorTable(GDALColorTable* ct, QString& sctFilename);
-    static void ditherMap(GDALDataset* dsSrc, const QString& tarFilename, GDALColorTable* ct);
+    /// dither the map with the native quantizer or with GDAL if quantizer is a nullptr
+    static void ditherMap(GDALDataset* dsSrc, const QString& tarFilename, GDALColorTable* ct, CQuantizer* quantizer);
 
     qint32 ncolors = 0;
     QString pctFilename;
     QString sctFilename;
     QString srcFilename;
     QString tarFilename;
+    bool useGdal = false;
+    qint32 nThreads = 1;
 
     static const GDALColorEntry noColor;
 };
@@ -0,0 +1,456 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "CQuantizer.h"
+
+#include <gdal_priv.h>
+#include <QtConcurrent>
+
+/// number of pixels to sample for the color histogram
+#define SAMPLE_PIXELS   (4 * 1024 * 1024)
+/// iterations to refine the median cut palette
+#define KMEANS_ITERATIONS 4
+/// rows to dither above a band to hide the seam
+#define OVERLAP         16
+/// approximate memory for a chunk of bands in bytes
+#define CHUNK_BYTES     (128 * 1024 * 1024)
+
+/// 5 bit per channel for the histogram
+#define HIST_IDX(r, g, b) (((r) << 10) | ((g) << 5) | (b))
+/// 6 bit per channel for the inverse color table
+#define INV_IDX(r, g, b) ((((r) >> 2) << 12) | (((g) >> 2) << 6) | ((b) >> 2))
+
+static inline qint32 colorDistance(qint32 r, qint32 g, qint32 b, const CQuantizer::color_t& color)
+{
+    const qint32 dr = r - color.red;
+    const qint32 dg = g - color.green;
+    const qint32 db = b - color.blue;
+    return dr * dr + dg * dg + db * db;
+}
+
+CQuantizer::CQuantizer(qint32 nThreads)
+    : nThreads(qMax(1, nThreads))
+{
+    QThreadPool::globalInstance()->setMaxThreadCount(this->nThreads);
+}
+
+void CQuantizer::readSample(GDALDataset* dataset, QVector<bin_t>& histogram)
+{
+    const qint32 xsize = dataset->GetRasterXSize();
+    const qint32 ysize = dataset->GetRasterYSize();
+
+    // read a decimated copy of the raster, GDAL will use overviews if there are any
+    const qreal step = qMax(1.0, qSqrt(qreal(xsize) * ysize / SAMPLE_PIXELS));
+    const qint32 bx = qMax(1, qRound(xsize / step));
+    const qint32 by = qMax(1, qRound(ysize / step));
+
+    int bandMap[4] = {1, 2, 3, 4};
+    QVector<quint8> rgba(bx * by * 4, 255);
+    CPLErr err = dataset->RasterIO(GF_Read, 0, 0, xsize, ysize, rgba.data(), bx, by, GDT_Byte,
+                                   qMin(dataset->GetRasterCount(), 4), bandMap, 4, 4 * bx, 1, nullptr);
+    if(err != CE_None)
+    {
+        throw tr("Failed to read from source file.");
+    }
+
+    const quint8* px = rgba.data();
+    for(qint32 i = 0; i < bx * by; i++, px += 4)
+    {
+        if(px[3] != 255)
+        {
+            continue;
+        }
+
+        bin_t& bin = histogram[HIST_IDX(px[0] >> 3, px[1] >> 3, px[2] >> 3)];
+        bin.count++;
+        bin.red += px[0];
+        bin.green += px[1];
+        bin.blue += px[2];
+    }
+}
+
+void CQuantizer::shrinkBox(const QVector<bin_t>& histogram, box_t& box)
+{
+    qint32 lo[3] = {31, 31, 31};
+    qint32 hi[3] = {0, 0, 0};
+    box.count = 0;
+
+    for(qint32 r = box.lo[0]; r <= box.hi[0]; r++)
+    {
+        for(qint32 g = box.lo[1]; g <= box.hi[1]; g++)
+        {
+            for(qint32 b = box.lo[2]; b <= box.hi[2]; b++)
+            {
+                const bin_t& bin = histogram[HIST_IDX(r, g, b)];
+                if(bin.count == 0)
+                {
+                    continue;
+                }
+
+                box.count += bin.count;
+                lo[0] = qMin(lo[0], r);
+                lo[1] = qMin(lo[1], g);
+                lo[2] = qMin(lo[2], b);
+                hi[0] = qMax(hi[0], r);
+                hi[1] = qMax(hi[1], g);
+                hi[2] = qMax(hi[2], b);
+            }
+        }
+    }
+
+    if(box.count)
+    {
+        memcpy(box.lo, lo, sizeof(lo));
+        memcpy(box.hi, hi, sizeof(hi));
+    }
+}
+
+void CQuantizer::refinePalette(const QVector<bin_t>& histogram, QVector<color_t>& palette)
+{
+    // k-means on the mean colors of all used histogram bins
+    QVector<const bin_t*> bins;
+    for(const bin_t& bin : histogram)
+    {
+        if(bin.count)
+        {
+            bins << &bin;
+        }
+    }
+
+    for(qint32 i = 0; i < KMEANS_ITERATIONS; i++)
+    {
+        QVector<bin_t> clusters(palette.size());
+        for(const bin_t* bin : qAsConst(bins))
+        {
+            const qint32 r = bin->red / bin->count;
+            const qint32 g = bin->green / bin->count;
+            const qint32 b = bin->blue / bin->count;
+
+            qint32 best = 0;
+            qint32 min = INT_MAX;
+            for(qint32 n = 0; n < palette.size(); n++)
+            {
+                const qint32 d = colorDistance(r, g, b, palette[n]);
+                if(d < min)
+                {
+                    min = d;
+                    best = n;
+                }
+            }
+
+            bin_t& cluster = clusters[best];
+            cluster.count += bin->count;
+            cluster.red += bin->red;
+            cluster.green += bin->green;
+            cluster.blue += bin->blue;
+        }
+
+        for(qint32 n = 0; n < palette.size(); n++)
+        {
+            const bin_t& cluster = clusters[n];
+            if(cluster.count)
+            {
+                palette[n] = color_t(cluster.red / cluster.count, cluster.green / cluster.count, cluster.blue / cluster.count);
+            }
+        }
+    }
+}
+
+GDALColorTable* CQuantizer::createColorTable(GDALDataset* dataset, qint32 ncolors)
+{
+    QVector<bin_t> histogram(1 << 15);
+    readSample(dataset, histogram);
+
+    // median cut: split the most populated box at the median of it's longest side
+    QList<box_t> boxes;
+    box_t root;
+    root.lo[0] = root.lo[1] = root.lo[2] = 0;
+    root.hi[0] = root.hi[1] = root.hi[2] = 31;
+    shrinkBox(histogram, root);
+    if(root.count == 0)
+    {
+        throw tr("Source file has no opaque pixels.");
+    }
+    boxes << root;
+
+    while(boxes.size() < ncolors)
+    {
+        qint32 best = -1;
+        quint64 max = 0;
+        for(qint32 i = 0; i < boxes.size(); i++)
+        {
+            const box_t& candidate = boxes[i];
+            const bool canSplit = (candidate.hi[0] > candidate.lo[0]) || (candidate.hi[1] > candidate.lo[1]) || (candidate.hi[2] > candidate.lo[2]);
+            if(canSplit && (candidate.count > max))
+            {
+                max = candidate.count;
+                best = i;
+            }
+        }
+
+        if(best < 0)
+        {
+            // less colors in the image than requested
+            break;
+        }
+
+        box_t box1 = boxes.takeAt(best);
+
+        qint32 axis = 0;
+        for(qint32 a = 1; a < 3; a++)
+        {
+            if((box1.hi[a] - box1.lo[a]) > (box1.hi[axis] - box1.lo[axis]))
+            {
+                axis = a;
+            }
+        }
+
+        quint64 slices[32] = {0};
+        for(qint32 r = box1.lo[0]; r <= box1.hi[0]; r++)
+        {
+            for(qint32 g = box1.lo[1]; g <= box1.hi[1]; g++)
+            {
+                for(qint32 b = box1.lo[2]; b <= box1.hi[2]; b++)
+                {
+                    const qint32 v[3] = {r, g, b};
+                    slices[v[axis]] += histogram[HIST_IDX(r, g, b)].count;
+                }
+            }
+        }
+
+        quint64 sum = 0;
+        qint32 cut = box1.lo[axis];
+        for(; cut < box1.hi[axis] - 1; cut++)
+        {
+            sum += slices[cut];
+            if(sum >= box1.count / 2)
+            {
+                break;
+            }
+        }
+
+        box_t box2 = box1;
+        box1.hi[axis] = cut;
+        box2.lo[axis] = cut + 1;
+        shrinkBox(histogram, box1);
+        shrinkBox(histogram, box2);
+        boxes << box1 << box2;
+    }
+
+    QVector<color_t> palette;
+    for(const box_t& box : qAsConst(boxes))
+    {
+        bin_t mean;
+        for(qint32 r = box.lo[0]; r <= box.hi[0]; r++)
+        {
+            for(qint32 g = box.lo[1]; g <= box.hi[1]; g++)
+            {
+                for(qint32 b = box.lo[2]; b <= box.hi[2]; b++)
+                {
+                    const bin_t& bin = histogram[HIST_IDX(r, g, b)];
+                    mean.count += bin.count;
+                    mean.red += bin.red;
+                    mean.green += bin.green;
+                    mean.blue += bin.blue;
+                }
+            }
+        }
+        palette << color_t(mean.red / mean.count, mean.green / mean.count, mean.blue / mean.count);
+    }
+
+    refinePalette(histogram, palette);
+
+    GDALColorTable* ct = new GDALColorTable(GPI_RGB);
+    for(qint32 i = 0; i < palette.size(); i++)
+    {
+        GDALColorEntry entry;
+        entry.c1 = palette[i].red;
+        entry.c2 = palette[i].green;
+        entry.c3 = palette[i].blue;
+        entry.c4 = 255;
+        ct->SetColorEntry(i, &entry);
+    }
+
+    return ct;
+}
+
+void CQuantizer::buildInverseTable(const GDALColorTable* ct)
+{
+    palette.clear();
+    for(qint32 i = 0; i < ct->GetColorEntryCount(); i++)
+    {
+        const GDALColorEntry* entry = ct->GetColorEntry(i);
+        palette << color_t(entry->c1, entry->c2, entry->c3);
+    }
+    nodata = palette.size();
+
+    if(palette.isEmpty())
+    {
+        throw tr("The color table is empty.");
+    }
+
+    // the nearest palette color for the center of each 6 bit color cell
+    inverse.resize(1 << 18);
+    QVector<qint32> reds;
+    for(qint32 r = 0; r < 64; r++)
+    {
+        reds << r;
+    }
+
+    quint8* table = inverse.data();
+    const QVector<color_t>& palette = this->palette;
+    QtConcurrent::blockingMap(reds, [table, &palette](qint32& red)
+    {
+        const qint32 r = (red << 2) + 2;
+        for(qint32 g = 2; g < 256; g += 4)
+        {
+            for(qint32 b = 2; b < 256; b += 4)
+            {
+                qint32 best = 0;
+                qint32 min = INT_MAX;
+                for(qint32 n = 0; n < palette.size(); n++)
+                {
+                    const qint32 d = colorDistance(r, g, b, palette[n]);
+                    if(d < min)
+                    {
+                        min = d;
+                        best = n;
+                    }
+                }
+                table[INV_IDX(r, g, b)] = best;
+            }
+        }
+    });
+}
+
+void CQuantizer::ditherBand(const quint8* rgba, qint32 rowOffset, qint32 xsize, const band_t& band, quint8* output, qint32 outRowOffset) const
+{
+    // errors of the current and the next row, scaled by 16, one extra pixel on both sides
+    const qint32 w = (xsize + 2) * 3;
+    QVector<qint32> errors(2 * w, 0);
+    qint32* errCur = errors.data();
+    qint32* errNext = errCur + w;
+
+    for(qint32 y = band.y0; y < band.y2; y++)
+    {
+        const quint8* row = rgba + qint64(y - rowOffset) * xsize * 4;
+        quint8* out = y >= band.y1 ? output + qint64(y - outRowOffset) * xsize : nullptr;
+
+        memset(errNext, 0, w * sizeof(qint32));
+
+        // serpentine scan
+        const qint32 dir = (y & 1) ? -1 : 1;
+        qint32 x = dir > 0 ? 0 : xsize - 1;
+        for(qint32 n = 0; n < xsize; n++, x += dir)
+        {
+            const quint8* px = row + x * 4;
+            if(px[3] != 255)
+            {
+                if(out != nullptr)
+                {
+                    out[x] = nodata;
+                }
+                continue;
+            }
+
+            const qint32* err = errCur + (x + 1) * 3;
+            const qint32 r = qBound(0, px[0] + err[0] / 16, 255);
+            const qint32 g = qBound(0, px[1] + err[1] / 16, 255);
+            const qint32 b = qBound(0, px[2] + err[2] / 16, 255);
+
+            const quint8 idx = inverse[INV_IDX(r, g, b)];
+            if(out != nullptr)
+            {
+                out[x] = idx;
+            }
+
+            const color_t& color = palette[idx];
+            const qint32 e[3] = {r - color.red, g - color.green, b - color.blue};
+
+            qint32* ahead = errCur + (x + 1 + dir) * 3;
+            qint32* belowBehind = errNext + (x + 1 - dir) * 3;
+            qint32* below = errNext + (x + 1) * 3;
+            qint32* belowAhead = errNext + (x + 1 + dir) * 3;
+            for(qint32 c = 0; c < 3; c++)
+            {
+                ahead[c] += e[c] * 7;
+                belowBehind[c] += e[c] * 3;
+                below[c] += e[c] * 5;
+                belowAhead[c] += e[c];
+            }
+        }
+
+        qSwap(errCur, errNext);
+    }
+}
+
+void CQuantizer::dither(GDALDataset* dsSrc, GDALRasterBand* target, const GDALColorTable* ct)
+{
+    buildInverseTable(ct);
+
+    const qint32 xsize = dsSrc->GetRasterXSize();
+    const qint32 ysize = dsSrc->GetRasterYSize();
+    const qint32 bandHeight = qBound(32, qint32(CHUNK_BYTES / (qint64(xsize) * 5 * nThreads)), 1024);
+    const qint32 chunkHeight = bandHeight * nThreads;
+
+    // the alpha channel is 255 if there is none
+    int bandMap[4] = {1, 2, 3, 4};
+    const qint32 nBands = qMin(dsSrc->GetRasterCount(), 4);
+    QVector<quint8> rgba(qint64(xsize) * (chunkHeight + OVERLAP) * 4, 255);
+    QVector<quint8> output(qint64(xsize) * chunkHeight, 0);
+
+    GDALTermProgress(0.0, nullptr, nullptr);
+    for(qint32 chunkStart = 0; chunkStart < ysize; chunkStart += chunkHeight)
+    {
+        const qint32 chunkEnd = qMin(ysize, chunkStart + chunkHeight);
+        const qint32 readStart = qMax(0, chunkStart - OVERLAP);
+        const qint32 rows = chunkEnd - readStart;
+
+        CPLErr err = dsSrc->RasterIO(GF_Read, 0, readStart, xsize, rows, rgba.data(), xsize, rows, GDT_Byte,
+                                     nBands, bandMap, 4, 4 * xsize, 1, nullptr);
+        if(err != CE_None)
+        {
+            throw tr("Failed to read from source file.");
+        }
+
+        QVector<band_t> bands;
+        for(qint32 y = chunkStart; y < chunkEnd; y += bandHeight)
+        {
+            band_t band;
+            band.y0 = qMax(readStart, y - OVERLAP);
+            band.y1 = y;
+            band.y2 = qMin(chunkEnd, y + bandHeight);
+            bands << band;
+        }
+
+        const quint8* src = rgba.constData();
+        quint8* dst = output.data();
+        QtConcurrent::blockingMap(bands, [&](band_t& band)
+        {
+            ditherBand(src, readStart, xsize, band, dst, chunkStart);
+        });
+
+        err = target->RasterIO(GF_Write, 0, chunkStart, xsize, chunkEnd - chunkStart, output.data(), xsize, chunkEnd - chunkStart, GDT_Byte, 0, 0, nullptr);
+        if(err != CE_None)
+        {
+            throw tr("Failed to write to target file.");
+        }
+
+        GDALTermProgress(double(chunkEnd) / ysize, nullptr, nullptr);
+    }
+}
@@ -0,0 +1,104 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef CQUANTIZER_H
+#define CQUANTIZER_H
+
+#include <gdal.h>
+#include <QtCore>
+
+class GDALColorTable;
+class GDALDataset;
+class GDALRasterBand;
+
+/**
+   @brief Native color reduction of RGB(A) rasters
+
+   The color table is calculated by a median cut on a 15 bit color histogram of a
+   sample of the source raster. The result is refined by a few iterations of k-means.
+
+   The raster is dithered by a serpentine Floyd-Steinberg error diffusion. The nearest
+   palette color is taken from an inverse color table with 6 bit per channel. The raster
+   is read in chunks of horizontal bands. The bands of a chunk are dithered in parallel.
+   To hide the seams each band starts dithering a few rows above it's first row.
+
+   Pixels with an alpha value less than 255 are set to the no data index, that is
+   the size of the color table.
+
+   All methods throw a QString on errors.
+ */
+class CQuantizer
+{
+    Q_DECLARE_TR_FUNCTIONS(CQuantizer)
+public:
+    CQuantizer(qint32 nThreads);
+    virtual ~CQuantizer() = default;
+
+    struct color_t
+    {
+        color_t() = default;
+        color_t(qint32 red, qint32 green, qint32 blue) : red(red), green(green), blue(blue)
+        {
+        }
+        qint32 red = 0;
+        qint32 green = 0;
+        qint32 blue = 0;
+    };
+
+    GDALColorTable* createColorTable(GDALDataset* dataset, qint32 ncolors);
+    void dither(GDALDataset* dsSrc, GDALRasterBand* target, const GDALColorTable* ct);
+
+private:
+    struct bin_t
+    {
+        quint64 count = 0;
+        quint64 red = 0;
+        quint64 green = 0;
+        quint64 blue = 0;
+    };
+
+    struct box_t
+    {
+        qint32 lo[3];
+        qint32 hi[3];
+        quint64 count = 0;
+    };
+
+    struct band_t
+    {
+        /// first row to dither, above y1 to hide the seam
+        qint32 y0;
+        /// first row to write
+        qint32 y1;
+        /// the row after the last row
+        qint32 y2;
+    };
+
+    void readSample(GDALDataset* dataset, QVector<bin_t>& histogram);
+    void shrinkBox(const QVector<bin_t>& histogram, box_t& box);
+    void refinePalette(const QVector<bin_t>& histogram, QVector<color_t>& palette);
+    void buildInverseTable(const GDALColorTable* ct);
+    void ditherBand(const quint8* rgba, qint32 rowOffset, qint32 xsize, const band_t& band, quint8* output, qint32 outRowOffset) const;
+
+    qint32 nThreads;
+    QVector<color_t> palette;
+    QVector<quint8> inverse;
+    quint8 nodata = 0;
+};
+
+#endif //CQUANTIZER_H
@@ -108,6 +108,12 @@ int main(int argc, char** argv)
         {
             {"s", "sct"}, QCoreApplication::translate("main", "Save color table to palette file (*.vrt)"), "filename", ""
         },
+        {
+            {"j", "threads"}, QCoreApplication::translate("main", "Number of threads. (default: number of CPU cores)"), "number", QString::number(QThread::idealThreadCount())
+        },
+        {
+            {"g", "gdal"}, QCoreApplication::translate("main", "Use GDAL's median cut and dithering instead of the native ones.")
+        },
     });
 
     // Process the actual command line arguments given by the user
@@ -144,10 +150,19 @@ int main(int argc, char** argv)
         parser.showHelp(-1);
     }
 
+    const qint32 nThreads = parser.value("threads").toInt(&ok);
+    if(!ok || nThreads < 1)
+    {
+        printStderrQString("");
+        printStderrQString(QCoreApplication::translate("main", "--threads must be an integer value greater than 0"));
+        printStderrQString("");
+        parser.showHelp(-1);
+    }
+
     QString pctFilename = parser.value("pct");
     QString sctFilename = parser.value("sct");
 
-    CApp theApp(ncolors, pctFilename, sctFilename, srcFilename, tarFilename);
+    CApp theApp(ncolors, pctFilename, sctFilename, srcFilename, tarFilename, parser.isSet("gdal"), nThreads);
     return theApp.exec();
 }
 
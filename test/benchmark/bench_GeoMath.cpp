@@ -0,0 +1,139 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "bench_GeoMath.h"
+#include "gis/GeoMath.h"
+
+#include <QRandomGenerator>
+#include <QTest>
+#include <QtCore>
+
+#define BENCH_NUM_POINTS 1000000
+
+/// a random walk with about 2m between the points, as recorded by a GPS device
+static QVector<pointDP> createLine(qint32 size)
+{
+    QVector<pointDP> line;
+    line.reserve(size);
+
+    // a fixed seed to compare the results of several runs
+    QRandomGenerator rnd(1);
+    qreal x = 0, y = 0, z = 500;
+    for(qint32 i = 0; i < size; i++)
+    {
+        x += 1 + rnd.bounded(3);
+        y += (rnd.bounded(100) - 50) / 10.0;
+        z += (rnd.bounded(10) - 5) / 10.0;
+        line << pointDP(x, y, z);
+    }
+
+    return line;
+}
+
+static qreal distPointLine3D(const point3D& x1, const point3D& x2, const point3D& x0)
+{
+    const qreal v1x = x0.x - x1.x, v1y = x0.y - x1.y, v1z = x0.z - x1.z;
+    const qreal v2x = x0.x - x2.x, v2y = x0.y - x2.y, v2z = x0.z - x2.z;
+    const qreal v3x = x2.x - x1.x, v3y = x2.y - x1.y, v3z = x2.z - x1.z;
+
+    const qreal cx = v1y * v2z - v1z * v2y;
+    const qreal cy = v1z * v2x - v1x * v2z;
+    const qreal cz = v1x * v2y - v1y * v2x;
+
+    return qSqrt((cx * cx + cy * cy + cz * cz) / (v3x * v3x + v3y * v3y + v3z * v3z));
+}
+
+static qint32 countUsed(const QVector<pointDP>& line)
+{
+    qint32 cnt = 0;
+    for(const pointDP& pt : line)
+    {
+        cnt += pt.used ? 1 : 0;
+    }
+    return cnt;
+}
+
+void bench_GeoMath::benchDouglasPeucker()
+{
+    const qreal d = 5.0;
+    QVector<pointDP> line = createLine(BENCH_NUM_POINTS);
+
+    QBENCHMARK_ONCE
+    {
+        GPS_Math_DouglasPeucker(line, d);
+    }
+
+    QVERIFY2(line.first().used && line.last().used, "Douglas Peucker removed the end points");
+
+    // all removed points have to be closer than d to the line between the remaining points
+    qint32 last = 0;
+    for(qint32 i = 1; i < line.size(); i++)
+    {
+        if(!line[i].used)
+        {
+            continue;
+        }
+
+        for(qint32 n = last + 1; n < i; n++)
+        {
+            QVERIFY2(distPointLine3D(line[last], line[i], line[n]) <= d, qPrintable(QString("Douglas Peucker removed point %1 too far from the line").arg(n)));
+        }
+        last = i;
+    }
+
+    QVERIFY2(countUsed(line) < line.size() / 2, "Douglas Peucker did not reduce the line");
+}
+
+void bench_GeoMath::benchVisvalingamWhyatt()
+{
+    const qreal area = 50.0;
+    QVector<pointDP> line = createLine(BENCH_NUM_POINTS);
+
+    QBENCHMARK_ONCE
+    {
+        GPS_Math_VisvalingamWhyatt(line, area);
+    }
+
+    QVERIFY2(line.first().used && line.last().used, "Visvalingam Whyatt removed the end points");
+
+    // each remaining inner point spans a triangle of at least the given area with it's neighbours
+    for(qint32 i = 1, prev = 0; i < line.size() - 1; i++)
+    {
+        if(!line[i].used)
+        {
+            continue;
+        }
+
+        qint32 next = i + 1;
+        while(!line[next].used)
+        {
+            next++;
+        }
+
+        const qreal base = qSqrt((line[next].x - line[prev].x) * (line[next].x - line[prev].x)
+                                 + (line[next].y - line[prev].y) * (line[next].y - line[prev].y)
+                                 + (line[next].z - line[prev].z) * (line[next].z - line[prev].z));
+        const qreal a = 0.5 * base * distPointLine3D(line[prev], line[next], line[i]);
+        QVERIFY2(a >= area * (1 - 1e-9), qPrintable(QString("Visvalingam Whyatt kept point %1 with a too small area").arg(i)));
+        prev = i;
+    }
+
+    QVERIFY2(countUsed(line) < line.size() / 2, "Visvalingam Whyatt did not reduce the line");
+}
+
+QTEST_GUILESS_MAIN(bench_GeoMath)
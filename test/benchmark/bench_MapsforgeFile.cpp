@@ -0,0 +1,178 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#include "bench_MapsforgeFile.h"
+#include "map/mapsforge/CMapsforgeFile.h"
+
+#include <QtConcurrent>
+#include <QTest>
+#include <QtCore>
+
+/// the number of tiles in each direction around the map's center to decode
+#define BENCH_NUM_TILES 16
+
+struct tileref_t
+{
+    quint32 x;
+    quint32 y;
+    QSharedPointer<CMapsforgeFile::tile_t> tile;
+};
+
+/// the tiles of a layer around the center of the map, like a large viewport
+static QVector<tileref_t> collectTiles(const CMapsforgeFile::layer_t& layer)
+{
+    const quint32 x0 = (layer.tileX1 + layer.tileX2) / 2;
+    const quint32 y0 = (layer.tileY1 + layer.tileY2) / 2;
+    const quint32 x1 = qMax(layer.tileX1, x0 - qMin(x0, quint32(BENCH_NUM_TILES / 2)));
+    const quint32 y1 = qMax(layer.tileY1, y0 - qMin(y0, quint32(BENCH_NUM_TILES / 2)));
+    const quint32 x2 = qMin(layer.tileX2, x1 + BENCH_NUM_TILES - 1);
+    const quint32 y2 = qMin(layer.tileY2, y1 + BENCH_NUM_TILES - 1);
+
+    QVector<tileref_t> tiles;
+    for(quint32 y = y1; y <= y2; y++)
+    {
+        for(quint32 x = x1; x <= x2; x++)
+        {
+            tiles << tileref_t {x, y, QSharedPointer<CMapsforgeFile::tile_t>()};
+        }
+    }
+    return tiles;
+}
+
+static qint32 countObjects(const QVector<tileref_t>& tiles)
+{
+    qint32 cnt = 0;
+    for(const tileref_t& ref : tiles)
+    {
+        cnt += ref.tile->nodes.count() + ref.tile->ways.count();
+    }
+    return cnt;
+}
+
+bench_MapsforgeFile::bench_MapsforgeFile(const QString& filename)
+    : filename(filename)
+{
+}
+
+void bench_MapsforgeFile::initTestCase()
+{
+    if(filename.isEmpty() || !QFile::exists(filename))
+    {
+        QSKIP("No map file. Pass a *.map file as first argument or set QMS_BENCH_MAP.");
+    }
+
+    CMapsforgeFile mapFile(filename);
+    try
+    {
+        mapFile.open();
+    }
+    catch(const CMapsforgeFile::exce_t& e)
+    {
+        QFAIL(qPrintable(e.msg));
+    }
+}
+
+void bench_MapsforgeFile::benchOpen()
+{
+    QBENCHMARK
+    {
+        CMapsforgeFile mapFile(filename);
+        mapFile.open();
+    }
+}
+
+void bench_MapsforgeFile::benchDecodeTiles_data()
+{
+    QTest::addColumn<qint32>("idxLayer");
+
+    CMapsforgeFile mapFile(filename);
+    mapFile.open();
+
+    const QList<CMapsforgeFile::layer_t>& layers = mapFile.getLayers();
+    for(qint32 i = 0; i < layers.count(); i++)
+    {
+        const CMapsforgeFile::layer_t& layer = layers[i];
+        QTest::newRow(qPrintable(QString("zoom %1-%2").arg(layer.minZoom).arg(layer.maxZoom))) << i;
+    }
+}
+
+void bench_MapsforgeFile::benchDecodeTiles()
+{
+    QFETCH(qint32, idxLayer);
+
+    CMapsforgeFile mapFile(filename);
+    mapFile.open();
+
+    // the highest zoom level of a sub-file has the most objects
+    const CMapsforgeFile::layer_t& layer = mapFile.getLayers()[idxLayer];
+    QVector<tileref_t> tiles = collectTiles(layer);
+
+    QBENCHMARK
+    {
+        for(tileref_t& ref : tiles)
+        {
+            ref.tile = mapFile.decodeTile(layer, ref.x, ref.y, layer.maxZoom);
+        }
+    }
+
+    qDebug() << "MAP:" << tiles.count() << "tiles with" << countObjects(tiles) << "objects";
+}
+
+void bench_MapsforgeFile::benchDecodeTilesParallel()
+{
+    CMapsforgeFile mapFile(filename);
+    mapFile.open();
+
+    // the same as CMapMAP::draw() does for a large viewport at the highest zoom level
+    const CMapsforgeFile::layer_t& layer = mapFile.getLayers()[mapFile.findLayer(21)];
+    QVector<tileref_t> tiles = collectTiles(layer);
+
+    QBENCHMARK
+    {
+        QtConcurrent::blockingMap(tiles, [&mapFile, &layer](tileref_t& ref)
+        {
+            ref.tile = mapFile.decodeTile(layer, ref.x, ref.y, layer.maxZoom);
+        });
+    }
+
+    // the result must not depend on the threads
+    for(const tileref_t& ref : qAsConst(tiles))
+    {
+        const QSharedPointer<CMapsforgeFile::tile_t>& tile = mapFile.decodeTile(layer, ref.x, ref.y, layer.maxZoom);
+        QCOMPARE(ref.tile->nodes.count(), tile->nodes.count());
+        QCOMPARE(ref.tile->ways.count(), tile->ways.count());
+    }
+
+    qDebug() << "MAP:" << tiles.count() << "tiles with" << countObjects(tiles) << "objects";
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    // the map file is taken from the first argument, all other arguments are passed to QTest
+    QStringList args = app.arguments();
+    QString filename = QString::fromLocal8Bit(qgetenv("QMS_BENCH_MAP"));
+    if(args.count() > 1 && args[1].endsWith(".map", Qt::CaseInsensitive))
+    {
+        filename = args.takeAt(1);
+    }
+
+    bench_MapsforgeFile bench(filename);
+    return QTest::qExec(&bench, args);
+}
@@ -0,0 +1,48 @@
+/**********************************************************************************************
+    Copyright (C) 2021 Oliver Eichler <oliver.eichler@gmx.de>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+**********************************************************************************************/
+
+#ifndef BENCH_MAPSFORGEFILE_H
+#define BENCH_MAPSFORGEFILE_H
+
+#include <QObject>
+
+/**
+   @brief Decoding of a Mapsforge map
+
+   There is no sample map in the tree. The map is taken from the first
+   argument or from the environment variable QMS_BENCH_MAP. Without a
+   map the benchmark is skipped.
+ */
+class bench_MapsforgeFile : public QObject
+{
+    Q_OBJECT
+public:
+    bench_MapsforgeFile(const QString& filename);
+
+private slots:
+    void initTestCase();
+    void benchOpen();
+    void benchDecodeTiles_data();
+    void benchDecodeTiles();
+    void benchDecodeTilesParallel();
+
+private:
+    QString filename;
+};
+
+#endif //BENCH_MAPSFORGEFILE_H